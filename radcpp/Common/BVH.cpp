@@ -0,0 +1,999 @@
+#include "radcpp/Common/BVH.h"
+#include "radcpp/Common/Parallel.h"
+#include "radcpp/Common/Simd.h"
+#include <bit>
+
+BVH::BVH()
+{
+}
+
+BVH::~BVH()
+{
+}
+
+struct BVHBin
+{
+    BoundingBox m_bounds;
+    uint32_t m_count = 0;
+};
+
+struct BVHBuildContext
+{
+    const BoundingBox* m_primBoxes;
+    std::vector<glm::vec3> m_centroids;
+    BVHBuildSettings m_settings;
+    std::vector<BVHNode>* m_nodes;
+    std::vector<uint32_t>* m_primIndices;
+    std::atomic<uint32_t> m_nodeCount;
+};
+
+struct BVHSplit
+{
+    int m_axis = -1;
+    uint32_t m_bin = 0;
+    float m_cost = FLT_MAX;
+};
+
+// Compute the bounds of the primitives and of their centroids, and bin the centroids along each axis.
+static void BinPrimitives(BVHBuildContext& ctx, uint32_t first, uint32_t count,
+    BoundingBox& bounds, BoundingBox& centroidBounds, std::vector<BVHBin>& bins)
+{
+    const uint32_t* primIndices = ctx.m_primIndices->data();
+    const uint32_t binCount = ctx.m_settings.binCount;
+    const bool parallel = (count >= ctx.m_settings.parallelThreshold);
+    const size_t grainSize = std::max<size_t>(ctx.m_settings.parallelThreshold / 2, 1);
+
+    bounds = BoundingBox();
+    centroidBounds = BoundingBox();
+    if (parallel)
+    {
+        std::mutex mutex;
+        ParallelFor(first, first + count, grainSize,
+            [&](size_t begin, size_t end)
+            {
+                BoundingBox localBounds;
+                BoundingBox localCentroidBounds;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    localBounds = Union(localBounds, ctx.m_primBoxes[primIndices[i]]);
+                    localCentroidBounds = Union(localCentroidBounds, ctx.m_centroids[primIndices[i]]);
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                bounds = Union(bounds, localBounds);
+                centroidBounds = Union(centroidBounds, localCentroidBounds);
+            });
+    }
+    else
+    {
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            bounds = Union(bounds, ctx.m_primBoxes[primIndices[i]]);
+            centroidBounds = Union(centroidBounds, ctx.m_centroids[primIndices[i]]);
+        }
+    }
+
+    bins.assign(3 * binCount, BVHBin());
+    const glm::vec3 extent = centroidBounds.Diagonal();
+    const glm::vec3 scale = glm::vec3(
+        (extent.x > 0.0f) ? (binCount * (1.0f - FLT_EPSILON) / extent.x) : 0.0f,
+        (extent.y > 0.0f) ? (binCount * (1.0f - FLT_EPSILON) / extent.y) : 0.0f,
+        (extent.z > 0.0f) ? (binCount * (1.0f - FLT_EPSILON) / extent.z) : 0.0f);
+    auto binRange = [&](size_t begin, size_t end, BVHBin* binsOut)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const uint32_t primIndex = primIndices[i];
+            const glm::vec3 offset = (ctx.m_centroids[primIndex] - centroidBounds.m_minCorner) * scale;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                uint32_t binIndex = std::min(static_cast<uint32_t>(offset[axis]), binCount - 1);
+                BVHBin& bin = binsOut[axis * binCount + binIndex];
+                bin.m_bounds = Union(bin.m_bounds, ctx.m_primBoxes[primIndex]);
+                bin.m_count++;
+            }
+        }
+    };
+
+    if (parallel)
+    {
+        std::mutex mutex;
+        ParallelFor(first, first + count, grainSize,
+            [&](size_t begin, size_t end)
+            {
+                std::vector<BVHBin> localBins(3 * binCount);
+                binRange(begin, end, localBins.data());
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t i = 0; i < bins.size(); ++i)
+                {
+                    bins[i].m_bounds = Union(bins[i].m_bounds, localBins[i].m_bounds);
+                    bins[i].m_count += localBins[i].m_count;
+                }
+            });
+    }
+    else
+    {
+        binRange(first, first + count, bins.data());
+    }
+}
+
+// Sweep the bins of each axis and return the split plane with the lowest SAH cost.
+static BVHSplit FindBestSplit(const BVHBuildContext& ctx, const BoundingBox& bounds, const std::vector<BVHBin>& bins)
+{
+    const uint32_t binCount = ctx.m_settings.binCount;
+    const float area = bounds.SurfaceArea();
+    const float invArea = (area > 0.0f) ? (1.0f / area) : 0.0f;
+
+    BVHSplit best;
+    std::vector<float> rightCosts(binCount);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const BVHBin* axisBins = &bins[axis * binCount];
+        // rightCosts[i] = SA * count of the bins [i, binCount)
+        BoundingBox rightBounds;
+        uint32_t rightCount = 0;
+        for (uint32_t i = binCount - 1; i > 0; --i)
+        {
+            rightBounds = Union(rightBounds, axisBins[i].m_bounds);
+            rightCount += axisBins[i].m_count;
+            rightCosts[i] = (rightCount > 0) ? rightBounds.SurfaceArea() * rightCount : 0.0f;
+        }
+
+        BoundingBox leftBounds;
+        uint32_t leftCount = 0;
+        uint32_t totalCount = rightCount + axisBins[0].m_count;
+        for (uint32_t i = 1; i < binCount; ++i)
+        {
+            leftBounds = Union(leftBounds, axisBins[i - 1].m_bounds);
+            leftCount += axisBins[i - 1].m_count;
+            if ((leftCount == 0) || (leftCount == totalCount))
+            {
+                continue;
+            }
+            float cost = ctx.m_settings.traversalCost +
+                ctx.m_settings.intersectionCost * (leftBounds.SurfaceArea() * leftCount + rightCosts[i]) * invArea;
+            if (cost < best.m_cost)
+            {
+                best.m_axis = axis;
+                best.m_bin = i;
+                best.m_cost = cost;
+            }
+        }
+    }
+    return best;
+}
+
+static void BuildRecursive(BVHBuildContext& ctx, uint32_t nodeIndex, uint32_t first, uint32_t count)
+{
+    BoundingBox bounds;
+    BoundingBox centroidBounds;
+    std::vector<BVHBin> bins;
+    BinPrimitives(ctx, first, count, bounds, centroidBounds, bins);
+
+    BVHNode& node = (*ctx.m_nodes)[nodeIndex];
+    node.m_minCorner = bounds.m_minCorner;
+    node.m_maxCorner = bounds.m_maxCorner;
+    node.m_index = first;
+    node.m_count = count;
+    if (count <= 1)
+    {
+        return;
+    }
+
+    const uint32_t binCount = ctx.m_settings.binCount;
+    const BVHSplit split = FindBestSplit(ctx, bounds, bins);
+    const float leafCost = ctx.m_settings.intersectionCost * count;
+    if ((count <= ctx.m_settings.maxLeafSize) && ((split.m_axis < 0) || (split.m_cost >= leafCost)))
+    {
+        return;
+    }
+
+    uint32_t* primIndices = ctx.m_primIndices->data();
+    uint32_t leftCount = count / 2;
+    if (split.m_axis >= 0)
+    {
+        const int axis = split.m_axis;
+        const float minCentroid = centroidBounds.m_minCorner[axis];
+        const float extent = centroidBounds.m_maxCorner[axis] - minCentroid;
+        const float scale = binCount * (1.0f - FLT_EPSILON) / extent;
+        uint32_t* middle = std::partition(primIndices + first, primIndices + first + count,
+            [&](uint32_t primIndex)
+            {
+                uint32_t binIndex = std::min(
+                    static_cast<uint32_t>((ctx.m_centroids[primIndex][axis] - minCentroid) * scale), binCount - 1);
+                return (binIndex < split.m_bin);
+            });
+        leftCount = static_cast<uint32_t>(middle - (primIndices + first));
+        if ((leftCount == 0) || (leftCount == count))
+        {
+            leftCount = count / 2;
+        }
+    }
+    // else all centroids are at the same point: any split is as good as another.
+
+    const uint32_t childIndex = ctx.m_nodeCount.fetch_add(2);
+    node.m_index = childIndex;
+    node.m_count = 0;
+
+    const uint32_t rightCount = count - leftCount;
+    if (count >= ctx.m_settings.parallelThreshold)
+    {
+        ParallelInvoke(
+            [&]() { BuildRecursive(ctx, childIndex, first, leftCount); },
+            [&]() { BuildRecursive(ctx, childIndex + 1, first + leftCount, rightCount); });
+    }
+    else
+    {
+        BuildRecursive(ctx, childIndex, first, leftCount);
+        BuildRecursive(ctx, childIndex + 1, first + leftCount, rightCount);
+    }
+}
+
+void BVH::Build(const BoundingBox* primBoxes, size_t primCount, const BVHBuildSettings& settings)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    Clear();
+    if (primCount == 0)
+    {
+        return;
+    }
+    assert(primCount < UINT32_MAX / 2);
+
+    BVHBuildContext ctx;
+    ctx.m_primBoxes = primBoxes;
+    ctx.m_settings = settings;
+    ctx.m_settings.binCount = std::max(settings.binCount, 2u);
+    ctx.m_settings.maxLeafSize = std::max(settings.maxLeafSize, 1u);
+    ctx.m_nodes = &m_nodes;
+    ctx.m_primIndices = &m_primIndices;
+    ctx.m_nodeCount = 1;
+
+    ctx.m_centroids.resize(primCount);
+    m_primIndices.resize(primCount);
+    ParallelFor(0, primCount, 64 * 1024,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                ctx.m_centroids[i] = primBoxes[i].GetCenter();
+                m_primIndices[i] = static_cast<uint32_t>(i);
+            }
+        });
+
+    // A binary tree with N leaves has 2N - 1 nodes.
+    m_nodes.resize(2 * primCount - 1);
+    BuildRecursive(ctx, 0, 0, static_cast<uint32_t>(primCount));
+    m_nodes.resize(ctx.m_nodeCount);
+    m_nodes.shrink_to_fit();
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    m_buildTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+}
+
+void BVH::Refit(const BoundingBox* primBoxes)
+{
+    // Children are always allocated after their parents, so a reverse sweep visits children first.
+    for (size_t i = m_nodes.size(); i > 0; --i)
+    {
+        BVHNode& node = m_nodes[i - 1];
+        BoundingBox bounds;
+        if (node.IsLeaf())
+        {
+            for (uint32_t j = node.m_index; j < node.m_index + node.m_count; ++j)
+            {
+                bounds = Union(bounds, primBoxes[m_primIndices[j]]);
+            }
+        }
+        else
+        {
+            bounds = Union(m_nodes[node.m_index].GetBoundingBox(), m_nodes[node.m_index + 1].GetBoundingBox());
+        }
+        node.m_minCorner = bounds.m_minCorner;
+        node.m_maxCorner = bounds.m_maxCorner;
+    }
+}
+
+void BVH::Refit(const AABBArray& primBoxes, const uint32_t* movedPrimIndices, size_t movedCount)
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+    if (m_parents.size() != m_nodes.size())
+    {
+        BuildParents();
+    }
+
+    // Gather the leaves of the moved primitives and their ancestors, once each:
+    // the walk up stops at the first node already gathered.
+    m_refitNodes.clear();
+    for (size_t i = 0; i < movedCount; ++i)
+    {
+        uint32_t nodeIndex = m_primLeaves[movedPrimIndices[i]];
+        while ((nodeIndex != UINT32_MAX) && !m_refitFlags[nodeIndex])
+        {
+            m_refitFlags[nodeIndex] = 1;
+            m_refitNodes.push_back(nodeIndex);
+            nodeIndex = m_parents[nodeIndex];
+        }
+    }
+    // Children are always allocated after their parents, so descending indices visit children first.
+    std::sort(m_refitNodes.begin(), m_refitNodes.end(), std::greater<uint32_t>());
+    for (uint32_t nodeIndex : m_refitNodes)
+    {
+        m_refitFlags[nodeIndex] = 0;
+        BVHNode& node = m_nodes[nodeIndex];
+        BoundingBox bounds;
+        if (node.IsLeaf())
+        {
+            for (uint32_t j = node.m_index; j < node.m_index + node.m_count; ++j)
+            {
+                bounds = Union(bounds, primBoxes.Get(m_primIndices[j]));
+            }
+        }
+        else
+        {
+            bounds = Union(m_nodes[node.m_index].GetBoundingBox(), m_nodes[node.m_index + 1].GetBoundingBox());
+        }
+        node.m_minCorner = bounds.m_minCorner;
+        node.m_maxCorner = bounds.m_maxCorner;
+    }
+}
+
+void BVH::BuildParents()
+{
+    m_parents.assign(m_nodes.size(), UINT32_MAX);
+    m_primLeaves.resize(m_primIndices.size());
+    m_refitFlags.assign(m_nodes.size(), 0);
+    for (uint32_t i = 0; i < static_cast<uint32_t>(m_nodes.size()); ++i)
+    {
+        const BVHNode& node = m_nodes[i];
+        if (node.IsLeaf())
+        {
+            for (uint32_t j = node.m_index; j < node.m_index + node.m_count; ++j)
+            {
+                m_primLeaves[m_primIndices[j]] = i;
+            }
+        }
+        else
+        {
+            m_parents[node.m_index] = i;
+            m_parents[node.m_index + 1] = i;
+        }
+    }
+}
+
+void BVH::Clear()
+{
+    m_nodes.clear();
+    m_primIndices.clear();
+    m_parents.clear();
+    m_primLeaves.clear();
+    m_refitFlags.clear();
+}
+
+BoundingBox BVH::GetBoundingBox() const
+{
+    return m_nodes.empty() ? BoundingBox() : m_nodes[0].GetBoundingBox();
+}
+
+uint32_t BVH::GetDepth() const
+{
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+    uint32_t maxDepth = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 1 } };
+    while (!stack.empty())
+    {
+        auto [nodeIndex, depth] = stack.back();
+        stack.pop_back();
+        maxDepth = std::max(maxDepth, depth);
+        const BVHNode& node = m_nodes[nodeIndex];
+        if (!node.IsLeaf())
+        {
+            stack.push_back({ node.m_index, depth + 1 });
+            stack.push_back({ node.m_index + 1, depth + 1 });
+        }
+    }
+    return maxDepth;
+}
+
+float BVH::GetSAHCost(float traversalCost, float intersectionCost) const
+{
+    if (m_nodes.empty())
+    {
+        return 0.0f;
+    }
+    float rootArea = m_nodes[0].GetBoundingBox().SurfaceArea();
+    if (rootArea <= 0.0f)
+    {
+        return intersectionCost * m_primIndices.size();
+    }
+    double cost = 0.0;
+    for (const BVHNode& node : m_nodes)
+    {
+        float area = node.GetBoundingBox().SurfaceArea();
+        cost += node.IsLeaf() ? (intersectionCost * node.m_count * area) : (traversalCost * area);
+    }
+    return static_cast<float>(cost / rootArea);
+}
+
+void BVH::Query(const BoundingBox& box, const std::function<void(uint32_t primIndex)>& callback) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const BVHNode& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!Overlaps(node.GetBoundingBox(), box))
+        {
+            continue;
+        }
+        if (node.IsLeaf())
+        {
+            for (uint32_t i = node.m_index; i < node.m_index + node.m_count; ++i)
+            {
+                callback(m_primIndices[i]);
+            }
+        }
+        else
+        {
+            stack.push_back(node.m_index + 1);
+            stack.push_back(node.m_index);
+        }
+    }
+}
+
+bool BVH::IntersectClosest(Ray& ray, const BVHRayCallback& callback) const
+{
+    const glm::vec3 invDirection = GetSafeInverseDirection(ray.m_direction);
+    float tNear = 0.0f;
+    if (m_nodes.empty() ||
+        !IntersectRayBox(ray.m_origin, invDirection, ray.m_tMin, ray.m_tMax, m_nodes[0].GetBoundingBox(), tNear))
+    {
+        return false;
+    }
+
+    bool hit = false;
+    std::vector<std::pair<uint32_t, float>> stack;
+    stack.reserve(64);
+    stack.push_back({ 0, tNear });
+    while (!stack.empty())
+    {
+        auto [nodeIndex, tEnter] = stack.back();
+        stack.pop_back();
+        if (tEnter > ray.m_tMax)
+        {
+            continue;
+        }
+        const BVHNode& node = m_nodes[nodeIndex];
+        if (node.IsLeaf())
+        {
+            for (uint32_t i = node.m_index; i < node.m_index + node.m_count; ++i)
+            {
+                hit |= callback(m_primIndices[i], ray);
+            }
+            continue;
+        }
+        float tLeft = 0.0f;
+        float tRight = 0.0f;
+        bool hitLeft = IntersectRayBox(ray.m_origin, invDirection, ray.m_tMin, ray.m_tMax,
+            m_nodes[node.m_index].GetBoundingBox(), tLeft);
+        bool hitRight = IntersectRayBox(ray.m_origin, invDirection, ray.m_tMin, ray.m_tMax,
+            m_nodes[node.m_index + 1].GetBoundingBox(), tRight);
+        if (hitLeft && hitRight)
+        {
+            // Push the far child first, so that the near one is visited first.
+            if (tLeft <= tRight)
+            {
+                stack.push_back({ node.m_index + 1, tRight });
+                stack.push_back({ node.m_index, tLeft });
+            }
+            else
+            {
+                stack.push_back({ node.m_index, tLeft });
+                stack.push_back({ node.m_index + 1, tRight });
+            }
+        }
+        else if (hitLeft)
+        {
+            stack.push_back({ node.m_index, tLeft });
+        }
+        else if (hitRight)
+        {
+            stack.push_back({ node.m_index + 1, tRight });
+        }
+    }
+    return hit;
+}
+
+bool BVH::IntersectAny(const Ray& ray, const BVHRayCallback& callback) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+    const glm::vec3 invDirection = GetSafeInverseDirection(ray.m_direction);
+    Ray primRay = ray;
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const BVHNode& node = m_nodes[stack.back()];
+        stack.pop_back();
+        float tNear = 0.0f;
+        if (!IntersectRayBox(ray.m_origin, invDirection, ray.m_tMin, ray.m_tMax, node.GetBoundingBox(), tNear))
+        {
+            continue;
+        }
+        if (node.IsLeaf())
+        {
+            for (uint32_t i = node.m_index; i < node.m_index + node.m_count; ++i)
+            {
+                primRay.m_tMax = ray.m_tMax;
+                if (callback(m_primIndices[i], primRay))
+                {
+                    return true;
+                }
+            }
+        }
+        else
+        {
+            stack.push_back(node.m_index + 1);
+            stack.push_back(node.m_index);
+        }
+    }
+    return false;
+}
+
+// Returns true if the left child should be visited first by the first active ray of the packet.
+static bool IsLeftChildNearer(const BVHNode& left, const BVHNode& right, const RayPacket8& packet, uint32_t activeMask)
+{
+    uint32_t lane = static_cast<uint32_t>(std::countr_zero(activeMask));
+    glm::vec3 direction(packet.m_directionX[lane], packet.m_directionY[lane], packet.m_directionZ[lane]);
+    glm::vec3 leftToRight = (right.m_minCorner + right.m_maxCorner) - (left.m_minCorner + left.m_maxCorner);
+    return (glm::dot(direction, leftToRight) >= 0.0f);
+}
+
+uint32_t BVH::IntersectClosest(RayPacket8& packet, uint32_t activeMask, const BVHRayPacketCallback& callback) const
+{
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+    uint32_t hitMask = 0;
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const BVHNode& node = m_nodes[stack.back()];
+        stack.pop_back();
+        // m_tMax shrinks with each hit, so rays leave the traversal of the nodes behind their closest hit.
+        uint32_t nodeMask = IntersectRayPacketBox(packet, activeMask, node.GetBoundingBox());
+        if (nodeMask == 0)
+        {
+            continue;
+        }
+        if (node.IsLeaf())
+        {
+            for (uint32_t i = node.m_index; i < node.m_index + node.m_count; ++i)
+            {
+                hitMask |= callback(m_primIndices[i], packet, nodeMask);
+            }
+        }
+        else if (IsLeftChildNearer(m_nodes[node.m_index], m_nodes[node.m_index + 1], packet, nodeMask))
+        {
+            stack.push_back(node.m_index + 1);
+            stack.push_back(node.m_index);
+        }
+        else
+        {
+            stack.push_back(node.m_index);
+            stack.push_back(node.m_index + 1);
+        }
+    }
+    return hitMask;
+}
+
+uint32_t BVH::IntersectAny(RayPacket8& packet, uint32_t activeMask, const BVHRayPacketCallback& callback) const
+{
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+    uint32_t hitMask = 0;
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty() && (activeMask != 0))
+    {
+        const BVHNode& node = m_nodes[stack.back()];
+        stack.pop_back();
+        uint32_t nodeMask = IntersectRayPacketBox(packet, activeMask, node.GetBoundingBox());
+        if (nodeMask == 0)
+        {
+            continue;
+        }
+        if (node.IsLeaf())
+        {
+            for (uint32_t i = node.m_index; (i < node.m_index + node.m_count) && (nodeMask != 0); ++i)
+            {
+                // Rays are terminated at their first hit.
+                uint32_t primHitMask = callback(m_primIndices[i], packet, nodeMask);
+                hitMask |= primHitMask;
+                nodeMask &= ~primHitMask;
+                activeMask &= ~primHitMask;
+            }
+        }
+        else
+        {
+            stack.push_back(node.m_index + 1);
+            stack.push_back(node.m_index);
+        }
+    }
+    return hitMask;
+}
+
+template<uint32_t Width>
+WideBVH<Width>::WideBVH()
+{
+}
+
+template<uint32_t Width>
+WideBVH<Width>::~WideBVH()
+{
+}
+
+template<uint32_t Width>
+void WideBVH<Width>::Collapse(const BVH& bvh)
+{
+    Clear();
+    if (bvh.IsEmpty())
+    {
+        return;
+    }
+    m_primIndices = bvh.m_primIndices;
+    m_nodes.reserve(bvh.m_nodes.size() / 2 + 1);
+    CollapseNode(bvh, 0);
+}
+
+template<uint32_t Width>
+uint32_t WideBVH<Width>::CollapseNode(const BVH& bvh, uint32_t binaryNodeIndex)
+{
+    const uint32_t wideNodeIndex = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+
+    // Open the interior child with the largest surface area until the node is full.
+    uint32_t children[Width];
+    uint32_t childCount = 0;
+    const BVHNode& binaryNode = bvh.m_nodes[binaryNodeIndex];
+    if (binaryNode.IsLeaf())
+    {
+        children[childCount++] = binaryNodeIndex;
+    }
+    else
+    {
+        children[childCount++] = binaryNode.m_index;
+        children[childCount++] = binaryNode.m_index + 1;
+    }
+    while (childCount < Width)
+    {
+        int largest = -1;
+        float largestArea = -1.0f;
+        for (uint32_t i = 0; i < childCount; ++i)
+        {
+            const BVHNode& child = bvh.m_nodes[children[i]];
+            float area = child.GetBoundingBox().SurfaceArea();
+            if (!child.IsLeaf() && (area > largestArea))
+            {
+                largest = static_cast<int>(i);
+                largestArea = area;
+            }
+        }
+        if (largest < 0)
+        {
+            break;
+        }
+        const BVHNode& opened = bvh.m_nodes[children[largest]];
+        children[largest] = opened.m_index;
+        children[childCount++] = opened.m_index + 1;
+    }
+
+    m_nodes[wideNodeIndex].m_childCount = childCount;
+    for (uint32_t i = 0; i < Width; ++i)
+    {
+        m_nodes[wideNodeIndex].SetChildBoundingBox(i, BoundingBox());
+        m_nodes[wideNodeIndex].m_children[i] = 0;
+        m_nodes[wideNodeIndex].m_counts[i] = 0;
+    }
+    for (uint32_t i = 0; i < childCount; ++i)
+    {
+        const BVHNode& child = bvh.m_nodes[children[i]];
+        uint32_t childIndex = child.IsLeaf() ? child.m_index : CollapseNode(bvh, children[i]);
+        // m_nodes may have been reallocated by the recursion.
+        WideBVHNode<Width>& node = m_nodes[wideNodeIndex];
+        node.SetChildBoundingBox(i, child.GetBoundingBox());
+        node.m_children[i] = childIndex;
+        node.m_counts[i] = child.m_count;
+    }
+    return wideNodeIndex;
+}
+
+template<uint32_t Width>
+void WideBVH<Width>::Refit(const BoundingBox* primBoxes)
+{
+    // Children are always allocated after their parents, so a reverse sweep visits children first.
+    for (size_t i = m_nodes.size(); i > 0; --i)
+    {
+        WideBVHNode<Width>& node = m_nodes[i - 1];
+        for (uint32_t j = 0; j < node.m_childCount; ++j)
+        {
+            BoundingBox bounds;
+            if (node.m_counts[j] > 0)
+            {
+                for (uint32_t k = node.m_children[j]; k < node.m_children[j] + node.m_counts[j]; ++k)
+                {
+                    bounds = Union(bounds, primBoxes[m_primIndices[k]]);
+                }
+            }
+            else
+            {
+                bounds = m_nodes[node.m_children[j]].GetBoundingBox();
+            }
+            node.SetChildBoundingBox(j, bounds);
+        }
+    }
+}
+
+template<uint32_t Width>
+void WideBVH<Width>::Clear()
+{
+    m_nodes.clear();
+    m_primIndices.clear();
+}
+
+template<uint32_t Width>
+BoundingBox WideBVH<Width>::GetBoundingBox() const
+{
+    return m_nodes.empty() ? BoundingBox() : m_nodes[0].GetBoundingBox();
+}
+
+template<uint32_t Width>
+float WideBVH<Width>::GetSAHCost(float traversalCost, float intersectionCost) const
+{
+    if (m_nodes.empty())
+    {
+        return 0.0f;
+    }
+    float rootArea = GetBoundingBox().SurfaceArea();
+    if (rootArea <= 0.0f)
+    {
+        return intersectionCost * m_primIndices.size();
+    }
+    double cost = traversalCost * rootArea;
+    for (const WideBVHNode<Width>& node : m_nodes)
+    {
+        for (uint32_t i = 0; i < node.m_childCount; ++i)
+        {
+            float area = node.GetChildBoundingBox(i).SurfaceArea();
+            cost += (node.m_counts[i] > 0) ? (intersectionCost * node.m_counts[i] * area) : (traversalCost * area);
+        }
+    }
+    return static_cast<float>(cost / rootArea);
+}
+
+// Returns a bit mask of the children overlapping the box.
+template<uint32_t Width>
+static inline uint32_t OverlapChildren(const WideBVHNode<Width>& node, const BoundingBox& box)
+{
+    if constexpr (Width == SimdWidth)
+    {
+        SimdFloat x = SimdAnd(
+            SimdCmpGE(SimdLoad(node.m_maxX), SimdSet1(box.m_minCorner.x)),
+            SimdCmpLE(SimdLoad(node.m_minX), SimdSet1(box.m_maxCorner.x)));
+        SimdFloat y = SimdAnd(
+            SimdCmpGE(SimdLoad(node.m_maxY), SimdSet1(box.m_minCorner.y)),
+            SimdCmpLE(SimdLoad(node.m_minY), SimdSet1(box.m_maxCorner.y)));
+        SimdFloat z = SimdAnd(
+            SimdCmpGE(SimdLoad(node.m_maxZ), SimdSet1(box.m_minCorner.z)),
+            SimdCmpLE(SimdLoad(node.m_minZ), SimdSet1(box.m_maxCorner.z)));
+        return static_cast<uint32_t>(SimdMoveMask(SimdAnd(SimdAnd(x, y), z)));
+    }
+    else
+    {
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < Width; i += 4)
+        {
+            __m128 x = _mm_and_ps(
+                _mm_cmpge_ps(_mm_load_ps(node.m_maxX + i), _mm_set1_ps(box.m_minCorner.x)),
+                _mm_cmple_ps(_mm_load_ps(node.m_minX + i), _mm_set1_ps(box.m_maxCorner.x)));
+            __m128 y = _mm_and_ps(
+                _mm_cmpge_ps(_mm_load_ps(node.m_maxY + i), _mm_set1_ps(box.m_minCorner.y)),
+                _mm_cmple_ps(_mm_load_ps(node.m_minY + i), _mm_set1_ps(box.m_maxCorner.y)));
+            __m128 z = _mm_and_ps(
+                _mm_cmpge_ps(_mm_load_ps(node.m_maxZ + i), _mm_set1_ps(box.m_minCorner.z)),
+                _mm_cmple_ps(_mm_load_ps(node.m_minZ + i), _mm_set1_ps(box.m_maxCorner.z)));
+            mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_and_ps(_mm_and_ps(x, y), z))) << i;
+        }
+        return mask;
+    }
+}
+
+template<uint32_t Width>
+void WideBVH<Width>::Query(const BoundingBox& box, const std::function<void(uint32_t primIndex)>& callback) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const WideBVHNode<Width>& node = m_nodes[stack.back()];
+        stack.pop_back();
+        uint32_t mask = OverlapChildren(node, box);
+        while (mask)
+        {
+            uint32_t i = static_cast<uint32_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+            if (node.m_counts[i] > 0)
+            {
+                for (uint32_t j = node.m_children[i]; j < node.m_children[i] + node.m_counts[i]; ++j)
+                {
+                    callback(m_primIndices[j]);
+                }
+            }
+            else
+            {
+                stack.push_back(node.m_children[i]);
+            }
+        }
+    }
+}
+
+// Slab test of a ray against all children; returns the hit mask and the entry distances.
+template<uint32_t Width>
+static inline uint32_t IntersectChildren(const WideBVHNode<Width>& node, const Ray& ray, const glm::vec3& invDirection,
+    float* tNear)
+{
+    constexpr float errorScale = 1.0f + 2.0f * (3.0f * FLT_EPSILON * 0.5f) / (1.0f - 3.0f * FLT_EPSILON * 0.5f);
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < Width; i += 4)
+    {
+        const __m128 ox = _mm_set1_ps(ray.m_origin.x);
+        const __m128 oy = _mm_set1_ps(ray.m_origin.y);
+        const __m128 oz = _mm_set1_ps(ray.m_origin.z);
+        const __m128 idx = _mm_set1_ps(invDirection.x);
+        const __m128 idy = _mm_set1_ps(invDirection.y);
+        const __m128 idz = _mm_set1_ps(invDirection.z);
+        const __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.m_minX + i), ox), idx);
+        const __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.m_maxX + i), ox), idx);
+        const __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.m_minY + i), oy), idy);
+        const __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.m_maxY + i), oy), idy);
+        const __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.m_minZ + i), oz), idz);
+        const __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.m_maxZ + i), oz), idz);
+        __m128 tEnter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)),
+            _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_set1_ps(ray.m_tMin)));
+        __m128 tExit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)),
+            _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(ray.m_tMax)));
+        tExit = _mm_mul_ps(tExit, _mm_set1_ps(errorScale));
+        _mm_storeu_ps(tNear + i, tEnter);
+        mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(tEnter, tExit))) << i;
+    }
+    // Unused slots have empty boxes, which a slab test does not reject.
+    return mask & ((1u << node.m_childCount) - 1);
+}
+
+template<uint32_t Width>
+bool WideBVH<Width>::IntersectClosest(Ray& ray, const BVHRayCallback& callback) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+    const glm::vec3 invDirection = GetSafeInverseDirection(ray.m_direction);
+    bool hit = false;
+    std::vector<std::pair<uint32_t, float>> stack;
+    stack.reserve(64);
+    stack.push_back({ 0, ray.m_tMin });
+    while (!stack.empty())
+    {
+        auto [nodeIndex, tEnter] = stack.back();
+        stack.pop_back();
+        if (tEnter > ray.m_tMax)
+        {
+            continue;
+        }
+        const WideBVHNode<Width>& node = m_nodes[nodeIndex];
+        float tNear[Width];
+        uint32_t mask = IntersectChildren(node, ray, invDirection, tNear);
+
+        // Visit the leaves now (nearest first), and push the inner children far to near.
+        uint32_t children[Width];
+        uint32_t childCount = 0;
+        while (mask)
+        {
+            children[childCount++] = static_cast<uint32_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+        std::sort(children, children + childCount,
+            [&](uint32_t a, uint32_t b) { return tNear[a] > tNear[b]; });
+        for (uint32_t i = childCount; i > 0; --i)
+        {
+            uint32_t child = children[i - 1];
+            if ((node.m_counts[child] > 0) && (tNear[child] <= ray.m_tMax))
+            {
+                for (uint32_t j = node.m_children[child]; j < node.m_children[child] + node.m_counts[child]; ++j)
+                {
+                    hit |= callback(m_primIndices[j], ray);
+                }
+            }
+        }
+        for (uint32_t i = 0; i < childCount; ++i)
+        {
+            uint32_t child = children[i];
+            if (node.m_counts[child] == 0)
+            {
+                stack.push_back({ node.m_children[child], tNear[child] });
+            }
+        }
+    }
+    return hit;
+}
+
+template<uint32_t Width>
+bool WideBVH<Width>::IntersectAny(const Ray& ray, const BVHRayCallback& callback) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+    const glm::vec3 invDirection = GetSafeInverseDirection(ray.m_direction);
+    Ray primRay = ray;
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const WideBVHNode<Width>& node = m_nodes[stack.back()];
+        stack.pop_back();
+        float tNear[Width];
+        uint32_t mask = IntersectChildren(node, ray, invDirection, tNear);
+        while (mask)
+        {
+            uint32_t child = static_cast<uint32_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+            if (node.m_counts[child] > 0)
+            {
+                for (uint32_t j = node.m_children[child]; j < node.m_children[child] + node.m_counts[child]; ++j)
+                {
+                    primRay.m_tMax = ray.m_tMax;
+                    if (callback(m_primIndices[j], primRay))
+                    {
+                        return true;
+                    }
+                }
+            }
+            else
+            {
+                stack.push_back(node.m_children[child]);
+            }
+        }
+    }
+    return false;
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
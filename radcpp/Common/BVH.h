@@ -0,0 +1,173 @@
+#ifndef RADCPP_BVH_H
+#define RADCPP_BVH_H
+#pragma once
+
+#include "radcpp/Common/Geometry.h"
+#include "radcpp/Common/Ray.h"
+
+// Binary BVH node (32 bytes).
+// Interior nodes: m_count == 0, the children are m_nodes[m_index] and m_nodes[m_index + 1].
+// Leaf nodes: m_count > 0, the primitives are m_primIndices[m_index, m_index + m_count).
+struct BVHNode
+{
+    glm::vec3 m_minCorner;
+    uint32_t m_index;
+    glm::vec3 m_maxCorner;
+    uint32_t m_count;
+
+    bool IsLeaf() const { return (m_count > 0); }
+    BoundingBox GetBoundingBox() const { return BoundingBox(m_minCorner, m_maxCorner); }
+
+}; // struct BVHNode
+
+// Intersect the ray with a primitive; on hit, shorten ray.m_tMax to the hit distance and return true.
+using BVHRayCallback = std::function<bool(uint32_t primIndex, Ray& ray)>;
+// Intersect the active rays of the packet with a primitive; shorten m_tMax of the rays hitting it
+// and return their mask.
+using BVHRayPacketCallback = std::function<uint32_t(uint32_t primIndex, RayPacket8& packet, uint32_t activeMask)>;
+
+struct BVHBuildSettings
+{
+    uint32_t binCount = 16;
+    // Nodes with more primitives are always split.
+    uint32_t maxLeafSize = 4;
+    // Relative costs of visiting a node and testing a primitive, used by the surface area heuristic (SAH).
+    float traversalCost = 1.0f;
+    float intersectionCost = 1.0f;
+    // Nodes with more primitives are binned and split in parallel on the global thread pool.
+    size_t parallelThreshold = 4096;
+};
+
+// Bounding volume hierarchy over primitives given by their bounding boxes, built top-down with binned SAH.
+// Please refer to: Ingo Wald, On fast Construction of SAH-based Bounding Volume Hierarchies, 2007.
+class BVH
+{
+public:
+    BVH();
+    ~BVH();
+
+    // The primitives are referred to by their index in primBoxes.
+    void Build(const BoundingBox* primBoxes, size_t primCount, const BVHBuildSettings& settings = {});
+    // Update the bounds after the primitives moved, keeping the topology (quality degrades with large motion).
+    void Refit(const BoundingBox* primBoxes);
+    // Update only the leaves of the moved primitives and their ancestors, bottom-up:
+    // the cost scales with the number of primitives moved, not with the size of the tree.
+    void Refit(const AABBArray& primBoxes, const uint32_t* movedPrimIndices, size_t movedCount);
+    void Clear();
+
+    bool IsEmpty() const { return m_nodes.empty(); }
+    BoundingBox GetBoundingBox() const;
+    uint32_t GetDepth() const;
+    // The expected cost of a query by the surface area heuristic, relative to the root:
+    // sum(traversalCost * SA(interior)) + sum(intersectionCost * count * SA(leaf)), divided by SA(root).
+    float GetSAHCost(float traversalCost = 1.0f, float intersectionCost = 1.0f) const;
+
+    // Invoke callback for each primitive in the leaves overlapping the box;
+    // the callback tests the primitive itself if the exact result is required.
+    void Query(const BoundingBox& box, const std::function<void(uint32_t primIndex)>& callback) const;
+
+    // Closest hit: visit the nodes front to back, pruning with ray.m_tMax, which is the closest hit distance on return.
+    bool IntersectClosest(Ray& ray, const BVHRayCallback& callback) const;
+    // Any hit: return as soon as the callback reports a hit (for occlusion).
+    bool IntersectAny(const Ray& ray, const BVHRayCallback& callback) const;
+    // Packet variants: the rays are traversed together while any of them is active;
+    // return the mask of the rays that hit something.
+    uint32_t IntersectClosest(RayPacket8& packet, uint32_t activeMask, const BVHRayPacketCallback& callback) const;
+    uint32_t IntersectAny(RayPacket8& packet, uint32_t activeMask, const BVHRayPacketCallback& callback) const;
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<uint32_t> m_primIndices;
+    // Build time of the last build, in milliseconds.
+    float m_buildTime = 0.0f;
+
+private:
+    // Build m_parents and m_primLeaves for the partial Refit(), on its first call after a build.
+    void BuildParents();
+
+    std::vector<uint32_t> m_parents; // the parent of each node, UINT32_MAX for the root
+    std::vector<uint32_t> m_primLeaves; // the leaf of each primitive
+    std::vector<uint8_t> m_refitFlags;
+    std::vector<uint32_t> m_refitNodes;
+
+}; // class BVH
+
+// Node of a BVH with Width children, whose bounds are stored in SoA form to be tested with SIMD at once.
+// Child i is a node (m_counts[i] == 0), or a leaf with primitives m_primIndices[m_children[i], m_children[i] + m_counts[i]).
+// Unused slots have empty bounds, so they never pass an overlap test.
+template<uint32_t Width>
+struct WideBVHNode
+{
+    alignas(32) float m_minX[Width];
+    alignas(32) float m_minY[Width];
+    alignas(32) float m_minZ[Width];
+    alignas(32) float m_maxX[Width];
+    alignas(32) float m_maxY[Width];
+    alignas(32) float m_maxZ[Width];
+    uint32_t m_children[Width];
+    uint32_t m_counts[Width];
+    uint32_t m_childCount;
+
+    BoundingBox GetChildBoundingBox(uint32_t i) const
+    {
+        return BoundingBox(glm::vec3(m_minX[i], m_minY[i], m_minZ[i]), glm::vec3(m_maxX[i], m_maxY[i], m_maxZ[i]));
+    }
+
+    void SetChildBoundingBox(uint32_t i, const BoundingBox& box)
+    {
+        m_minX[i] = box.m_minCorner.x;
+        m_minY[i] = box.m_minCorner.y;
+        m_minZ[i] = box.m_minCorner.z;
+        m_maxX[i] = box.m_maxCorner.x;
+        m_maxY[i] = box.m_maxCorner.y;
+        m_maxZ[i] = box.m_maxCorner.z;
+    }
+
+    BoundingBox GetBoundingBox() const
+    {
+        BoundingBox box;
+        for (uint32_t i = 0; i < m_childCount; ++i)
+        {
+            box = Union(box, GetChildBoundingBox(i));
+        }
+        return box;
+    }
+
+}; // struct WideBVHNode
+
+// BVH with 4 or 8 children per node, collapsed from a binary BVH by repeatedly opening the child with the largest
+// surface area; fewer and shallower nodes, and the children of a node are tested together with SIMD.
+template<uint32_t Width>
+class WideBVH
+{
+public:
+    static_assert((Width == 4) || (Width == 8), "WideBVH supports 4 or 8 children per node.");
+
+    WideBVH();
+    ~WideBVH();
+
+    void Collapse(const BVH& bvh);
+    void Refit(const BoundingBox* primBoxes);
+    void Clear();
+
+    bool IsEmpty() const { return m_nodes.empty(); }
+    BoundingBox GetBoundingBox() const;
+    float GetSAHCost(float traversalCost = 1.0f, float intersectionCost = 1.0f) const;
+
+    void Query(const BoundingBox& box, const std::function<void(uint32_t primIndex)>& callback) const;
+
+    // Single ray traversal testing all children of a node at once.
+    bool IntersectClosest(Ray& ray, const BVHRayCallback& callback) const;
+    bool IntersectAny(const Ray& ray, const BVHRayCallback& callback) const;
+
+    std::vector<WideBVHNode<Width>> m_nodes;
+    std::vector<uint32_t> m_primIndices;
+
+private:
+    uint32_t CollapseNode(const BVH& bvh, uint32_t binaryNodeIndex);
+
+}; // class WideBVH
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
+
+#endif // RADCPP_BVH_H
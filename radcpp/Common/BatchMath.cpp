@@ -0,0 +1,127 @@
+#include "radcpp/Common/BatchMath.h"
+#include "radcpp/Common/BatchMathKernels.h"
+#include <atomic>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::SSE41: return "SSE4.1";
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::AVX512: return "AVX-512";
+    }
+    return "Unknown";
+}
+
+static SimdLevel DetectCpuSimdLevel()
+{
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || (maxLeaf < 7))
+    {
+        return SimdLevel::SSE41;
+    }
+    // The OS must save the YMM (and ZMM) states on context switches.
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    bool avx2 = fma && (info[1] & (1 << 5)) && ((xcr0 & 0x06) == 0x06);
+    bool avx512 = avx2 && (info[1] & (1 << 16)) && ((xcr0 & 0xE0) == 0xE0);
+    return avx512 ? SimdLevel::AVX512 : (avx2 ? SimdLevel::AVX2 : SimdLevel::SSE41);
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE41;
+#endif
+}
+
+// SSE4.1 is the baseline: every x64 CPU the engine supports (Vulkan capable) has it.
+SimdLevel GetCpuSimdLevel()
+{
+    static const SimdLevel level = DetectCpuSimdLevel();
+    return level;
+}
+
+static const BatchMathKernels& GetKernels(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX512: return GetBatchMathKernelsAVX512();
+    case SimdLevel::AVX2: return GetBatchMathKernelsAVX2();
+    default: return GetBatchMathKernelsSSE41();
+    }
+}
+
+static std::atomic<SimdLevel> g_simdLevel = GetCpuSimdLevel();
+
+SimdLevel GetSimdLevel()
+{
+    return g_simdLevel.load(std::memory_order_relaxed);
+}
+
+void SetSimdLevel(SimdLevel level)
+{
+    if (level > GetCpuSimdLevel())
+    {
+        level = GetCpuSimdLevel();
+    }
+    g_simdLevel.store(level, std::memory_order_relaxed);
+}
+
+static const BatchMathKernels& GetKernels()
+{
+    return GetKernels(GetSimdLevel());
+}
+
+void TransformPoints(const glm::mat4& m, const glm::vec3* src, glm::vec3* dst, size_t count)
+{
+    GetKernels().transformPoints(glm::value_ptr(m), glm::value_ptr(src[0]), glm::value_ptr(dst[0]), count);
+}
+
+void TransformDirections(const glm::mat4& m, const glm::vec3* src, glm::vec3* dst, size_t count)
+{
+    GetKernels().transformDirections(glm::value_ptr(m), glm::value_ptr(src[0]), glm::value_ptr(dst[0]), count);
+}
+
+void TransformPoints(const glm::mat4& m, const float* srcX, const float* srcY, const float* srcZ,
+    float* dstX, float* dstY, float* dstZ, size_t count)
+{
+    const float* src[3] = { srcX, srcY, srcZ };
+    float* dst[3] = { dstX, dstY, dstZ };
+    GetKernels().transformPointsSoA(glm::value_ptr(m), src, dst, count);
+}
+
+void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* dst, size_t count)
+{
+    GetKernels().multiplyMatrices(glm::value_ptr(a[0]), 16, glm::value_ptr(b[0]), glm::value_ptr(dst[0]), count);
+}
+
+void MultiplyMatrices(const glm::mat4& a, const glm::mat4* b, glm::mat4* dst, size_t count)
+{
+    GetKernels().multiplyMatrices(glm::value_ptr(a), 0, glm::value_ptr(b[0]), glm::value_ptr(dst[0]), count);
+}
+
+void ComputeNormalMatrices(const glm::mat4* src, glm::mat3* dst, size_t count)
+{
+    GetKernels().computeNormalMatrices(glm::value_ptr(src[0]), glm::value_ptr(dst[0]), count);
+}
+
+void TransformBoundingBoxes(const glm::mat4& m, const float* const src[6], float* const dst[6], size_t count)
+{
+    GetKernels().transformBoundingBoxes(glm::value_ptr(m), src, dst, count);
+}
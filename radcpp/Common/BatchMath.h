@@ -0,0 +1,46 @@
+#ifndef RADCPP_BATCH_MATH_H
+#define RADCPP_BATCH_MATH_H
+#pragma once
+
+#include "radcpp/Common/Math.h"
+
+// Batch transforms over arrays, dispatched at runtime to the widest instruction set supported by the CPU.
+// Each function gives the same results as the glm expression noted (bit-exact: the same operations
+// in the same order, without FMA), so batch and per-element code paths can be mixed freely.
+
+enum class SimdLevel
+{
+    SSE41,
+    AVX2,
+    AVX512,
+};
+
+const char* GetSimdLevelName(SimdLevel level);
+// The widest level supported by the CPU and the OS.
+SimdLevel GetCpuSimdLevel();
+// The level used by the batch functions; the CPU level by default.
+SimdLevel GetSimdLevel();
+// Force a lower level (for testing and benchmarks); clamped to the CPU level.
+void SetSimdLevel(SimdLevel level);
+
+// dst[i] = glm::vec3(m * glm::vec4(src[i], 1.0f))
+void TransformPoints(const glm::mat4& m, const glm::vec3* src, glm::vec3* dst, size_t count);
+// dst[i] = glm::vec3(m * glm::vec4(src[i], 0.0f))
+void TransformDirections(const glm::mat4& m, const glm::vec3* src, glm::vec3* dst, size_t count);
+// TransformPoints on SoA arrays; dst may alias src.
+void TransformPoints(const glm::mat4& m, const float* srcX, const float* srcY, const float* srcZ,
+    float* dstX, float* dstY, float* dstZ, size_t count);
+
+// dst[i] = a[i] * b[i]
+void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* dst, size_t count);
+// dst[i] = a * b[i]
+void MultiplyMatrices(const glm::mat4& a, const glm::mat4* b, glm::mat4* dst, size_t count);
+
+// dst[i] = glm::inverseTranspose(glm::mat3(src[i])), to transform normals.
+void ComputeNormalMatrices(const glm::mat4* src, glm::mat3* dst, size_t count);
+
+// dst[i] = Transform(src[i], m) on SoA boxes (arrays of minX, minY, minZ, maxX, maxY, maxZ);
+// empty boxes stay unchanged. dst may alias src.
+void TransformBoundingBoxes(const glm::mat4& m, const float* const src[6], float* const dst[6], size_t count);
+
+#endif // RADCPP_BATCH_MATH_H
@@ -0,0 +1,49 @@
+// Compiled with /arch:AVX2 (see the project settings of this file).
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__AVX2__)
+#pragma GCC target("avx2")
+#endif
+#include <immintrin.h>
+#include <cstddef>
+
+#define RADCPP_BATCH_MATH_ISA 1
+
+namespace {
+
+struct V
+{
+    using Float = __m256;
+    static constexpr size_t Width = 8;
+
+    static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+    static Float Set1(float f) { return _mm256_set1_ps(f); }
+    static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+    static Float Abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static Float SelectGreater(Float a, Float b, Float x, Float y) { return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+    static Float BroadcastColumn(const float* p) { return _mm256_broadcast_ps(reinterpret_cast<const __m128*>(p)); }
+    static Float Set4(float a, float b, float c, float d) { return _mm256_setr_ps(a, b, c, d, a, b, c, d); }
+    static Float Xor(Float a, Float b) { return _mm256_xor_ps(a, b); }
+    static Float LoadGroups(const float* p, size_t stride)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + stride), 1);
+    }
+    static void StoreGroups(float* p, size_t stride, Float v)
+    {
+        _mm_storeu_ps(p, _mm256_castps256_ps128(v));
+        _mm_storeu_ps(p + stride, _mm256_extractf128_ps(v, 1));
+    }
+    template<int i0, int i1, int i2, int i3>
+    static Float Permute(Float v) { return _mm256_permute_ps(v, _MM_SHUFFLE(i3, i2, i1, i0)); }
+}; // struct V
+
+} // namespace
+
+#include "radcpp/Common/BatchMathKernels.h"
+
+const BatchMathKernels& GetBatchMathKernelsAVX2()
+{
+    return g_kernels;
+}
@@ -0,0 +1,60 @@
+// Compiled with /arch:AVX512 (see the project settings of this file).
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__AVX512F__)
+#pragma GCC target("avx512f")
+#endif
+#include <immintrin.h>
+#include <cstddef>
+
+#define RADCPP_BATCH_MATH_ISA 1
+
+namespace {
+
+struct V
+{
+    using Float = __m512;
+    static constexpr size_t Width = 16;
+
+    static Float Load(const float* p) { return _mm512_loadu_ps(p); }
+    static void Store(float* p, Float v) { _mm512_storeu_ps(p, v); }
+    static Float Set1(float f) { return _mm512_set1_ps(f); }
+    static Float Add(Float a, Float b) { return _mm512_add_ps(a, b); }
+    static Float Sub(Float a, Float b) { return _mm512_sub_ps(a, b); }
+    static Float Mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+    static Float Div(Float a, Float b) { return _mm512_div_ps(a, b); }
+    static Float Abs(Float a) { return _mm512_abs_ps(a); }
+    static Float SelectGreater(Float a, Float b, Float x, Float y)
+    {
+        return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_GT_OQ), y, x);
+    }
+    static Float BroadcastColumn(const float* p) { return _mm512_broadcast_f32x4(_mm_loadu_ps(p)); }
+    static Float Set4(float a, float b, float c, float d) { return _mm512_broadcast_f32x4(_mm_setr_ps(a, b, c, d)); }
+    static Float Xor(Float a, Float b)
+    {
+        return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+    }
+    static Float LoadGroups(const float* p, size_t stride)
+    {
+        Float v = _mm512_castps128_ps512(_mm_loadu_ps(p));
+        v = _mm512_insertf32x4(v, _mm_loadu_ps(p + stride), 1);
+        v = _mm512_insertf32x4(v, _mm_loadu_ps(p + stride * 2), 2);
+        return _mm512_insertf32x4(v, _mm_loadu_ps(p + stride * 3), 3);
+    }
+    static void StoreGroups(float* p, size_t stride, Float v)
+    {
+        _mm_storeu_ps(p, _mm512_castps512_ps128(v));
+        _mm_storeu_ps(p + stride, _mm512_extractf32x4_ps(v, 1));
+        _mm_storeu_ps(p + stride * 2, _mm512_extractf32x4_ps(v, 2));
+        _mm_storeu_ps(p + stride * 3, _mm512_extractf32x4_ps(v, 3));
+    }
+    template<int i0, int i1, int i2, int i3>
+    static Float Permute(Float v) { return _mm512_permute_ps(v, _MM_SHUFFLE(i3, i2, i1, i0)); }
+}; // struct V
+
+} // namespace
+
+#include "radcpp/Common/BatchMathKernels.h"
+
+const BatchMathKernels& GetBatchMathKernelsAVX512()
+{
+    return g_kernels;
+}
@@ -0,0 +1,347 @@
+#ifndef RADCPP_BATCH_MATH_KERNELS_H
+#define RADCPP_BATCH_MATH_KERNELS_H
+#pragma once
+
+// Internal to BatchMath: the kernels compiled once per instruction set (BatchMathSSE41/AVX2/AVX512.cpp).
+// They work on raw float arrays (glm column-major layouts) and include nothing but the intrinsics,
+// so no inline function of a shared header is compiled with a wider instruction set than the caller expects.
+
+#include <cstddef>
+
+struct BatchMathKernels
+{
+    // m: mat4; src/dst: vec3 arrays.
+    void (*transformPoints)(const float* m, const float* src, float* dst, size_t count);
+    void (*transformDirections)(const float* m, const float* src, float* dst, size_t count);
+    void (*transformPointsSoA)(const float* m, const float* const src[3], float* const dst[3], size_t count);
+    // a: mat4 array advanced by aStride floats per matrix (0: the same matrix for all); b/dst: mat4 arrays.
+    void (*multiplyMatrices)(const float* a, size_t aStride, const float* b, float* dst, size_t count);
+    // src: mat4 array; dst: mat3 array.
+    void (*computeNormalMatrices)(const float* src, float* dst, size_t count);
+    // m: mat4; src/dst: minX, minY, minZ, maxX, maxY, maxZ arrays.
+    void (*transformBoundingBoxes)(const float* m, const float* const src[6], float* const dst[6], size_t count);
+};
+
+const BatchMathKernels& GetBatchMathKernelsSSE41();
+const BatchMathKernels& GetBatchMathKernelsAVX2();
+const BatchMathKernels& GetBatchMathKernelsAVX512();
+
+// The implementation, expanded in each ISA translation unit after defining RADCPP_BATCH_MATH_ISA and
+// a traits struct V (in an anonymous namespace), providing:
+// Float, Width (a multiple of 4), Load, Store, Set1, Set4 (4 floats repeated to all groups of 4 lanes),
+// Add, Sub, Mul, Div, Abs, Xor, SelectGreater(a, b, x, y) (a > b ? x : y per lane),
+// BroadcastColumn (4 floats repeated to all groups), LoadGroups/StoreGroups(p, stride, ...) (group g from/to
+// p + g * stride, stored in order of g), and Permute<i0, i1, i2, i3> (within each group).
+// AoS data is processed one element per group of 4 lanes, so it is never transposed through memory
+// (scalar stores reloaded by wide loads would stall on store forwarding).
+// Every expression follows the order of operations of the glm equivalent, for bit-exact results.
+#ifdef RADCPP_BATCH_MATH_ISA
+
+// Multiply-add must not be fused, even where the instruction set has FMA.
+#if defined(_MSC_VER)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace {
+
+using Float = V::Float;
+constexpr size_t W = V::Width;
+constexpr size_t G = W / 4; // groups of 4 lanes
+
+template<int k>
+Float Splat(Float v)
+{
+    return V::template Permute<k, k, k, k>(v);
+}
+
+// out = (m0 * x + m1 * y) + (m2 * z + m3 * w), the order of glm's mat4 * vec4.
+template<bool IsPoint>
+void TransformBlock(const Float m[16], const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ)
+{
+    Float vx = V::Load(x);
+    Float vy = V::Load(y);
+    Float vz = V::Load(z);
+    Float vw = V::Set1(IsPoint ? 1.0f : 0.0f);
+    float* out[3] = { outX, outY, outZ };
+    for (int r = 0; r < 3; ++r)
+    {
+        Float lo = V::Add(V::Mul(m[0 + r], vx), V::Mul(m[4 + r], vy));
+        Float hi = V::Add(V::Mul(m[8 + r], vz), V::Mul(m[12 + r], vw));
+        V::Store(out[r], V::Add(lo, hi));
+    }
+}
+
+void LoadMatrix(const float* m, Float splat[16])
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        splat[i] = V::Set1(m[i]);
+    }
+}
+
+// One vec3 per group: each group loads 4 floats (the next vector's x in the 4th lane, which is ignored),
+// and the groups are stored in order, so each store overwrites the garbage 4th lane of the previous one.
+template<bool IsPoint>
+void TransformVectorGroups(const Float c[4], const float* src, float* dst)
+{
+    Float v = V::LoadGroups(src, 3);
+    Float lo = V::Add(V::Mul(c[0], Splat<0>(v)), V::Mul(c[1], Splat<1>(v)));
+    Float hi = V::Add(V::Mul(c[2], Splat<2>(v)), V::Mul(c[3], V::Set1(IsPoint ? 1.0f : 0.0f)));
+    V::StoreGroups(dst, 3, V::Add(lo, hi));
+}
+
+template<bool IsPoint>
+void TransformVectors(const float* m, const float* src, float* dst, size_t count)
+{
+    Float c[4];
+    for (int k = 0; k < 4; ++k)
+    {
+        c[k] = V::BroadcastColumn(m + k * 4);
+    }
+    size_t base = 0;
+    // Stay one vector away from the end, not to read or write past it.
+    for (; base + G < count; base += G)
+    {
+        TransformVectorGroups<IsPoint>(c, src + base * 3, dst + base * 3);
+    }
+    alignas(64) float tail[G * 3 + 1] = {};
+    size_t n = count - base;
+    for (size_t i = 0; i < n * 3; ++i)
+    {
+        tail[i] = src[base * 3 + i];
+    }
+    TransformVectorGroups<IsPoint>(c, tail, tail);
+    for (size_t i = 0; i < n * 3; ++i)
+    {
+        dst[base * 3 + i] = tail[i];
+    }
+}
+
+void TransformPoints(const float* m, const float* src, float* dst, size_t count)
+{
+    TransformVectors<true>(m, src, dst, count);
+}
+
+void TransformDirections(const float* m, const float* src, float* dst, size_t count)
+{
+    TransformVectors<false>(m, src, dst, count);
+}
+
+void TransformPointsSoA(const float* m, const float* const src[3], float* const dst[3], size_t count)
+{
+    Float splat[16];
+    LoadMatrix(m, splat);
+    size_t base = 0;
+    for (; base + W <= count; base += W)
+    {
+        TransformBlock<true>(splat, src[0] + base, src[1] + base, src[2] + base,
+            dst[0] + base, dst[1] + base, dst[2] + base);
+    }
+    if (base < count)
+    {
+        alignas(64) float tail[3][W] = {};
+        size_t n = count - base;
+        for (size_t k = 0; k < 3; ++k)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                tail[k][j] = src[k][base + j];
+            }
+        }
+        TransformBlock<true>(splat, tail[0], tail[1], tail[2], tail[0], tail[1], tail[2]);
+        for (size_t k = 0; k < 3; ++k)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                dst[k][base + j] = tail[k][j];
+            }
+        }
+    }
+}
+
+// Each register holds W / 4 columns of b; column c of the product is
+// ((a0 * b[c][0] + a1 * b[c][1]) + a2 * b[c][2]) + a3 * b[c][3], the order of glm's mat4 * mat4.
+void MultiplyMatrices(const float* a, size_t aStride, const float* b, float* dst, size_t count)
+{
+    constexpr size_t ColumnsPerRegister = W / 4;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* ai = a + i * aStride;
+        const float* bi = b + i * 16;
+        float* di = dst + i * 16;
+        Float a0 = V::BroadcastColumn(ai + 0);
+        Float a1 = V::BroadcastColumn(ai + 4);
+        Float a2 = V::BroadcastColumn(ai + 8);
+        Float a3 = V::BroadcastColumn(ai + 12);
+        for (size_t c = 0; c < 4; c += ColumnsPerRegister)
+        {
+            Float bc = V::Load(bi + c * 4);
+            Float r = V::Add(V::Mul(a0, Splat<0>(bc)), V::Mul(a1, Splat<1>(bc)));
+            r = V::Add(r, V::Mul(a2, Splat<2>(bc)));
+            r = V::Add(r, V::Mul(a3, Splat<3>(bc)));
+            V::Store(di + c * 4, r);
+        }
+    }
+}
+
+// glm::inverseTranspose(mat3), one matrix per group: column i of the result is the cofactors of the other two
+// columns p and q: ((p.y * q.z, p.x * q.z, p.x * q.y) - (q.y * p.z, q.x * p.z, q.x * p.y)) with signs (+, -, +)
+// or (-, +, -), divided by the determinant m00 * cofactor00 - m01 * (-cofactor01) + m02 * cofactor02.
+Float ComputeCofactors(Float p, Float q)
+{
+    Float a = V::Mul(V::template Permute<1, 0, 0, 3>(p), V::template Permute<2, 2, 1, 3>(q));
+    Float b = V::Mul(V::template Permute<1, 0, 0, 3>(q), V::template Permute<2, 2, 1, 3>(p));
+    return V::Sub(a, b);
+}
+
+void ComputeNormalMatrixGroups(const float* src, float* dst, size_t count)
+{
+    Float c0 = V::LoadGroups(src + 0, 16);
+    Float c1 = V::LoadGroups(src + 4, 16);
+    Float c2 = V::LoadGroups(src + 8, 16);
+    Float t0 = ComputeCofactors(c1, c2);
+    Float t1 = ComputeCofactors(c0, c2);
+    Float t2 = ComputeCofactors(c0, c1);
+
+    Float p = V::Mul(c0, t0);
+    Float det = V::Add(V::Sub(Splat<0>(p), Splat<1>(p)), Splat<2>(p));
+
+    Float evenSigns = V::Set4(0.0f, -0.0f, 0.0f, 0.0f);
+    Float oddSigns = V::Set4(-0.0f, 0.0f, -0.0f, 0.0f);
+    alignas(64) float columns[3][W];
+    V::Store(columns[0], V::Div(V::Xor(t0, evenSigns), det));
+    V::Store(columns[1], V::Div(V::Xor(t1, oddSigns), det));
+    V::Store(columns[2], V::Div(V::Xor(t2, evenSigns), det));
+    for (size_t g = 0; g < count; ++g)
+    {
+        for (size_t c = 0; c < 3; ++c)
+        {
+            for (size_t r = 0; r < 3; ++r)
+            {
+                dst[g * 9 + c * 3 + r] = columns[c][g * 4 + r];
+            }
+        }
+    }
+}
+
+void ComputeNormalMatrices(const float* src, float* dst, size_t count)
+{
+    size_t base = 0;
+    for (; base + G <= count; base += G)
+    {
+        ComputeNormalMatrixGroups(src + base * 16, dst + base * 9, G);
+    }
+    if (base < count)
+    {
+        // Pad with identities.
+        alignas(64) float tail[G * 16] = {};
+        for (size_t i = 0; i < G * 16; ++i)
+        {
+            tail[i] = (i % 16 % 5 == 0) ? 1.0f : 0.0f;
+        }
+        size_t n = count - base;
+        for (size_t i = 0; i < n * 16; ++i)
+        {
+            tail[i] = src[base * 16 + i];
+        }
+        ComputeNormalMatrixGroups(tail, dst + base * 9, n);
+    }
+}
+
+// The order of BoundingBox's Transform: center = m * (center, 1);
+// extent = (abs(m0) * ex + abs(m1) * ey) + abs(m2) * ez; empty boxes (min > max on any axis) are kept.
+void TransformBoundingBoxBlock(const Float m[16], const Float absM[9],
+    const float* const src[6], float* const dst[6], size_t offset)
+{
+    Float half = V::Set1(0.5f);
+    Float one = V::Set1(1.0f);
+    Float minV[3], maxV[3], center[3], extent[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        minV[k] = V::Load(src[k] + offset);
+        maxV[k] = V::Load(src[3 + k] + offset);
+        center[k] = V::Mul(V::Add(minV[k], maxV[k]), half);
+        extent[k] = V::Mul(V::Sub(maxV[k], minV[k]), half);
+    }
+    for (int r = 0; r < 3; ++r)
+    {
+        Float c = V::Add(
+            V::Add(V::Mul(m[0 + r], center[0]), V::Mul(m[4 + r], center[1])),
+            V::Add(V::Mul(m[8 + r], center[2]), V::Mul(m[12 + r], one)));
+        Float e = V::Add(V::Mul(absM[0 + r], extent[0]), V::Mul(absM[3 + r], extent[1]));
+        e = V::Add(e, V::Mul(absM[6 + r], extent[2]));
+        Float newMin = V::Sub(c, e);
+        Float newMax = V::Add(c, e);
+        for (int k = 0; k < 3; ++k)
+        {
+            newMin = V::SelectGreater(minV[k], maxV[k], minV[r], newMin);
+            newMax = V::SelectGreater(minV[k], maxV[k], maxV[r], newMax);
+        }
+        V::Store(dst[r] + offset, newMin);
+        V::Store(dst[3 + r] + offset, newMax);
+    }
+}
+
+void TransformBoundingBoxes(const float* m, const float* const src[6], float* const dst[6], size_t count)
+{
+    Float splat[16];
+    LoadMatrix(m, splat);
+    Float absM[9];
+    for (int c = 0; c < 3; ++c)
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            absM[c * 3 + r] = V::Abs(splat[c * 4 + r]);
+        }
+    }
+    size_t base = 0;
+    for (; base + W <= count; base += W)
+    {
+        TransformBoundingBoxBlock(splat, absM, src, dst, base);
+    }
+    if (base < count)
+    {
+        alignas(64) float tail[6][W] = {};
+        const float* tailSrc[6];
+        float* tailDst[6];
+        size_t n = count - base;
+        for (size_t k = 0; k < 6; ++k)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                tail[k][j] = src[k][base + j];
+            }
+            tailSrc[k] = tail[k];
+            tailDst[k] = tail[k];
+        }
+        TransformBoundingBoxBlock(splat, absM, tailSrc, tailDst, 0);
+        for (size_t k = 0; k < 6; ++k)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                dst[k][base + j] = tail[k][j];
+            }
+        }
+    }
+}
+
+constexpr BatchMathKernels g_kernels =
+{
+    TransformPoints,
+    TransformDirections,
+    TransformPointsSoA,
+    MultiplyMatrices,
+    ComputeNormalMatrices,
+    TransformBoundingBoxes,
+};
+
+} // namespace
+
+#endif // RADCPP_BATCH_MATH_ISA
+
+#endif // RADCPP_BATCH_MATH_KERNELS_H
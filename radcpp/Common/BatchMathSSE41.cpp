@@ -0,0 +1,42 @@
+// Compiled with the SSE4.1 instructions available to every x64 target of the project.
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__SSE4_1__)
+#pragma GCC target("sse4.1")
+#endif
+#include <smmintrin.h>
+#include <cstddef>
+
+#define RADCPP_BATCH_MATH_ISA 1
+
+namespace {
+
+struct V
+{
+    using Float = __m128;
+    static constexpr size_t Width = 4;
+
+    static Float Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, Float v) { _mm_storeu_ps(p, v); }
+    static Float Set1(float f) { return _mm_set1_ps(f); }
+    static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+    static Float Abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static Float SelectGreater(Float a, Float b, Float x, Float y) { return _mm_blendv_ps(y, x, _mm_cmpgt_ps(a, b)); }
+    static Float BroadcastColumn(const float* p) { return _mm_loadu_ps(p); }
+    static Float Set4(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+    static Float Xor(Float a, Float b) { return _mm_xor_ps(a, b); }
+    static Float LoadGroups(const float* p, size_t) { return _mm_loadu_ps(p); }
+    static void StoreGroups(float* p, size_t, Float v) { _mm_storeu_ps(p, v); }
+    template<int i0, int i1, int i2, int i3>
+    static Float Permute(Float v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(i3, i2, i1, i0)); }
+}; // struct V
+
+} // namespace
+
+#include "radcpp/Common/BatchMathKernels.h"
+
+const BatchMathKernels& GetBatchMathKernelsSSE41()
+{
+    return g_kernels;
+}
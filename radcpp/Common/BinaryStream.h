@@ -0,0 +1,217 @@
+#ifndef RADCPP_BINARY_STREAM_H
+#define RADCPP_BINARY_STREAM_H
+#pragma once
+
+#include "radcpp/Common/Common.h"
+#include "radcpp/Common/ArrayRef.h"
+#include "radcpp/Common/File.h"
+#include <string>
+#include <vector>
+
+// Serialize trivially copyable data into a byte buffer in the native layout (no endian conversion).
+// Arrays are written as a 64-bit element count followed by the elements at an aligned offset,
+// so that a reader over a memory mapped file can reference them in place.
+class BinaryWriter
+{
+public:
+    static constexpr size_t ArrayAlignment = 16;
+
+    size_t GetSize() const { return m_buffer.size(); }
+    const uint8_t* GetData() const { return m_buffer.data(); }
+
+    void WriteBytes(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    }
+
+    template<typename T>
+    void Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteBytes(&value, sizeof(T));
+    }
+
+    // Overwrite a value written before (to patch offsets and counts known later).
+    template<typename T>
+    void WriteAt(size_t offset, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        assert(offset + sizeof(T) <= m_buffer.size());
+        memcpy(m_buffer.data() + offset, &value, sizeof(T));
+    }
+
+    // Pad with zeros to a multiple of alignment.
+    void Align(size_t alignment)
+    {
+        m_buffer.resize((m_buffer.size() + alignment - 1) / alignment * alignment, 0);
+    }
+
+    template<typename T>
+    void WriteArray(const T* data, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Write<uint64_t>(count);
+        Align(ArrayAlignment);
+        WriteBytes(data, count * sizeof(T));
+    }
+
+    template<typename T>
+    void WriteArray(const std::vector<T>& values)
+    {
+        WriteArray(values.data(), values.size());
+    }
+
+    void WriteString(std::string_view str)
+    {
+        Write<uint32_t>(static_cast<uint32_t>(str.size()));
+        WriteBytes(str.data(), str.size());
+    }
+
+    // Write to a temporary file renamed over filePath, so that readers never see a partial file.
+    bool SaveToFile(const Path& filePath) const
+    {
+        Path tempPath = filePath;
+        tempPath += ".tmp";
+        File file;
+        if (!file.Open(tempPath, FileOpenWrite | FileOpenBinary))
+        {
+            return false;
+        }
+        const bool written = (file.Write(m_buffer.data(), m_buffer.size()) == 1);
+        file.Close();
+        std::error_code ec;
+        if (written)
+        {
+            std::filesystem::rename(tempPath, filePath, ec);
+        }
+        if (!written || ec)
+        {
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::vector<uint8_t> m_buffer;
+
+}; // class BinaryWriter
+
+// Read the data written by BinaryWriter from memory. Reads past the end fail and set the stream invalid,
+// after which all reads fail; check IsValid() once after a sequence of reads.
+class BinaryReader
+{
+public:
+    BinaryReader(const uint8_t* data, size_t size) :
+        m_data(data),
+        m_size(size)
+    {
+    }
+
+    bool IsValid() const { return m_valid; }
+    size_t GetOffset() const { return m_offset; }
+    size_t GetSize() const { return m_size; }
+
+    bool Seek(size_t offset)
+    {
+        if (!m_valid || (offset > m_size))
+        {
+            m_valid = false;
+            return false;
+        }
+        m_offset = offset;
+        return true;
+    }
+
+    // Return a pointer to size bytes in place, or nullptr if out of range.
+    const uint8_t* ReadBytes(size_t size)
+    {
+        if (!m_valid || (size > m_size - m_offset))
+        {
+            m_valid = false;
+            return nullptr;
+        }
+        const uint8_t* bytes = m_data + m_offset;
+        m_offset += size;
+        return bytes;
+    }
+
+    template<typename T>
+    bool Read(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (const uint8_t* bytes = ReadBytes(sizeof(T)))
+        {
+            memcpy(&value, bytes, sizeof(T));
+            return true;
+        }
+        return false;
+    }
+
+    template<typename T>
+    T Read()
+    {
+        T value = {};
+        Read(value);
+        return value;
+    }
+
+    // Reference the elements of an array in place; the data must outlive the result.
+    template<typename T>
+    ArrayRef<T> ReadArray()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        uint64_t count = 0;
+        if (!Read(count) || (count > (m_size / sizeof(T))))
+        {
+            m_valid = false;
+            return {};
+        }
+        const size_t offset = (m_offset + BinaryWriter::ArrayAlignment - 1) /
+            BinaryWriter::ArrayAlignment * BinaryWriter::ArrayAlignment;
+        if (!Seek(offset))
+        {
+            return {};
+        }
+        const uint8_t* bytes = ReadBytes(static_cast<size_t>(count) * sizeof(T));
+        if (bytes == nullptr)
+        {
+            return {};
+        }
+        assert(reinterpret_cast<uintptr_t>(bytes) % alignof(T) == 0);
+        return ArrayRef<T>(reinterpret_cast<const T*>(bytes), static_cast<size_t>(count));
+    }
+
+    template<typename T>
+    bool ReadArray(std::vector<T>& values)
+    {
+        ArrayRef<T> elements = ReadArray<T>();
+        values.assign(elements.begin(), elements.end());
+        return m_valid;
+    }
+
+    bool ReadString(std::string& str)
+    {
+        uint32_t length = 0;
+        if (!Read(length))
+        {
+            return false;
+        }
+        if (const uint8_t* bytes = ReadBytes(length))
+        {
+            str.assign(reinterpret_cast<const char*>(bytes), length);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+    bool m_valid = true;
+
+}; // class BinaryReader
+
+#endif // RADCPP_BINARY_STREAM_H
@@ -2,6 +2,11 @@
 
 #ifdef _WIN32
 #include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #ifndef PATH_MAX_LEN
@@ -74,6 +79,7 @@ void File::Close()
     if (m_handle != nullptr)
     {
         fclose(m_handle);
+        m_handle = nullptr;
     }
 }
 
@@ -203,6 +209,93 @@ std::vector<std::string> File::ReadLines(const Path& path)
     }
 }
 
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const Path& filePath)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(fileHandle, &fileSize) || (fileSize.QuadPart == 0))
+    {
+        // Empty files cannot be mapped.
+        CloseHandle(fileHandle);
+        return false;
+    }
+    HANDLE mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr)
+    {
+        CloseHandle(fileHandle);
+        return false;
+    }
+    void* data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr)
+    {
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        return false;
+    }
+    m_fileHandle = fileHandle;
+    m_mappingHandle = mappingHandle;
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat fileStatus = {};
+    if ((fstat(fd, &fileStatus) != 0) || (fileStatus.st_size == 0))
+    {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = static_cast<size_t>(fileStatus.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_data == nullptr)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mappingHandle);
+    CloseHandle(m_fileHandle);
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
 namespace FileSystem
 {
     Path GetAbsolutePath(const Path& path)
@@ -62,6 +62,33 @@ private:
 
 }; // class File
 
+// A read-only view of a whole file mapped into memory: pages are loaded on first access,
+// and can be copied from directly without reading into an intermediate buffer.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const Path& filePath);
+    void Close();
+    bool IsOpen() const { return (m_data != nullptr); }
+
+    const uint8_t* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#endif
+
+}; // class MappedFile
+
 // C++17 FileSystem
 namespace FileSystem
 {
@@ -0,0 +1,97 @@
+#include "radcpp/Common/FreeListAllocator.h"
+
+FreeListAllocator::FreeListAllocator(uint64_t capacity)
+{
+    Reset(capacity);
+}
+
+FreeListAllocator::~FreeListAllocator()
+{
+}
+
+void FreeListAllocator::Reset(uint64_t capacity)
+{
+    m_capacity = capacity;
+    m_usedSize = 0;
+    m_freeRanges.clear();
+    m_freeSizes.clear();
+    m_allocations.clear();
+    if (capacity > 0)
+    {
+        AddFreeRange(0, capacity);
+    }
+}
+
+uint64_t FreeListAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    if ((size == 0) || (alignment == 0))
+    {
+        return InvalidOffset;
+    }
+    // The smallest free range of at least size bytes, if aligned enough; otherwise the smallest one
+    // of size + alignment - 1 bytes, which fits with any padding.
+    auto iter = m_freeSizes.lower_bound(size);
+    if ((iter != m_freeSizes.end()) && ((iter->second + alignment - 1) / alignment * alignment + size > iter->second + iter->first))
+    {
+        iter = m_freeSizes.lower_bound(size + alignment - 1);
+    }
+    if (iter != m_freeSizes.end())
+    {
+        const uint64_t rangeOffset = iter->second;
+        const uint64_t rangeSize = iter->first;
+        const uint64_t offset = (rangeOffset + alignment - 1) / alignment * alignment;
+        RemoveFreeRange(m_freeRanges.find(rangeOffset));
+        if (offset > rangeOffset)
+        {
+            AddFreeRange(rangeOffset, offset - rangeOffset);
+        }
+        if (offset + size < rangeOffset + rangeSize)
+        {
+            AddFreeRange(offset + size, rangeOffset + rangeSize - (offset + size));
+        }
+        m_allocations[offset] = size;
+        m_usedSize += size;
+        return offset;
+    }
+    return InvalidOffset;
+}
+
+void FreeListAllocator::Free(uint64_t offset)
+{
+    auto allocation = m_allocations.find(offset);
+    assert(allocation != m_allocations.end());
+    uint64_t size = allocation->second;
+    m_allocations.erase(allocation);
+    m_usedSize -= size;
+
+    // Coalesce with the free neighbors.
+    auto next = m_freeRanges.lower_bound(offset);
+    if ((next != m_freeRanges.end()) && (next->first == offset + size))
+    {
+        size += next->second->first;
+        next = std::next(next);
+        RemoveFreeRange(std::prev(next));
+    }
+    if (next != m_freeRanges.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second->first == offset)
+        {
+            offset = prev->first;
+            size += prev->second->first;
+            RemoveFreeRange(prev);
+        }
+    }
+    AddFreeRange(offset, size);
+}
+
+void FreeListAllocator::AddFreeRange(uint64_t offset, uint64_t size)
+{
+    m_freeRanges[offset] = m_freeSizes.emplace(size, offset);
+}
+
+void FreeListAllocator::RemoveFreeRange(std::map<uint64_t, SizeIterator>::iterator iter)
+{
+    m_freeSizes.erase(iter->second);
+    m_freeRanges.erase(iter);
+}
@@ -0,0 +1,50 @@
+#ifndef RADCPP_FREE_LIST_ALLOCATOR_H
+#define RADCPP_FREE_LIST_ALLOCATOR_H
+#pragma once
+
+#include "radcpp/Common/Common.h"
+#include <map>
+#include <unordered_map>
+
+// Sub-allocate ranges of a linear resource of a fixed capacity (a buffer, a heap), storing no data itself.
+// Allocations take the best fitting free range (with the alignment padding, the best fit of size + alignment - 1
+// bytes if the best one of size bytes is misaligned); freed ranges are coalesced with their free neighbors.
+// Both are O(log n) in the number of free ranges. Not thread safe.
+class FreeListAllocator
+{
+public:
+    static constexpr uint64_t InvalidOffset = UINT64_MAX;
+
+    FreeListAllocator(uint64_t capacity = 0);
+    ~FreeListAllocator();
+
+    // Free all the ranges, with a new capacity.
+    void Reset(uint64_t capacity);
+
+    // Return the offset of size bytes, a multiple of alignment (any value, not only powers of two),
+    // or InvalidOffset if no free range fits.
+    uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+    // Free the range allocated at offset.
+    void Free(uint64_t offset);
+
+    uint64_t GetCapacity() const { return m_capacity; }
+    uint64_t GetUsedSize() const { return m_usedSize; }
+    uint64_t GetFreeSize() const { return m_capacity - m_usedSize; }
+    uint64_t GetLargestFreeSize() const { return m_freeSizes.empty() ? 0 : m_freeSizes.rbegin()->first; }
+    size_t GetAllocationCount() const { return m_allocations.size(); }
+    size_t GetFreeRangeCount() const { return m_freeRanges.size(); }
+
+private:
+    using SizeIterator = std::multimap<uint64_t, uint64_t>::iterator;
+    void AddFreeRange(uint64_t offset, uint64_t size);
+    void RemoveFreeRange(std::map<uint64_t, SizeIterator>::iterator iter);
+
+    uint64_t m_capacity = 0;
+    uint64_t m_usedSize = 0;
+    std::multimap<uint64_t, uint64_t> m_freeSizes; // size to offset, to find the best fit
+    std::map<uint64_t, SizeIterator> m_freeRanges; // offset to the entry of m_freeSizes, to find the neighbors
+    std::unordered_map<uint64_t, uint64_t> m_allocations; // offset to size
+
+}; // class FreeListAllocator
+
+#endif // RADCPP_FREE_LIST_ALLOCATOR_H
@@ -1,4 +1,7 @@
 #include "radcpp/Common/Geometry.h"
+#include "radcpp/Common/Simd.h"
+#include "radcpp/Common/BatchMath.h"
+#include <bit>
 
 // https://pbr-book.org/3ed-2018/Geometry_and_Transformations/Vectors
 void ConstructCoordinateSystem(const glm::vec3& v1, glm::vec3& v2, glm::vec3& v3)
@@ -15,3 +18,444 @@ void ConstructCoordinateSystem(const glm::vec3& v1, glm::vec3& v2, glm::vec3& v3
     }
     v3 = glm::cross(v1, v2);
 }
+
+void AABBArray::Resize(size_t count)
+{
+    m_minX.resize(count, FLT_MAX);
+    m_minY.resize(count, FLT_MAX);
+    m_minZ.resize(count, FLT_MAX);
+    m_maxX.resize(count, -FLT_MAX);
+    m_maxY.resize(count, -FLT_MAX);
+    m_maxZ.resize(count, -FLT_MAX);
+}
+
+void AABBArray::Reserve(size_t count)
+{
+    m_minX.reserve(count);
+    m_minY.reserve(count);
+    m_minZ.reserve(count);
+    m_maxX.reserve(count);
+    m_maxY.reserve(count);
+    m_maxZ.reserve(count);
+}
+
+void AABBArray::Clear()
+{
+    m_minX.clear();
+    m_minY.clear();
+    m_minZ.clear();
+    m_maxX.clear();
+    m_maxY.clear();
+    m_maxZ.clear();
+}
+
+void AABBArray::PushBack(const BoundingBox& box)
+{
+    m_minX.push_back(box.m_minCorner.x);
+    m_minY.push_back(box.m_minCorner.y);
+    m_minZ.push_back(box.m_minCorner.z);
+    m_maxX.push_back(box.m_maxCorner.x);
+    m_maxY.push_back(box.m_maxCorner.y);
+    m_maxZ.push_back(box.m_maxCorner.z);
+}
+
+void AABBArray::Set(size_t index, const BoundingBox& box)
+{
+    m_minX[index] = box.m_minCorner.x;
+    m_minY[index] = box.m_minCorner.y;
+    m_minZ[index] = box.m_minCorner.z;
+    m_maxX[index] = box.m_maxCorner.x;
+    m_maxY[index] = box.m_maxCorner.y;
+    m_maxZ[index] = box.m_maxCorner.z;
+}
+
+BoundingBox AABBArray::Get(size_t index) const
+{
+    return BoundingBox(
+        glm::vec3(m_minX[index], m_minY[index], m_minZ[index]),
+        glm::vec3(m_maxX[index], m_maxY[index], m_maxZ[index]));
+}
+
+// Append base + (index of each set bit of mask) to indices.
+static inline void CompactIndices(int mask, size_t base, uint32_t* indices, size_t& count)
+{
+    uint32_t bits = static_cast<uint32_t>(mask);
+    while (bits)
+    {
+        indices[count++] = static_cast<uint32_t>(base + std::countr_zero(bits));
+        bits &= bits - 1;
+    }
+}
+
+void TransformBoundingBoxes(const AABBArray& src, const glm::mat4& transform, AABBArray& dst)
+{
+    const size_t count = src.Size();
+    if (&dst != &src)
+    {
+        dst.Resize(count);
+    }
+
+    const float* srcArrays[6] = { src.m_minX.data(), src.m_minY.data(), src.m_minZ.data(),
+        src.m_maxX.data(), src.m_maxY.data(), src.m_maxZ.data() };
+    float* dstArrays[6] = { dst.m_minX.data(), dst.m_minY.data(), dst.m_minZ.data(),
+        dst.m_maxX.data(), dst.m_maxY.data(), dst.m_maxZ.data() };
+    TransformBoundingBoxes(transform, srcArrays, dstArrays, count);
+}
+
+void TransformBoundingBoxes(const AABBArray& src, const glm::mat4* transforms, AABBArray& dst)
+{
+    const size_t count = src.Size();
+    if (&dst != &src)
+    {
+        dst.Resize(count);
+    }
+
+    // Each box has its own matrix, transposing matrices into SoA form costs more than it saves,
+    // so process one box per iteration with the matrix columns in SSE registers.
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const glm::mat4& m = transforms[i];
+        __m128 col0 = _mm_loadu_ps(&m[0][0]);
+        __m128 col1 = _mm_loadu_ps(&m[1][0]);
+        __m128 col2 = _mm_loadu_ps(&m[2][0]);
+        __m128 col3 = _mm_loadu_ps(&m[3][0]);
+
+        __m128 minCorner = _mm_setr_ps(src.m_minX[i], src.m_minY[i], src.m_minZ[i], 0.0f);
+        __m128 maxCorner = _mm_setr_ps(src.m_maxX[i], src.m_maxY[i], src.m_maxZ[i], 0.0f);
+        __m128 center = _mm_mul_ps(_mm_add_ps(minCorner, maxCorner), half);
+        __m128 extent = _mm_mul_ps(_mm_sub_ps(maxCorner, minCorner), half);
+
+        // (m0 * x + m1 * y) + (m2 * z + m3), the order of glm's mat4 * vec4.
+        __m128 newCenter = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(col0, _mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0))),
+                _mm_mul_ps(col1, _mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1)))),
+            _mm_add_ps(_mm_mul_ps(col2, _mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2))), col3));
+        __m128 newExtent = _mm_mul_ps(_mm_andnot_ps(signMask, col0), _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(0, 0, 0, 0)));
+        newExtent = _mm_add_ps(newExtent, _mm_mul_ps(_mm_andnot_ps(signMask, col1), _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(1, 1, 1, 1))));
+        newExtent = _mm_add_ps(newExtent, _mm_mul_ps(_mm_andnot_ps(signMask, col2), _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(2, 2, 2, 2))));
+
+        // Empty boxes (min > max on any axis, lane 3 is 0 > 0) are kept, as by Transform(): broadcast the mask
+        // to all lanes, and blend.
+        __m128 emptyMask = _mm_cmpgt_ps(minCorner, maxCorner);
+        emptyMask = _mm_or_ps(emptyMask, _mm_shuffle_ps(emptyMask, emptyMask, _MM_SHUFFLE(1, 0, 3, 2)));
+        emptyMask = _mm_or_ps(emptyMask, _mm_shuffle_ps(emptyMask, emptyMask, _MM_SHUFFLE(2, 3, 0, 1)));
+        alignas(16) float newMin[4];
+        alignas(16) float newMax[4];
+        _mm_store_ps(newMin, _mm_or_ps(_mm_and_ps(emptyMask, minCorner),
+            _mm_andnot_ps(emptyMask, _mm_sub_ps(newCenter, newExtent))));
+        _mm_store_ps(newMax, _mm_or_ps(_mm_and_ps(emptyMask, maxCorner),
+            _mm_andnot_ps(emptyMask, _mm_add_ps(newCenter, newExtent))));
+        dst.m_minX[i] = newMin[0];
+        dst.m_minY[i] = newMin[1];
+        dst.m_minZ[i] = newMin[2];
+        dst.m_maxX[i] = newMax[0];
+        dst.m_maxY[i] = newMax[1];
+        dst.m_maxZ[i] = newMax[2];
+    }
+}
+
+void UnionBoundingBoxes(const AABBArray& a, const AABBArray& b, AABBArray& dst)
+{
+    assert(a.Size() == b.Size());
+    const size_t count = a.Size();
+    if ((&dst != &a) && (&dst != &b))
+    {
+        dst.Resize(count);
+    }
+
+    size_t i = 0;
+    for (; i + SimdWidth <= count; i += SimdWidth)
+    {
+        SimdStore(&dst.m_minX[i], SimdMin(SimdLoad(&a.m_minX[i]), SimdLoad(&b.m_minX[i])));
+        SimdStore(&dst.m_minY[i], SimdMin(SimdLoad(&a.m_minY[i]), SimdLoad(&b.m_minY[i])));
+        SimdStore(&dst.m_minZ[i], SimdMin(SimdLoad(&a.m_minZ[i]), SimdLoad(&b.m_minZ[i])));
+        SimdStore(&dst.m_maxX[i], SimdMax(SimdLoad(&a.m_maxX[i]), SimdLoad(&b.m_maxX[i])));
+        SimdStore(&dst.m_maxY[i], SimdMax(SimdLoad(&a.m_maxY[i]), SimdLoad(&b.m_maxY[i])));
+        SimdStore(&dst.m_maxZ[i], SimdMax(SimdLoad(&a.m_maxZ[i]), SimdLoad(&b.m_maxZ[i])));
+    }
+
+    for (; i < count; ++i)
+    {
+        dst.Set(i, Union(a.Get(i), b.Get(i)));
+    }
+}
+
+BoundingBox UnionBoundingBoxes(const AABBArray& boxes)
+{
+    const size_t count = boxes.Size();
+    // Empty boxes are (FLT_MAX, -FLT_MAX), the identity of min/max, so they need no special care.
+    SimdFloat minX = SimdSet1(FLT_MAX), minY = SimdSet1(FLT_MAX), minZ = SimdSet1(FLT_MAX);
+    SimdFloat maxX = SimdSet1(-FLT_MAX), maxY = SimdSet1(-FLT_MAX), maxZ = SimdSet1(-FLT_MAX);
+
+    size_t i = 0;
+    for (; i + SimdWidth <= count; i += SimdWidth)
+    {
+        minX = SimdMin(minX, SimdLoad(&boxes.m_minX[i]));
+        minY = SimdMin(minY, SimdLoad(&boxes.m_minY[i]));
+        minZ = SimdMin(minZ, SimdLoad(&boxes.m_minZ[i]));
+        maxX = SimdMax(maxX, SimdLoad(&boxes.m_maxX[i]));
+        maxY = SimdMax(maxY, SimdLoad(&boxes.m_maxY[i]));
+        maxZ = SimdMax(maxZ, SimdLoad(&boxes.m_maxZ[i]));
+    }
+
+    BoundingBox ret(
+        glm::vec3(SimdReduceMin(minX), SimdReduceMin(minY), SimdReduceMin(minZ)),
+        glm::vec3(SimdReduceMax(maxX), SimdReduceMax(maxY), SimdReduceMax(maxZ)));
+    for (; i < count; ++i)
+    {
+        ret = Union(ret, boxes.Get(i));
+    }
+    return ret;
+}
+
+size_t OverlapBoundingBoxes(const AABBArray& boxes, const BoundingBox& query, uint32_t* indices)
+{
+    const size_t count = boxes.Size();
+    const SimdFloat qMinX = SimdSet1(query.m_minCorner.x);
+    const SimdFloat qMinY = SimdSet1(query.m_minCorner.y);
+    const SimdFloat qMinZ = SimdSet1(query.m_minCorner.z);
+    const SimdFloat qMaxX = SimdSet1(query.m_maxCorner.x);
+    const SimdFloat qMaxY = SimdSet1(query.m_maxCorner.y);
+    const SimdFloat qMaxZ = SimdSet1(query.m_maxCorner.z);
+
+    size_t numIndices = 0;
+    size_t i = 0;
+    for (; i + SimdWidth <= count; i += SimdWidth)
+    {
+        SimdFloat x = SimdAnd(SimdCmpGE(SimdLoad(&boxes.m_maxX[i]), qMinX), SimdCmpLE(SimdLoad(&boxes.m_minX[i]), qMaxX));
+        SimdFloat y = SimdAnd(SimdCmpGE(SimdLoad(&boxes.m_maxY[i]), qMinY), SimdCmpLE(SimdLoad(&boxes.m_minY[i]), qMaxY));
+        SimdFloat z = SimdAnd(SimdCmpGE(SimdLoad(&boxes.m_maxZ[i]), qMinZ), SimdCmpLE(SimdLoad(&boxes.m_minZ[i]), qMaxZ));
+        CompactIndices(SimdMoveMask(SimdAnd(SimdAnd(x, y), z)), i, indices, numIndices);
+    }
+
+    for (; i < count; ++i)
+    {
+        if (Overlaps(boxes.Get(i), query))
+        {
+            indices[numIndices++] = static_cast<uint32_t>(i);
+        }
+    }
+    return numIndices;
+}
+
+size_t ContainedBoundingBoxes(const AABBArray& boxes, const BoundingBox& query, uint32_t* indices)
+{
+    const size_t count = boxes.Size();
+    const SimdFloat qMinX = SimdSet1(query.m_minCorner.x);
+    const SimdFloat qMinY = SimdSet1(query.m_minCorner.y);
+    const SimdFloat qMinZ = SimdSet1(query.m_minCorner.z);
+    const SimdFloat qMaxX = SimdSet1(query.m_maxCorner.x);
+    const SimdFloat qMaxY = SimdSet1(query.m_maxCorner.y);
+    const SimdFloat qMaxZ = SimdSet1(query.m_maxCorner.z);
+
+    size_t numIndices = 0;
+    size_t i = 0;
+    for (; i + SimdWidth <= count; i += SimdWidth)
+    {
+        SimdFloat x = SimdAnd(SimdCmpGE(SimdLoad(&boxes.m_minX[i]), qMinX), SimdCmpLE(SimdLoad(&boxes.m_maxX[i]), qMaxX));
+        SimdFloat y = SimdAnd(SimdCmpGE(SimdLoad(&boxes.m_minY[i]), qMinY), SimdCmpLE(SimdLoad(&boxes.m_maxY[i]), qMaxY));
+        SimdFloat z = SimdAnd(SimdCmpGE(SimdLoad(&boxes.m_minZ[i]), qMinZ), SimdCmpLE(SimdLoad(&boxes.m_maxZ[i]), qMaxZ));
+        CompactIndices(SimdMoveMask(SimdAnd(SimdAnd(x, y), z)), i, indices, numIndices);
+    }
+
+    for (; i < count; ++i)
+    {
+        BoundingBox box = boxes.Get(i);
+        if (IsInside(query, box.m_minCorner) && IsInside(query, box.m_maxCorner))
+        {
+            indices[numIndices++] = static_cast<uint32_t>(i);
+        }
+    }
+    return numIndices;
+}
+
+size_t BoundingBoxesContainingPoint(const AABBArray& boxes, const glm::vec3& p, uint32_t* indices)
+{
+    const size_t count = boxes.Size();
+    const SimdFloat px = SimdSet1(p.x);
+    const SimdFloat py = SimdSet1(p.y);
+    const SimdFloat pz = SimdSet1(p.z);
+
+    size_t numIndices = 0;
+    size_t i = 0;
+    for (; i + SimdWidth <= count; i += SimdWidth)
+    {
+        SimdFloat x = SimdAnd(SimdCmpLE(SimdLoad(&boxes.m_minX[i]), px), SimdCmpGE(SimdLoad(&boxes.m_maxX[i]), px));
+        SimdFloat y = SimdAnd(SimdCmpLE(SimdLoad(&boxes.m_minY[i]), py), SimdCmpGE(SimdLoad(&boxes.m_maxY[i]), py));
+        SimdFloat z = SimdAnd(SimdCmpLE(SimdLoad(&boxes.m_minZ[i]), pz), SimdCmpGE(SimdLoad(&boxes.m_maxZ[i]), pz));
+        CompactIndices(SimdMoveMask(SimdAnd(SimdAnd(x, y), z)), i, indices, numIndices);
+    }
+
+    for (; i < count; ++i)
+    {
+        if (IsInside(boxes.Get(i), p))
+        {
+            indices[numIndices++] = static_cast<uint32_t>(i);
+        }
+    }
+    return numIndices;
+}
+
+Frustum::Frustum(const glm::mat4& m, bool depthZeroToOne)
+{
+    // The rows of the matrix (glm matrices are column-major).
+    const glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+    m_planes[PlaneLeft] = row3 + row0;
+    m_planes[PlaneRight] = row3 - row0;
+    m_planes[PlaneBottom] = row3 + row1;
+    m_planes[PlaneTop] = row3 - row1;
+    m_planes[PlaneNear] = depthZeroToOne ? row2 : (row3 + row2);
+    m_planes[PlaneFar] = row3 - row2;
+    for (glm::vec4& plane : m_planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+        {
+            plane /= length;
+        }
+    }
+}
+
+bool Frustum::Intersects(const BoundingBox& box) const
+{
+    const glm::vec3 center = (box.m_minCorner + box.m_maxCorner) * 0.5f;
+    const glm::vec3 extent = (box.m_maxCorner - box.m_minCorner) * 0.5f;
+    for (const glm::vec4& plane : m_planes)
+    {
+        // The box is outside if even its corner farthest along the normal is behind the plane.
+        const glm::vec3 normal = glm::vec3(plane);
+        if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::Intersects(const Sphere& sphere) const
+{
+    for (const glm::vec4& plane : m_planes)
+    {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SphereArray::Resize(size_t count)
+{
+    m_centerX.resize(count, 0.0f);
+    m_centerY.resize(count, 0.0f);
+    m_centerZ.resize(count, 0.0f);
+    m_radius.resize(count, 0.0f);
+}
+
+void SphereArray::PushBack(const Sphere& sphere)
+{
+    m_centerX.push_back(sphere.center.x);
+    m_centerY.push_back(sphere.center.y);
+    m_centerZ.push_back(sphere.center.z);
+    m_radius.push_back(sphere.radius);
+}
+
+void SphereArray::Set(size_t index, const Sphere& sphere)
+{
+    m_centerX[index] = sphere.center.x;
+    m_centerY[index] = sphere.center.y;
+    m_centerZ[index] = sphere.center.z;
+    m_radius[index] = sphere.radius;
+}
+
+Sphere SphereArray::Get(size_t index) const
+{
+    Sphere sphere;
+    sphere.center = glm::vec3(m_centerX[index], m_centerY[index], m_centerZ[index]);
+    sphere.radius = m_radius[index];
+    return sphere;
+}
+
+size_t CullBoundingBoxes(const AABBArray& boxes, size_t first, size_t count, const Frustum& frustum, uint32_t* indices)
+{
+    assert(first + count <= boxes.Size());
+    const SimdFloat half = SimdSet1(0.5f);
+    const SimdFloat zero = SimdZero();
+    size_t numIndices = 0;
+    size_t i = first;
+    // first may be any index, so use unaligned loads.
+    for (; i + SimdWidth <= first + count; i += SimdWidth)
+    {
+        const SimdFloat minX = SimdLoadU(&boxes.m_minX[i]);
+        const SimdFloat minY = SimdLoadU(&boxes.m_minY[i]);
+        const SimdFloat minZ = SimdLoadU(&boxes.m_minZ[i]);
+        const SimdFloat maxX = SimdLoadU(&boxes.m_maxX[i]);
+        const SimdFloat maxY = SimdLoadU(&boxes.m_maxY[i]);
+        const SimdFloat maxZ = SimdLoadU(&boxes.m_maxZ[i]);
+        const SimdFloat cx = SimdMul(SimdAdd(minX, maxX), half);
+        const SimdFloat cy = SimdMul(SimdAdd(minY, maxY), half);
+        const SimdFloat cz = SimdMul(SimdAdd(minZ, maxZ), half);
+        const SimdFloat ex = SimdMul(SimdSub(maxX, minX), half);
+        const SimdFloat ey = SimdMul(SimdSub(maxY, minY), half);
+        const SimdFloat ez = SimdMul(SimdSub(maxZ, minZ), half);
+
+        SimdFloat inside = SimdCmpGE(zero, zero); // all ones
+        for (const glm::vec4& plane : frustum.m_planes)
+        {
+            const SimdFloat nx = SimdSet1(plane.x);
+            const SimdFloat ny = SimdSet1(plane.y);
+            const SimdFloat nz = SimdSet1(plane.z);
+            SimdFloat distance = SimdMulAdd(nz, cz, SimdMulAdd(ny, cy, SimdMulAdd(nx, cx, SimdSet1(plane.w))));
+            SimdFloat radius = SimdMulAdd(SimdAbs(nz), ez, SimdMulAdd(SimdAbs(ny), ey, SimdMul(SimdAbs(nx), ex)));
+            inside = SimdAnd(inside, SimdCmpGE(SimdAdd(distance, radius), zero));
+        }
+        CompactIndices(SimdMoveMask(inside), i, indices, numIndices);
+    }
+
+    for (; i < first + count; ++i)
+    {
+        if (frustum.Intersects(boxes.Get(i)))
+        {
+            indices[numIndices++] = static_cast<uint32_t>(i);
+        }
+    }
+    return numIndices;
+}
+
+size_t CullBoundingSpheres(const SphereArray& spheres, size_t first, size_t count, const Frustum& frustum, uint32_t* indices)
+{
+    assert(first + count <= spheres.Size());
+    const SimdFloat zero = SimdZero();
+    size_t numIndices = 0;
+    size_t i = first;
+    for (; i + SimdWidth <= first + count; i += SimdWidth)
+    {
+        const SimdFloat cx = SimdLoadU(&spheres.m_centerX[i]);
+        const SimdFloat cy = SimdLoadU(&spheres.m_centerY[i]);
+        const SimdFloat cz = SimdLoadU(&spheres.m_centerZ[i]);
+        const SimdFloat radius = SimdLoadU(&spheres.m_radius[i]);
+
+        SimdFloat inside = SimdCmpGE(zero, zero); // all ones
+        for (const glm::vec4& plane : frustum.m_planes)
+        {
+            SimdFloat distance = SimdMulAdd(SimdSet1(plane.z), cz,
+                SimdMulAdd(SimdSet1(plane.y), cy, SimdMulAdd(SimdSet1(plane.x), cx, SimdSet1(plane.w))));
+            inside = SimdAnd(inside, SimdCmpGE(SimdAdd(distance, radius), zero));
+        }
+        CompactIndices(SimdMoveMask(inside), i, indices, numIndices);
+    }
+
+    for (; i < first + count; ++i)
+    {
+        if (frustum.Intersects(spheres.Get(i)))
+        {
+            indices[numIndices++] = static_cast<uint32_t>(i);
+        }
+    }
+    return numIndices;
+}
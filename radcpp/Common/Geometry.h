@@ -3,6 +3,8 @@
 #pragma once
 
 #include "radcpp/Common/Math.h"
+#include "radcpp/Common/Memory.h"
+#include <vector>
 
 struct Sphere
 {
@@ -18,7 +20,7 @@ struct BoundingBox
     BoundingBox()
     {
         m_minCorner = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
-        m_maxCorner = glm::vec3(FLT_MIN, FLT_MIN, FLT_MIN);
+        m_maxCorner = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
     }
 
     BoundingBox(const glm::vec3& p)
@@ -65,6 +67,12 @@ struct BoundingBox
             (*this)[(corner & 4) ? 1 : 0].z);
     }
 
+    // A default constructed box is empty (min > max), so that it can be used as the identity of Union.
+    bool IsEmpty() const
+    {
+        return (m_minCorner.x > m_maxCorner.x) || (m_minCorner.y > m_maxCorner.y) || (m_minCorner.z > m_maxCorner.z);
+    }
+
     glm::vec3 Diagonal() const
     {
         return m_maxCorner - m_minCorner;
@@ -141,10 +149,30 @@ struct BoundingBox
 
     void Expand(float delta)
     {
-        m_minCorner += delta;
+        m_minCorner -= delta;
         m_maxCorner += delta;
     }
 
+    // Transform the box and return the axis-aligned box of the result.
+    // Uses the center/extent form of Arvo's method: the new center is the transformed center,
+    // the new half extent is |M| * extent, where |M| is the upper 3x3 part of the matrix with absolute elements.
+    // Please refer to: James Arvo, Transforming Axis-Aligned Bounding Boxes, Graphics Gems, 1990.
+    friend BoundingBox Transform(const BoundingBox& b, const glm::mat4& m)
+    {
+        if (b.IsEmpty())
+        {
+            return b;
+        }
+        glm::vec3 center = (b.m_minCorner + b.m_maxCorner) * 0.5f;
+        glm::vec3 extent = (b.m_maxCorner - b.m_minCorner) * 0.5f;
+        glm::vec3 newCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+        glm::vec3 newExtent =
+            glm::abs(glm::vec3(m[0])) * extent.x +
+            glm::abs(glm::vec3(m[1])) * extent.y +
+            glm::abs(glm::vec3(m[2])) * extent.z;
+        return BoundingBox(newCenter - newExtent, newCenter + newExtent);
+    }
+
     Sphere GetBoundingSphere()
     {
         Sphere s;
@@ -160,6 +188,110 @@ struct BoundingBox
 
 }; // struct BoundingBox
 
+// Structure of Arrays (SoA) storage for many bounding boxes: each component is stored contiguously,
+// so that the batch kernels below can process 4 (SSE) or 8 (AVX) boxes per iteration.
+// The arrays are 32-byte aligned; the kernels handle any count (the remainder is processed with scalar code).
+class AABBArray
+{
+public:
+    using FloatArray = std::vector<float, boost::alignment::aligned_allocator<float, 32>>;
+
+    AABBArray() {}
+    AABBArray(size_t count) { Resize(count); }
+    ~AABBArray() {}
+
+    size_t Size() const { return m_minX.size(); }
+    bool IsEmpty() const { return m_minX.empty(); }
+
+    void Resize(size_t count);
+    void Reserve(size_t count);
+    void Clear();
+
+    void PushBack(const BoundingBox& box);
+    void Set(size_t index, const BoundingBox& box);
+    BoundingBox Get(size_t index) const;
+
+    FloatArray m_minX;
+    FloatArray m_minY;
+    FloatArray m_minZ;
+    FloatArray m_maxX;
+    FloatArray m_maxY;
+    FloatArray m_maxZ;
+
+}; // class AABBArray
+
+// Batch kernels over AABBArray; the boxes are assumed to be non-empty unless stated otherwise.
+// dst may alias src for the element-wise kernels.
+
+// Transform all boxes by the same matrix (Arvo's method); dispatched to the widest instruction set by BatchMath.
+void TransformBoundingBoxes(const AABBArray& src, const glm::mat4& transform, AABBArray& dst);
+// Transform box i by transforms[i] (Arvo's method).
+void TransformBoundingBoxes(const AABBArray& src, const glm::mat4* transforms, AABBArray& dst);
+// dst[i] = Union(a[i], b[i])
+void UnionBoundingBoxes(const AABBArray& a, const AABBArray& b, AABBArray& dst);
+// Returns the union of all boxes; empty boxes are ignored.
+BoundingBox UnionBoundingBoxes(const AABBArray& boxes);
+// Write the indices of the boxes overlapping the query box into indices (must hold boxes.Size() elements);
+// return the number of indices written.
+size_t OverlapBoundingBoxes(const AABBArray& boxes, const BoundingBox& query, uint32_t* indices);
+// Write the indices of the boxes entirely inside the query box; return the number of indices written.
+size_t ContainedBoundingBoxes(const AABBArray& boxes, const BoundingBox& query, uint32_t* indices);
+// Write the indices of the boxes containing the point; return the number of indices written.
+size_t BoundingBoxesContainingPoint(const AABBArray& boxes, const glm::vec3& p, uint32_t* indices);
+
+// Frustum bounded by 6 planes (left, right, bottom, top, near, far) stored as (normal, distance),
+// with the normals pointing inside: a point p is inside if dot(normal, p) + distance >= 0 for all planes.
+struct Frustum
+{
+    enum PlaneIndex
+    {
+        PlaneLeft,
+        PlaneRight,
+        PlaneBottom,
+        PlaneTop,
+        PlaneNear,
+        PlaneFar,
+        PlaneCount
+    };
+
+    glm::vec4 m_planes[PlaneCount];
+
+    Frustum() {}
+    // Extract the planes from a (view) projection matrix; the planes are in the space the matrix transforms from.
+    // depthZeroToOne: the clip space depth range is [0, 1] (Vulkan), or [-1, 1] (OpenGL).
+    // Please refer to: Gil Gribb and Klaus Hartmann, Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix, 2001.
+    Frustum(const glm::mat4& matrix, bool depthZeroToOne);
+
+    // The tests are conservative: a box or sphere outside the frustum but near a corner or edge may be reported as intersecting.
+    bool Intersects(const BoundingBox& box) const;
+    bool Intersects(const Sphere& sphere) const;
+
+}; // struct Frustum
+
+// SoA storage of bounding spheres.
+class SphereArray
+{
+public:
+    using FloatArray = AABBArray::FloatArray;
+
+    size_t Size() const { return m_centerX.size(); }
+    void Resize(size_t count);
+    void PushBack(const Sphere& sphere);
+    void Set(size_t index, const Sphere& sphere);
+    Sphere Get(size_t index) const;
+
+    FloatArray m_centerX;
+    FloatArray m_centerY;
+    FloatArray m_centerZ;
+    FloatArray m_radius;
+
+}; // class SphereArray
+
+// Frustum culling of boxes [first, first + count): write the indices of the boxes intersecting the frustum
+// (must hold count elements), and return the number of indices written. Ranges can be culled in parallel.
+size_t CullBoundingBoxes(const AABBArray& boxes, size_t first, size_t count, const Frustum& frustum, uint32_t* indices);
+size_t CullBoundingSpheres(const SphereArray& spheres, size_t first, size_t count, const Frustum& frustum, uint32_t* indices);
+
 // Coordinate System from a vector
 void ConstructCoordinateSystem(const glm::vec3& v1, glm::vec3& v2, glm::vec3& v3);
 
@@ -0,0 +1,561 @@
+#ifndef RADCPP_GPU_HASH_H
+#define RADCPP_GPU_HASH_H
+#pragma once
+
+#include "radcpp/Common/Math.h"
+#include <bit>
+
+// CPU port of VulkanEngine/Shaders/Hash.h with the same names and arithmetic, to validate GPU noise on the CPU.
+// The integer hashes are bit exact; the float hashes match as long as the shader compiler does not
+// contract or reorder the float math (and md5/trig depend on the precision of the GPU's sin).
+// Please refer to: Mark Jarzynski and Marc Olano, Hash Functions for GPU Rendering, JCGT 2020.
+namespace GpuHash
+{
+
+using uint = uint32_t;
+using glm::uvec2;
+using glm::uvec3;
+using glm::uvec4;
+using glm::vec2;
+using glm::vec3;
+using glm::vec4;
+
+constexpr uint c1 = 0xcc9e2d51u;
+constexpr uint c2 = 0x1b873593u;
+
+inline uint rotl(uint x, uint r) { return std::rotl(x, static_cast<int>(r)); }
+inline uint rotr(uint x, uint r) { return std::rotr(x, static_cast<int>(r)); }
+
+inline uint fmix(uint h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+inline uint mur(uint a, uint h)
+{
+    a *= c1;
+    a = rotr(a, 17u);
+    a *= c2;
+    h ^= a;
+    h = rotr(h, 19u);
+    return h * 5u + 0xe6546b64u;
+}
+
+inline uint bswap32(uint x)
+{
+    return (((x & 0x000000ffu) << 24) |
+        ((x & 0x0000ff00u) << 8) |
+        ((x & 0x00ff0000u) >> 8) |
+        ((x & 0xff000000u) >> 24));
+}
+
+inline uint taus(uint z, int s1, int s2, int s3, uint m)
+{
+    uint b = (((z << s1) ^ z) >> s2);
+    return (((z & m) << s3) ^ b);
+}
+
+inline uint seed(uvec2 p) { return 19u * p.x + 47u * p.y + 101u; }
+inline uint seed(uvec3 p) { return 19u * p.x + 47u * p.y + 101u * p.z + 131u; }
+inline uint seed(uvec4 p) { return 19u * p.x + 47u * p.y + 101u * p.z + 131u * p.w + 173u; }
+
+inline uint bbs(uint v)
+{
+    v = v % 65521u;
+    v = (v * v) % 65521u;
+    v = (v * v) % 65521u;
+    return v;
+}
+
+inline uint city(uint s)
+{
+    uint len = 4u;
+    uint b = 0u;
+    uint c = 9u;
+    for (uint i = 0u; i < len; i++)
+    {
+        uint v = (s >> (i * 8u)) & 0xffu;
+        b = b * c1 + v;
+        c ^= b;
+    }
+    return fmix(mur(b, mur(len, c)));
+}
+
+inline uint city(uvec2 s)
+{
+    uint len = 8u;
+    uint a = len, b = len * 5u, c = 9u, d = b;
+    a += bswap32(s.x);
+    b += bswap32(s.y);
+    c += bswap32(s.y);
+    return fmix(mur(c, mur(b, mur(a, d))));
+}
+
+inline uint city(uvec3 s)
+{
+    uint len = 12u;
+    uint a = len, b = len * 5u, c = 9u, d = b;
+    a += bswap32(s.x);
+    b += bswap32(s.z);
+    c += bswap32(s.y);
+    return fmix(mur(c, mur(b, mur(a, d))));
+}
+
+inline uint city(uvec4 s)
+{
+    uint len = 16u;
+    uint a = bswap32(s.w);
+    uint b = bswap32(s.y);
+    uint c = bswap32(s.z);
+    uint d = bswap32(s.z);
+    uint e = bswap32(s.x);
+    uint f = bswap32(s.w);
+    uint h = len;
+    return fmix(mur(f, mur(e, mur(d, mur(c, mur(b, mur(a, h)))))));
+}
+
+inline uint esgtsa(uint s)
+{
+    s = (s ^ 2747636419u) * 2654435769u;
+    s = (s ^ (s >> 16u)) * 2654435769u;
+    s = (s ^ (s >> 16u)) * 2654435769u;
+    return s;
+}
+
+inline float fast(vec2 v)
+{
+    v = (1.0f / 4320.0f) * v + vec2(0.25f, 0.0f);
+    float state = glm::fract(glm::dot(v * v, vec2(3571.0f)));
+    return glm::fract(state * state * (3571.0f * 2.0f));
+}
+
+inline float hashwithoutsine11(float p)
+{
+    p = glm::fract(p * 0.1031f);
+    p *= p + 33.33f;
+    p *= p + p;
+    return glm::fract(p);
+}
+
+inline float hashwithoutsine12(vec2 p)
+{
+    vec3 p3 = glm::fract(vec3(p.x, p.y, p.x) * 0.1031f);
+    p3 += glm::dot(p3, vec3(p3.y, p3.z, p3.x) + 33.33f);
+    return glm::fract((p3.x + p3.y) * p3.z);
+}
+
+inline float hashwithoutsine13(vec3 p3)
+{
+    p3 = glm::fract(p3 * 0.1031f);
+    p3 += glm::dot(p3, vec3(p3.y, p3.z, p3.x) + 33.33f);
+    return glm::fract((p3.x + p3.y) * p3.z);
+}
+
+inline vec2 hashwithoutsine2(vec3 p3)
+{
+    p3 += glm::dot(p3, vec3(p3.y, p3.z, p3.x) + 33.33f);
+    return glm::fract((vec2(p3.x, p3.x) + vec2(p3.y, p3.z)) * vec2(p3.z, p3.y));
+}
+
+inline vec2 hashwithoutsine21(float p)
+{
+    return hashwithoutsine2(glm::fract(vec3(p, p, p) * vec3(0.1031f, 0.1030f, 0.0973f)));
+}
+
+inline vec2 hashwithoutsine22(vec2 p)
+{
+    return hashwithoutsine2(glm::fract(vec3(p.x, p.y, p.x) * vec3(0.1031f, 0.1030f, 0.0973f)));
+}
+
+inline vec2 hashwithoutsine23(vec3 p3)
+{
+    return hashwithoutsine2(glm::fract(p3 * vec3(0.1031f, 0.1030f, 0.0973f)));
+}
+
+inline vec3 hashwithoutsine31(float p)
+{
+    vec3 p3 = glm::fract(vec3(p, p, p) * vec3(0.1031f, 0.1030f, 0.0973f));
+    p3 += glm::dot(p3, vec3(p3.y, p3.z, p3.x) + 33.33f);
+    return glm::fract((vec3(p3.x, p3.x, p3.y) + vec3(p3.y, p3.z, p3.z)) * vec3(p3.z, p3.y, p3.x));
+}
+
+inline vec3 hashwithoutsine32(vec2 p)
+{
+    vec3 p3 = glm::fract(vec3(p.x, p.y, p.x) * vec3(0.1031f, 0.1030f, 0.0973f));
+    p3 += glm::dot(p3, vec3(p3.y, p3.x, p3.z) + 33.33f);
+    return glm::fract((vec3(p3.x, p3.x, p3.y) + vec3(p3.y, p3.z, p3.z)) * vec3(p3.z, p3.y, p3.x));
+}
+
+inline vec3 hashwithoutsine33(vec3 p3)
+{
+    p3 = glm::fract(p3 * vec3(0.1031f, 0.1030f, 0.0973f));
+    p3 += glm::dot(p3, vec3(p3.y, p3.x, p3.z) + 33.33f);
+    return glm::fract((vec3(p3.x, p3.x, p3.y) + vec3(p3.y, p3.x, p3.x)) * vec3(p3.z, p3.y, p3.x));
+}
+
+inline vec4 hashwithoutsine4(vec4 p4)
+{
+    p4 += glm::dot(p4, vec4(p4.w, p4.z, p4.x, p4.y) + 33.33f);
+    return glm::fract((vec4(p4.x, p4.x, p4.y, p4.z) + vec4(p4.y, p4.z, p4.z, p4.w)) * vec4(p4.z, p4.y, p4.w, p4.x));
+}
+
+inline vec4 hashwithoutsine41(float p)
+{
+    return hashwithoutsine4(glm::fract(vec4(p, p, p, p) * vec4(0.1031f, 0.1030f, 0.0973f, 0.1099f)));
+}
+
+inline vec4 hashwithoutsine42(vec2 p)
+{
+    return hashwithoutsine4(glm::fract(vec4(p.x, p.y, p.x, p.y) * vec4(0.1031f, 0.1030f, 0.0973f, 0.1099f)));
+}
+
+inline vec4 hashwithoutsine43(vec3 p)
+{
+    return hashwithoutsine4(glm::fract(vec4(p.x, p.y, p.z, p.x) * vec4(0.1031f, 0.1030f, 0.0973f, 0.1099f)));
+}
+
+inline vec4 hashwithoutsine44(vec4 p4)
+{
+    return hashwithoutsine4(glm::fract(p4 * vec4(0.1031f, 0.1030f, 0.0973f, 0.1099f)));
+}
+
+inline uint hybridtaus(uvec4 z)
+{
+    z.x = taus(z.x, 13, 19, 12, 0xfffffffeu);
+    z.y = taus(z.y, 2, 25, 4, 0xfffffff8u);
+    z.z = taus(z.z, 3, 11, 17, 0xfffffff0u);
+    z.w = z.w * 1664525u + 1013904223u;
+    return z.x ^ z.y ^ z.z ^ z.w;
+}
+
+inline float ign(vec2 v)
+{
+    vec3 magic = vec3(0.06711056f, 0.00583715f, 52.9829189f);
+    return glm::fract(magic.z * glm::fract(glm::dot(v, vec2(magic.x, magic.y))));
+}
+
+inline uint iqint1(uint n)
+{
+    n = (n << 13u) ^ n;
+    n = n * (n * n * 15731u + 789221u) + 1376312589u;
+    return n;
+}
+
+inline uvec3 iqint2(uvec3 x)
+{
+    const uint k = 1103515245u;
+    x = ((x >> 8u) ^ uvec3(x.y, x.z, x.x)) * k;
+    x = ((x >> 8u) ^ uvec3(x.y, x.z, x.x)) * k;
+    x = ((x >> 8u) ^ uvec3(x.y, x.z, x.x)) * k;
+    return x;
+}
+
+inline uint iqint3(uvec2 x)
+{
+    uvec2 q = 1103515245u * ((x >> 1u) ^ uvec2(x.y, x.x));
+    uint n = 1103515245u * ((q.x) ^ (q.y >> 3u));
+    return n;
+}
+
+inline uint jkiss32(uvec2 p)
+{
+    uint x = p.x;
+    uint y = p.y;
+    uint z = 345678912u, w = 456789123u, c = 0u;
+    int t;
+    y ^= (y << 5); y ^= (y >> 7); y ^= (y << 22);
+    t = int(z + w + c); z = w; c = uint(t < 0); w = uint(t & 2147483647);
+    x += 1411392427u;
+    return x + y + w;
+}
+
+inline uint lcg(uint p)
+{
+    return p * 1664525u + 1013904223u;
+}
+
+namespace Md5
+{
+
+inline uint F(uvec3 v) { return (v.x & v.y) | (~v.x & v.z); }
+inline uint G(uvec3 v) { return (v.x & v.z) | (v.y & ~v.z); }
+inline uint H(uvec3 v) { return v.x ^ v.y ^ v.z; }
+inline uint I(uvec3 v) { return v.y ^ (v.x | ~v.z); }
+
+template<uint (*Function)(uvec3)>
+inline void Step(uvec4& v, uvec4& rotate, uint x, uint ac)
+{
+    v.x = v.y + rotl(v.x + Function(uvec3(v.y, v.z, v.w)) + x + ac, rotate.x);
+    rotate = uvec4(rotate.y, rotate.z, rotate.w, rotate.x);
+    v = uvec4(v.y, v.z, v.w, v.x);
+}
+
+inline uint K(uint i)
+{
+    return uint(std::abs(std::sin(float(i) + 1.0f)) * float(0xffffffffu));
+}
+
+} // namespace Md5
+
+inline uvec4 md5(uvec4 u)
+{
+    using namespace Md5;
+    const uvec4 digest = uvec4(0x67452301u, 0xefcdab89u, 0x98badcfeu, 0x10325476u);
+    uvec4 r, v = digest;
+    uint i = 0u;
+    uint M[16] = { u.x, u.y, u.z, u.w };
+
+    static const uint g[16] = { 1, 6, 11, 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12 };
+    static const uint h[16] = { 5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2 };
+    static const uint k[16] = { 0, 7, 14, 5, 12, 3, 10, 1, 8, 15, 6, 13, 4, 11, 2, 9 };
+    r = uvec4(7, 12, 17, 22);
+    for (uint j = 0; j < 16; ++j) { Step<F>(v, r, M[j], K(i++)); }
+    r = uvec4(5, 9, 14, 20);
+    for (uint j = 0; j < 16; ++j) { Step<G>(v, r, M[g[j]], K(i++)); }
+    r = uvec4(4, 11, 16, 23);
+    for (uint j = 0; j < 16; ++j) { Step<H>(v, r, M[h[j]], K(i++)); }
+    r = uvec4(6, 10, 15, 21);
+    for (uint j = 0; j < 16; ++j) { Step<I>(v, r, M[k[j]], K(i++)); }
+
+    return digest + v;
+}
+
+inline uint murmur3(const uint* seed, uint count)
+{
+    uint h = 0u;
+    for (uint i = 0; i < count; ++i)
+    {
+        uint k = seed[i];
+        k *= c1;
+        k = rotl(k, 15u);
+        k *= c2;
+        h ^= k;
+        h = rotl(h, 13u);
+        h = h * 5u + 0xe6546b64u;
+    }
+    h ^= count * 4u;
+    return fmix(h);
+}
+
+inline uint murmur3(uint seed) { return murmur3(&seed, 1); }
+inline uint murmur3(uvec2 seed) { return murmur3(&seed.x, 2); }
+inline uint murmur3(uvec3 seed) { return murmur3(&seed.x, 3); }
+inline uint murmur3(uvec4 seed) { return murmur3(&seed.x, 4); }
+
+inline uint pcg(uint v)
+{
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+inline uvec2 pcg2d(uvec2 v)
+{
+    v = v * 1664525u + 1013904223u;
+    v.x += v.y * 1664525u;
+    v.y += v.x * 1664525u;
+    v = v ^ (v >> 16u);
+    v.x += v.y * 1664525u;
+    v.y += v.x * 1664525u;
+    v = v ^ (v >> 16u);
+    return v;
+}
+
+inline uvec3 pcg3d(uvec3 v)
+{
+    v = v * 1664525u + 1013904223u;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v ^= v >> 16u;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    return v;
+}
+
+inline uvec3 pcg3d16(uvec3 v)
+{
+    v = v * 12829u + 47989u;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v >>= 16u;
+    return v;
+}
+
+inline uvec4 pcg4d(uvec4 v)
+{
+    v = v * 1664525u + 1013904223u;
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+    v ^= v >> 16u;
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+    return v;
+}
+
+inline float pseudo(vec2 v)
+{
+    v = glm::fract(v / 128.0f) * 128.0f + vec2(-64.340622f, -72.465622f);
+    return glm::fract(glm::dot(vec3(v.x, v.y, v.x) * vec3(v.x, v.y, v.y), vec3(20.390625f, 60.703125f, 2.4281209f)));
+}
+
+inline uint ranlim32(uint j)
+{
+    uint u, v, w1, w2, x, y;
+
+    v = 2244614371u;
+    w1 = 521288629u;
+    w2 = 362436069u;
+
+    u = j ^ v;
+
+    u = u * 2891336453u + 1640531513u;
+    v ^= v >> 13; v ^= v << 17; v ^= v >> 5;
+    w1 = 33378u * (w1 & 0xffffu) + (w1 >> 16);
+    w2 = 57225u * (w2 & 0xffffu) + (w2 >> 16);
+
+    v = u;
+
+    u = u * 2891336453u + 1640531513u;
+    v ^= v >> 13; v ^= v << 17; v ^= v >> 5;
+    w1 = 33378u * (w1 & 0xffffu) + (w1 >> 16);
+    w2 = 57225u * (w2 & 0xffffu) + (w2 >> 16);
+
+    x = u ^ (u << 9); x ^= x >> 17; x ^= x << 6;
+    y = w1 ^ (w1 << 17); y ^= y >> 15; y ^= y << 5;
+
+    return (x + v) ^ (y + w2);
+}
+
+// The shader starts at 4 for one component and 8 for more.
+inline uint superfast(const uint* data, uint count)
+{
+    uint hash = (count == 1) ? 4u : 8u, tmp;
+    for (uint i = 0; i < count; ++i)
+    {
+        hash += data[i] & 0xffffu;
+        tmp = (((data[i] >> 16) & 0xffffu) << 11) ^ hash;
+        hash = (hash << 16) ^ tmp;
+        hash += hash >> 11;
+    }
+    // Force "avalanching" of final 127 bits
+    hash ^= hash << 3;
+    hash += hash >> 5;
+    hash ^= hash << 4;
+    hash += hash >> 17;
+    hash ^= hash << 25;
+    hash += hash >> 6;
+    return hash;
+}
+
+inline uint superfast(uint data) { return superfast(&data, 1); }
+inline uint superfast(uvec2 data) { return superfast(&data.x, 2); }
+inline uint superfast(uvec3 data) { return superfast(&data.x, 3); }
+inline uint superfast(uvec4 data) { return superfast(&data.x, 4); }
+
+inline uvec2 tea(int tea, uvec2 p)
+{
+    uint s = 0u;
+    for (int i = 0; i < tea; i++)
+    {
+        s += 0x9E3779B9u;
+        p.x += (p.y << 4u) ^ (p.y + s) ^ (p.y >> 5u);
+        p.y += (p.x << 4u) ^ (p.x + s) ^ (p.x >> 5u);
+    }
+    return p;
+}
+
+inline float trig(vec2 p)
+{
+    return glm::fract(43757.5453f * std::sin(glm::dot(p, vec2(12.9898f, 78.233f))));
+}
+
+inline uint wang(uint v)
+{
+    v = (v ^ 61u) ^ (v >> 16u);
+    v *= 9u;
+    v ^= v >> 4u;
+    v *= 0x27d4eb2du;
+    v ^= v >> 15u;
+    return v;
+}
+
+inline uint xorshift128(uvec4 v)
+{
+    v.w ^= v.w << 11u;
+    v.w ^= v.w >> 8u;
+    v = uvec4(v.w, v.x, v.y, v.z);
+    v.x ^= v.y;
+    v.x ^= v.y >> 19u;
+    return v.x;
+}
+
+inline uint xorshift32(uint v)
+{
+    v ^= v << 13u;
+    v ^= v >> 17u;
+    v ^= v << 5u;
+    return v;
+}
+
+constexpr uint PRIME32_2 = 2246822519u, PRIME32_3 = 3266489917u;
+constexpr uint PRIME32_4 = 668265263u, PRIME32_5 = 374761393u;
+
+inline uint xxhash32Finalize(uint h32)
+{
+    h32 = PRIME32_2 * (h32 ^ (h32 >> 15));
+    h32 = PRIME32_3 * (h32 ^ (h32 >> 13));
+    return h32 ^ (h32 >> 16);
+}
+
+inline uint xxhash32(uint p)
+{
+    uint h32 = p + PRIME32_5;
+    h32 = PRIME32_4 * rotl(h32, 17);
+    return xxhash32Finalize(h32);
+}
+
+inline uint xxhash32(uvec2 p)
+{
+    uint h32 = p.y + PRIME32_5 + p.x * PRIME32_3;
+    h32 = PRIME32_4 * rotl(h32, 17);
+    return xxhash32Finalize(h32);
+}
+
+inline uint xxhash32(uvec3 p)
+{
+    uint h32 = p.z + PRIME32_5 + p.x * PRIME32_3;
+    h32 = PRIME32_4 * rotl(h32, 17);
+    h32 += p.y * PRIME32_3;
+    h32 = PRIME32_4 * rotl(h32, 17);
+    return xxhash32Finalize(h32);
+}
+
+inline uint xxhash32(uvec4 p)
+{
+    uint h32 = p.w + PRIME32_5 + p.x * PRIME32_3;
+    h32 = PRIME32_4 * rotl(h32, 17);
+    h32 += p.y * PRIME32_3;
+    h32 = PRIME32_4 * rotl(h32, 17);
+    h32 += p.z * PRIME32_3;
+    h32 = PRIME32_4 * rotl(h32, 17);
+    return xxhash32Finalize(h32);
+}
+
+} // namespace GpuHash
+
+#endif // RADCPP_GPU_HASH_H
@@ -0,0 +1,100 @@
+#include "radcpp/Common/Hash.h"
+#include <bit>
+
+static constexpr uint64_t XXHPrime64_1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t XXHPrime64_2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t XXHPrime64_3 = 0x165667B19E3779F9ull;
+static constexpr uint64_t XXHPrime64_4 = 0x85EBCA77C2B2AE63ull;
+static constexpr uint64_t XXHPrime64_5 = 0x27D4EB2F165667C5ull;
+
+// Little endian loads, unaligned.
+static uint64_t XXHRead64(const uint8_t* p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t XXHRead32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t XXHRound64(uint64_t acc, uint64_t input)
+{
+    acc += input * XXHPrime64_2;
+    acc = std::rotl(acc, 31);
+    return acc * XXHPrime64_1;
+}
+
+static uint64_t XXHMergeRound64(uint64_t acc, uint64_t value)
+{
+    acc ^= XXHRound64(0, value);
+    return acc * XXHPrime64_1 + XXHPrime64_4;
+}
+
+uint64_t XXHash64(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    uint64_t h;
+
+    if (size >= 32)
+    {
+        // Four independent lanes of 8 bytes.
+        uint64_t v1 = seed + XXHPrime64_1 + XXHPrime64_2;
+        uint64_t v2 = seed + XXHPrime64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXHPrime64_1;
+        const uint8_t* limit = end - 32;
+        do
+        {
+            v1 = XXHRound64(v1, XXHRead64(p));
+            v2 = XXHRound64(v2, XXHRead64(p + 8));
+            v3 = XXHRound64(v3, XXHRead64(p + 16));
+            v4 = XXHRound64(v4, XXHRead64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        h = XXHMergeRound64(h, v1);
+        h = XXHMergeRound64(h, v2);
+        h = XXHMergeRound64(h, v3);
+        h = XXHMergeRound64(h, v4);
+    }
+    else
+    {
+        h = seed + XXHPrime64_5;
+    }
+
+    h += static_cast<uint64_t>(size);
+
+    while (p + 8 <= end)
+    {
+        h ^= XXHRound64(0, XXHRead64(p));
+        h = std::rotl(h, 27) * XXHPrime64_1 + XXHPrime64_4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= uint64_t(XXHRead32(p)) * XXHPrime64_1;
+        h = std::rotl(h, 23) * XXHPrime64_2 + XXHPrime64_3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= (*p) * XXHPrime64_5;
+        h = std::rotl(h, 11) * XXHPrime64_1;
+        ++p;
+    }
+
+    // Avalanche.
+    h ^= h >> 33;
+    h *= XXHPrime64_2;
+    h ^= h >> 29;
+    h *= XXHPrime64_3;
+    h ^= h >> 32;
+    return h;
+}
@@ -0,0 +1,19 @@
+#ifndef RADCPP_HASH_H
+#define RADCPP_HASH_H
+#pragma once
+
+#include "radcpp/Common/Common.h"
+
+// Non-cryptographic hashes of byte arrays, for content keys of caches.
+
+// XXH64: 64-bit hash at memory bandwidth, the same result on all platforms.
+// Please refer to: https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+uint64_t XXHash64(const void* data, size_t size, uint64_t seed = 0);
+
+// Mix a value into a 64-bit hash.
+inline uint64_t HashCombine64(uint64_t seed, uint64_t value)
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 12) + (seed >> 4));
+}
+
+#endif // RADCPP_HASH_H
@@ -1,4 +1,5 @@
 #include "radcpp/Common/Math.h"
+#include "radcpp/Common/Simd.h"
 
 // Finds solutions of the quadratic equation at^2 + bt + c = 0; return true if solutions were found.
 // Please refer to: https://pbr-book.org/3ed-2018/Utilities/Mathematical_Routines
@@ -24,4 +25,141 @@ bool SolveQuadraticEquation(float a, float b, float c, float& t0, float& t1)
         std::swap(t0, t1);
     }
     return true;
-}
\ No newline at end of file
+}
+
+// Apply op to the full SIMD vectors, then to the tail padded with 1.
+template<typename Op>
+static void SimdTransform(const float* src, float* dst, size_t count, Op op)
+{
+    size_t i = 0;
+    for (; i + SimdWidth <= count; i += SimdWidth)
+    {
+        SimdStoreU(dst + i, op(SimdLoadU(src + i)));
+    }
+    if (i < count)
+    {
+        alignas(32) float tail[SimdWidth];
+        for (size_t j = 0; j < SimdWidth; ++j)
+        {
+            tail[j] = (i + j < count) ? src[i + j] : 1.0f;
+        }
+        SimdStore(tail, op(SimdLoad(tail)));
+        for (size_t j = 0; i + j < count; ++j)
+        {
+            dst[i + j] = tail[j];
+        }
+    }
+}
+
+void Exp(const float* src, float* dst, size_t count, MathAccuracy accuracy)
+{
+    if (accuracy == MathAccuracy::Fast)
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdExpFast(x); });
+    }
+    else
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdExp(x); });
+    }
+}
+
+void Log(const float* src, float* dst, size_t count, MathAccuracy accuracy)
+{
+    if (accuracy == MathAccuracy::Fast)
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdLogFast(x); });
+    }
+    else
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdLog(x); });
+    }
+}
+
+void Sin(const float* src, float* dst, size_t count, MathAccuracy accuracy)
+{
+    if (accuracy == MathAccuracy::Fast)
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdSinFast(x); });
+    }
+    else
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdSin(x); });
+    }
+}
+
+void Cos(const float* src, float* dst, size_t count, MathAccuracy accuracy)
+{
+    if (accuracy == MathAccuracy::Fast)
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdCosFast(x); });
+    }
+    else
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdCos(x); });
+    }
+}
+
+void Pow(const float* x, const float* y, float* dst, size_t count, MathAccuracy accuracy)
+{
+    size_t i = 0;
+    for (; i + SimdWidth <= count; i += SimdWidth)
+    {
+        SimdFloat vx = SimdLoadU(x + i);
+        SimdFloat vy = SimdLoadU(y + i);
+        SimdStoreU(dst + i, (accuracy == MathAccuracy::Fast) ? SimdPowFast(vx, vy) : SimdPow(vx, vy));
+    }
+    if (i < count)
+    {
+        alignas(32) float tailX[SimdWidth];
+        alignas(32) float tailY[SimdWidth];
+        for (size_t j = 0; j < SimdWidth; ++j)
+        {
+            tailX[j] = (i + j < count) ? x[i + j] : 1.0f;
+            tailY[j] = (i + j < count) ? y[i + j] : 1.0f;
+        }
+        SimdFloat vx = SimdLoad(tailX);
+        SimdFloat vy = SimdLoad(tailY);
+        SimdStore(tailX, (accuracy == MathAccuracy::Fast) ? SimdPowFast(vx, vy) : SimdPow(vx, vy));
+        for (size_t j = 0; i + j < count; ++j)
+        {
+            dst[i + j] = tailX[j];
+        }
+    }
+}
+
+void Pow(const float* x, float y, float* dst, size_t count, MathAccuracy accuracy)
+{
+    const SimdFloat vy = SimdSet1(y);
+    if (accuracy == MathAccuracy::Fast)
+    {
+        SimdTransform(x, dst, count, [vy](SimdFloat v) { return SimdPowFast(v, vy); });
+    }
+    else
+    {
+        SimdTransform(x, dst, count, [vy](SimdFloat v) { return SimdPow(v, vy); });
+    }
+}
+
+void LinearToSrgb(const float* src, float* dst, size_t count, MathAccuracy accuracy)
+{
+    if (accuracy == MathAccuracy::Fast)
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdLinearToSrgbFast(x); });
+    }
+    else
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdLinearToSrgb(x); });
+    }
+}
+
+void SrgbToLinear(const float* src, float* dst, size_t count, MathAccuracy accuracy)
+{
+    if (accuracy == MathAccuracy::Fast)
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdSrgbToLinearFast(x); });
+    }
+    else
+    {
+        SimdTransform(src, dst, count, [](SimdFloat x) { return SimdSrgbToLinear(x); });
+    }
+}
@@ -25,4 +25,25 @@
 
 bool SolveQuadraticEquation(float a, float b, float c, float& t0, float& t1);
 
+// Vectorized transcendental functions over float arrays (dst may alias src).
+// Precise: within about 1 ulp of <cmath>; Fast: within about 1e-4 relative error, about twice as fast.
+// Denormal results flush to zero; Sin and Cos are within 1 ulp on [-pi, pi], and within 1e-7 absolute error
+// for |x| < 8192 (beyond, the reduction loses precision);
+// Pow is exp(y * log(x)) for x >= 0 (NaN for x < 0).
+enum class MathAccuracy
+{
+    Precise,
+    Fast,
+};
+
+void Exp(const float* src, float* dst, size_t count, MathAccuracy accuracy = MathAccuracy::Precise);
+void Log(const float* src, float* dst, size_t count, MathAccuracy accuracy = MathAccuracy::Precise);
+void Sin(const float* src, float* dst, size_t count, MathAccuracy accuracy = MathAccuracy::Precise);
+void Cos(const float* src, float* dst, size_t count, MathAccuracy accuracy = MathAccuracy::Precise);
+void Pow(const float* x, const float* y, float* dst, size_t count, MathAccuracy accuracy = MathAccuracy::Precise);
+void Pow(const float* x, float y, float* dst, size_t count, MathAccuracy accuracy = MathAccuracy::Precise);
+// sRGB transfer functions (IEC 61966-2-1) for texture processing, on values in [0, 1].
+void LinearToSrgb(const float* src, float* dst, size_t count, MathAccuracy accuracy = MathAccuracy::Precise);
+void SrgbToLinear(const float* src, float* dst, size_t count, MathAccuracy accuracy = MathAccuracy::Precise);
+
 #endif // RADCPP_MATH_H
\ No newline at end of file
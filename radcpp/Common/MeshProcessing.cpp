@@ -0,0 +1,826 @@
+#include "radcpp/Common/MeshProcessing.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <unordered_map>
+
+static uint32_t HashVertex(const uint8_t* vertex, size_t vertexStride)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < vertexStride; ++i)
+    {
+        hash ^= vertex[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+size_t GenerateVertexRemap(uint32_t* remap, const void* vertices, size_t vertexCount, size_t vertexStride)
+{
+    const uint8_t* vertexData = static_cast<const uint8_t*>(vertices);
+    // Open addressing hash table of vertex indices, with a power of two size and a load factor below 0.5.
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2)
+    {
+        tableSize *= 2;
+    }
+    std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+    uint32_t uniqueCount = 0;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const uint8_t* vertex = vertexData + i * vertexStride;
+        size_t slot = HashVertex(vertex, vertexStride) & (tableSize - 1);
+        while (true)
+        {
+            uint32_t entry = table[slot];
+            if (entry == UINT32_MAX)
+            {
+                table[slot] = static_cast<uint32_t>(i);
+                remap[i] = uniqueCount++;
+                break;
+            }
+            if (memcmp(vertexData + entry * vertexStride, vertex, vertexStride) == 0)
+            {
+                remap[i] = remap[entry];
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+    return uniqueCount;
+}
+
+void RemapVertexBuffer(void* dst, const void* vertices, size_t vertexCount, size_t vertexStride, const uint32_t* remap)
+{
+    uint8_t* dstData = static_cast<uint8_t*>(dst);
+    const uint8_t* srcData = static_cast<const uint8_t*>(vertices);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        if (remap[i] != UINT32_MAX)
+        {
+            memcpy(dstData + remap[i] * vertexStride, srcData + i * vertexStride, vertexStride);
+        }
+    }
+}
+
+void RemapIndexBuffer(uint32_t* dst, const uint32_t* indices, size_t indexCount, const uint32_t* remap)
+{
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        dst[i] = remap[indices[i]];
+    }
+}
+
+// Scoring of Forsyth's algorithm.
+static constexpr uint32_t ForsythCacheSize = 32;
+static constexpr float ForsythCacheDecayPower = 1.5f;
+static constexpr float ForsythLastTriangleScore = 0.75f;
+static constexpr float ForsythValenceBoostScale = 2.0f;
+static constexpr float ForsythValenceBoostPower = 0.5f;
+
+static float ForsythVertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // The vertices of the last triangle: a fixed score, so that strips are not favored over fans.
+            score = ForsythLastTriangleScore;
+        }
+        else
+        {
+            const float scaler = 1.0f / (ForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, ForsythCacheDecayPower);
+        }
+    }
+    // Boost the vertices with few triangles left, to get rid of lone triangles.
+    score += ForsythValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -ForsythValenceBoostPower);
+    return score;
+}
+
+void OptimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Vertex to triangle adjacency.
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        remainingTriangles[indices[i]]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                adjacency[fill[indices[3 * t + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScores[v] = ForsythVertexScore(-1, remainingTriangles[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        triangleScores[t] = vertexScores[indices[3 * t + 0]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+    }
+
+    // The cache holds up to ForsythCacheSize + 3 vertices while a triangle is added.
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(ForsythCacheSize + 3);
+    newCache.reserve(ForsythCacheSize + 3);
+
+    // Start with the best triangle.
+    size_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+    size_t nextUnemitted = 0;
+    for (size_t outputTriangle = 0; outputTriangle < triangleCount; ++outputTriangle)
+    {
+        if (bestTriangle == SIZE_MAX)
+        {
+            // Dead end: no triangle in the cache is left, continue with the first one not emitted.
+            while (emitted[nextUnemitted])
+            {
+                ++nextUnemitted;
+            }
+            bestTriangle = nextUnemitted;
+        }
+
+        const uint32_t* triangle = indices + 3 * bestTriangle;
+        dst[3 * outputTriangle + 0] = triangle[0];
+        dst[3 * outputTriangle + 1] = triangle[1];
+        dst[3 * outputTriangle + 2] = triangle[2];
+        emitted[bestTriangle] = true;
+
+        // Remove the triangle from the adjacency of its vertices.
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = triangle[k];
+            uint32_t* begin = adjacency.data() + adjacencyOffsets[v];
+            uint32_t* end = begin + remainingTriangles[v];
+            uint32_t* it = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+            std::swap(*it, *(end - 1));
+            remainingTriangles[v]--;
+        }
+
+        // Move the vertices of the triangle to the front of the cache.
+        newCache.clear();
+        newCache.insert(newCache.end(), triangle, triangle + 3);
+        for (uint32_t v : cache)
+        {
+            if ((v != triangle[0]) && (v != triangle[1]) && (v != triangle[2]))
+            {
+                newCache.push_back(v);
+            }
+        }
+        // Vertices falling off the cache need their scores updated too.
+        for (size_t i = ForsythCacheSize; i < newCache.size(); ++i)
+        {
+            cachePositions[newCache[i]] = -1;
+            vertexScores[newCache[i]] = ForsythVertexScore(-1, remainingTriangles[newCache[i]]);
+        }
+        const size_t evictedBegin = std::min<size_t>(newCache.size(), ForsythCacheSize);
+        for (size_t i = 0; i < evictedBegin; ++i)
+        {
+            uint32_t v = newCache[i];
+            cachePositions[v] = static_cast<int>(i);
+            vertexScores[v] = ForsythVertexScore(static_cast<int>(i), remainingTriangles[v]);
+        }
+
+        // Update the scores of the triangles around the vertices changed, and find the best one.
+        bestTriangle = SIZE_MAX;
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < newCache.size(); ++i)
+        {
+            uint32_t v = newCache[i];
+            for (uint32_t j = 0; j < remainingTriangles[v]; ++j)
+            {
+                uint32_t t = adjacency[adjacencyOffsets[v] + j];
+                float score = vertexScores[indices[3 * t + 0]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        newCache.resize(evictedBegin);
+        std::swap(cache, newCache);
+    }
+}
+
+// Number of vertices missing a FIFO cache of cacheSize vertices for each triangle.
+static void SimulateVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize,
+    const std::function<void(size_t triangleIndex, uint32_t missCount)>& callback, std::vector<uint32_t>& timestamps)
+{
+    // A vertex is in the cache if it was inserted less than cacheSize insertions ago.
+    timestamps.assign(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    for (size_t t = 0; t < indexCount / 3; ++t)
+    {
+        uint32_t missCount = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = indices[3 * t + k];
+            if (time - timestamps[v] > cacheSize)
+            {
+                timestamps[v] = time++;
+                missCount++;
+            }
+        }
+        callback(t, missCount);
+    }
+}
+
+void OptimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+    const glm::vec3* positions, size_t vertexCount, float threshold)
+{
+    constexpr uint32_t CacheSize = 16;
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Hard boundaries: where the cache is flushed (all the vertices of a triangle miss),
+    // reordering the clusters costs nothing.
+    std::vector<uint32_t> missCounts(triangleCount);
+    std::vector<uint32_t> timestamps;
+    SimulateVertexCache(indices, indexCount, vertexCount, CacheSize,
+        [&](size_t t, uint32_t missCount) { missCounts[t] = missCount; }, timestamps);
+    std::vector<size_t> hardBoundaries;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if ((t == 0) || (missCounts[t] == 3))
+        {
+            hardBoundaries.push_back(t);
+        }
+    }
+    hardBoundaries.push_back(triangleCount);
+
+    // Soft boundaries: split a hard cluster where the ACMR of the part so far, rendered with a cold cache,
+    // is within the threshold of the ACMR of the whole hard cluster.
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+    {
+        const size_t begin = hardBoundaries[c];
+        const size_t end = hardBoundaries[c + 1];
+        uint32_t hardMissCount = 0;
+        for (size_t t = begin; t < end; ++t)
+        {
+            hardMissCount += missCounts[t];
+        }
+        const float hardACMR = float(hardMissCount) / float(end - begin);
+
+        uint32_t time = CacheSize + 1;
+        std::fill(timestamps.begin(), timestamps.end(), 0);
+        size_t clusterBegin = begin;
+        uint32_t clusterMissCount = 0;
+        clusters.push_back(begin);
+        for (size_t t = begin; t < end; ++t)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t v = indices[3 * t + k];
+                if (time - timestamps[v] > CacheSize)
+                {
+                    timestamps[v] = time++;
+                    clusterMissCount++;
+                }
+            }
+            const size_t clusterSize = t + 1 - clusterBegin;
+            if ((t + 1 < end) && (float(clusterMissCount) <= threshold * hardACMR * float(clusterSize)))
+            {
+                clusters.push_back(t + 1);
+                clusterBegin = t + 1;
+                clusterMissCount = 0;
+                time += CacheSize + 1; // flush
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // Sort the clusters by how much they face outwards from the mesh center.
+    glm::dvec3 meshCenter(0.0);
+    double meshArea = 0.0;
+    const size_t clusterCount = clusters.size() - 1;
+    std::vector<glm::vec3> clusterCenters(clusterCount);
+    std::vector<glm::vec3> clusterNormals(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        glm::dvec3 center(0.0);
+        glm::dvec3 normal(0.0);
+        double area = 0.0;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const glm::vec3& p0 = positions[indices[3 * t + 0]];
+            const glm::vec3& p1 = positions[indices[3 * t + 1]];
+            const glm::vec3& p2 = positions[indices[3 * t + 2]];
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            double triangleArea = glm::length(n);
+            center += glm::dvec3(p0 + p1 + p2) * (triangleArea / 3.0);
+            normal += glm::dvec3(n);
+            area += triangleArea;
+        }
+        meshCenter += center;
+        meshArea += area;
+        clusterCenters[c] = (area > 0.0) ? glm::vec3(center / area) : positions[indices[3 * clusters[c]]];
+        double normalLength = glm::length(normal);
+        clusterNormals[c] = (normalLength > 0.0) ? glm::vec3(normal / normalLength) : glm::vec3(0.0f);
+    }
+    if (meshArea > 0.0)
+    {
+        meshCenter /= meshArea;
+    }
+
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        sortKeys[c] = glm::dot(clusterCenters[c] - glm::vec3(meshCenter), clusterNormals[c]);
+    }
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    size_t outputIndex = 0;
+    for (size_t c : order)
+    {
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            dst[outputIndex++] = indices[3 * t + 0];
+            dst[outputIndex++] = indices[3 * t + 1];
+            dst[outputIndex++] = indices[3 * t + 2];
+        }
+    }
+}
+
+size_t GenerateVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    std::fill(remap, remap + vertexCount, UINT32_MAX);
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t v = indices[i];
+        if (remap[v] == UINT32_MAX)
+        {
+            remap[v] = nextVertex++;
+        }
+    }
+    return nextVertex;
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+    uint32_t cacheSize)
+{
+    VertexCacheStatistics stats = {};
+    std::vector<uint32_t> timestamps;
+    SimulateVertexCache(indices, indexCount, vertexCount, cacheSize,
+        [&](size_t, uint32_t missCount) { stats.vertexTransformCount += missCount; }, timestamps);
+    const size_t triangleCount = indexCount / 3;
+    stats.acmr = (triangleCount > 0) ? float(stats.vertexTransformCount) / float(triangleCount) : 0.0f;
+    stats.atvr = (vertexCount > 0) ? float(stats.vertexTransformCount) / float(vertexCount) : 0.0f;
+    return stats;
+}
+
+// Sum of weighted squared distances to planes: Q(p) = p^T A p + 2 b^T p + c, with A symmetric.
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight;
+
+    void AddPlane(const glm::dvec3& n, double d, double w)
+    {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+        b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& q)
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+        return *this;
+    }
+
+    // Weighted mean squared distance.
+    double Evaluate(const glm::vec3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double error =
+            a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z +
+            a11 * y * y + 2.0 * a12 * y * z + a22 * z * z +
+            2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return (weight > 0.0) ? std::max(error, 0.0) / weight : 0.0;
+    }
+
+}; // struct Quadric
+
+size_t SimplifyMesh(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+    const glm::vec3* positions, size_t vertexCount, size_t targetIndexCount, float targetError,
+    float* resultError)
+{
+    std::copy(indices, indices + indexCount, dst);
+    double maxError = 0.0;
+    const double maxErrorAllowed = double(targetError) * double(targetError);
+
+    // Lock the vertices whose position is shared with other vertices (seams of normals, UVs...).
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::vector<uint32_t> positionRemap(vertexCount);
+        GenerateVertexRemap(positionRemap.data(), positions, vertexCount, sizeof(glm::vec3));
+        std::vector<uint32_t> positionUseCounts(vertexCount, 0);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            positionUseCounts[positionRemap[v]]++;
+        }
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            locked[v] = (positionUseCounts[positionRemap[v]] > 1);
+        }
+    }
+    // Lock the vertices on borders and non-manifold edges.
+    {
+        std::unordered_map<uint64_t, uint32_t> edgeUseCounts;
+        edgeUseCounts.reserve(indexCount);
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t a = indices[i + k];
+                uint32_t b = indices[i + (k + 1) % 3];
+                edgeUseCounts[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)]++;
+            }
+        }
+        for (const auto& [edge, useCount] : edgeUseCounts)
+        {
+            if (useCount != 2)
+            {
+                locked[uint32_t(edge >> 32)] = true;
+                locked[uint32_t(edge)] = true;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        glm::dvec3 p0 = positions[indices[i + 0]];
+        glm::dvec3 p1 = positions[indices[i + 1]];
+        glm::dvec3 p2 = positions[indices[i + 2]];
+        glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(n);
+        if (length > 0.0)
+        {
+            n /= length;
+            double d = -glm::dot(n, p0);
+            // Weighted by area.
+            for (int k = 0; k < 3; ++k)
+            {
+                quadrics[indices[i + k]].AddPlane(n, d, length * 0.5);
+            }
+        }
+    }
+
+    struct Collapse
+    {
+        uint32_t v0; // removed
+        uint32_t v1; // kept
+        double error;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> collapsedInPass(vertexCount);
+
+    // Collapse independent edges in passes, cheapest first; a vertex takes part in one collapse per pass,
+    // so that the triangles around each collapse are still those of the pass start.
+    while (indexCount > targetIndexCount)
+    {
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            adjacencyOffsets[dst[i] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(indexCount);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < indexCount; ++i)
+            {
+                adjacency[fill[dst[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t a = dst[i + k];
+                uint32_t b = dst[i + (k + 1) % 3];
+                for (int direction = 0; direction < 2; ++direction)
+                {
+                    if (!locked[a])
+                    {
+                        Quadric q = quadrics[a];
+                        q += quadrics[b];
+                        collapses.push_back({ a, b, q.Evaluate(positions[b]) });
+                    }
+                    std::swap(a, b);
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(collapsedInPass.begin(), collapsedInPass.end(), false);
+        const size_t trianglesToRemove = (indexCount - targetIndexCount + 2) / 3;
+        size_t trianglesRemoved = 0;
+        size_t collapseCount = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if ((collapse.error > maxErrorAllowed) || (trianglesRemoved >= trianglesToRemove))
+            {
+                break;
+            }
+            const uint32_t v0 = collapse.v0;
+            const uint32_t v1 = collapse.v1;
+            if (collapsedInPass[v0] || collapsedInPass[v1])
+            {
+                continue;
+            }
+
+            // Reject collapses flipping a triangle around v0.
+            bool flipped = false;
+            size_t degenerateCount = 0;
+            for (uint32_t j = adjacencyOffsets[v0]; j < adjacencyOffsets[v0 + 1]; ++j)
+            {
+                const uint32_t* triangle = dst + 3 * adjacency[j];
+                if ((triangle[0] == v1) || (triangle[1] == v1) || (triangle[2] == v1))
+                {
+                    degenerateCount++;
+                    continue;
+                }
+                glm::vec3 p[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+                glm::vec3 normalBefore = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int k = 0; k < 3; ++k)
+                {
+                    if (triangle[k] == v0)
+                    {
+                        p[k] = positions[v1];
+                    }
+                }
+                glm::vec3 normalAfter = glm::cross(p[1] - p[0], p[2] - p[0]);
+                // Also reject turning by more than ~75 degrees, which folds thin triangles over their neighbors.
+                if (glm::dot(normalBefore, normalAfter) <= 0.25f * glm::length(normalBefore) * glm::length(normalAfter))
+                {
+                    flipped = true;
+                    break;
+                }
+            }
+            if (flipped)
+            {
+                continue;
+            }
+
+            remap[v0] = v1;
+            quadrics[v1] += quadrics[v0];
+            for (uint32_t j = adjacencyOffsets[v0]; j < adjacencyOffsets[v0 + 1]; ++j)
+            {
+                const uint32_t* triangle = dst + 3 * adjacency[j];
+                collapsedInPass[triangle[0]] = true;
+                collapsedInPass[triangle[1]] = true;
+                collapsedInPass[triangle[2]] = true;
+            }
+            trianglesRemoved += degenerateCount;
+            maxError = std::max(maxError, collapse.error);
+            collapseCount++;
+        }
+
+        if (collapseCount == 0)
+        {
+            break;
+        }
+
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            uint32_t a = remap[dst[i + 0]];
+            uint32_t b = remap[dst[i + 1]];
+            uint32_t c = remap[dst[i + 2]];
+            if ((a != b) && (b != c) && (c != a))
+            {
+                dst[writeIndex++] = a;
+                dst[writeIndex++] = b;
+                dst[writeIndex++] = c;
+            }
+        }
+        indexCount = writeIndex;
+    }
+
+    if (resultError)
+    {
+        *resultError = static_cast<float>(std::sqrt(maxError));
+    }
+    return indexCount;
+}
+
+glm::vec2 EncodeOctahedral(const glm::vec3& v)
+{
+    const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    // Degenerate vectors (zero, or with NaN or infinite components) would give NaN.
+    if (!(l1 > 0.0f) || !std::isfinite(l1))
+    {
+        return glm::vec2(0.0f);
+    }
+    glm::vec3 n = v / l1;
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        // Fold the lower hemisphere over the diagonals.
+        e.x = (1.0f - std::abs(n.y)) * ((n.x >= 0.0f) ? 1.0f : -1.0f);
+        e.y = (1.0f - std::abs(n.x)) * ((n.y >= 0.0f) ? 1.0f : -1.0f);
+    }
+    return e;
+}
+
+glm::vec3 DecodeOctahedral(const glm::vec2& e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += (n.x >= 0.0f) ? -t : t;
+    n.y += (n.y >= 0.0f) ? -t : t;
+    return glm::normalize(n);
+}
+
+void BuildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices,
+    std::vector<uint32_t>& meshletTriangles, const uint32_t* indices, size_t indexCount, size_t vertexCount,
+    size_t maxVertices, size_t maxTriangles)
+{
+    assert((maxVertices >= 3) && (maxVertices <= 256) && (maxTriangles >= 1));
+    meshlets.clear();
+    meshletVertices.clear();
+    meshletTriangles.clear();
+    meshletTriangles.reserve(indexCount / 3);
+
+    // Local index of the vertices in the current meshlet.
+    std::vector<uint32_t> localIndices(vertexCount, UINT32_MAX);
+    Meshlet meshlet = {};
+    auto finishMeshlet = [&]()
+    {
+        for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+        {
+            localIndices[meshletVertices[meshlet.vertexOffset + i]] = UINT32_MAX;
+        }
+        meshlets.push_back(meshlet);
+        meshlet.vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+        meshlet.triangleOffset = static_cast<uint32_t>(meshletTriangles.size());
+        meshlet.vertexCount = 0;
+        meshlet.triangleCount = 0;
+    };
+
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        const uint32_t a = indices[i + 0];
+        const uint32_t b = indices[i + 1];
+        const uint32_t c = indices[i + 2];
+        uint32_t newVertexCount = (localIndices[a] == UINT32_MAX);
+        newVertexCount += (localIndices[b] == UINT32_MAX) && (b != a);
+        newVertexCount += (localIndices[c] == UINT32_MAX) && (c != a) && (c != b);
+        if ((meshlet.vertexCount + newVertexCount > maxVertices) || (meshlet.triangleCount >= maxTriangles))
+        {
+            finishMeshlet();
+        }
+
+        uint32_t packed = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = indices[i + k];
+            if (localIndices[v] == UINT32_MAX)
+            {
+                localIndices[v] = meshlet.vertexCount++;
+                meshletVertices.push_back(v);
+            }
+            packed |= localIndices[v] << (8 * k);
+        }
+        meshletTriangles.push_back(packed);
+        meshlet.triangleCount++;
+    }
+    if (meshlet.triangleCount > 0)
+    {
+        finishMeshlet();
+    }
+}
+
+MeshletBounds ComputeMeshletBounds(const Meshlet& meshlet, const uint32_t* meshletVertices,
+    const uint32_t* meshletTriangles, const glm::vec3* positions)
+{
+    MeshletBounds bounds = {};
+    const uint32_t* vertices = meshletVertices + meshlet.vertexOffset;
+    const uint32_t* triangles = meshletTriangles + meshlet.triangleOffset;
+
+    // Bounding sphere: centered on the bounding box.
+    BoundingBox box;
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+    {
+        box = Union(box, positions[vertices[i]]);
+    }
+    bounds.center = box.GetCenter();
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+    {
+        bounds.radius = std::max(bounds.radius, glm::distance(bounds.center, positions[vertices[i]]));
+    }
+
+    // Normal cone: the axis is the average normal, and the apex is moved back so that the cone
+    // contains the back-facing region of every triangle.
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> corners;
+    normals.reserve(meshlet.triangleCount);
+    corners.reserve(meshlet.triangleCount);
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = 0; i < meshlet.triangleCount; ++i)
+    {
+        const glm::vec3& p0 = positions[vertices[(triangles[i] >> 0) & 0xFF]];
+        const glm::vec3& p1 = positions[vertices[(triangles[i] >> 8) & 0xFF]];
+        const glm::vec3& p2 = positions[vertices[(triangles[i] >> 16) & 0xFF]];
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normals.push_back(normal / length);
+            corners.push_back(p0);
+            axis += normals.back();
+        }
+    }
+
+    bounds.coneApex = bounds.center;
+    bounds.coneAxis = glm::vec3(0.0f);
+    bounds.coneCutoff = 1.0f;
+    float axisLength = glm::length(axis);
+    if (axisLength == 0.0f)
+    {
+        return bounds;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals)
+    {
+        minDot = std::min(minDot, glm::dot(normal, axis));
+    }
+    // Cones wider than ~85 degrees almost never cull.
+    if (minDot <= 0.1f)
+    {
+        return bounds;
+    }
+
+    float maxT = 0.0f;
+    for (size_t i = 0; i < normals.size(); ++i)
+    {
+        float t = glm::dot(bounds.center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+        maxT = std::max(maxT, t);
+    }
+    bounds.coneApex = bounds.center - axis * maxT;
+    bounds.coneAxis = axis;
+    bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    return bounds;
+}
@@ -0,0 +1,98 @@
+#ifndef RADCPP_MESH_PROCESSING_H
+#define RADCPP_MESH_PROCESSING_H
+#pragma once
+
+#include "radcpp/Common/Geometry.h"
+#include <vector>
+
+// Index buffer processing for triangle lists; indices are uint32_t and vertices are opaque blobs of vertexStride bytes.
+// Remap tables map old vertex indices to new ones (UINT32_MAX: the vertex is dropped).
+
+// Build a remap table which merges binary identical vertices; return the number of unique vertices.
+size_t GenerateVertexRemap(uint32_t* remap, const void* vertices, size_t vertexCount, size_t vertexStride);
+// dst[remap[i]] = vertices[i]; dst must not alias vertices.
+void RemapVertexBuffer(void* dst, const void* vertices, size_t vertexCount, size_t vertexStride, const uint32_t* remap);
+// dst[i] = remap[indices[i]]; dst may alias indices.
+void RemapIndexBuffer(uint32_t* dst, const uint32_t* indices, size_t indexCount, const uint32_t* remap);
+
+// Reorder the triangles for the post-transform vertex cache; dst must not alias indices.
+// Please refer to: Tom Forsyth, Linear-Speed Vertex Cache Optimisation, 2006.
+void OptimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// Reorder clusters of the vertex cache optimized triangles so that outward facing clusters are drawn first,
+// to reduce overdraw; threshold (>= 1) bounds the increase of ACMR when splitting clusters.
+// dst must not alias indices.
+// Please refer to: Pedro Sander, Diego Nehab and Joshua Barczak, Fast Triangle Reordering for Vertex Locality and Reduced Overdraw, 2007.
+void OptimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+    const glm::vec3* positions, size_t vertexCount, float threshold = 1.05f);
+
+// Build a remap table which orders the vertices by their first use in the index buffer, for vertex fetch locality;
+// unreferenced vertices are dropped. Return the number of vertices referenced.
+size_t GenerateVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// Simplify the mesh by quadric error edge collapses, keeping the vertices (the result indexes the same vertex buffer);
+// stop at targetIndexCount or when the next collapse would exceed targetError. The error of a collapse is the square
+// root of its quadric error: the area-weighted RMS distance of the vertex to the planes of its original triangles
+// (in position units), an estimate rather than a bound of the deviation from the input.
+// Border, non-manifold and attribute seam vertices (positions shared by several vertices) are never removed,
+// so the result may stay above the target. Return the index count written to dst (at most indexCount),
+// and the largest error of the collapses in resultError.
+// Please refer to: Michael Garland and Paul Heckbert, Surface Simplification Using Quadric Error Metrics, 1997.
+size_t SimplifyMesh(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+    const glm::vec3* positions, size_t vertexCount, size_t targetIndexCount, float targetError = FLT_MAX,
+    float* resultError = nullptr);
+
+// A cluster of triangles with its own small vertex set, for culling at a finer grain than meshes.
+struct Meshlet
+{
+    uint32_t vertexOffset; // into meshletVertices
+    uint32_t triangleOffset; // into meshletTriangles
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+// Bounding sphere and normal cone of a meshlet (48 bytes, laid out for std430 storage buffers).
+// The meshlet is back-facing from the viewpoint v if dot(normalize(coneApex - v), coneAxis) >= coneCutoff.
+struct MeshletBounds
+{
+    glm::vec3 center;
+    float radius;
+    glm::vec3 coneApex;
+    float coneCutoff; // sine of the cone half angle; 1 if the normals are too spread for the cone to cull
+    glm::vec3 coneAxis;
+    float padding;
+};
+
+// Split the triangles in their order into meshlets of at most maxVertices (<= 256) and maxTriangles;
+// meshletVertices gets the vertex indices of the meshlets, and meshletTriangles one entry per triangle
+// with its local vertex indices packed in 8 bits each (a | b << 8 | c << 16).
+// As the order is kept, meshlet i covers triangles [triangleOffset, triangleOffset + triangleCount) of the input,
+// and can be drawn with the input index buffer too. Run it after OptimizeVertexCache for fewer, fuller meshlets.
+void BuildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices,
+    std::vector<uint32_t>& meshletTriangles, const uint32_t* indices, size_t indexCount, size_t vertexCount,
+    size_t maxVertices = 64, size_t maxTriangles = 124);
+
+// Please refer to: meshoptimizer, meshopt_computeMeshletBounds.
+MeshletBounds ComputeMeshletBounds(const Meshlet& meshlet, const uint32_t* meshletVertices,
+    const uint32_t* meshletTriangles, const glm::vec3* positions);
+
+struct VertexCacheStatistics
+{
+    uint32_t vertexTransformCount;
+    // Average cache miss ratio: transformed vertices per triangle, 0.5 (ideal for large grids) to 3.
+    float acmr;
+    // Average transform to vertex ratio: transformed vertices per vertex, 1 is ideal.
+    float atvr;
+};
+
+// Simulate a FIFO post-transform cache of cacheSize vertices.
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+    uint32_t cacheSize = 16);
+
+// Octahedral mapping of unit vectors to [-1, 1]^2, for compact normals and tangents;
+// zero and non-finite vectors are encoded as (0, 0), which decodes to +Z.
+// Please refer to: Zina Cigolle et al., A Survey of Efficient Representations for Independent Unit Vectors, JCGT 2014.
+glm::vec2 EncodeOctahedral(const glm::vec3& v);
+glm::vec3 DecodeOctahedral(const glm::vec2& e);
+
+#endif // RADCPP_MESH_PROCESSING_H
@@ -14,6 +14,8 @@
 
 // Misc
 #include <random>
+#include "radcpp/Common/Random.h"
+#include "radcpp/Common/GpuHash.h"
 #include <ratio>
 #include <cfenv>
 #include <bit>
@@ -0,0 +1,99 @@
+#include "radcpp/Common/Parallel.h"
+
+ThreadPool::ThreadPool(size_t threadCount) :
+    m_pool(std::max<size_t>(threadCount, 1)),
+    m_threadCount(std::max<size_t>(threadCount, 1))
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    m_pool.join();
+}
+
+void ThreadPool::Join()
+{
+    m_pool.join();
+}
+
+ThreadPool* GetGlobalThreadPool()
+{
+    static ThreadPool pool;
+    return &pool;
+}
+
+void ParallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& func)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    grainSize = std::max<size_t>(grainSize, 1);
+    const size_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+    ThreadPool* pool = GetGlobalThreadPool();
+    if ((chunkCount == 1) || (pool->GetThreadCount() == 1))
+    {
+        func(begin, end);
+        return;
+    }
+
+    // Chunks are claimed with an atomic counter by the workers and the calling thread alike;
+    // the state is shared because workers may start after all chunks are done and the caller has returned.
+    struct ParallelForState
+    {
+        std::function<void(size_t, size_t)> func;
+        size_t end;
+        size_t grainSize;
+        std::atomic<size_t> next;
+        std::atomic<size_t> remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<ParallelForState>();
+    state->func = func;
+    state->end = end;
+    state->grainSize = grainSize;
+    state->next = begin;
+    state->remaining = chunkCount;
+
+    auto work = [state]()
+    {
+        while (true)
+        {
+            size_t chunkBegin = state->next.fetch_add(state->grainSize);
+            if (chunkBegin >= state->end)
+            {
+                break;
+            }
+            size_t chunkEnd = std::min(chunkBegin + state->grainSize, state->end);
+            state->func(chunkBegin, chunkEnd);
+            if (state->remaining.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done.notify_all();
+            }
+        }
+    };
+
+    const size_t workerCount = std::min(chunkCount - 1, pool->GetThreadCount());
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        pool->Post(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->remaining == 0; });
+}
+
+void ParallelInvoke(const std::function<void()>& func1, const std::function<void()>& func2)
+{
+    ParallelFor(0, 2, 1,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                (i == 0) ? func1() : func2();
+            }
+        });
+}
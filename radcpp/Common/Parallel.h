@@ -7,6 +7,8 @@
 #include <atomic>
 #include <thread>
 #include <condition_variable>
+#include <memory>
+#include <mutex>
 
 #ifdef _WIN32
 #include <sdkddkver.h>
@@ -41,4 +43,39 @@ private:
 
 }; // class AtomicFloat
 
+// A pool of worker threads (boost::asio::thread_pool).
+class ThreadPool
+{
+public:
+    ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    size_t GetThreadCount() const { return m_threadCount; }
+
+    template<typename Task>
+    void Post(Task&& task)
+    {
+        boost::asio::post(m_pool, std::forward<Task>(task));
+    }
+
+    // Block until all posted tasks are done; the pool cannot be used afterwards.
+    void Join();
+
+private:
+    boost::asio::thread_pool m_pool;
+    size_t m_threadCount;
+
+}; // class ThreadPool
+
+// The pool shared by the parallel algorithms below, created on first use.
+ThreadPool* GetGlobalThreadPool();
+
+// Invoke func(chunkBegin, chunkEnd) for chunks of [begin, end) of at most grainSize elements, in parallel.
+// The calling thread works on the chunks too, and returns when all chunks are done,
+// so it is safe to call ParallelFor recursively from inside func.
+void ParallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& func);
+
+// Invoke the two functions in parallel and return when both are done.
+void ParallelInvoke(const std::function<void()>& func1, const std::function<void()>& func2);
+
 #endif // RADCPP_PARALLEL_H
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "radcpp/Common/RadixSort.h"
+
+void RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values,
+    std::vector<uint64_t>& tempKeys, std::vector<uint32_t>& tempValues)
+{
+    assert(keys.size() == values.size());
+    const size_t count = keys.size();
+    if (count <= 1)
+    {
+        return;
+    }
+
+    // The histograms of all the passes, in a single read of the keys.
+    constexpr uint32_t PassCount = sizeof(uint64_t);
+    std::vector<size_t> histograms(PassCount * 256, 0);
+    for (uint64_t key : keys)
+    {
+        for (uint32_t pass = 0; pass < PassCount; ++pass)
+        {
+            histograms[pass * 256 + ((key >> (pass * 8)) & 0xFF)]++;
+        }
+    }
+
+    tempKeys.resize(count);
+    tempValues.resize(count);
+    for (uint32_t pass = 0; pass < PassCount; ++pass)
+    {
+        size_t* histogram = &histograms[pass * 256];
+        const uint32_t shift = pass * 8;
+        if (histogram[(keys[0] >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+        // Exclusive prefix sums: the first position of each bucket.
+        size_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; ++bucket)
+        {
+            const size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            const size_t dst = histogram[(keys[i] >> shift) & 0xFF]++;
+            tempKeys[dst] = keys[i];
+            tempValues[dst] = values[i];
+        }
+        keys.swap(tempKeys);
+        values.swap(tempValues);
+    }
+}
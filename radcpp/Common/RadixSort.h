@@ -0,0 +1,14 @@
+#ifndef RADCPP_RADIX_SORT_H
+#define RADCPP_RADIX_SORT_H
+#pragma once
+
+#include "radcpp/Common/Common.h"
+#include <vector>
+
+// Sort the keys in ascending order, moving the values with them: a stable LSD radix sort by bytes, O(n) per pass.
+// The passes of the bytes all the keys share are skipped (the high bytes of small keys).
+// temp buffers are resized to the number of keys, and can be reused across calls to save the allocations.
+void RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values,
+    std::vector<uint64_t>& tempKeys, std::vector<uint32_t>& tempValues);
+
+#endif // RADCPP_RADIX_SORT_H
@@ -0,0 +1,320 @@
+#include "radcpp/Common/Random.h"
+#include <immintrin.h>
+
+void Xoshiro256::Jump(const uint64_t polynomial[4])
+{
+    uint64_t state[4] = {};
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int b = 0; b < 64; ++b)
+        {
+            if (polynomial[i] & (uint64_t(1) << b))
+            {
+                state[0] ^= m_state[0];
+                state[1] ^= m_state[1];
+                state[2] ^= m_state[2];
+                state[3] ^= m_state[3];
+            }
+            Next();
+        }
+    }
+    m_state[0] = state[0];
+    m_state[1] = state[1];
+    m_state[2] = state[2];
+    m_state[3] = state[3];
+}
+
+void Xoshiro256::Jump()
+{
+    static const uint64_t JumpPolynomial[4] =
+    { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+    Jump(JumpPolynomial);
+}
+
+void Xoshiro256::LongJump()
+{
+    static const uint64_t LongJumpPolynomial[4] =
+    { 0x76e15d3efefdcbbf, 0xc5004e441c522fb3, 0x77710069854ee241, 0x39109bb02acbe635 };
+    Jump(LongJumpPolynomial);
+}
+
+static void Xoshiro128Next(uint32_t s[4])
+{
+    const uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = std::rotl(s[3], 11);
+}
+
+// Equivalent to 2^64 steps.
+static void Xoshiro128Jump(uint32_t s[4])
+{
+    static const uint32_t JumpPolynomial[4] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+    uint32_t state[4] = {};
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int b = 0; b < 32; ++b)
+        {
+            if (JumpPolynomial[i] & (1u << b))
+            {
+                state[0] ^= s[0];
+                state[1] ^= s[1];
+                state[2] ^= s[2];
+                state[3] ^= s[3];
+            }
+            Xoshiro128Next(s);
+        }
+    }
+    s[0] = state[0];
+    s[1] = state[1];
+    s[2] = state[2];
+    s[3] = state[3];
+}
+
+void Xoshiro128x8::Seed(uint64_t seed)
+{
+    uint32_t s[4];
+    for (int i = 0; i < 4; i += 2)
+    {
+        uint64_t bits = SplitMix64(seed);
+        s[i] = static_cast<uint32_t>(bits);
+        s[i + 1] = static_cast<uint32_t>(bits >> 32);
+    }
+    for (int lane = 0; lane < 8; ++lane)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            m_state[i][lane] = s[i];
+        }
+        Xoshiro128Jump(s);
+    }
+}
+
+// The floats take the 23 high bits as the mantissa of [1, 2), minus 1.
+#if defined(__AVX2__)
+
+void Xoshiro128x8::Generate(float* dst, size_t count)
+{
+    __m256i s0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_state[0]));
+    __m256i s1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_state[1]));
+    __m256i s2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_state[2]));
+    __m256i s3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_state[3]));
+    const __m256i one = _mm256_set1_epi32(0x3f800000);
+    const __m256 oneFloat = _mm256_set1_ps(1.0f);
+    for (size_t i = 0; i < count; i += 8)
+    {
+        __m256i result = _mm256_add_epi32(s0, s3);
+        __m256i t = _mm256_slli_epi32(s1, 9);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = _mm256_or_si256(_mm256_slli_epi32(s3, 11), _mm256_srli_epi32(s3, 21));
+
+        __m256 f = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(result, 9), one)), oneFloat);
+        if (i + 8 <= count)
+        {
+            _mm256_storeu_ps(dst + i, f);
+        }
+        else
+        {
+            alignas(32) float tail[8];
+            _mm256_store_ps(tail, f);
+            for (size_t j = 0; i + j < count; ++j)
+            {
+                dst[i + j] = tail[j];
+            }
+        }
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(m_state[0]), s0);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(m_state[1]), s1);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(m_state[2]), s2);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(m_state[3]), s3);
+}
+
+#else
+
+// Two SSE2 halves, with the same results as the AVX2 path.
+void Xoshiro128x8::Generate(float* dst, size_t count)
+{
+    __m128i s[4][2];
+    for (int k = 0; k < 4; ++k)
+    {
+        s[k][0] = _mm_load_si128(reinterpret_cast<const __m128i*>(m_state[k]));
+        s[k][1] = _mm_load_si128(reinterpret_cast<const __m128i*>(m_state[k] + 4));
+    }
+    const __m128i one = _mm_set1_epi32(0x3f800000);
+    const __m128 oneFloat = _mm_set1_ps(1.0f);
+    for (size_t i = 0; i < count; i += 8)
+    {
+        alignas(16) float f[8];
+        for (int h = 0; h < 2; ++h)
+        {
+            __m128i result = _mm_add_epi32(s[0][h], s[3][h]);
+            __m128i t = _mm_slli_epi32(s[1][h], 9);
+            s[2][h] = _mm_xor_si128(s[2][h], s[0][h]);
+            s[3][h] = _mm_xor_si128(s[3][h], s[1][h]);
+            s[1][h] = _mm_xor_si128(s[1][h], s[2][h]);
+            s[0][h] = _mm_xor_si128(s[0][h], s[3][h]);
+            s[2][h] = _mm_xor_si128(s[2][h], t);
+            s[3][h] = _mm_or_si128(_mm_slli_epi32(s[3][h], 11), _mm_srli_epi32(s[3][h], 21));
+            _mm_store_ps(f + h * 4, _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(result, 9), one)), oneFloat));
+        }
+        for (size_t j = 0; (j < 8) && (i + j < count); ++j)
+        {
+            dst[i + j] = f[j];
+        }
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+        _mm_store_si128(reinterpret_cast<__m128i*>(m_state[k]), s[k][0]);
+        _mm_store_si128(reinterpret_cast<__m128i*>(m_state[k] + 4), s[k][1]);
+    }
+}
+
+#endif
+
+// Direction numbers of the first dimensions, from the primitive polynomials and initial numbers of
+// Stephen Joe and Frances Kuo, new-joe-kuo-6.21201; dimension 0 is the van der Corput sequence.
+// They are expanded into the XOR of the directions selected by each byte of the index, for 4 lookups per point.
+struct SobolTables
+{
+    uint32_t byteDirections[SobolMaxDimension][4][256];
+
+    SobolTables()
+    {
+        struct Polynomial
+        {
+            uint32_t s;
+            uint32_t a;
+            uint32_t m[5];
+        };
+        static const Polynomial polynomials[SobolMaxDimension - 1] =
+        {
+            { 1, 0, { 1 } },
+            { 2, 1, { 1, 3 } },
+            { 3, 1, { 1, 3, 1 } },
+            { 3, 2, { 1, 1, 1 } },
+            { 4, 1, { 1, 1, 3, 3 } },
+            { 4, 4, { 1, 3, 5, 13 } },
+            { 5, 2, { 1, 1, 5, 5, 17 } },
+        };
+        uint32_t v[SobolMaxDimension][32];
+        for (uint32_t k = 0; k < 32; ++k)
+        {
+            v[0][k] = 1u << (31 - k);
+        }
+        for (uint32_t d = 1; d < SobolMaxDimension; ++d)
+        {
+            const Polynomial& p = polynomials[d - 1];
+            for (uint32_t k = 0; k < 32; ++k)
+            {
+                if (k < p.s)
+                {
+                    v[d][k] = p.m[k] << (31 - k);
+                    continue;
+                }
+                uint32_t x = v[d][k - p.s] ^ (v[d][k - p.s] >> p.s);
+                for (uint32_t i = 1; i < p.s; ++i)
+                {
+                    if ((p.a >> (p.s - 1 - i)) & 1)
+                    {
+                        x ^= v[d][k - i];
+                    }
+                }
+                v[d][k] = x;
+            }
+        }
+
+        for (uint32_t d = 0; d < SobolMaxDimension; ++d)
+        {
+            for (uint32_t byteIndex = 0; byteIndex < 4; ++byteIndex)
+            {
+                for (uint32_t value = 0; value < 256; ++value)
+                {
+                    uint32_t x = 0;
+                    for (uint32_t bit = 0; bit < 8; ++bit)
+                    {
+                        if (value & (1u << bit))
+                        {
+                            x ^= v[d][byteIndex * 8 + bit];
+                        }
+                    }
+                    byteDirections[d][byteIndex][value] = x;
+                }
+            }
+        }
+    }
+}; // struct SobolTables
+
+uint32_t Sobol(uint32_t index, uint32_t dimension)
+{
+    static const SobolTables tables;
+    assert(dimension < SobolMaxDimension);
+    const auto& t = tables.byteDirections[dimension];
+    return t[0][index & 0xFF] ^ t[1][(index >> 8) & 0xFF] ^ t[2][(index >> 16) & 0xFF] ^ t[3][index >> 24];
+}
+
+static uint32_t ReverseBits(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Laine-Karras style hash: each bit only depends on the lower bits, which (on the reversed bits)
+// makes it a nested uniform scramble.
+uint32_t OwenScramble(uint32_t x, uint32_t seed)
+{
+    x = ReverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return ReverseBits(x);
+}
+
+static uint32_t HashCombine(uint32_t seed, uint32_t v)
+{
+    return seed ^ (v + (seed << 6) + (seed >> 2));
+}
+
+float SobolOwen(uint32_t index, uint32_t dimension, uint32_t seed)
+{
+    index = OwenScramble(index, seed);
+    return ToUnitFloat(OwenScramble(Sobol(index, dimension), HashCombine(seed, dimension)));
+}
+
+float RadicalInverse(uint32_t base, uint64_t index)
+{
+    const double invBase = 1.0 / base;
+    double invBaseN = 1.0;
+    uint64_t reversed = 0;
+    while (index != 0)
+    {
+        uint64_t next = index / base;
+        uint64_t digit = index - next * base;
+        reversed = reversed * base + digit;
+        invBaseN *= invBase;
+        index = next;
+    }
+    return std::min(static_cast<float>(reversed * invBaseN), 0x1.fffffep-1f);
+}
+
+float Halton(uint64_t index, uint32_t dimension)
+{
+    static const uint32_t Primes[HaltonMaxDimension] =
+    {
+        2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+        59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131,
+    };
+    assert(dimension < HaltonMaxDimension);
+    return RadicalInverse(Primes[dimension], index);
+}
@@ -0,0 +1,197 @@
+#ifndef RADCPP_RANDOM_H
+#define RADCPP_RANDOM_H
+#pragma once
+
+#include "radcpp/Common/Common.h"
+#include "radcpp/Common/Math.h"
+#include <bit>
+
+// Fast pseudo-random generators and low-discrepancy sequences for bulk sampling.
+// The generators satisfy UniformRandomBitGenerator, so they also work with <random> distributions.
+
+// Map 32 random bits to a float in [0, 1) (the 24 high bits, all representable).
+inline float ToUnitFloat(uint32_t bits)
+{
+    return static_cast<float>(bits >> 8) * 0x1p-24f;
+}
+
+// Map 64 random bits to a double in [0, 1).
+inline double ToUnitDouble(uint64_t bits)
+{
+    return static_cast<double>(bits >> 11) * 0x1p-53;
+}
+
+// Used to seed the other generators from a single value.
+// Please refer to: https://prng.di.unimi.it/splitmix64.c
+inline uint64_t SplitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// PCG32 (XSH RR): 64-bit state, 2^63 selectable streams of period 2^64.
+// Please refer to: https://www.pcg-random.org/
+class PCG32
+{
+public:
+    using result_type = uint32_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    PCG32(uint64_t seed = 0x853c49e6748fea9bull, uint64_t stream = 0xda3e39cb94b95bdbull)
+    {
+        Seed(seed, stream);
+    }
+
+    void Seed(uint64_t seed, uint64_t stream)
+    {
+        m_state = 0;
+        m_inc = (stream << 1) | 1;
+        Next();
+        m_state += seed;
+        Next();
+    }
+
+    uint32_t Next()
+    {
+        uint64_t state = m_state;
+        m_state = state * Multiplier + m_inc;
+        uint32_t xorShifted = static_cast<uint32_t>(((state >> 18) ^ state) >> 27);
+        uint32_t rot = static_cast<uint32_t>(state >> 59);
+        return std::rotr(xorShifted, static_cast<int>(rot));
+    }
+
+    uint32_t operator()() { return Next(); }
+
+    // Uniform in [0, bound), without modulo bias.
+    // Please refer to: Daniel Lemire, Fast Random Integer Generation in an Interval, 2019.
+    uint32_t NextBounded(uint32_t bound)
+    {
+        uint64_t m = uint64_t(Next()) * bound;
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < bound)
+        {
+            uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold)
+            {
+                m = uint64_t(Next()) * bound;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    float NextFloat() { return ToUnitFloat(Next()); }
+
+    // Skip delta outputs in O(log(delta)).
+    // Please refer to: Forrest Brown, Random Number Generation with Arbitrary Strides, 1994.
+    void Advance(uint64_t delta)
+    {
+        uint64_t accMult = 1;
+        uint64_t accPlus = 0;
+        uint64_t curMult = Multiplier;
+        uint64_t curPlus = m_inc;
+        while (delta > 0)
+        {
+            if (delta & 1)
+            {
+                accMult *= curMult;
+                accPlus = accPlus * curMult + curPlus;
+            }
+            curPlus = (curMult + 1) * curPlus;
+            curMult *= curMult;
+            delta >>= 1;
+        }
+        m_state = accMult * m_state + accPlus;
+    }
+
+private:
+    static constexpr uint64_t Multiplier = 6364136223846793005ull;
+    uint64_t m_state;
+    uint64_t m_inc;
+
+}; // class PCG32
+
+// xoshiro256**: 256-bit state, period 2^256 - 1; Jump() gives non-overlapping streams for threads.
+// Please refer to: David Blackman and Sebastiano Vigna, Scrambled Linear Pseudorandom Number Generators, 2021.
+class Xoshiro256
+{
+public:
+    using result_type = uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    Xoshiro256(uint64_t seed = 0) { Seed(seed); }
+
+    void Seed(uint64_t seed)
+    {
+        for (uint64_t& s : m_state)
+        {
+            s = SplitMix64(seed);
+        }
+    }
+
+    uint64_t Next()
+    {
+        const uint64_t result = std::rotl(m_state[1] * 5, 7) * 9;
+        const uint64_t t = m_state[1] << 17;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = std::rotl(m_state[3], 45);
+        return result;
+    }
+
+    uint64_t operator()() { return Next(); }
+
+    float NextFloat() { return ToUnitFloat(static_cast<uint32_t>(Next() >> 32)); }
+    double NextDouble() { return ToUnitDouble(Next()); }
+
+    // Equivalent to 2^128 calls of Next(): 2^128 non-overlapping sequences.
+    void Jump();
+    // Equivalent to 2^192 calls of Next(): 2^64 starting points, each with 2^64 Jump() streams.
+    void LongJump();
+
+private:
+    void Jump(const uint64_t polynomial[4]);
+    uint64_t m_state[4];
+
+}; // class Xoshiro256
+
+// Eight xoshiro128+ generators in SIMD lanes, 2^64 steps apart, for bulk uniform floats
+// (the low bits of xoshiro128+ are weak, but only the high 23 bits go into the floats).
+class Xoshiro128x8
+{
+public:
+    Xoshiro128x8(uint64_t seed = 0) { Seed(seed); }
+
+    void Seed(uint64_t seed);
+    // Uniform floats in [0, 1); count need not be a multiple of 8.
+    void Generate(float* dst, size_t count);
+
+private:
+    alignas(32) uint32_t m_state[4][8];
+
+}; // class Xoshiro128x8
+
+// Sobol sequence with Owen scrambling (nested uniform scramble), and Owen-scrambled index shuffling,
+// so each seed gives an independent randomization that keeps the stratification of the sequence.
+// Please refer to: Brent Burley, Practical Hash-based Owen Scrambling, JCGT 2020.
+constexpr uint32_t SobolMaxDimension = 8;
+// Unscrambled Sobol point; dimension < SobolMaxDimension.
+uint32_t Sobol(uint32_t index, uint32_t dimension);
+uint32_t OwenScramble(uint32_t x, uint32_t seed);
+// Component dimension of the shuffled scrambled point; dimensions share the shuffling,
+// so consecutive dimensions of the same index form a well distributed point.
+float SobolOwen(uint32_t index, uint32_t dimension, uint32_t seed);
+
+// Halton sequence: the radical inverse of index in the base of the dimension-th prime.
+constexpr uint32_t HaltonMaxDimension = 32;
+float RadicalInverse(uint32_t base, uint64_t index);
+float Halton(uint64_t index, uint32_t dimension);
+
+#endif // RADCPP_RANDOM_H
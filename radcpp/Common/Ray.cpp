@@ -0,0 +1,261 @@
+#include "radcpp/Common/Ray.h"
+#include "radcpp/Common/Simd.h"
+
+// Conservative bound of the rounding error of the slab distances (Ize 2013): 1 + 2 * gamma(3).
+static constexpr float SlabErrorScale = 1.0f + 2.0f * (3.0f * FLT_EPSILON * 0.5f) / (1.0f - 3.0f * FLT_EPSILON * 0.5f);
+
+glm::vec3 GetSafeInverseDirection(const glm::vec3& direction)
+{
+    constexpr float tiny = 1e-20f;
+    glm::vec3 d = direction;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (std::abs(d[i]) < tiny)
+        {
+            d[i] = std::copysign(tiny, d[i]);
+        }
+    }
+    return 1.0f / d;
+}
+
+bool IntersectRayBox(const glm::vec3& origin, const glm::vec3& invDirection, float tMin, float tMax,
+    const BoundingBox& box, float& tNear)
+{
+    glm::vec3 t0 = (box.m_minCorner - origin) * invDirection;
+    glm::vec3 t1 = (box.m_maxCorner - origin) * invDirection;
+    glm::vec3 tSlabNear = glm::min(t0, t1);
+    glm::vec3 tSlabFar = glm::max(t0, t1);
+    float tEnter = std::max(std::max(tSlabNear.x, tSlabNear.y), std::max(tSlabNear.z, tMin));
+    float tExit = std::min(std::min(tSlabFar.x, tSlabFar.y), std::min(tSlabFar.z, tMax)) * SlabErrorScale;
+    tNear = tEnter;
+    return (tEnter <= tExit);
+}
+
+bool IntersectRayTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+    float& t, float& u, float& v)
+{
+    glm::vec3 e1 = v1 - v0;
+    glm::vec3 e2 = v2 - v0;
+    glm::vec3 p = glm::cross(ray.m_direction, e2);
+    float det = glm::dot(e1, p);
+    if (det == 0.0f)
+    {
+        return false;
+    }
+    float invDet = 1.0f / det;
+    glm::vec3 s = ray.m_origin - v0;
+    u = glm::dot(s, p) * invDet;
+    if ((u < 0.0f) || (u > 1.0f))
+    {
+        return false;
+    }
+    glm::vec3 q = glm::cross(s, e1);
+    v = glm::dot(ray.m_direction, q) * invDet;
+    if ((v < 0.0f) || (u + v > 1.0f))
+    {
+        return false;
+    }
+    t = glm::dot(e2, q) * invDet;
+    return (t > ray.m_tMin) && (t < ray.m_tMax);
+}
+
+WatertightRay::WatertightRay(const Ray& ray)
+{
+    glm::vec3 absDirection = glm::abs(ray.m_direction);
+    m_kz = (absDirection.x > absDirection.y) ?
+        ((absDirection.x > absDirection.z) ? 0 : 2) :
+        ((absDirection.y > absDirection.z) ? 1 : 2);
+    m_kx = (m_kz + 1) % 3;
+    m_ky = (m_kx + 1) % 3;
+    // Preserve the winding.
+    if (ray.m_direction[m_kz] < 0.0f)
+    {
+        std::swap(m_kx, m_ky);
+    }
+    m_shearX = ray.m_direction[m_kx] / ray.m_direction[m_kz];
+    m_shearY = ray.m_direction[m_ky] / ray.m_direction[m_kz];
+    m_shearZ = 1.0f / ray.m_direction[m_kz];
+}
+
+bool IntersectRayTriangleWatertight(const Ray& ray, const WatertightRay& wr,
+    const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t, float& u, float& v)
+{
+    const glm::vec3 a = v0 - ray.m_origin;
+    const glm::vec3 b = v1 - ray.m_origin;
+    const glm::vec3 c = v2 - ray.m_origin;
+    const float ax = a[wr.m_kx] - wr.m_shearX * a[wr.m_kz];
+    const float ay = a[wr.m_ky] - wr.m_shearY * a[wr.m_kz];
+    const float bx = b[wr.m_kx] - wr.m_shearX * b[wr.m_kz];
+    const float by = b[wr.m_ky] - wr.m_shearY * b[wr.m_kz];
+    const float cx = c[wr.m_kx] - wr.m_shearX * c[wr.m_kz];
+    const float cy = c[wr.m_ky] - wr.m_shearY * c[wr.m_kz];
+
+    // Scaled barycentric coordinates (edge functions).
+    float e0 = cx * by - cy * bx;
+    float e1 = ax * cy - ay * cx;
+    float e2 = bx * ay - by * ax;
+    // Fall back to double precision on the edges.
+    if ((e0 == 0.0f) || (e1 == 0.0f) || (e2 == 0.0f))
+    {
+        e0 = static_cast<float>(double(cx) * double(by) - double(cy) * double(bx));
+        e1 = static_cast<float>(double(ax) * double(cy) - double(ay) * double(cx));
+        e2 = static_cast<float>(double(bx) * double(ay) - double(by) * double(ax));
+    }
+    if (((e0 < 0.0f) || (e1 < 0.0f) || (e2 < 0.0f)) &&
+        ((e0 > 0.0f) || (e1 > 0.0f) || (e2 > 0.0f)))
+    {
+        return false;
+    }
+    const float det = e0 + e1 + e2;
+    if (det == 0.0f)
+    {
+        return false;
+    }
+
+    const float az = wr.m_shearZ * a[wr.m_kz];
+    const float bz = wr.m_shearZ * b[wr.m_kz];
+    const float cz = wr.m_shearZ * c[wr.m_kz];
+    const float invDet = 1.0f / det;
+    t = (e0 * az + e1 * bz + e2 * cz) * invDet;
+    u = e1 * invDet;
+    v = e2 * invDet;
+    return (t > ray.m_tMin) && (t < ray.m_tMax);
+}
+
+void RayPacket8::Set(uint32_t i, const Ray& ray)
+{
+    glm::vec3 invDirection = GetSafeInverseDirection(ray.m_direction);
+    m_originX[i] = ray.m_origin.x;
+    m_originY[i] = ray.m_origin.y;
+    m_originZ[i] = ray.m_origin.z;
+    m_directionX[i] = ray.m_direction.x;
+    m_directionY[i] = ray.m_direction.y;
+    m_directionZ[i] = ray.m_direction.z;
+    m_invDirectionX[i] = invDirection.x;
+    m_invDirectionY[i] = invDirection.y;
+    m_invDirectionZ[i] = invDirection.z;
+    m_tMin[i] = ray.m_tMin;
+    m_tMax[i] = ray.m_tMax;
+}
+
+Ray RayPacket8::Get(uint32_t i) const
+{
+    return Ray(
+        glm::vec3(m_originX[i], m_originY[i], m_originZ[i]),
+        glm::vec3(m_directionX[i], m_directionY[i], m_directionZ[i]),
+        m_tMin[i], m_tMax[i]);
+}
+
+uint32_t IntersectRayPacketBox(const RayPacket8& packet, uint32_t activeMask, const BoundingBox& box)
+{
+    const SimdFloat minX = SimdSet1(box.m_minCorner.x);
+    const SimdFloat minY = SimdSet1(box.m_minCorner.y);
+    const SimdFloat minZ = SimdSet1(box.m_minCorner.z);
+    const SimdFloat maxX = SimdSet1(box.m_maxCorner.x);
+    const SimdFloat maxY = SimdSet1(box.m_maxCorner.y);
+    const SimdFloat maxZ = SimdSet1(box.m_maxCorner.z);
+    const SimdFloat errorScale = SimdSet1(SlabErrorScale);
+
+    uint32_t hitMask = 0;
+    for (uint32_t i = 0; i < RayPacket8::Size; i += SimdWidth)
+    {
+        if (((activeMask >> i) & ((1u << SimdWidth) - 1)) == 0)
+        {
+            continue;
+        }
+        const SimdFloat ox = SimdLoad(packet.m_originX + i);
+        const SimdFloat oy = SimdLoad(packet.m_originY + i);
+        const SimdFloat oz = SimdLoad(packet.m_originZ + i);
+        const SimdFloat idx = SimdLoad(packet.m_invDirectionX + i);
+        const SimdFloat idy = SimdLoad(packet.m_invDirectionY + i);
+        const SimdFloat idz = SimdLoad(packet.m_invDirectionZ + i);
+
+        const SimdFloat t0x = SimdMul(SimdSub(minX, ox), idx);
+        const SimdFloat t1x = SimdMul(SimdSub(maxX, ox), idx);
+        const SimdFloat t0y = SimdMul(SimdSub(minY, oy), idy);
+        const SimdFloat t1y = SimdMul(SimdSub(maxY, oy), idy);
+        const SimdFloat t0z = SimdMul(SimdSub(minZ, oz), idz);
+        const SimdFloat t1z = SimdMul(SimdSub(maxZ, oz), idz);
+
+        SimdFloat tEnter = SimdMax(SimdMax(SimdMin(t0x, t1x), SimdMin(t0y, t1y)),
+            SimdMax(SimdMin(t0z, t1z), SimdLoad(packet.m_tMin + i)));
+        SimdFloat tExit = SimdMin(SimdMin(SimdMax(t0x, t1x), SimdMax(t0y, t1y)),
+            SimdMin(SimdMax(t0z, t1z), SimdLoad(packet.m_tMax + i)));
+        tExit = SimdMul(tExit, errorScale);
+        hitMask |= static_cast<uint32_t>(SimdMoveMask(SimdCmpLE(tEnter, tExit))) << i;
+    }
+    return hitMask & activeMask;
+}
+
+uint32_t IntersectRayPacketTriangle(const RayPacket8& packet, uint32_t activeMask,
+    const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float* tOut, float* uOut, float* vOut)
+{
+    const glm::vec3 edge1 = v1 - v0;
+    const glm::vec3 edge2 = v2 - v0;
+    const SimdFloat e1x = SimdSet1(edge1.x), e1y = SimdSet1(edge1.y), e1z = SimdSet1(edge1.z);
+    const SimdFloat e2x = SimdSet1(edge2.x), e2y = SimdSet1(edge2.y), e2z = SimdSet1(edge2.z);
+    const SimdFloat v0x = SimdSet1(v0.x), v0y = SimdSet1(v0.y), v0z = SimdSet1(v0.z);
+    const SimdFloat zero = SimdZero();
+    const SimdFloat one = SimdSet1(1.0f);
+
+    uint32_t hitMask = 0;
+    for (uint32_t i = 0; i < RayPacket8::Size; i += SimdWidth)
+    {
+        if (((activeMask >> i) & ((1u << SimdWidth) - 1)) == 0)
+        {
+            continue;
+        }
+        const SimdFloat dx = SimdLoad(packet.m_directionX + i);
+        const SimdFloat dy = SimdLoad(packet.m_directionY + i);
+        const SimdFloat dz = SimdLoad(packet.m_directionZ + i);
+
+        // p = cross(d, e2)
+        const SimdFloat px = SimdSub(SimdMul(dy, e2z), SimdMul(dz, e2y));
+        const SimdFloat py = SimdSub(SimdMul(dz, e2x), SimdMul(dx, e2z));
+        const SimdFloat pz = SimdSub(SimdMul(dx, e2y), SimdMul(dy, e2x));
+        const SimdFloat det = SimdMulAdd(e1z, pz, SimdMulAdd(e1y, py, SimdMul(e1x, px)));
+        const SimdFloat invDet = SimdDiv(one, det);
+
+        // s = o - v0
+        const SimdFloat sx = SimdSub(SimdLoad(packet.m_originX + i), v0x);
+        const SimdFloat sy = SimdSub(SimdLoad(packet.m_originY + i), v0y);
+        const SimdFloat sz = SimdSub(SimdLoad(packet.m_originZ + i), v0z);
+        const SimdFloat u = SimdMul(SimdMulAdd(sz, pz, SimdMulAdd(sy, py, SimdMul(sx, px))), invDet);
+
+        // q = cross(s, e1)
+        const SimdFloat qx = SimdSub(SimdMul(sy, e1z), SimdMul(sz, e1y));
+        const SimdFloat qy = SimdSub(SimdMul(sz, e1x), SimdMul(sx, e1z));
+        const SimdFloat qz = SimdSub(SimdMul(sx, e1y), SimdMul(sy, e1x));
+        const SimdFloat v = SimdMul(SimdMulAdd(dz, qz, SimdMulAdd(dy, qy, SimdMul(dx, qx))), invDet);
+        const SimdFloat t = SimdMul(SimdMulAdd(e2z, qz, SimdMulAdd(e2y, qy, SimdMul(e2x, qx))), invDet);
+
+        SimdFloat hit = SimdAnd(SimdCmpGE(u, zero), SimdCmpGE(v, zero));
+        hit = SimdAnd(hit, SimdCmpLE(SimdAdd(u, v), one));
+        hit = SimdAnd(hit, SimdCmpGT(t, SimdLoad(packet.m_tMin + i)));
+        hit = SimdAnd(hit, SimdCmpLT(t, SimdLoad(packet.m_tMax + i)));
+        // det == 0 gives inf/NaN, which fail the comparisons above except for inf t with finite barycentrics.
+        hit = SimdAnd(hit, SimdOr(SimdCmpLT(det, zero), SimdCmpGT(det, zero)));
+
+        uint32_t laneMask = (static_cast<uint32_t>(SimdMoveMask(hit)) << i) & activeMask;
+        if (laneMask)
+        {
+            alignas(32) float tLanes[SimdWidth];
+            alignas(32) float uLanes[SimdWidth];
+            alignas(32) float vLanes[SimdWidth];
+            SimdStore(tLanes, t);
+            SimdStore(uLanes, u);
+            SimdStore(vLanes, v);
+            for (uint32_t lane = 0; lane < SimdWidth; ++lane)
+            {
+                if (laneMask & (1u << (i + lane)))
+                {
+                    tOut[i + lane] = tLanes[lane];
+                    uOut[i + lane] = uLanes[lane];
+                    vOut[i + lane] = vLanes[lane];
+                }
+            }
+            hitMask |= laneMask;
+        }
+    }
+    return hitMask;
+}
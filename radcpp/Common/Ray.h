@@ -0,0 +1,113 @@
+#ifndef RADCPP_RAY_H
+#define RADCPP_RAY_H
+#pragma once
+
+#include "radcpp/Common/Geometry.h"
+
+struct Ray
+{
+    glm::vec3 m_origin;
+    float m_tMin = 0.0f;
+    glm::vec3 m_direction; // not necessarily normalized; t is measured in units of its length
+    float m_tMax = FLT_MAX;
+
+    Ray() {}
+    Ray(const glm::vec3& origin, const glm::vec3& direction, float tMin = 0.0f, float tMax = FLT_MAX) :
+        m_origin(origin),
+        m_tMin(tMin),
+        m_direction(direction),
+        m_tMax(tMax)
+    {
+    }
+
+    glm::vec3 At(float t) const { return m_origin + m_direction * t; }
+
+}; // struct Ray
+
+struct RayHit
+{
+    float m_t = FLT_MAX;
+    // Barycentric coordinates: the hit point is (1 - u - v) * v0 + u * v1 + v * v2.
+    float m_u = 0.0f;
+    float m_v = 0.0f;
+    uint32_t m_primIndex = UINT32_MAX;
+
+    bool IsValid() const { return (m_primIndex != UINT32_MAX); }
+
+}; // struct RayHit
+
+// Reciprocal of the direction for slab tests; zero components are replaced by a tiny value of the same sign,
+// so that no NaN is produced when the origin lies on a slab plane.
+glm::vec3 GetSafeInverseDirection(const glm::vec3& direction);
+
+// Slab test; tNear is the entry distance (clamped to tMin) if the ray hits the box within [tMin, tMax].
+// Please refer to: Thiago Ize, Robust BVH Ray Traversal, JCGT 2013.
+bool IntersectRayBox(const glm::vec3& origin, const glm::vec3& invDirection, float tMin, float tMax,
+    const BoundingBox& box, float& tNear);
+
+// Moller-Trumbore: fast, but rays through shared edges or vertices may slip between adjacent triangles.
+// Please refer to: Tomas Moller and Ben Trumbore, Fast, Minimum Storage Ray/Triangle Intersection, 1997.
+bool IntersectRayTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+    float& t, float& u, float& v);
+
+// Per-ray data of the watertight test (the shear transform to ray space).
+struct WatertightRay
+{
+    int m_kx;
+    int m_ky;
+    int m_kz;
+    float m_shearX;
+    float m_shearY;
+    float m_shearZ;
+
+    WatertightRay(const Ray& ray);
+
+}; // struct WatertightRay
+
+// Watertight: never misses on shared edges or vertices.
+// Please refer to: Sven Woop, Carsten Benthin and Ingo Wald, Watertight Ray/Triangle Intersection, JCGT 2013.
+bool IntersectRayTriangleWatertight(const Ray& ray, const WatertightRay& watertightRay,
+    const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t, float& u, float& v);
+
+// 8 rays in SoA form, tested together with SIMD; lanes are selected with 8-bit masks.
+struct RayPacket8
+{
+    static constexpr uint32_t Size = 8;
+    static constexpr uint32_t FullMask = 0xFF;
+
+    alignas(32) float m_originX[Size];
+    alignas(32) float m_originY[Size];
+    alignas(32) float m_originZ[Size];
+    alignas(32) float m_directionX[Size];
+    alignas(32) float m_directionY[Size];
+    alignas(32) float m_directionZ[Size];
+    alignas(32) float m_invDirectionX[Size];
+    alignas(32) float m_invDirectionY[Size];
+    alignas(32) float m_invDirectionZ[Size];
+    alignas(32) float m_tMin[Size];
+    alignas(32) float m_tMax[Size];
+
+    // Set lane i; the inverse direction is updated too.
+    void Set(uint32_t i, const Ray& ray);
+    Ray Get(uint32_t i) const;
+
+}; // struct RayPacket8
+
+struct RayPacketHit8
+{
+    alignas(32) float m_t[RayPacket8::Size];
+    alignas(32) float m_u[RayPacket8::Size];
+    alignas(32) float m_v[RayPacket8::Size];
+    uint32_t m_primIndex[RayPacket8::Size];
+
+}; // struct RayPacketHit8
+
+// Slab test of the active rays against one box; returns the mask of the rays hitting it within [tMin, tMax].
+uint32_t IntersectRayPacketBox(const RayPacket8& packet, uint32_t activeMask, const BoundingBox& box);
+
+// Moller-Trumbore test of the active rays against one triangle; returns the mask of the rays hitting it
+// within (tMin, tMax), and writes t, u and v of those lanes.
+uint32_t IntersectRayPacketTriangle(const RayPacket8& packet, uint32_t activeMask,
+    const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float* t, float* u, float* v);
+
+#endif // RADCPP_RAY_H
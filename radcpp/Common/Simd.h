@@ -0,0 +1,333 @@
+#ifndef RADCPP_SIMD_H
+#define RADCPP_SIMD_H
+#pragma once
+
+#include "radcpp/Common/Common.h"
+#include <immintrin.h>
+
+// Thin wrappers of the widest float vector enabled at compile time (AVX: 8 lanes, SSE: 4 lanes),
+// so that batch kernels can be written once for both instruction sets.
+// Loads and stores are aligned; use the U variants for unaligned addresses.
+// Multiply-add is not fused, so that the results match scalar (glm) code exactly.
+#if defined(__AVX__)
+
+#define RADCPP_SIMD_AVX 1
+constexpr size_t SimdWidth = 8;
+using SimdFloat = __m256;
+
+inline SimdFloat SimdLoad(const float* p) { return _mm256_load_ps(p); }
+inline SimdFloat SimdLoadU(const float* p) { return _mm256_loadu_ps(p); }
+inline void SimdStore(float* p, SimdFloat v) { _mm256_store_ps(p, v); }
+inline void SimdStoreU(float* p, SimdFloat v) { _mm256_storeu_ps(p, v); }
+inline SimdFloat SimdSet1(float f) { return _mm256_set1_ps(f); }
+inline SimdFloat SimdZero() { return _mm256_setzero_ps(); }
+
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return _mm256_add_ps(a, b); }
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return _mm256_sub_ps(a, b); }
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return _mm256_mul_ps(a, b); }
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return _mm256_div_ps(a, b); }
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return _mm256_min_ps(a, b); }
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return _mm256_max_ps(a, b); }
+inline SimdFloat SimdSqrt(SimdFloat a) { return _mm256_sqrt_ps(a); }
+inline SimdFloat SimdRound(SimdFloat a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline SimdFloat SimdFloor(SimdFloat a) { return _mm256_floor_ps(a); }
+
+inline SimdFloat SimdCmpLT(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline SimdFloat SimdCmpLE(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+inline SimdFloat SimdCmpGT(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline SimdFloat SimdCmpGE(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+
+inline SimdFloat SimdAnd(SimdFloat a, SimdFloat b) { return _mm256_and_ps(a, b); }
+inline SimdFloat SimdOr(SimdFloat a, SimdFloat b) { return _mm256_or_ps(a, b); }
+inline SimdFloat SimdXor(SimdFloat a, SimdFloat b) { return _mm256_xor_ps(a, b); }
+// (~a) & b
+inline SimdFloat SimdAndNot(SimdFloat a, SimdFloat b) { return _mm256_andnot_ps(a, b); }
+// mask ? a : b
+inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return _mm256_blendv_ps(b, a, mask); }
+inline int SimdMoveMask(SimdFloat mask) { return _mm256_movemask_ps(mask); }
+inline SimdFloat SimdCmpEQ(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+inline SimdFloat SimdCmpUnordered(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_UNORD_Q); }
+
+// Integer conversions on the bits, to build and take apart floats without integer vector instructions (AVX1):
+// float(int32 bits of a), and the bits of int32(round(a)).
+inline SimdFloat SimdConvertBitsToFloat(SimdFloat a) { return _mm256_cvtepi32_ps(_mm256_castps_si256(a)); }
+inline SimdFloat SimdConvertFloatToBits(SimdFloat a) { return _mm256_castsi256_ps(_mm256_cvtps_epi32(a)); }
+inline SimdFloat SimdSet1Bits(uint32_t bits) { return _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(bits))); }
+
+inline float SimdReduceMin(SimdFloat v)
+{
+    __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+inline float SimdReduceMax(SimdFloat v)
+{
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+#else // SSE
+
+constexpr size_t SimdWidth = 4;
+using SimdFloat = __m128;
+
+inline SimdFloat SimdLoad(const float* p) { return _mm_load_ps(p); }
+inline SimdFloat SimdLoadU(const float* p) { return _mm_loadu_ps(p); }
+inline void SimdStore(float* p, SimdFloat v) { _mm_store_ps(p, v); }
+inline void SimdStoreU(float* p, SimdFloat v) { _mm_storeu_ps(p, v); }
+inline SimdFloat SimdSet1(float f) { return _mm_set1_ps(f); }
+inline SimdFloat SimdZero() { return _mm_setzero_ps(); }
+
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return _mm_add_ps(a, b); }
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return _mm_sub_ps(a, b); }
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return _mm_mul_ps(a, b); }
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return _mm_div_ps(a, b); }
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return _mm_min_ps(a, b); }
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return _mm_max_ps(a, b); }
+inline SimdFloat SimdSqrt(SimdFloat a) { return _mm_sqrt_ps(a); }
+// SSE2 only: exact for |a| < 2^31.
+inline SimdFloat SimdRound(SimdFloat a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+inline SimdFloat SimdFloor(SimdFloat a)
+{
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+}
+
+inline SimdFloat SimdCmpLT(SimdFloat a, SimdFloat b) { return _mm_cmplt_ps(a, b); }
+inline SimdFloat SimdCmpLE(SimdFloat a, SimdFloat b) { return _mm_cmple_ps(a, b); }
+inline SimdFloat SimdCmpGT(SimdFloat a, SimdFloat b) { return _mm_cmpgt_ps(a, b); }
+inline SimdFloat SimdCmpGE(SimdFloat a, SimdFloat b) { return _mm_cmpge_ps(a, b); }
+
+inline SimdFloat SimdAnd(SimdFloat a, SimdFloat b) { return _mm_and_ps(a, b); }
+inline SimdFloat SimdOr(SimdFloat a, SimdFloat b) { return _mm_or_ps(a, b); }
+inline SimdFloat SimdXor(SimdFloat a, SimdFloat b) { return _mm_xor_ps(a, b); }
+// (~a) & b
+inline SimdFloat SimdAndNot(SimdFloat a, SimdFloat b) { return _mm_andnot_ps(a, b); }
+// mask ? a : b
+inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline int SimdMoveMask(SimdFloat mask) { return _mm_movemask_ps(mask); }
+inline SimdFloat SimdCmpEQ(SimdFloat a, SimdFloat b) { return _mm_cmpeq_ps(a, b); }
+inline SimdFloat SimdCmpUnordered(SimdFloat a, SimdFloat b) { return _mm_cmpunord_ps(a, b); }
+
+inline SimdFloat SimdConvertBitsToFloat(SimdFloat a) { return _mm_cvtepi32_ps(_mm_castps_si128(a)); }
+inline SimdFloat SimdConvertFloatToBits(SimdFloat a) { return _mm_castsi128_ps(_mm_cvtps_epi32(a)); }
+inline SimdFloat SimdSet1Bits(uint32_t bits) { return _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(bits))); }
+
+inline float SimdReduceMin(SimdFloat v)
+{
+    __m128 m = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+inline float SimdReduceMax(SimdFloat v)
+{
+    __m128 m = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+#endif
+
+inline SimdFloat SimdAbs(SimdFloat v) { return SimdAndNot(SimdSet1(-0.0f), v); }
+inline SimdFloat SimdMulAdd(SimdFloat a, SimdFloat b, SimdFloat c) { return SimdAdd(SimdMul(a, b), c); }
+
+// Transcendental functions in two accuracy tiers: the plain ones are within about 1 ulp of <cmath> (Cephes),
+// the Fast ones within about 1e-4 relative error, with lower degree polynomials.
+// Results that would be denormal flush to zero, and denormal inputs of Log are handled.
+// Please refer to: Stephen Moshier, Cephes Mathematical Library, http://www.netlib.org/cephes/
+
+// x * 2^n for integral n in [-126, 127].
+inline SimdFloat SimdLdexp(SimdFloat x, SimdFloat n)
+{
+    return SimdMul(x, SimdConvertFloatToBits(SimdMul(SimdAdd(n, SimdSet1(127.0f)), SimdSet1(8388608.0f))));
+}
+
+template<bool Fast>
+inline SimdFloat SimdExpImpl(SimdFloat x)
+{
+    const SimdFloat maxX = SimdSet1(88.72283935546875f);
+    const SimdFloat minX = SimdSet1(-87.33654022216797f);
+    SimdFloat overflow = SimdCmpGT(x, maxX);
+    SimdFloat underflow = SimdCmpLT(x, minX);
+    SimdFloat nan = SimdCmpUnordered(x, x);
+    SimdFloat clamped = SimdMin(SimdMax(x, minX), maxX);
+
+    // exp(x) = 2^n * exp(r), r = x - n * ln(2) in [-ln(2) / 2, ln(2) / 2], ln(2) split in two for precision.
+    SimdFloat n = SimdRound(SimdMul(clamped, SimdSet1(1.44269504088896341f)));
+    SimdFloat r = SimdSub(clamped, SimdMul(n, SimdSet1(0.693359375f)));
+    r = SimdSub(r, SimdMul(n, SimdSet1(-2.12194440e-4f)));
+    SimdFloat z = SimdMul(r, r);
+    SimdFloat p;
+    if constexpr (Fast)
+    {
+        p = SimdMulAdd(SimdSet1(4.1666666e-2f), r, SimdSet1(1.6666667e-1f));
+        p = SimdMulAdd(p, r, SimdSet1(0.5f));
+    }
+    else
+    {
+        p = SimdMulAdd(SimdSet1(1.9875691500e-4f), r, SimdSet1(1.3981999507e-3f));
+        p = SimdMulAdd(p, r, SimdSet1(8.3334519073e-3f));
+        p = SimdMulAdd(p, r, SimdSet1(4.1665795894e-2f));
+        p = SimdMulAdd(p, r, SimdSet1(1.6666665459e-1f));
+        p = SimdMulAdd(p, r, SimdSet1(5.0000001201e-1f));
+    }
+    SimdFloat y = SimdAdd(SimdAdd(SimdMul(p, z), r), SimdSet1(1.0f));
+
+    // n = 128 near the top of the range: scale by 2^127 and double.
+    SimdFloat top = SimdCmpGT(n, SimdSet1(127.0f));
+    y = SimdLdexp(y, SimdMin(n, SimdSet1(127.0f)));
+    y = SimdAdd(y, SimdAnd(top, y));
+
+    y = SimdSelect(overflow, SimdSet1(INFINITY), y);
+    y = SimdAndNot(underflow, y);
+    return SimdSelect(nan, x, y);
+}
+
+inline SimdFloat SimdExp(SimdFloat x) { return SimdExpImpl<false>(x); }
+inline SimdFloat SimdExpFast(SimdFloat x) { return SimdExpImpl<true>(x); }
+
+template<bool Fast>
+inline SimdFloat SimdLogImpl(SimdFloat x)
+{
+    SimdFloat invalid = SimdOr(SimdCmpLT(x, SimdZero()), SimdCmpUnordered(x, x));
+    SimdFloat zero = SimdCmpEQ(x, SimdZero());
+    SimdFloat infinite = SimdCmpEQ(x, SimdSet1(INFINITY));
+
+    // Scale denormals to normals.
+    SimdFloat denormal = SimdCmpLT(x, SimdSet1(FLT_MIN));
+    x = SimdSelect(denormal, SimdMul(x, SimdSet1(8388608.0f)), x);
+    SimdFloat e = SimdSub(SimdMul(SimdConvertBitsToFloat(SimdAnd(x, SimdSet1Bits(0x7f800000u))), SimdSet1(1.0f / 8388608.0f)),
+        SimdSet1(126.0f));
+    e = SimdSub(e, SimdAnd(denormal, SimdSet1(23.0f)));
+    // x = m * 2^e, m in [0.5, 1); move m to [sqrt(0.5), sqrt(2)).
+    SimdFloat m = SimdOr(SimdAnd(x, SimdSet1Bits(0x007fffffu)), SimdSet1Bits(0x3f000000u));
+    SimdFloat small = SimdCmpLT(m, SimdSet1(0.707106781186547524f));
+    e = SimdSub(e, SimdAnd(small, SimdSet1(1.0f)));
+    m = SimdAdd(m, SimdAnd(small, m));
+
+    SimdFloat y;
+    if constexpr (Fast)
+    {
+        // ln(m) = 2 atanh(s), s = (m - 1) / (m + 1) in [-0.172, 0.172].
+        SimdFloat s = SimdDiv(SimdSub(m, SimdSet1(1.0f)), SimdAdd(m, SimdSet1(1.0f)));
+        SimdFloat s2 = SimdMul(s, s);
+        SimdFloat p = SimdMulAdd(SimdMulAdd(SimdSet1(0.4f), s2, SimdSet1(0.6666667f)), s2, SimdSet1(2.0f));
+        y = SimdMulAdd(e, SimdSet1(0.693147180559945309f), SimdMul(p, s));
+    }
+    else
+    {
+        SimdFloat r = SimdSub(m, SimdSet1(1.0f));
+        SimdFloat z = SimdMul(r, r);
+        SimdFloat p = SimdMulAdd(SimdSet1(7.0376836292e-2f), r, SimdSet1(-1.1514610310e-1f));
+        p = SimdMulAdd(p, r, SimdSet1(1.1676998740e-1f));
+        p = SimdMulAdd(p, r, SimdSet1(-1.2420140846e-1f));
+        p = SimdMulAdd(p, r, SimdSet1(1.4249322787e-1f));
+        p = SimdMulAdd(p, r, SimdSet1(-1.6668057665e-1f));
+        p = SimdMulAdd(p, r, SimdSet1(2.0000714765e-1f));
+        p = SimdMulAdd(p, r, SimdSet1(-2.4999993993e-1f));
+        p = SimdMulAdd(p, r, SimdSet1(3.3333331174e-1f));
+        y = SimdMul(SimdMul(p, r), z);
+        y = SimdAdd(y, SimdMul(e, SimdSet1(-2.12194440e-4f)));
+        y = SimdSub(y, SimdMul(z, SimdSet1(0.5f)));
+        y = SimdAdd(r, y);
+        y = SimdAdd(y, SimdMul(e, SimdSet1(0.693359375f)));
+    }
+
+    y = SimdSelect(infinite, x, y);
+    y = SimdSelect(zero, SimdSet1(-INFINITY), y);
+    return SimdSelect(invalid, SimdSet1(NAN), y);
+}
+
+inline SimdFloat SimdLog(SimdFloat x) { return SimdLogImpl<false>(x); }
+inline SimdFloat SimdLogFast(SimdFloat x) { return SimdLogImpl<true>(x); }
+
+// Octant reduction with pi/4 split in three parts, accurate for |x| < 8192.
+template<bool Fast>
+inline void SimdSinCosImpl(SimdFloat x, SimdFloat& sinX, SimdFloat& cosX)
+{
+    SimdFloat signMask = SimdSet1(-0.0f);
+    SimdFloat sinSign = SimdAnd(x, signMask);
+    x = SimdAbs(x);
+
+    // j = the octant of x, rounded up to even; reduce x to [-pi/4, pi/4] with pi/4 split in three.
+    SimdFloat j = SimdFloor(SimdMul(x, SimdSet1(1.27323954473516f)));
+    j = SimdAdd(j, SimdAnd(SimdCmpEQ(SimdSub(j, SimdMul(SimdFloor(SimdMul(j, SimdSet1(0.5f))), SimdSet1(2.0f))),
+        SimdSet1(1.0f)), SimdSet1(1.0f)));
+    x = SimdSub(x, SimdMul(j, SimdSet1(0.78515625f)));
+    x = SimdSub(x, SimdMul(j, SimdSet1(2.4187564849853515625e-4f)));
+    x = SimdSub(x, SimdMul(j, SimdSet1(3.77489497744594108e-8f)));
+    // j mod 8, in 0, 2, 4, 6.
+    j = SimdSub(j, SimdMul(SimdFloor(SimdMul(j, SimdSet1(0.125f))), SimdSet1(8.0f)));
+
+    SimdFloat z = SimdMul(x, x);
+    SimdFloat s, c;
+    if constexpr (Fast)
+    {
+        s = SimdMulAdd(SimdMulAdd(SimdSet1(8.3333333e-3f), z, SimdSet1(-1.6666667e-1f)), SimdMul(z, x), x);
+        c = SimdMulAdd(SimdMulAdd(SimdSet1(-1.3888889e-3f), z, SimdSet1(4.1666667e-2f)), SimdMul(z, z),
+            SimdSub(SimdSet1(1.0f), SimdMul(z, SimdSet1(0.5f))));
+    }
+    else
+    {
+        s = SimdMulAdd(SimdSet1(-1.9515295891e-4f), z, SimdSet1(8.3321608736e-3f));
+        s = SimdMulAdd(s, z, SimdSet1(-1.6666654611e-1f));
+        s = SimdMulAdd(s, SimdMul(z, x), x);
+        c = SimdMulAdd(SimdSet1(2.443315711809948e-5f), z, SimdSet1(-1.388731625493765e-3f));
+        c = SimdMulAdd(c, z, SimdSet1(4.166664568298827e-2f));
+        c = SimdMulAdd(c, SimdMul(z, z), SimdSub(SimdSet1(1.0f), SimdMul(z, SimdSet1(0.5f))));
+    }
+
+    // Octants 2 and 6 swap sin and cos; sin flips in 4 and 6, cos in 2 and 4.
+    SimdFloat swap = SimdOr(SimdCmpEQ(j, SimdSet1(2.0f)), SimdCmpEQ(j, SimdSet1(6.0f)));
+    SimdFloat sinFlip = SimdAnd(SimdCmpGE(j, SimdSet1(4.0f)), signMask);
+    SimdFloat cosFlip = SimdAnd(SimdAnd(SimdCmpGE(j, SimdSet1(2.0f)), SimdCmpLE(j, SimdSet1(4.0f))), signMask);
+    sinX = SimdXor(SimdSelect(swap, c, s), SimdXor(sinFlip, sinSign));
+    cosX = SimdXor(SimdSelect(swap, s, c), cosFlip);
+}
+
+inline SimdFloat SimdSin(SimdFloat x) { SimdFloat s, c; SimdSinCosImpl<false>(x, s, c); return s; }
+inline SimdFloat SimdCos(SimdFloat x) { SimdFloat s, c; SimdSinCosImpl<false>(x, s, c); return c; }
+inline SimdFloat SimdSinFast(SimdFloat x) { SimdFloat s, c; SimdSinCosImpl<true>(x, s, c); return s; }
+inline SimdFloat SimdCosFast(SimdFloat x) { SimdFloat s, c; SimdSinCosImpl<true>(x, s, c); return c; }
+
+// x^y = exp(y * log(x)) for x >= 0 (NaN for x < 0); the error grows with |y * log(x)|.
+template<bool Fast>
+inline SimdFloat SimdPowImpl(SimdFloat x, SimdFloat y)
+{
+    SimdFloat r = SimdExpImpl<Fast>(SimdMul(y, SimdLogImpl<Fast>(x)));
+    // x^0 = 1 (including 0^0), 0^y = 0 for y > 0 and inf for y < 0.
+    SimdFloat zero = SimdCmpEQ(x, SimdZero());
+    r = SimdSelect(zero, SimdSelect(SimdCmpGT(y, SimdZero()), SimdZero(), SimdSet1(INFINITY)), r);
+    r = SimdSelect(SimdCmpEQ(x, SimdSet1(1.0f)), SimdSet1(1.0f), r);
+    return SimdSelect(SimdCmpEQ(y, SimdZero()), SimdSet1(1.0f), r);
+}
+
+inline SimdFloat SimdPow(SimdFloat x, SimdFloat y) { return SimdPowImpl<false>(x, y); }
+inline SimdFloat SimdPowFast(SimdFloat x, SimdFloat y) { return SimdPowImpl<true>(x, y); }
+
+// sRGB transfer functions (IEC 61966-2-1).
+template<bool Fast>
+inline SimdFloat SimdLinearToSrgbImpl(SimdFloat x)
+{
+    SimdFloat curve = SimdSub(SimdMul(SimdSet1(1.055f), SimdPowImpl<Fast>(x, SimdSet1(1.0f / 2.4f))), SimdSet1(0.055f));
+    return SimdSelect(SimdCmpLE(x, SimdSet1(0.0031308f)), SimdMul(x, SimdSet1(12.92f)), curve);
+}
+
+template<bool Fast>
+inline SimdFloat SimdSrgbToLinearImpl(SimdFloat x)
+{
+    SimdFloat curve = SimdPowImpl<Fast>(SimdMul(SimdAdd(x, SimdSet1(0.055f)), SimdSet1(1.0f / 1.055f)), SimdSet1(2.4f));
+    return SimdSelect(SimdCmpLE(x, SimdSet1(0.04045f)), SimdMul(x, SimdSet1(1.0f / 12.92f)), curve);
+}
+
+inline SimdFloat SimdLinearToSrgb(SimdFloat x) { return SimdLinearToSrgbImpl<false>(x); }
+inline SimdFloat SimdLinearToSrgbFast(SimdFloat x) { return SimdLinearToSrgbImpl<true>(x); }
+inline SimdFloat SimdSrgbToLinear(SimdFloat x) { return SimdSrgbToLinearImpl<false>(x); }
+inline SimdFloat SimdSrgbToLinearFast(SimdFloat x) { return SimdSrgbToLinearImpl<true>(x); }
+
+#endif // RADCPP_SIMD_H
@@ -0,0 +1,155 @@
+#include "radcpp/Common/TransformHierarchy.h"
+#include "radcpp/Common/Parallel.h"
+
+TransformHierarchy::TransformHierarchy()
+{
+}
+
+TransformHierarchy::~TransformHierarchy()
+{
+}
+
+void TransformHierarchy::Build(const uint32_t* parents, const glm::mat4* localTransforms, size_t count)
+{
+    assert(count < InvalidIndex);
+    m_parents.assign(parents, parents + count);
+    m_localTransforms.assign(localTransforms, localTransforms + count);
+    m_worldTransforms.resize(count);
+    m_levels.resize(count);
+    m_subtreeEnds.resize(count);
+    m_dirtyFlags.assign(count, 0);
+    m_dirtyNodes.clear();
+    m_updateStamps.assign(count, 0);
+    m_updateCount = 1;
+    m_updatedRanges.clear();
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint32_t parent = m_parents[i];
+        assert((parent == InvalidIndex) || (parent < i));
+        m_levels[i] = (parent == InvalidIndex) ? 0 : (m_levels[parent] + 1);
+        m_subtreeEnds[i] = i + 1;
+    }
+    // In preorder, a subtree ends where the subtree of its last child ends.
+    for (uint32_t i = static_cast<uint32_t>(count); i-- > 0;)
+    {
+        const uint32_t parent = m_parents[i];
+        if (parent != InvalidIndex)
+        {
+            m_subtreeEnds[parent] = std::max(m_subtreeEnds[parent], m_subtreeEnds[i]);
+        }
+    }
+    UpdateRange(0, static_cast<uint32_t>(count));
+}
+
+void TransformHierarchy::Clear()
+{
+    m_parents.clear();
+    m_subtreeEnds.clear();
+    m_levels.clear();
+    m_localTransforms.clear();
+    m_worldTransforms.clear();
+    m_dirtyFlags.clear();
+    m_dirtyNodes.clear();
+    m_updateStamps.clear();
+    m_updatedRanges.clear();
+}
+
+void TransformHierarchy::SetLocalTransform(uint32_t index, const glm::mat4& transform)
+{
+    m_localTransforms[index] = transform;
+    if (!m_dirtyFlags[index])
+    {
+        m_dirtyFlags[index] = 1;
+        m_dirtyNodes.push_back(index);
+    }
+}
+
+size_t TransformHierarchy::Update()
+{
+    if (m_dirtyNodes.empty())
+    {
+        return 0;
+    }
+    ++m_updateCount;
+    m_updatedRanges.clear();
+
+    // Ascending order puts each node after the dirty ancestors that cover it.
+    std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end());
+    size_t updateCount = 0;
+    uint32_t coveredEnd = 0;
+    for (uint32_t index : m_dirtyNodes)
+    {
+        m_dirtyFlags[index] = 0;
+        if (index < coveredEnd)
+        {
+            continue;
+        }
+        coveredEnd = m_subtreeEnds[index];
+        UpdateRange(index, coveredEnd);
+        m_updatedRanges.emplace_back(index, coveredEnd);
+        updateCount += coveredEnd - index;
+    }
+    m_dirtyNodes.clear();
+    return updateCount;
+}
+
+void TransformHierarchy::UpdateWorldTransform(uint32_t index)
+{
+    const uint32_t parent = m_parents[index];
+    m_worldTransforms[index] = (parent == InvalidIndex) ?
+        m_localTransforms[index] : (m_worldTransforms[parent] * m_localTransforms[index]);
+    m_updateStamps[index] = m_updateCount;
+}
+
+// The parents of the range are up to date, or in the range (before their children).
+void TransformHierarchy::UpdateRange(uint32_t begin, uint32_t end)
+{
+    // Descend while the range is a single subtree: update its root, its children are the rest of the range.
+    while ((end - begin >= m_parallelThreshold) && (m_subtreeEnds[begin] == end))
+    {
+        UpdateWorldTransform(begin++);
+    }
+    if (end - begin < m_parallelThreshold)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            UpdateWorldTransform(i);
+        }
+        return;
+    }
+
+    // The range is a sequence of sibling subtrees, which are independent: update them in parallel,
+    // in chunks of whole subtrees of about m_parallelThreshold nodes.
+    std::vector<std::pair<uint32_t, uint32_t>> chunks;
+    uint32_t chunkBegin = begin;
+    for (uint32_t i = begin; i < end; i = m_subtreeEnds[i])
+    {
+        if (m_subtreeEnds[i] - chunkBegin >= m_parallelThreshold)
+        {
+            chunks.emplace_back(chunkBegin, m_subtreeEnds[i]);
+            chunkBegin = m_subtreeEnds[i];
+        }
+    }
+    if (chunkBegin < end)
+    {
+        chunks.emplace_back(chunkBegin, end);
+    }
+    ParallelFor(0, chunks.size(), 1,
+        [&](size_t first, size_t last)
+        {
+            for (size_t c = first; c < last; ++c)
+            {
+                auto [chunkBegin, chunkEnd] = chunks[c];
+                if (m_subtreeEnds[chunkBegin] == chunkEnd)
+                {
+                    UpdateRange(chunkBegin, chunkEnd);
+                    continue;
+                }
+                for (uint32_t i = chunkBegin; i < chunkEnd; ++i)
+                {
+                    UpdateWorldTransform(i);
+                }
+            }
+        });
+}
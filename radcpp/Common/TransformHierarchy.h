@@ -0,0 +1,65 @@
+#ifndef RADCPP_TRANSFORM_HIERARCHY_H
+#define RADCPP_TRANSFORM_HIERARCHY_H
+#pragma once
+
+#include "radcpp/Common/Math.h"
+
+// Flattened transform hierarchy: contiguous arrays of local and world transforms, in depth-first preorder
+// so that parents come before their children and each subtree is a contiguous range.
+// Changing a local transform marks the node dirty; Update() only recomputes the dirty subtrees,
+// splitting large ones (wide levels) into sibling subtrees updated in parallel.
+class TransformHierarchy
+{
+public:
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    TransformHierarchy();
+    ~TransformHierarchy();
+
+    // parents[i] is the index of the parent of node i (less than i), or InvalidIndex for roots;
+    // the nodes must be in depth-first preorder. All world transforms are computed.
+    void Build(const uint32_t* parents, const glm::mat4* localTransforms, size_t count);
+    void Clear();
+
+    size_t GetNodeCount() const { return m_parents.size(); }
+    uint32_t GetParent(uint32_t index) const { return m_parents[index]; }
+    // The end of the range [index, end) of the subtree of the node.
+    uint32_t GetSubtreeEnd(uint32_t index) const { return m_subtreeEnds[index]; }
+    uint32_t GetLevel(uint32_t index) const { return m_levels[index]; }
+
+    const glm::mat4& GetLocalTransform(uint32_t index) const { return m_localTransforms[index]; }
+    // Up to date after Update().
+    const glm::mat4& GetWorldTransform(uint32_t index) const { return m_worldTransforms[index]; }
+    // Not thread-safe.
+    void SetLocalTransform(uint32_t index, const glm::mat4& transform);
+    bool HasDirtyNodes() const { return !m_dirtyNodes.empty(); }
+
+    // Recompute the world transforms of the dirty subtrees; return the number of nodes updated.
+    size_t Update();
+    // Whether the world transform of the node was recomputed by the last Update().
+    bool IsUpdated(uint32_t index) const { return (m_updateStamps[index] == m_updateCount); }
+    // The node ranges [begin, end) recomputed by the last Update(): whole subtrees, disjoint and in ascending order.
+    const std::vector<std::pair<uint32_t, uint32_t>>& GetUpdatedRanges() const { return m_updatedRanges; }
+
+    // Subtrees with more nodes are updated in parallel on the global thread pool.
+    size_t m_parallelThreshold = 4096;
+
+private:
+    void UpdateWorldTransform(uint32_t index);
+    void UpdateRange(uint32_t begin, uint32_t end);
+
+    std::vector<uint32_t> m_parents;
+    std::vector<uint32_t> m_subtreeEnds;
+    std::vector<uint32_t> m_levels;
+    std::vector<glm::mat4> m_localTransforms;
+    std::vector<glm::mat4> m_worldTransforms;
+
+    std::vector<uint8_t> m_dirtyFlags;
+    std::vector<uint32_t> m_dirtyNodes;
+    std::vector<uint32_t> m_updateStamps;
+    uint32_t m_updateCount = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> m_updatedRanges;
+
+}; // class TransformHierarchy
+
+#endif // RADCPP_TRANSFORM_HIERARCHY_H
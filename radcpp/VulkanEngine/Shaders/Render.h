@@ -9,8 +9,29 @@ layout(set = 0, binding = 0) uniform FrameUniforms
 layout(set = 0, binding = 1) uniform MeshUniforms
 {
     mat4 modelToWorld;
+    mat3 normalToWorld; // inverse transpose of modelToWorld
+    vec4 positionOffset; // dequantization of compact positions
+    vec4 positionScale;
 } g_meshUniforms;
 
+// Octahedral mapping of unit vectors to [-1, 1]^2.
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+// Compact tangent: octahedral x in 16 bits, y in 15 bits, and the handness in the top bit.
+vec4 DecodeTangent(uvec2 packed)
+{
+    vec2 e = vec2(float(packed.x) / 65535.0, float(packed.y & 0x7FFFu) / 32767.0) * 2.0 - 1.0;
+    float handness = ((packed.y & 0x8000u) != 0u) ? -1.0 : 1.0;
+    return vec4(DecodeOctahedral(e), handness);
+}
+
 struct FragAttribs
 {
     vec3 worldPosition;
@@ -2,6 +2,17 @@
 
 #include "Render.h"
 
+#ifdef COMPACT_VERTEX_FORMAT
+#ifdef HAS_POSITION
+layout(location = 0) in vec4 g_inputPosition; // unorm16, relative to the mesh bounding box
+#endif
+#ifdef HAS_NORMAL
+layout(location = 1) in vec2 g_inputNormal; // octahedral
+#endif
+#ifdef HAS_TANGENT
+layout(location = 2) in uvec2 g_inputTangent; // see DecodeTangent
+#endif
+#else
 #ifdef HAS_POSITION
 layout(location = 0) in vec3 g_inputPosition;
 #endif
@@ -11,6 +22,7 @@ layout(location = 1) in vec3 g_inputNormal;
 #ifdef HAS_TANGENT
 layout(location = 2) in vec4 g_inputTangent;
 #endif
+#endif
 #ifdef HAS_COLOR
 layout(location = 3) in vec4 g_inputColor;
 #endif
@@ -22,19 +34,37 @@ layout(location = 0) out FragAttribs g_fragAttribs;
 
 void main()
 {
-    vec4 worldPosition = g_meshUniforms.modelToWorld * vec4(g_inputPosition, 1.0f);
+#ifdef COMPACT_VERTEX_FORMAT
+    vec3 position = g_meshUniforms.positionOffset.xyz + g_meshUniforms.positionScale.xyz * g_inputPosition.xyz;
+#ifdef HAS_NORMAL
+    vec3 normal = DecodeOctahedral(g_inputNormal);
+#endif
+#ifdef HAS_TANGENT
+    vec4 tangent = DecodeTangent(g_inputTangent);
+#endif
+#else
+    vec3 position = g_inputPosition;
+#ifdef HAS_NORMAL
+    vec3 normal = g_inputNormal;
+#endif
+#ifdef HAS_TANGENT
+    vec4 tangent = g_inputTangent;
+#endif
+#endif
+
+    vec4 worldPosition = g_meshUniforms.modelToWorld * vec4(position, 1.0f);
     gl_Position = g_frameUniforms.viewProjectionMatrix * worldPosition;
 
     g_fragAttribs.worldPosition = worldPosition.xyz;
 
 #ifdef HAS_NORMAL
 #ifdef HAS_TANGENT
-    vec3 worldNormal = normalize(vec3(g_meshUniforms.modelToWorld * vec4(g_inputNormal, 0.0)));
-    vec3 worldTangent = normalize(vec3(g_meshUniforms.modelToWorld * vec4(g_inputTangent.xyz, 0.0)));
-    vec3 worldBitangent = cross(worldNormal, worldTangent) * g_inputTangent.w;
+    vec3 worldNormal = normalize(g_meshUniforms.normalToWorld * normal);
+    vec3 worldTangent = normalize(vec3(g_meshUniforms.modelToWorld * vec4(tangent.xyz, 0.0)));
+    vec3 worldBitangent = cross(worldNormal, worldTangent) * tangent.w;
     g_fragAttribs.tangentToWorld = mat3(worldTangent, worldBitangent, worldNormal);
 #else
-    g_fragAttribs.worldNormal = normalize(vec3(g_meshUniforms.normalMatrix * vec4(g_inputNormal, 0.0)));
+    g_fragAttribs.worldNormal = normalize(g_meshUniforms.normalToWorld * normal);
 #endif
 #endif
 
@@ -17,3 +17,15 @@ glm::mat4 VulkanCamera::GetProjectionMatrix()
 {
     return glm::perspective(m_yfov, m_aspectRatio, m_zNear, m_zFar);
 }
+
+Ray VulkanCamera::GenerateRay(float x, float y)
+{
+    glm::mat4 inverseViewProjection = glm::inverse(GetProjectionMatrix() * GetViewMatrix());
+    // OpenGL clip space (the projection matrix is not corrected for Vulkan): y up, z in [-1, 1].
+    glm::vec2 ndc = glm::vec2(2.0f * x - 1.0f, 1.0f - 2.0f * y);
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, +1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+    return Ray(origin, glm::normalize(target - origin));
+}
@@ -4,6 +4,7 @@
 
 #include "radcpp/Common/Math.h"
 #include "radcpp/Common/Memory.h"
+#include "radcpp/Common/Ray.h"
 
 class VulkanCamera : public RefCounted<VulkanCamera>
 {
@@ -20,6 +21,8 @@ public:
     // assume all directions are normalized
     glm::mat4 GetViewMatrix();
     glm::mat4 GetProjectionMatrix();
+    // The ray through the point (x, y) of the view, in [0, 1] from the top-left corner (for picking).
+    Ray GenerateRay(float x, float y);
 
     std::string m_name;
     Type m_type = Type::Perspective;
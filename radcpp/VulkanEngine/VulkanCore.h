@@ -21,6 +21,7 @@
 #include "VulkanCore/VulkanSemaphore.h"
 #include "VulkanCore/VulkanShader.h"
 #include "VulkanCore/VulkanSwapchain.h"
+#include "VulkanCore/VulkanUploadContext.h"
 #include "VulkanCore/VulkanWindow.h"
 
 #endif // VULKAN_CORE_H
\ No newline at end of file
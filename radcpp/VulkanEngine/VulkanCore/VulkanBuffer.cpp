@@ -2,6 +2,7 @@
 #include "VulkanDevice.h"
 #include "VulkanQueue.h"
 #include "VulkanCommandBuffer.h"
+#include "VulkanUploadContext.h"
 
 VulkanBuffer::VulkanBuffer(Ref<VulkanDevice> device, const VulkanBufferCreateInfo& createInfo) :
     m_device(std::move(device))
@@ -137,19 +138,8 @@ void VulkanBuffer::Write(const void* data, VkDeviceSize offset, VkDeviceSize siz
     }
     else
     {
-        Ref<VulkanCommandBuffer> commandBuffer = m_device->AllocateCommandBufferOneTimeUse();
-
-        Ref<VulkanBuffer> stagingBuffer = m_device->CreateStagingBuffer(size);
-        stagingBuffer->Write(data);
-        commandBuffer->Begin();
-        VkBufferCopy copyRegion = {};
-        copyRegion.srcOffset = 0;
-        copyRegion.dstOffset = offset;
-        copyRegion.size = size;
-        commandBuffer->CopyBuffer(stagingBuffer.get(), this, { &copyRegion, 1 });
-        commandBuffer->End();
-
-        m_device->GetQueue()->SubmitAndWaitForCompletion({ commandBuffer.get() });
+        // Batched with the other uploads, submitted before the frame (VulkanWindow::EndFrame flushes them).
+        m_device->GetUploadContext()->UploadBuffer(this, offset, data, size);
     }
 }
 
@@ -23,6 +23,9 @@ public:
 
     void Read(void* dest, VkDeviceSize offset, VkDeviceSize size);
     void Read(void* dest);
+    // Device local buffers are written through the upload context of the device, without waiting: the copy is
+    // batched, and submitted by the next Flush() of the upload context (once a frame, before the frame submission);
+    // flush it to use the buffer in a submission of your own.
     void Write(const void* data, VkDeviceSize offset, VkDeviceSize size);
     void Write(const void* data);
 
@@ -38,6 +38,52 @@ void VulkanCommandBuffer::Begin(VkCommandBufferUsageFlags flags, const VkCommand
 
     VK_CHECK(m_device->GetFunctionTable()->
         vkBeginCommandBuffer(m_handle, &beginInfo));
+    InvalidateStateCache();
+    m_stateCommandCount = 0;
+    m_skippedStateCommandCount = 0;
+}
+
+void VulkanCommandBuffer::InvalidateStateCache()
+{
+    for (BindPointState& state : m_bindPointStates)
+    {
+        state.pipeline = VK_NULL_HANDLE;
+        state.layout = VK_NULL_HANDLE;
+        for (BoundDescriptorSet& descriptorSet : state.descriptorSets)
+        {
+            descriptorSet.handle = VK_NULL_HANDLE;
+        }
+    }
+    std::fill(std::begin(m_vertexBuffers), std::end(m_vertexBuffers), VK_NULL_HANDLE);
+    m_indexBuffer = VK_NULL_HANDLE;
+    m_viewports.clear();
+    m_scissors.clear();
+}
+
+bool VulkanCommandBuffer::SkipStateCommand(bool redundant)
+{
+    m_stateCommandCount++;
+    if (redundant)
+    {
+        m_skippedStateCommandCount++;
+    }
+    return redundant;
+}
+
+void VulkanCommandBuffer::BeginSecondary(VulkanRenderPass* renderPass, uint32_t subpass,
+    VulkanFramebuffer* framebuffer, VkCommandBufferUsageFlags flags)
+{
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.pNext = nullptr;
+    inheritanceInfo.renderPass = renderPass->GetHandle();
+    inheritanceInfo.subpass = subpass;
+    inheritanceInfo.framebuffer = framebuffer ? framebuffer->GetHandle() : VK_NULL_HANDLE;
+    inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+    inheritanceInfo.queryFlags = 0;
+    inheritanceInfo.pipelineStatistics = 0;
+
+    Begin(flags | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &inheritanceInfo);
 }
 
 void VulkanCommandBuffer::End()
@@ -69,7 +115,7 @@ void VulkanCommandBuffer::BeginRenderPass(
 
 void VulkanCommandBuffer::BeginRenderPass(
     VulkanRenderPass* renderPass, VulkanFramebuffer* framebuffer,
-    ArrayRef<VkClearValue> clearValues)
+    ArrayRef<VkClearValue> clearValues, VkSubpassContents contents)
 {
     VkRenderPassBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -83,7 +129,7 @@ void VulkanCommandBuffer::BeginRenderPass(
     beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     beginInfo.pClearValues = clearValues.data();
 
-    BeginRenderPass(beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    BeginRenderPass(beginInfo, contents);
 }
 
 void VulkanCommandBuffer::EndRenderPass()
@@ -97,10 +143,32 @@ void VulkanCommandBuffer::NextSubpass(VkSubpassContents contents)
         vkCmdNextSubpass(m_handle, contents);
 }
 
+void VulkanCommandBuffer::ExecuteCommands(ArrayRef<VulkanCommandBuffer*> commandBuffers)
+{
+    SmallVector<VkCommandBuffer, 8> commandBufferHandles(commandBuffers.size());
+    for (size_t i = 0; i < commandBuffers.size(); i++)
+    {
+        commandBufferHandles[i] = commandBuffers[i]->GetHandle();
+    }
+    m_device->GetFunctionTable()->
+        vkCmdExecuteCommands(m_handle, static_cast<uint32_t>(commandBufferHandles.size()), commandBufferHandles.data());
+    InvalidateStateCache();
+}
+
 void VulkanCommandBuffer::BindPipeline(VulkanPipeline* pipeline)
 {
+    const VkPipelineBindPoint bindPoint = pipeline->GetBindPoint();
+    if (bindPoint < CachedBindPointCount)
+    {
+        VkPipeline& boundPipeline = m_bindPointStates[bindPoint].pipeline;
+        if (SkipStateCommand(boundPipeline == pipeline->GetHandle()))
+        {
+            return;
+        }
+        boundPipeline = pipeline->GetHandle();
+    }
     m_device->GetFunctionTable()->
-        vkCmdBindPipeline(m_handle, pipeline->GetBindPoint(), pipeline->GetHandle());
+        vkCmdBindPipeline(m_handle, bindPoint, pipeline->GetHandle());
 }
 
 void VulkanCommandBuffer::BindDescriptorSets(
@@ -116,6 +184,45 @@ void VulkanCommandBuffer::BindDescriptorSets(
         descSetsHandles[i] = descSets[i]->GetHandle();
     }
 
+    const VkPipelineBindPoint bindPoint = pipeline->GetBindPoint();
+    const uint32_t setCount = static_cast<uint32_t>(descSetsHandles.size());
+    if ((bindPoint < CachedBindPointCount) && (firstSet + setCount <= MaxCachedDescriptorSets))
+    {
+        // Redundant if the same call was the last one to bind all the sets.
+        BindPointState& state = m_bindPointStates[bindPoint];
+        bool redundant = (state.layout == layout->GetHandle());
+        for (uint32_t i = 0; redundant && (i < setCount); i++)
+        {
+            const BoundDescriptorSet& boundSet = state.descriptorSets[firstSet + i];
+            redundant = (boundSet.handle == descSetsHandles[i]) &&
+                (boundSet.callFirstSet == firstSet) && (boundSet.callSetCount == setCount);
+        }
+        redundant = redundant && std::equal(dynamicOffsets.begin(), dynamicOffsets.end(),
+            state.descriptorSets[firstSet].callDynamicOffsets.begin(),
+            state.descriptorSets[firstSet].callDynamicOffsets.end());
+        if (SkipStateCommand(redundant))
+        {
+            return;
+        }
+        if (state.layout != layout->GetHandle())
+        {
+            // The sets bound with another layout may be disturbed.
+            for (BoundDescriptorSet& boundSet : state.descriptorSets)
+            {
+                boundSet.handle = VK_NULL_HANDLE;
+            }
+            state.layout = layout->GetHandle();
+        }
+        for (uint32_t i = 0; i < setCount; i++)
+        {
+            BoundDescriptorSet& boundSet = state.descriptorSets[firstSet + i];
+            boundSet.handle = descSetsHandles[i];
+            boundSet.callFirstSet = firstSet;
+            boundSet.callSetCount = setCount;
+        }
+        state.descriptorSets[firstSet].callDynamicOffsets.assign(dynamicOffsets.begin(), dynamicOffsets.end());
+    }
+
     m_device->GetFunctionTable()->
         vkCmdBindDescriptorSets(m_handle, pipeline->GetBindPoint(), layout->GetHandle(),
             firstSet, static_cast<uint32_t>(descSetsHandles.size()), descSetsHandles.data(),
@@ -124,11 +231,25 @@ void VulkanCommandBuffer::BindDescriptorSets(
 
 void VulkanCommandBuffer::SetScissors(ArrayRef<VkRect2D> scissors, uint32_t first)
 {
+    if (SkipStateCommand((first == m_firstScissor) && (scissors.size() == m_scissors.size()) &&
+        (memcmp(scissors.data(), m_scissors.data(), scissors.size() * sizeof(VkRect2D)) == 0)))
+    {
+        return;
+    }
+    m_firstScissor = first;
+    m_scissors.assign(scissors.begin(), scissors.end());
     m_device->GetFunctionTable()->vkCmdSetScissor(m_handle, first, static_cast<uint32_t>(scissors.size()), scissors.data());
 }
 
 void VulkanCommandBuffer::SetViewports(ArrayRef<VkViewport> viewports, uint32_t first)
 {
+    if (SkipStateCommand((first == m_firstViewport) && (viewports.size() == m_viewports.size()) &&
+        (memcmp(viewports.data(), m_viewports.data(), viewports.size() * sizeof(VkViewport)) == 0)))
+    {
+        return;
+    }
+    m_firstViewport = first;
+    m_viewports.assign(viewports.begin(), viewports.end());
     m_device->GetFunctionTable()->vkCmdSetViewport(m_handle, first, static_cast<uint32_t>(viewports.size()), viewports.data());
 }
 
@@ -170,6 +291,14 @@ void VulkanCommandBuffer::SetDepthBias(float constantFactor, float clamp, float
 
 void VulkanCommandBuffer::BindIndexBuffer(VulkanBuffer* buffer, VkDeviceSize offset, VkIndexType indexType)
 {
+    if (SkipStateCommand((m_indexBuffer == buffer->GetHandle()) &&
+        (m_indexBufferOffset == offset) && (m_indexType == indexType)))
+    {
+        return;
+    }
+    m_indexBuffer = buffer->GetHandle();
+    m_indexBufferOffset = offset;
+    m_indexType = indexType;
     m_device->GetFunctionTable()->vkCmdBindIndexBuffer(m_handle, buffer->GetHandle(), offset, indexType);
 }
 
@@ -182,6 +311,25 @@ void VulkanCommandBuffer::BindVertexBuffers(
         buffersHandles[i] = buffers[i]->GetHandle();
     }
 
+    if (firstBinding + buffersHandles.size() <= MaxCachedVertexBindings)
+    {
+        bool redundant = true;
+        for (uint32_t i = 0; redundant && (i < buffersHandles.size()); i++)
+        {
+            redundant = (m_vertexBuffers[firstBinding + i] == buffersHandles[i]) &&
+                (m_vertexBufferOffsets[firstBinding + i] == offsets[i]);
+        }
+        if (SkipStateCommand(redundant))
+        {
+            return;
+        }
+        for (uint32_t i = 0; i < buffersHandles.size(); i++)
+        {
+            m_vertexBuffers[firstBinding + i] = buffersHandles[i];
+            m_vertexBufferOffsets[firstBinding + i] = offsets[i];
+        }
+    }
+
     m_device->GetFunctionTable()->vkCmdBindVertexBuffers(m_handle,
         firstBinding, static_cast<uint32_t>(buffersHandles.size()), buffersHandles.data(), offsets.data());
 }
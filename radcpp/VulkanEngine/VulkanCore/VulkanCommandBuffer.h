@@ -4,6 +4,10 @@
 
 #include "VulkanCommon.h"
 
+// The binds and the dynamic states (viewports and scissors) are cached: setting them again to the values
+// already set is skipped. The cache is reset by Begin() and ExecuteCommands(); call InvalidateStateCache() after
+// recording commands through GetHandle(). Assumes the graphics pipelines set the viewports and scissors dynamically
+// (as VulkanGraphicsPipeline does), so that binding them does not disturb these states.
 class VulkanCommandBuffer : public VulkanObject
 {
 public:
@@ -14,17 +18,30 @@ public:
 
     void Reset(VkCommandBufferResetFlags flags = 0);
 
+    void InvalidateStateCache();
+    // The bind and dynamic state commands recorded since Begin(), including the ones skipped as redundant.
+    uint32_t GetStateCommandCount() const { return m_stateCommandCount; }
+    uint32_t GetSkippedStateCommandCount() const { return m_skippedStateCommandCount; }
+
     // Recording
 
     void Begin(VkCommandBufferUsageFlags flags = 0, const VkCommandBufferInheritanceInfo* pInheritanceInfo = nullptr);
+    // Begin a secondary command buffer to be executed inside the subpass of the render pass;
+    // the framebuffer is optional (may be more efficient if known).
+    void BeginSecondary(VulkanRenderPass* renderPass, uint32_t subpass, VulkanFramebuffer* framebuffer = nullptr,
+        VkCommandBufferUsageFlags flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
     void End();
 
     void BeginRenderPass(const VkRenderPassBeginInfo& beginInfo, VkSubpassContents contents);
     void BeginRenderPass(VulkanRenderPass* renderPass, VulkanFramebuffer* framebuffer,
         const VkRect2D& renderArea, ArrayRef<VkClearValue> clearValues, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
-    void BeginRenderPass(VulkanRenderPass* renderPass, VulkanFramebuffer* framebuffer, ArrayRef<VkClearValue> clearValues);
+    void BeginRenderPass(VulkanRenderPass* renderPass, VulkanFramebuffer* framebuffer, ArrayRef<VkClearValue> clearValues,
+        VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
     void EndRenderPass();
     void NextSubpass(VkSubpassContents contents);
+    // Execute secondary command buffers; inside a render pass, the subpass must be begun with
+    // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. The states bound are undefined after it.
+    void ExecuteCommands(ArrayRef<VulkanCommandBuffer*> commandBuffers);
 
     void BindPipeline(VulkanPipeline* pipeline);
     void BindDescriptorSets(VulkanPipeline* pipeline, VulkanPipelineLayout* layout,
@@ -162,6 +179,39 @@ private:
     VkCommandBuffer             m_handle = VK_NULL_HANDLE;
     VkCommandBufferLevel        m_level;
 
+    // State cache, for the graphics and compute bind points.
+    static constexpr uint32_t CachedBindPointCount = 2;
+    static constexpr uint32_t MaxCachedDescriptorSets = 8;
+    static constexpr uint32_t MaxCachedVertexBindings = 8;
+    struct BoundDescriptorSet
+    {
+        VkDescriptorSet handle;
+        // The sets bound by the same call, and its dynamic offsets (stored for the first set only).
+        uint32_t callFirstSet;
+        uint32_t callSetCount;
+        std::vector<uint32_t> callDynamicOffsets;
+    };
+    struct BindPointState
+    {
+        VkPipeline pipeline;
+        VkPipelineLayout layout;
+        BoundDescriptorSet descriptorSets[MaxCachedDescriptorSets];
+    };
+    // Return true if the command is redundant, and count it.
+    bool SkipStateCommand(bool redundant);
+    BindPointState              m_bindPointStates[CachedBindPointCount] = {};
+    VkBuffer                    m_vertexBuffers[MaxCachedVertexBindings] = {};
+    VkDeviceSize                m_vertexBufferOffsets[MaxCachedVertexBindings] = {};
+    VkBuffer                    m_indexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize                m_indexBufferOffset = 0;
+    VkIndexType                 m_indexType = VK_INDEX_TYPE_MAX_ENUM;
+    uint32_t                    m_firstViewport = 0;
+    std::vector<VkViewport>     m_viewports;
+    uint32_t                    m_firstScissor = 0;
+    std::vector<VkRect2D>       m_scissors;
+    uint32_t                    m_stateCommandCount = 0;
+    uint32_t                    m_skippedStateCommandCount = 0;
+
 }; // class VulkanCommandBuffer
 
 
@@ -33,6 +33,10 @@ class VulkanObject : public RefCounted<VulkanObject>
 public:
     VulkanObject() {}
     virtual ~VulkanObject() {}
+
+    // The number of Refs to the object, to find cached objects no longer used elsewhere.
+    size_t GetRefCount() const { return GetUseCount(); }
+
 protected:
     VulkanObject(VulkanObject&&) = delete;
     VulkanObject& operator=(VulkanObject&&) = delete;
@@ -65,6 +69,7 @@ class VulkanDescriptorSet;
 class VulkanDescriptorSetLayout;
 class VulkanPipelineLayout;
 class VulkanSwapchain;
+class VulkanUploadContext;
 
 class VulkanError : public std::exception
 {
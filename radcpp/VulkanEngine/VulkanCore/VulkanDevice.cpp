@@ -48,6 +48,15 @@ VulkanDevice::VulkanDevice(
         queueInfo.pQueuePriorities = queuePriorities;
         queueInfos.push_back(queueInfo);
     }
+    // Without dedicated families, the compute and transfer work goes to the universal queue.
+    if (m_queueFamilyIndices[VulkanQueueFamilyCompute] == VK_QUEUE_FAMILY_IGNORED)
+    {
+        m_queueFamilyIndices[VulkanQueueFamilyCompute] = m_queueFamilyIndices[VulkanQueueFamilyUniversal];
+    }
+    if (m_queueFamilyIndices[VulkanQueueFamilyTransfer] == VK_QUEUE_FAMILY_IGNORED)
+    {
+        m_queueFamilyIndices[VulkanQueueFamilyTransfer] = m_queueFamilyIndices[VulkanQueueFamilyUniversal];
+    }
 
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
     createInfo.pQueueCreateInfos = queueInfos.data();
@@ -93,9 +102,18 @@ VulkanDevice::VulkanDevice(
     for (uint32_t i = 0; i < VulkanQueueFamilyCount; i++)
     {
         VulkanQueueFamily queueFamily = static_cast<VulkanQueueFamily>(i);
-        m_queues[i] = MakeRefCounted<VulkanQueue>(this, queueFamily);
+        // A family falling back shares the universal queue (and its submission order).
+        if ((queueFamily != VulkanQueueFamilyUniversal) && !HasDedicatedQueue(queueFamily))
+        {
+            m_queues[i] = m_queues[VulkanQueueFamilyUniversal];
+        }
+        else
+        {
+            m_queues[i] = MakeRefCounted<VulkanQueue>(this, queueFamily);
+        }
         m_commandPoolsTransientAlloc[queueFamily] = CreateCommandPool(queueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
     }
+    m_uploadContext = MakeRefCounted<VulkanUploadContext>(this);
 }
 
 VulkanDevice::~VulkanDevice()
@@ -129,6 +147,11 @@ uint32_t VulkanDevice::GetQueueFamilyIndex(VulkanQueueFamily queueFamily)
     return m_queueFamilyIndices[queueFamily];
 }
 
+bool VulkanDevice::HasDedicatedQueue(VulkanQueueFamily queueFamily) const
+{
+    return (m_queueFamilyIndices[queueFamily] != m_queueFamilyIndices[VulkanQueueFamilyUniversal]);
+}
+
 VulkanQueue* VulkanDevice::GetQueue(VulkanQueueFamily queueFamily)
 {
     return m_queues[queueFamily].get();
@@ -182,6 +205,20 @@ Ref<VulkanSemaphore> VulkanDevice::CreateSemaphoreFromHandle(VkSemaphore semapho
     return MakeRefCounted<VulkanSemaphore>(this, semaphoreHandle);
 }
 
+Ref<VulkanSemaphore> VulkanDevice::CreateTimelineSemaphore(uint64_t initialValue)
+{
+    VkSemaphoreTypeCreateInfo typeCreateInfo = {};
+    typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeCreateInfo.pNext = nullptr;
+    typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeCreateInfo.initialValue = initialValue;
+    VkSemaphoreCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    createInfo.pNext = &typeCreateInfo;
+    createInfo.flags = 0; // reserved for future use
+    return MakeRefCounted<VulkanSemaphore>(this, createInfo);
+}
+
 Ref<VulkanEvent> VulkanDevice::CreateEvent()
 {
     VkEventCreateInfo createInfo = {};
@@ -197,6 +234,71 @@ void VulkanDevice::WaitIdle()
         vkDeviceWaitIdle(m_handle));
 }
 
+uint64_t VulkanDevice::GetCompletedSerial()
+{
+    // Read before the queues: the serials allocated afterwards are not complete.
+    uint64_t completedSerial = GetSubmittedSerial();
+    for (uint32_t i = 0; i < VulkanQueueFamilyCount; i++)
+    {
+        if ((i == VulkanQueueFamilyUniversal) || (m_queues[i] != m_queues[VulkanQueueFamilyUniversal]))
+        {
+            completedSerial = std::min(completedSerial, m_queues[i]->GetCompletedSerialBound());
+        }
+    }
+    // Kept monotonic for concurrent callers.
+    uint64_t previous = m_completedSerial.load(std::memory_order_relaxed);
+    while ((previous < completedSerial) &&
+        !m_completedSerial.compare_exchange_weak(previous, completedSerial, std::memory_order_relaxed))
+    {
+    }
+    return std::max(previous, completedSerial);
+}
+
+bool VulkanDevice::IsSerialComplete(uint64_t serial)
+{
+    return (serial <= m_completedSerial.load(std::memory_order_relaxed)) || (serial <= GetCompletedSerial());
+}
+
+void VulkanDevice::WaitForSerial(uint64_t serial)
+{
+    for (uint32_t i = 0; i < VulkanQueueFamilyCount; i++)
+    {
+        if ((i == VulkanQueueFamilyUniversal) || (m_queues[i] != m_queues[VulkanQueueFamilyUniversal]))
+        {
+            m_queues[i]->WaitForSerial(serial);
+        }
+    }
+}
+
+void VulkanDevice::TagRetired(uint64_t serial)
+{
+    std::lock_guard lock(m_retireMutex);
+    for (auto iter = m_retiredObjects.rbegin(); iter != m_retiredObjects.rend(); ++iter)
+    {
+        if (iter->serial != UINT64_MAX)
+        {
+            break;
+        }
+        iter->serial = serial;
+    }
+}
+
+size_t VulkanDevice::CollectRetired()
+{
+    // Released out of the lock: destructors may retire other objects.
+    std::vector<RetiredObject> completedObjects;
+    {
+        std::lock_guard lock(m_retireMutex);
+        const uint64_t completedSerial = GetCompletedSerial();
+        while (!m_retiredObjects.empty() && (m_retiredObjects.front().serial <= completedSerial))
+        {
+            completedObjects.push_back(std::move(m_retiredObjects.front()));
+            m_retiredObjects.pop_front();
+        }
+    }
+    return completedObjects.size();
+}
+
 Ref<VulkanRenderPass> VulkanDevice::CreateRenderPass(const VkRenderPassCreateInfo& createInfo)
 {
     return MakeRefCounted<VulkanRenderPass>(this, createInfo);
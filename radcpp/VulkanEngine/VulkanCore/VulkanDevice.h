@@ -3,6 +3,9 @@
 #pragma once
 
 #include "VulkanCommon.h"
+#include <any>
+#include <deque>
+#include <mutex>
 
 class VulkanDevice : public VulkanObject
 {
@@ -20,7 +23,10 @@ public:
     bool SupportsExtension(std::string_view extension);
 
     uint32_t GetQueueFamilyIndex(VulkanQueueFamily queueFamily);
+    // The compute and transfer families fall back to the universal queue if the device has no dedicated ones.
     VulkanQueue* GetQueue(VulkanQueueFamily queueFamily = VulkanQueueFamilyUniversal);
+    // False if the family falls back to the universal queue (for the universal family too).
+    bool HasDedicatedQueue(VulkanQueueFamily queueFamily) const;
     bool SupportsSurface(VulkanQueueFamily queueFamily, VkSurfaceKHR surface) const;
 
     Ref<VulkanCommandPool> CreateCommandPool(
@@ -28,15 +34,43 @@ public:
         VkCommandPoolCreateFlags flags = 0);
     // Allocate a command buffer from the internal CommandPool created with VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
     Ref<VulkanCommandBuffer> AllocateCommandBufferOneTimeUse(VulkanQueueFamily queueFamily = VulkanQueueFamilyUniversal);
+    // Batched uploads to device local resources, through a staging ring shared by the device.
+    VulkanUploadContext* GetUploadContext() const { return m_uploadContext.get(); }
 
     // Synchronization and Cache Control
     Ref<VulkanFence> CreateFence(VkFenceCreateFlags flags = 0);
     Ref<VulkanSemaphore> CreateSemaphore(VkSemaphoreCreateFlags flags = 0);
     Ref<VulkanSemaphore> CreateSemaphoreSignaled();
     Ref<VulkanSemaphore> CreateSemaphoreFromHandle(VkSemaphore semaphoreHandle);
+    Ref<VulkanSemaphore> CreateTimelineSemaphore(uint64_t initialValue = 0);
     Ref<VulkanEvent> CreateEvent();
     void WaitIdle();
 
+    // GPU progress: each submission gets the next serial of the device, which the timeline semaphore of its queue
+    // signals. A serial is complete when all the submissions up to it completed, on every queue; resources used
+    // by the submissions up to GetSubmittedSerial() can be released once it is complete.
+    uint64_t GetSubmittedSerial() const { return m_submittedSerial.load(std::memory_order_acquire); }
+    // Monotonic, queries the queues.
+    uint64_t GetCompletedSerial();
+    bool IsSerialComplete(uint64_t serial);
+    void WaitForSerial(uint64_t serial);
+
+    // Deferred destruction: keep an object the commands recorded so far may use alive until they complete,
+    // instead of waiting for the device to be idle. The objects retired are tagged with the serial passed
+    // to the next TagRetired() call (the frame submission), and released by CollectRetired() once it completes.
+    template<typename T>
+    void Retire(Ref<T> object)
+    {
+        if (object)
+        {
+            std::lock_guard lock(m_retireMutex);
+            m_retiredObjects.push_back({ UINT64_MAX, std::move(object) });
+        }
+    }
+    void TagRetired(uint64_t serial);
+    // Release the objects retired whose serial is complete; return the number of them.
+    size_t CollectRetired();
+
     // RenderPass
     Ref<VulkanRenderPass> CreateRenderPass(const VkRenderPassCreateInfo& createInfo);
     Ref<VulkanFramebuffer> CreateFramebuffer(
@@ -98,6 +132,21 @@ private:
     int m_queueFamilyIndices[VulkanQueueFamilyCount];
     Ref<VulkanQueue> m_queues[VulkanQueueFamilyCount];
     Ref<VulkanCommandPool> m_commandPoolsTransientAlloc[VulkanQueueFamilyCount];
+    Ref<VulkanUploadContext> m_uploadContext;
+
+    friend class VulkanQueue;
+    // Called by the queues, in the order of their submissions.
+    uint64_t AllocateSerial() { return m_submittedSerial.fetch_add(1, std::memory_order_acq_rel) + 1; }
+    std::atomic<uint64_t> m_submittedSerial = 0;
+    std::atomic<uint64_t> m_completedSerial = 0;
+
+    struct RetiredObject
+    {
+        uint64_t serial; // UINT64_MAX until tagged
+        std::any object; // the Ref
+    };
+    std::mutex m_retireMutex;
+    std::deque<RetiredObject> m_retiredObjects; // in serial order
 
     std::vector<std::string> m_enabledExtensionNames;
 
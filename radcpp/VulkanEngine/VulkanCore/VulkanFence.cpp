@@ -26,3 +26,9 @@ void VulkanFence::Reset()
     VK_CHECK(m_device->GetFunctionTable()->
         vkResetFences(m_device->GetHandle(), 1, &m_handle));
 }
+
+bool VulkanFence::IsSignaled() const
+{
+    return (m_device->GetFunctionTable()->
+        vkGetFenceStatus(m_device->GetHandle(), m_handle) == VK_SUCCESS);
+}
@@ -16,6 +16,8 @@ public:
     // in nanoseconds, will be adjusted to the closest value allowed by the implementation dependent timeout accuracy.
     void Wait(uint64_t timeout = UINT64_MAX);
     void Reset();
+    // Query the status without waiting.
+    bool IsSignaled() const;
 
 private:
     Ref<VulkanDevice> m_device;
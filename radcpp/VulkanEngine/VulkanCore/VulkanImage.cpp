@@ -4,11 +4,14 @@
 #include "VulkanQueue.h"
 #include "VulkanCommandBuffer.h"
 #include "VulkanBuffer.h"
+#include "VulkanUploadContext.h"
 
 #include "vk_format_utils.h"
 
 #include "compressonator/compressonator.h"
 
+#include <mutex>
+
 VulkanImage::VulkanImage(Ref<VulkanDevice> device, const VulkanImageCreateInfo& createInfo) :
     m_device(std::move(device))
 {
@@ -72,6 +75,16 @@ Ref<VulkanImageView> VulkanImage::CreateImageView(
     VkFormat                            format,
     const VkImageSubresourceRange&      subresourceRange,
     const VkComponentMapping*           componentMapping)
+{
+    return MakeRefCounted<VulkanImageView>(m_device, this,
+        GetImageViewCreateInfo(type, format, subresourceRange, componentMapping));
+}
+
+VkImageViewCreateInfo VulkanImage::GetImageViewCreateInfo(
+    VkImageViewType                     type,
+    VkFormat                            format,
+    const VkImageSubresourceRange&      subresourceRange,
+    const VkComponentMapping*           componentMapping) const
 {
     VkImageViewCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -92,8 +105,7 @@ Ref<VulkanImageView> VulkanImage::CreateImageView(
         createInfo.components.a = VK_COMPONENT_SWIZZLE_A;
     }
     createInfo.subresourceRange = subresourceRange;
-
-    return MakeRefCounted<VulkanImageView>(m_device, this, createInfo);
+    return createInfo;
 }
 
 Ref<VulkanImageView> VulkanImage::CreateImageView2D(uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer)
@@ -111,6 +123,14 @@ void VulkanImage::CopyFromBuffer(VulkanBuffer* buffer, ArrayRef<VkBufferImageCop
 {
     Ref<VulkanCommandBuffer> commandBuffer = m_device->AllocateCommandBufferOneTimeUse();
     commandBuffer->Begin();
+    CopyFromBuffer(commandBuffer.get(), buffer, copyInfos);
+    commandBuffer->End();
+
+    m_device->GetQueue()->SubmitAndWaitForCompletion({ commandBuffer.get() });
+}
+
+void VulkanImage::CopyFromBuffer(VulkanCommandBuffer* commandBuffer, VulkanBuffer* buffer, ArrayRef<VkBufferImageCopy> copyInfos)
+{
     commandBuffer->TransitLayout(this,
         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
         VK_ACCESS_NONE, VK_ACCESS_TRANSFER_WRITE_BIT,
@@ -120,12 +140,25 @@ void VulkanImage::CopyFromBuffer(VulkanBuffer* buffer, ArrayRef<VkBufferImageCop
         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
         VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_MEMORY_READ_BIT,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void VulkanImage::CopyFromBuffer2D(VulkanBuffer* buffer, VkDeviceSize bufferOffset, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount)
+{
+    Ref<VulkanCommandBuffer> commandBuffer = m_device->AllocateCommandBufferOneTimeUse();
+    commandBuffer->Begin();
+    CopyFromBuffer2D(commandBuffer.get(), buffer, bufferOffset, baseMipLevel, levelCount, baseArrayLayer, layerCount);
     commandBuffer->End();
 
     m_device->GetQueue()->SubmitAndWaitForCompletion({ commandBuffer.get() });
 }
 
-void VulkanImage::CopyFromBuffer2D(VulkanBuffer* buffer, VkDeviceSize bufferOffset, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount)
+void VulkanImage::CopyFromBuffer2D(VulkanCommandBuffer* commandBuffer, VulkanBuffer* buffer, VkDeviceSize bufferOffset, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount)
+{
+    CopyFromBuffer(commandBuffer, buffer,
+        GetCopyRegions2D(bufferOffset, baseMipLevel, levelCount, baseArrayLayer, layerCount));
+}
+
+std::vector<VkBufferImageCopy> VulkanImage::GetCopyRegions2D(VkDeviceSize bufferOffset, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount) const
 {
     std::vector<VkBufferImageCopy> copyInfos(levelCount);
     VkExtent3D blockExtent = FormatTexelBlockExtent(m_format);
@@ -149,7 +182,7 @@ void VulkanImage::CopyFromBuffer2D(VulkanBuffer* buffer, VkDeviceSize bufferOffs
 
         bufferOffset += (copyInfos[mipLevel].bufferRowLength / blockExtent.width) * (copyInfos[mipLevel].bufferImageHeight / blockExtent.height) * blockSize * layerCount;
     }
-    CopyFromBuffer(buffer, copyInfos);
+    return copyInfos;
 }
 
 void VulkanImage::Write2D(VulkanBuffer* buffer, VkDeviceSize bufferOffset, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount)
@@ -200,7 +233,10 @@ Ref<VulkanImageView> VulkanImage::CreateDefaultView()
     wholeRange.baseArrayLayer = 0;
     wholeRange.layerCount = m_arrayLayers;
 
-    return CreateImageView(viewType, m_format, wholeRange);
+    // The view is owned by the image, so it does not reference the image back,
+    // which would keep both alive forever.
+    return MakeRefCounted<VulkanImageView>(m_device, nullptr,
+        GetImageViewCreateInfo(viewType, m_format, wholeRange, nullptr));
 }
 
 VulkanImageView::VulkanImageView(Ref<VulkanDevice> device, Ref<VulkanImage> image, const VkImageViewCreateInfo& createInfo) :
@@ -298,9 +334,42 @@ VkFormat MapCMPFormatToVulkanFormat(CMP_FORMAT srcFormat)
     return VK_FORMAT_UNDEFINED;
 }
 
+size_t VulkanImageData::GetMipOffset(uint32_t mipLevel) const
+{
+    // The same layout as CopyFromBuffer2D.
+    VkExtent3D blockExtent = FormatTexelBlockExtent(format);
+    uint32_t blockSize = FormatElementSize(format);
+    size_t offset = 0;
+    for (uint32_t level = 0; level < mipLevel; level++)
+    {
+        uint32_t mipWidth = std::max<uint32_t>(width >> level, 1);
+        uint32_t mipHeight = std::max<uint32_t>(height >> level, 1);
+        offset += size_t(RoundUpToMultiple(mipWidth, blockExtent.width) / blockExtent.width) *
+            (RoundUpToMultiple(mipHeight, blockExtent.height) / blockExtent.height) * blockSize;
+    }
+    return offset;
+}
+
 Ref<VulkanImage> VulkanImage::CreateImage2DFromFile(VulkanDevice* device, const Path& filePath, bool bGenerateMipmaps)
 {
-    Ref<VulkanImage> image;
+    VulkanImageData imageData;
+    if (!LoadImage2DFromFile(filePath, bGenerateMipmaps, imageData))
+    {
+        return nullptr;
+    }
+
+    Ref<VulkanImage> image = CreateImage2D(device, imageData);
+    VulkanUploadContext* uploadContext = device->GetUploadContext();
+    uploadContext->UploadImage2D(image.get(), imageData.data.data(), imageData.data.size());
+    uploadContext->Flush();
+    return image;
+}
+
+bool VulkanImage::LoadImage2DFromFile(const Path& filePath, bool bGenerateMipmaps, VulkanImageData& imageData)
+{
+    // Register the image plugins once, before the loads on multiple threads.
+    static std::once_flag initFlag;
+    std::call_once(initFlag, []() { CMP_InitFramework(); });
 
     // RAII wrapper for CMP_MipSet
     class MipSet
@@ -332,7 +401,7 @@ Ref<VulkanImage> VulkanImage::CreateImage2DFromFile(VulkanDevice* device, const
     CMP_ERROR status = CMP_LoadTexture(fileName.c_str(), &mipSet);
     if (status != CMP_OK)
     {
-        return nullptr;
+        return false;
     }
 
     if (bGenerateMipmaps && (mipSet->m_nMipLevels <= 1))
@@ -342,41 +411,38 @@ Ref<VulkanImage> VulkanImage::CreateImage2DFromFile(VulkanDevice* device, const
         CMP_GenerateMIPLevels(mipSet, minMipSize);
     }
 
-    VulkanImageCreateInfo createInfo = {};
-    VkFormat format = MapCMPFormatToVulkanFormat(mipSet->m_format);
-    createInfo.SetTexture2DInfo(format,
-        mipSet->m_nWidth, mipSet->m_nHeight);
-    createInfo.m_createInfo.mipLevels = mipSet->m_nMipLevels;
-
-    if (VulkanFormat(format).IsCompressed())
+    imageData.format = MapCMPFormatToVulkanFormat(mipSet->m_format);
+    imageData.width = static_cast<uint32_t>(mipSet->m_nWidth);
+    imageData.height = static_cast<uint32_t>(mipSet->m_nHeight);
+    imageData.mipLevels = static_cast<uint32_t>(mipSet->m_nMipLevels);
+    if (VulkanFormat(imageData.format).IsCompressed())
     {
-        image = device->CreateImage(createInfo);
-        Ref<VulkanBuffer> stagingBuffer = device->CreateStagingBuffer(mipSet->dwDataSize);
-        stagingBuffer->Write(mipSet->pData);
-        image->Write2D(stagingBuffer.get(), 0,
-            0, mipSet->m_nMipLevels, 0, 1);
+        imageData.data.assign(mipSet->pData, mipSet->pData + mipSet->dwDataSize);
     }
     else
     {
-        image = device->CreateImage(createInfo);
-        VkDeviceSize dataSize = 0;
-        for (uint32_t level = 0; level < static_cast<uint32_t>(mipSet->m_nMipLevels); ++level)
+        size_t dataSize = 0;
+        for (uint32_t level = 0; level < imageData.mipLevels; ++level)
         {
             dataSize += mipSet->m_pMipLevelTable[level]->m_dwLinearSize;
         }
-        Ref<VulkanBuffer> stagingBuffer = device->CreateStagingBuffer(dataSize);
-        uint8_t* pStaging = (uint8_t*)stagingBuffer->MapMemory(0, stagingBuffer->GetSize());
-        for (uint32_t level = 0; level < static_cast<uint32_t>(mipSet->m_nMipLevels); ++level)
+        imageData.data.resize(dataSize);
+        uint8_t* pData = imageData.data.data();
+        for (uint32_t level = 0; level < imageData.mipLevels; ++level)
         {
             uint32_t mipDataSize = mipSet->m_pMipLevelTable[level]->m_dwLinearSize;
-            memcpy(pStaging, mipSet->m_pMipLevelTable[level]->m_pbData, mipDataSize);
-            pStaging += mipDataSize;
+            memcpy(pData, mipSet->m_pMipLevelTable[level]->m_pbData, mipDataSize);
+            pData += mipDataSize;
         }
-        stagingBuffer->UnmapMemory();
-
-        image->Write2D(stagingBuffer.get(), 0,
-            0, mipSet->m_nMipLevels, 0, 1);
     }
+    return true;
+}
 
-    return image;
+Ref<VulkanImage> VulkanImage::CreateImage2D(VulkanDevice* device, const VulkanImageData& imageData)
+{
+    VulkanImageCreateInfo createInfo = {};
+    createInfo.SetTexture2DInfo(imageData.format,
+        imageData.width, imageData.height);
+    createInfo.m_createInfo.mipLevels = imageData.mipLevels;
+    return device->CreateImage(createInfo);
 }
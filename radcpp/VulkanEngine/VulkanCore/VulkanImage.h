@@ -5,6 +5,19 @@
 #include "VulkanCommon.h"
 #include "radcpp/Common/File.h"
 
+// CPU side data of a 2D image decoded from a file: the mip levels concatenated, as copied by CopyFromBuffer2D.
+struct VulkanImageData
+{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 0;
+    std::vector<uint8_t> data;
+
+    // The offset of the mip level in data (mipLevel == mipLevels gives the size of the chain).
+    size_t GetMipOffset(uint32_t mipLevel) const;
+};
+
 class VulkanImage : public VulkanObject
 {
 public:
@@ -13,6 +26,10 @@ public:
     ~VulkanImage();
 
     static Ref<VulkanImage> CreateImage2DFromFile(VulkanDevice* device, const Path& filePath, bool bGenerateMipmaps);
+    // Decode the file and generate the mipmaps on the CPU; no device is involved, so files can be loaded in parallel.
+    static bool LoadImage2DFromFile(const Path& filePath, bool bGenerateMipmaps, VulkanImageData& imageData);
+    // Create an image of the format and size of the data, without uploading it.
+    static Ref<VulkanImage> CreateImage2D(VulkanDevice* device, const VulkanImageData& imageData);
 
     VkImage GetHandle() const { return m_handle; }
     VkImageType GetType() const { return m_type; }
@@ -47,12 +64,28 @@ public:
         VulkanBuffer* buffer, VkDeviceSize bufferOffset,
         uint32_t baseMipLevel, uint32_t levelCount,
         uint32_t baseArrayLayer, uint32_t layerCount);
+    // Record the copies (with the layout transitions to shader read) into commandBuffer instead of submitting them,
+    // to batch the uploads of many images.
+    void CopyFromBuffer(VulkanCommandBuffer* commandBuffer, VulkanBuffer* buffer, ArrayRef<VkBufferImageCopy> copyInfos);
+    void CopyFromBuffer2D(VulkanCommandBuffer* commandBuffer,
+        VulkanBuffer* buffer, VkDeviceSize bufferOffset,
+        uint32_t baseMipLevel, uint32_t levelCount,
+        uint32_t baseArrayLayer, uint32_t layerCount);
+    // The regions copied by CopyFromBuffer2D: the levels concatenated from bufferOffset.
+    std::vector<VkBufferImageCopy> GetCopyRegions2D(VkDeviceSize bufferOffset,
+        uint32_t baseMipLevel, uint32_t levelCount,
+        uint32_t baseArrayLayer, uint32_t layerCount) const;
     void Write2D(
         VulkanBuffer* buffer, VkDeviceSize bufferOffset,
         uint32_t baseMipLevel, uint32_t levelCount,
         uint32_t baseArrayLayer, uint32_t layerCount);
 
 private:
+    VkImageViewCreateInfo GetImageViewCreateInfo(
+        VkImageViewType                     type,
+        VkFormat                            format,
+        const VkImageSubresourceRange&      subresourceRange,
+        const VkComponentMapping*           componentMapping) const;
     Ref<VulkanImageView> CreateDefaultView();
 
     Ref<VulkanDevice>           m_device;
@@ -87,7 +120,7 @@ public:
 
 private:
     Ref<VulkanDevice>       m_device;
-    Ref<VulkanImage>        m_image;
+    Ref<VulkanImage>        m_image; // null for the default view, owned by the image
     VkImageView             m_handle = VK_NULL_HANDLE;
 
 }; // class VulkanImageView
@@ -13,6 +13,7 @@ VulkanQueue::VulkanQueue(Ref<VulkanDevice> device, VulkanQueueFamily queueFamily
 {
     m_device->GetFunctionTable()->
         vkGetDeviceQueue(m_device->GetHandle(), m_device->GetQueueFamilyIndex(queueFamily), 0, &m_handle);
+    m_timeline = m_device->CreateTimelineSemaphore();
 }
 
 VulkanQueue::~VulkanQueue()
@@ -26,11 +27,13 @@ const VkQueueFamilyProperties& VulkanQueue::GetQueueFamilyProperties() const
     return m_device->GetPhysicalDevice()->GetQueueFamilyProperties()[queueFamilyIndex];
 }
 
-void VulkanQueue::Submit(
+uint64_t VulkanQueue::Submit(
     ArrayRef<VulkanCommandBuffer*>      commandBuffers,
     ArrayRef<VulkanSubmitWait>          waitSemaphores,
     ArrayRef<VulkanSemaphore*>          signalSemaphores,
-    VulkanFence*                        fence)
+    VulkanFence*                        fence,
+    ArrayRef<VulkanTimelineWait>        waitTimelines,
+    ArrayRef<VulkanTimelineSignal>      signalTimelines)
 {
     SmallVector<VkCommandBuffer, 8> commandBuffersHandles(commandBuffers.size());
     for (int i = 0; i < commandBuffers.size(); i++)
@@ -38,23 +41,48 @@ void VulkanQueue::Submit(
         commandBuffersHandles[i] = commandBuffers[i]->GetHandle();
     }
 
+    // The values of the binary semaphores are ignored.
     SmallVector<VkSemaphore, 8> waitSemaphoresHandles(waitSemaphores.size());
     SmallVector<VkPipelineStageFlags, 8> waitDstStageMasks(waitSemaphores.size());
+    SmallVector<uint64_t, 8> waitValues(waitSemaphores.size(), 0);
     for (int i = 0; i < waitSemaphores.size(); i++)
     {
         waitSemaphoresHandles[i] = waitSemaphores[i].first->GetHandle();
         waitDstStageMasks[i] = waitSemaphores[i].second;
     }
+    for (const VulkanTimelineWait& wait : waitTimelines)
+    {
+        waitSemaphoresHandles.PushBack(wait.semaphore->GetHandle());
+        waitDstStageMasks.PushBack(wait.stageMask);
+        waitValues.PushBack(wait.value);
+    }
 
     SmallVector<VkSemaphore, 8> signalSemaphoresHandles(signalSemaphores.size());
+    SmallVector<uint64_t, 8> signalValues(signalSemaphores.size(), 0);
     for (int i = 0; i < signalSemaphores.size(); i++)
     {
         signalSemaphoresHandles[i] = signalSemaphores[i]->GetHandle();
     }
+    for (const VulkanTimelineSignal& signal : signalTimelines)
+    {
+        signalSemaphoresHandles.PushBack(signal.semaphore->GetHandle());
+        signalValues.PushBack(signal.value);
+    }
+    // The timeline of the queue, signaled with the serial allocated below.
+    signalSemaphoresHandles.PushBack(m_timeline->GetHandle());
+    signalValues.PushBack(0);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.pNext = nullptr;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.pNext = nullptr;
+    submitInfo.pNext = &timelineInfo;
     submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphoresHandles.size());
     submitInfo.pWaitSemaphores = waitSemaphoresHandles.data();
     submitInfo.pWaitDstStageMask = waitDstStageMasks.data();
@@ -63,8 +91,18 @@ void VulkanQueue::Submit(
     submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphoresHandles.size());
     submitInfo.pSignalSemaphores = signalSemaphoresHandles.data();
 
+    // Serials are allocated in the submission order of the queue, so that its timeline increases.
+    std::lock_guard lock(m_mutex);
+    const uint64_t serial = m_device->AllocateSerial();
+    signalValues[signalValues.size() - 1] = serial;
     VK_CHECK(m_device->GetFunctionTable()->
         vkQueueSubmit(m_handle, 1, &submitInfo, fence ? fence->GetHandle() : VK_NULL_HANDLE));
+    if (m_pendingSerials.size() >= 64)
+    {
+        PollLocked();
+    }
+    m_pendingSerials.push_back(serial);
+    return serial;
 }
 
 void VulkanQueue::SubmitAndWaitForCompletion(
@@ -72,17 +110,62 @@ void VulkanQueue::SubmitAndWaitForCompletion(
     ArrayRef<VulkanSubmitWait>          waitSemaphores,
     ArrayRef<VulkanSemaphore*>          signalSemaphores)
 {
-    Ref<VulkanFence> fence = m_device->CreateFence();
-    Submit(commandBuffers, waitSemaphores, signalSemaphores, fence.get());
-    fence->Wait();
+    const uint64_t serial = Submit(commandBuffers, waitSemaphores, signalSemaphores, nullptr);
+    m_timeline->Wait(serial);
 }
 
 void VulkanQueue::WaitIdle()
 {
+    std::lock_guard lock(m_mutex);
     VK_CHECK(m_device->GetFunctionTable()->
         vkQueueWaitIdle(m_handle));
 }
 
+bool VulkanQueue::IsSerialComplete(uint64_t serial) const
+{
+    return (m_timeline->GetCounterValue() >= serial);
+}
+
+void VulkanQueue::WaitForSerial(uint64_t serial)
+{
+    // The timeline only takes the serials of this queue: wait for the last one up to the serial.
+    uint64_t value = 0;
+    {
+        std::lock_guard lock(m_mutex);
+        for (uint64_t pendingSerial : m_pendingSerials)
+        {
+            if (pendingSerial > serial)
+            {
+                break;
+            }
+            value = pendingSerial;
+        }
+    }
+    if (value > 0)
+    {
+        m_timeline->Wait(value);
+    }
+}
+
+uint64_t VulkanQueue::GetCompletedSerialBound()
+{
+    std::lock_guard lock(m_mutex);
+    PollLocked();
+    return m_pendingSerials.empty() ? UINT64_MAX : (m_pendingSerials.front() - 1);
+}
+
+void VulkanQueue::PollLocked()
+{
+    if (!m_pendingSerials.empty())
+    {
+        const uint64_t counterValue = m_timeline->GetCounterValue();
+        while (!m_pendingSerials.empty() && (m_pendingSerials.front() <= counterValue))
+        {
+            m_pendingSerials.pop_front();
+        }
+    }
+}
+
 bool VulkanQueue::Present(
     ArrayRef<VulkanSemaphore*> waitSemaphores,
     ArrayRef<VulkanSwapchain*> swapchains,
@@ -113,6 +196,7 @@ bool VulkanQueue::Present(
     presentInfo.pImageIndices = imageIndices.data();
     presentInfo.pResults = results.data();
 
+    std::lock_guard lock(m_mutex);
     VK_CHECK(m_device->GetFunctionTable()->
         vkQueuePresentKHR(m_handle, &presentInfo));
 
@@ -3,9 +3,28 @@
 #pragma once
 
 #include "VulkanCommon.h"
+#include <deque>
+#include <mutex>
 
 using VulkanSubmitWait = std::pair<VulkanSemaphore*, VkPipelineStageFlags>;
 
+// A value of a timeline semaphore to wait for (before the stages), or to signal.
+struct VulkanTimelineWait
+{
+    VulkanSemaphore* semaphore;
+    uint64_t value;
+    VkPipelineStageFlags stageMask;
+};
+
+struct VulkanTimelineSignal
+{
+    VulkanSemaphore* semaphore;
+    uint64_t value;
+};
+
+// Submissions are serialized: the queue may be shared by the families falling back to the universal one,
+// and submitted to from any thread. Each submission gets the next serial of the device (see
+// VulkanDevice::GetCompletedSerial), signaled by the timeline semaphore of the queue when it completes.
 class VulkanQueue : public VulkanObject
 {
 public:
@@ -17,14 +36,17 @@ public:
     VulkanQueueFamily GetQueueFamily() const { return m_queueFamily; }
     const VkQueueFamilyProperties& GetQueueFamilyProperties() const;
 
-    void Submit(
+    // Return the serial of the submission. The fence is optional, the serial can be waited for instead.
+    uint64_t Submit(
         ArrayRef<VulkanCommandBuffer*>  commandBuffers,
         ArrayRef<VulkanSubmitWait>      waitSemaphores,
         ArrayRef<VulkanSemaphore*>      signalSemaphores,
-        VulkanFence*                    fence
+        VulkanFence*                    fence,
+        ArrayRef<VulkanTimelineWait>    waitTimelines = {},
+        ArrayRef<VulkanTimelineSignal>  signalTimelines = {}
     );
 
-    // Create a fence implicitly; wait GPU to complete the commands and notify the host.
+    // Wait GPU to complete the commands and notify the host (through the timeline of the queue, no fence is created).
     void SubmitAndWaitForCompletion(
         ArrayRef<VulkanCommandBuffer*>  commandBuffers,
         ArrayRef<VulkanSubmitWait>      waitSemaphores = {},
@@ -33,6 +55,15 @@ public:
 
     void WaitIdle();
 
+    // Signaled with the serials of the submissions, to wait for them on another queue.
+    VulkanSemaphore* GetTimeline() const { return m_timeline.get(); }
+    // The serial must be of a submission to this queue.
+    bool IsSerialComplete(uint64_t serial) const;
+    // Wait for the submissions to this queue up to the serial (of any queue).
+    void WaitForSerial(uint64_t serial);
+    // The serials below the oldest submission not complete, UINT64_MAX if none.
+    uint64_t GetCompletedSerialBound();
+
     bool Present(
         ArrayRef<VulkanSemaphore*>      waitSemaphores,
         ArrayRef<VulkanSwapchain*>      swapchains,
@@ -42,9 +73,15 @@ public:
         ArrayRef<VulkanSwapchain*>      swapchains);
 
 private:
+    // Pop the serials completed.
+    void PollLocked();
+
     Ref<VulkanDevice>           m_device;
     VkQueue                     m_handle = VK_NULL_HANDLE;
     VulkanQueueFamily           m_queueFamily;
+    std::mutex                  m_mutex;
+    Ref<VulkanSemaphore>        m_timeline;
+    std::deque<uint64_t>        m_pendingSerials;
 
 }; // class VulkanQueue
 
@@ -7,6 +7,11 @@ VulkanSemaphore::VulkanSemaphore(Ref<VulkanDevice> device, const VkSemaphoreCrea
     VK_CHECK(m_device->GetFunctionTable()->
         vkCreateSemaphore(m_device->GetHandle(), &createInfo, nullptr, &m_handle));
     m_isManaged = true;
+    const VkSemaphoreTypeCreateInfo* typeCreateInfo = static_cast<const VkSemaphoreTypeCreateInfo*>(createInfo.pNext);
+    if (typeCreateInfo && (typeCreateInfo->sType == VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO))
+    {
+        m_isTimeline = (typeCreateInfo->semaphoreType == VK_SEMAPHORE_TYPE_TIMELINE);
+    }
 }
 
 VulkanSemaphore::VulkanSemaphore(Ref<VulkanDevice> device, VkSemaphore handle) :
@@ -25,3 +30,40 @@ VulkanSemaphore::~VulkanSemaphore()
     }
     m_handle = VK_NULL_HANDLE;
 }
+
+uint64_t VulkanSemaphore::GetCounterValue() const
+{
+    assert(m_isTimeline);
+    uint64_t value = 0;
+    VK_CHECK(m_device->GetFunctionTable()->
+        vkGetSemaphoreCounterValue(m_device->GetHandle(), m_handle, &value));
+    return value;
+}
+
+bool VulkanSemaphore::Wait(uint64_t value, uint64_t timeout)
+{
+    assert(m_isTimeline);
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.pNext = nullptr;
+    waitInfo.flags = 0;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_handle;
+    waitInfo.pValues = &value;
+    const VkResult result = m_device->GetFunctionTable()->
+        vkWaitSemaphores(m_device->GetHandle(), &waitInfo, timeout);
+    VK_CHECK(result);
+    return (result == VK_SUCCESS);
+}
+
+void VulkanSemaphore::Signal(uint64_t value)
+{
+    assert(m_isTimeline);
+    VkSemaphoreSignalInfo signalInfo = {};
+    signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    signalInfo.pNext = nullptr;
+    signalInfo.semaphore = m_handle;
+    signalInfo.value = value;
+    VK_CHECK(m_device->GetFunctionTable()->
+        vkSignalSemaphore(m_device->GetHandle(), &signalInfo));
+}
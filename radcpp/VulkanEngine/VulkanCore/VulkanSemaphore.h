@@ -14,10 +14,18 @@ public:
 
     VkSemaphore GetHandle() const { return m_handle; }
 
+    // Timeline semaphores only (VK_SEMAPHORE_TYPE_TIMELINE): the payload is a monotonic 64-bit value.
+    bool IsTimeline() const { return m_isTimeline; }
+    uint64_t GetCounterValue() const;
+    // Wait on the host until the value is reached; return false on timeout (in nanoseconds).
+    bool Wait(uint64_t value, uint64_t timeout = UINT64_MAX);
+    void Signal(uint64_t value);
+
 private:
     Ref<VulkanDevice> m_device;
     VkSemaphore m_handle = VK_NULL_HANDLE;
     bool m_isManaged = true;
+    bool m_isTimeline = false;
 
 }; // class VulkanSemaphore
 
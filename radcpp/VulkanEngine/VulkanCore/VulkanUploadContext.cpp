@@ -0,0 +1,343 @@
+#include "VulkanUploadContext.h"
+#include "VulkanDevice.h"
+#include "VulkanQueue.h"
+#include "VulkanCommandPool.h"
+#include "VulkanCommandBuffer.h"
+#include "VulkanBuffer.h"
+#include "VulkanImage.h"
+
+// Host coherent (VMA_MEMORY_USAGE_CPU_ONLY) and mapped for its lifetime.
+static Ref<VulkanBuffer> CreateMappedStagingBuffer(VulkanDevice* device, VkDeviceSize size)
+{
+    VulkanBufferCreateInfo createInfo;
+    createInfo.SetStagingBufferInfo(size);
+    createInfo.m_allocationCreateInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    return device->CreateBuffer(createInfo);
+}
+
+VulkanUploadContext::VulkanUploadContext(Ref<VulkanDevice> device, VkDeviceSize ringSize, VkDeviceSize batchSize) :
+    m_device(std::move(device)),
+    m_ringSize(ringSize),
+    m_batchSize(batchSize)
+{
+    m_useTransferQueue = m_device->HasDedicatedQueue(VulkanQueueFamilyTransfer);
+    if (m_useTransferQueue)
+    {
+        m_commandPool = m_device->CreateCommandPool(VulkanQueueFamilyTransfer, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        m_acquireCommandPool = m_device->CreateCommandPool(VulkanQueueFamilyUniversal, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    }
+    else
+    {
+        m_commandPool = m_device->CreateCommandPool(VulkanQueueFamilyUniversal, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    }
+}
+
+VulkanUploadContext::~VulkanUploadContext()
+{
+    WaitIdle();
+}
+
+VulkanUploadToken VulkanUploadContext::UploadBuffer(VulkanBuffer* buffer, VkDeviceSize offset,
+    const void* data, VkDeviceSize size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    assert(offset + size <= buffer->GetSize());
+
+    std::lock_guard lock(m_mutex);
+    VkDeviceSize stagingOffset = 0;
+    uint8_t* pStaging = nullptr;
+    VulkanBuffer* stagingBuffer = AllocateStaging(size, stagingOffset, pStaging);
+    memcpy(pStaging, data, size);
+
+    VkBufferCopy copyRegion = {};
+    copyRegion.srcOffset = stagingOffset;
+    copyRegion.dstOffset = offset;
+    copyRegion.size = size;
+    m_recording.commandBuffer->CopyBuffer(stagingBuffer, buffer, { &copyRegion, 1 });
+    if (m_useTransferQueue)
+    {
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcQueueFamilyIndex = m_device->GetQueueFamilyIndex(VulkanQueueFamilyTransfer);
+        barrier.dstQueueFamilyIndex = m_device->GetQueueFamilyIndex(VulkanQueueFamilyUniversal);
+        barrier.buffer = buffer->GetHandle();
+        barrier.offset = offset;
+        barrier.size = size;
+        m_recording.bufferBarriers.push_back(barrier);
+    }
+    m_recording.resources.push_back(buffer);
+    const VulkanUploadToken token = m_recording.token;
+    EndUploadLocked(size);
+    return token;
+}
+
+VulkanUploadToken VulkanUploadContext::UploadImage2D(VulkanImage* image, const void* data, VkDeviceSize size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    std::lock_guard lock(m_mutex);
+    VkDeviceSize stagingOffset = 0;
+    uint8_t* pStaging = nullptr;
+    VulkanBuffer* stagingBuffer = AllocateStaging(size, stagingOffset, pStaging);
+    memcpy(pStaging, data, size);
+
+    if (m_useTransferQueue)
+    {
+        // The transfer queue does not support the shader stages: the transition to shader read
+        // is done by the ownership transfer.
+        m_recording.commandBuffer->TransitLayout(image,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_NONE, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        m_recording.commandBuffer->CopyBufferToImage(stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            image->GetCopyRegions2D(stagingOffset, 0, image->GetMipLevels(), 0, 1));
+
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = m_device->GetQueueFamilyIndex(VulkanQueueFamilyTransfer);
+        barrier.dstQueueFamilyIndex = m_device->GetQueueFamilyIndex(VulkanQueueFamilyUniversal);
+        barrier.image = image->GetHandle();
+        barrier.subresourceRange.aspectMask = VulkanFormat(image->GetFormat()).GetAspectFlags();
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = image->GetMipLevels();
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        m_recording.imageBarriers.push_back(barrier);
+    }
+    else
+    {
+        image->CopyFromBuffer2D(m_recording.commandBuffer.get(), stagingBuffer, stagingOffset,
+            0, image->GetMipLevels(), 0, 1);
+    }
+    m_recording.resources.push_back(image);
+    const VulkanUploadToken token = m_recording.token;
+    EndUploadLocked(size);
+    return token;
+}
+
+VulkanBuffer* VulkanUploadContext::AllocateStaging(VkDeviceSize size, VkDeviceSize& offset, uint8_t*& pMapped)
+{
+    if (size > m_ringSize)
+    {
+        Ref<VulkanBuffer> stagingBuffer = CreateMappedStagingBuffer(m_device.get(), size);
+        offset = 0;
+        pMapped = static_cast<uint8_t*>(stagingBuffer->GetPersistentMappedAddr());
+        GetRecordingBatch().resources.push_back(stagingBuffer);
+        m_stats.dedicatedCount++;
+        return stagingBuffer.get();
+    }
+
+    if (!m_ringBuffer)
+    {
+        m_ringBuffer = CreateMappedStagingBuffer(m_device.get(), m_ringSize);
+        m_pRing = static_cast<uint8_t*>(m_ringBuffer->GetPersistentMappedAddr());
+    }
+    while (true)
+    {
+        // Offsets aligned for any texel block size; the data does not wrap around the end of the ring.
+        uint64_t position = RoundUpToMultiple<uint64_t>(m_ringHead, 16);
+        const uint64_t ringOffset = position % m_ringSize;
+        if (ringOffset + size > m_ringSize)
+        {
+            position += m_ringSize - ringOffset;
+        }
+        if (position + size - m_ringTail <= m_ringSize)
+        {
+            Batch& batch = GetRecordingBatch();
+            m_ringHead = position + size;
+            batch.ringEnd = m_ringHead;
+            offset = position % m_ringSize;
+            pMapped = m_pRing + offset;
+            return m_ringBuffer.get();
+        }
+
+        // Full: submit the batch recorded, then wait for the oldest batch to release its space.
+        if (m_recording.commandBuffer)
+        {
+            SubmitLocked();
+        }
+        else if (!m_pendingBatches.empty())
+        {
+            if (PollLocked() == 0)
+            {
+                m_stats.stallCount++;
+                WaitForFrontLocked();
+            }
+        }
+        else
+        {
+            // Nothing in use, start over from the beginning.
+            m_ringHead = 0;
+            m_ringTail = 0;
+        }
+    }
+}
+
+VulkanUploadContext::Batch& VulkanUploadContext::GetRecordingBatch()
+{
+    if (!m_recording.commandBuffer)
+    {
+        m_recording.token = m_nextToken++;
+        m_recording.commandBuffer = m_commandPool->Allocate();
+        m_recording.commandBuffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        m_recording.ringEnd = m_ringHead;
+        if (m_useTransferQueue)
+        {
+            m_recording.acquireCommandBuffer = m_acquireCommandPool->Allocate();
+            m_recording.acquireCommandBuffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        }
+    }
+    return m_recording;
+}
+
+void VulkanUploadContext::EndUploadLocked(VkDeviceSize size)
+{
+    m_recording.size += size;
+    m_stats.uploadCount++;
+    m_stats.uploadedSize += size;
+    if (m_recording.size >= m_batchSize)
+    {
+        SubmitLocked();
+    }
+}
+
+void VulkanUploadContext::SubmitLocked()
+{
+    if (m_useTransferQueue)
+    {
+        // The release and the acquire have the same barriers; the access masks out of their queue are ignored.
+        for (VkBufferMemoryBarrier& barrier : m_recording.bufferBarriers)
+        {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_NONE;
+        }
+        for (VkImageMemoryBarrier& barrier : m_recording.imageBarriers)
+        {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_NONE;
+        }
+        m_recording.commandBuffer->SetPipelineBarrier(
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            {}, m_recording.bufferBarriers, m_recording.imageBarriers);
+        for (VkBufferMemoryBarrier& barrier : m_recording.bufferBarriers)
+        {
+            barrier.srcAccessMask = VK_ACCESS_NONE;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        }
+        for (VkImageMemoryBarrier& barrier : m_recording.imageBarriers)
+        {
+            barrier.srcAccessMask = VK_ACCESS_NONE;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_MEMORY_READ_BIT;
+        }
+        m_recording.acquireCommandBuffer->SetPipelineBarrier(
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+            {}, m_recording.bufferBarriers, m_recording.imageBarriers);
+        m_recording.acquireCommandBuffer->End();
+        m_recording.bufferBarriers.clear();
+        m_recording.imageBarriers.clear();
+    }
+    else
+    {
+        // Make the copies visible to any later command of the queue.
+        m_recording.commandBuffer->SetMemoryBarrier(
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+    }
+    m_recording.commandBuffer->End();
+
+    if (m_useTransferQueue)
+    {
+        // The acquire waits for the copies on the timeline of the transfer queue, so its serial covers them.
+        VulkanQueue* transferQueue = m_device->GetQueue(VulkanQueueFamilyTransfer);
+        const uint64_t transferSerial = transferQueue->Submit({ m_recording.commandBuffer.get() }, {}, {}, nullptr);
+        m_recording.serial = m_device->GetQueue(VulkanQueueFamilyUniversal)->Submit(
+            { m_recording.acquireCommandBuffer.get() }, {}, {}, nullptr,
+            { VulkanTimelineWait{ transferQueue->GetTimeline(), transferSerial, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT } });
+    }
+    else
+    {
+        m_recording.serial = m_device->GetQueue()->Submit({ m_recording.commandBuffer.get() }, {}, {}, nullptr);
+    }
+    m_pendingBatches.push_back(std::move(m_recording));
+    m_recording = Batch();
+    m_stats.submitCount++;
+}
+
+size_t VulkanUploadContext::PollLocked()
+{
+    size_t completedCount = 0;
+    VulkanQueue* queue = m_device->GetQueue();
+    while (!m_pendingBatches.empty() && queue->IsSerialComplete(m_pendingBatches.front().serial))
+    {
+        Batch& batch = m_pendingBatches.front();
+        m_ringTail = batch.ringEnd;
+        m_completedToken = batch.token;
+        m_pendingBatches.pop_front();
+        ++completedCount;
+    }
+    return completedCount;
+}
+
+void VulkanUploadContext::WaitForFrontLocked()
+{
+    m_device->GetQueue()->WaitForSerial(m_pendingBatches.front().serial);
+    PollLocked();
+}
+
+VulkanUploadToken VulkanUploadContext::Flush()
+{
+    std::lock_guard lock(m_mutex);
+    if (m_recording.commandBuffer)
+    {
+        SubmitLocked();
+    }
+    PollLocked();
+    return m_nextToken - 1;
+}
+
+bool VulkanUploadContext::IsComplete(VulkanUploadToken token)
+{
+    std::lock_guard lock(m_mutex);
+    if (token <= m_completedToken)
+    {
+        return true;
+    }
+    PollLocked();
+    return (token <= m_completedToken);
+}
+
+void VulkanUploadContext::Wait(VulkanUploadToken token)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_recording.commandBuffer && (token >= m_recording.token))
+    {
+        SubmitLocked();
+    }
+    while ((m_completedToken < token) && !m_pendingBatches.empty())
+    {
+        WaitForFrontLocked();
+    }
+}
+
+void VulkanUploadContext::WaitIdle()
+{
+    Wait(UINT64_MAX);
+}
+
+VulkanUploadContext::Stats VulkanUploadContext::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    Stats stats = m_stats;
+    stats.pendingBatchCount = m_pendingBatches.size();
+    return stats;
+}
@@ -0,0 +1,102 @@
+#ifndef VULKAN_UPLOAD_CONTEXT_H
+#define VULKAN_UPLOAD_CONTEXT_H
+#pragma once
+
+#include "VulkanCommon.h"
+#include <deque>
+#include <mutex>
+
+// Identifies the batch an upload is recorded to; batches complete in order, 0 is always complete.
+using VulkanUploadToken = uint64_t;
+
+// Upload data to device local buffers and images through a persistently mapped staging ring:
+// the data is copied to the ring on the call, and the copies are recorded to a batch submitted (without waiting)
+// when it reaches the batch size, or on Flush() - once a frame by the renderer. The ring space of a batch is
+// reused when its serial (of the universal queue) completes. Flushed uploads are visible to the later submissions to the universal queue
+// (a barrier ends each batch); wait for the token only to access the data from the host, or from another queue.
+// With a dedicated transfer queue, the copies run on it and the destinations are released to the universal family;
+// each batch is followed by a submission to the universal queue acquiring them, after the timeline of the transfer queue.
+// Thread safe.
+class VulkanUploadContext : public VulkanObject
+{
+public:
+    static constexpr VkDeviceSize DefaultRingSize = 64ull * 1024 * 1024;
+    static constexpr VkDeviceSize DefaultBatchSize = 16ull * 1024 * 1024;
+
+    struct Stats
+    {
+        uint64_t submitCount;
+        uint64_t uploadCount;
+        VkDeviceSize uploadedSize;
+        uint64_t stallCount; // waits for the ring space of a previous batch
+        uint64_t dedicatedCount; // uploads larger than the ring, staged in buffers of their own
+        size_t pendingBatchCount; // submitted, not complete
+    };
+
+    VulkanUploadContext(Ref<VulkanDevice> device,
+        VkDeviceSize ringSize = DefaultRingSize, VkDeviceSize batchSize = DefaultBatchSize);
+    ~VulkanUploadContext();
+
+    // The destinations are referenced until the copies complete; data can be released on return.
+    VulkanUploadToken UploadBuffer(VulkanBuffer* buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+    // Upload all the mip levels of the first layer, concatenated as copied by VulkanImage::CopyFromBuffer2D;
+    // the image is left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+    VulkanUploadToken UploadImage2D(VulkanImage* image, const void* data, VkDeviceSize size);
+
+    // Submit the batch recorded, if any; return the token of the last batch.
+    VulkanUploadToken Flush();
+    // Query without waiting.
+    bool IsComplete(VulkanUploadToken token);
+    // Flush the batch of the token if not submitted yet, and wait for it.
+    void Wait(VulkanUploadToken token);
+    void WaitIdle();
+
+    Stats GetStats() const;
+
+private:
+    struct Batch
+    {
+        VulkanUploadToken token = 0;
+        Ref<VulkanCommandBuffer> commandBuffer;
+        // With a dedicated transfer queue: the ownership transfers of the destinations to the universal family,
+        // released by commandBuffer and acquired by acquireCommandBuffer after the copies.
+        Ref<VulkanCommandBuffer> acquireCommandBuffer;
+        uint64_t serial = 0; // of the last submission to the universal queue
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        uint64_t ringEnd = 0; // the ring position after the data of the batch
+        VkDeviceSize size = 0;
+        std::vector<Ref<VulkanObject>> resources; // the destinations, and the dedicated staging buffers
+    };
+
+    // Return the staging buffer and the offset to copy size bytes to, in the recording batch.
+    VulkanBuffer* AllocateStaging(VkDeviceSize size, VkDeviceSize& offset, uint8_t*& pMapped);
+    Batch& GetRecordingBatch();
+    void SubmitLocked();
+    // Release the ring space of the batches completed, and return the number of them.
+    size_t PollLocked();
+    void WaitForFrontLocked();
+    void EndUploadLocked(VkDeviceSize size);
+
+    Ref<VulkanDevice> m_device;
+    bool m_useTransferQueue = false;
+    Ref<VulkanCommandPool> m_commandPool; // of the transfer family if used
+    Ref<VulkanCommandPool> m_acquireCommandPool;
+    VkDeviceSize m_ringSize;
+    VkDeviceSize m_batchSize;
+    Ref<VulkanBuffer> m_ringBuffer; // created on the first upload
+    uint8_t* m_pRing = nullptr;
+    // Monotonic positions; the ring offset is position % m_ringSize.
+    uint64_t m_ringHead = 0;
+    uint64_t m_ringTail = 0;
+
+    mutable std::mutex m_mutex;
+    Batch m_recording;
+    std::deque<Batch> m_pendingBatches;
+    VulkanUploadToken m_nextToken = 1;
+    VulkanUploadToken m_completedToken = 0;
+    Stats m_stats = {};
+
+}; // class VulkanUploadContext
+
+#endif // VULKAN_UPLOAD_CONTEXT_H
@@ -66,7 +66,6 @@ bool VulkanWindow::Init(Ref<VulkanDevice> device)
     {
         m_swapchainImageAcquired[i] = m_device->CreateSemaphore();
         m_drawComplete[i] = m_device->CreateSemaphore();
-        m_frameThrottles[i] = m_device->CreateFence(VK_FENCE_CREATE_SIGNALED_BIT);
     }
 
     return true;
@@ -79,8 +78,8 @@ void VulkanWindow::GetDrawableSize(int* w, int* h)
 
 VulkanCommandBuffer* VulkanWindow::BeginFrame()
 {
-    m_frameThrottles[m_frameIndex]->Wait();
-    m_frameThrottles[m_frameIndex]->Reset();
+    m_device->GetQueue()->WaitForSerial(m_frameSerials[m_frameIndex]);
+    m_device->CollectRetired();
     m_swapchainImageIndex = m_swapchain->AcquireNextImage(m_swapchainImageAcquired[m_frameIndex].get());
 
     return m_commandBuffers[m_swapchainImageIndex].get();
@@ -88,7 +87,9 @@ VulkanCommandBuffer* VulkanWindow::BeginFrame()
 
 void VulkanWindow::EndFrame()
 {
-    m_device->GetQueue()->Submit(
+    // The uploads recorded during the frame go first, the frame may use them.
+    m_device->GetUploadContext()->Flush();
+    m_frameSerials[m_frameIndex] = m_device->GetQueue()->Submit(
         std::array{
             m_commandBuffers[m_swapchainImageIndex].get()
         },
@@ -98,8 +99,10 @@ void VulkanWindow::EndFrame()
         std::array{ // signal
             m_drawComplete[m_frameIndex].get()
         },
-        m_frameThrottles[m_frameIndex].get()
+        nullptr
     );
+    // The objects retired while recording the frame may be used by it.
+    m_device->TagRetired(m_frameSerials[m_frameIndex]);
     m_device->GetQueue()->Present(
         std::array{ // wait
             m_drawComplete[m_frameIndex].get()
@@ -123,7 +126,14 @@ VulkanCommandBuffer* VulkanWindow::GetCommandBuffer()
 
 void VulkanWindow::OnResized(int width, int height)
 {
-    m_device->WaitIdle();
+    // The frames in flight may still use the resources of the previous size, released after them.
+    m_device->Retire(m_swapchain);
+    m_device->Retire(m_depthStencil);
+    m_device->Retire(m_defaultRenderPass);
+    for (const Ref<VulkanFramebuffer>& framebuffer : m_defaultFramebuffers)
+    {
+        m_device->Retire(framebuffer);
+    }
 
     int drawableWidth = 0;
     int drawableHeight = 0;
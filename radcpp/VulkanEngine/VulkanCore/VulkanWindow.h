@@ -18,8 +18,13 @@ public:
 
     void GetDrawableSize(int* w, int* h);
 
+    // max frame count in flight
+    static constexpr uint32_t FrameLag = 2;
     VulkanCommandBuffer* BeginFrame();
     void EndFrame();
+    // The frame-lag slot of the current frame, in [0, FrameLag): BeginFrame() waits for the last submission
+    // of the slot, so the per-frame resources indexed by it can be reused after.
+    uint32_t GetFrameIndex() const { return m_frameIndex; }
 
     // Get the default command buffer corresponding to current swapchainImage
     VulkanCommandBuffer* GetCommandBuffer();
@@ -60,13 +65,11 @@ protected:
     Ref<VulkanRenderPass> m_defaultRenderPass;
     std::vector<Ref<VulkanFramebuffer>> m_defaultFramebuffers;
 
-    // max frame count in flight
-    static constexpr uint32_t FrameLag = 2;
     Ref<VulkanSemaphore> m_swapchainImageAcquired[FrameLag];
     Ref<VulkanSemaphore> m_drawComplete[FrameLag];
     Ref<VulkanSemaphore> m_swapchainImageOwnershipTransferComplete[FrameLag];
-    // Fences that we can use to throttle if we get too far ahead of image presents.
-    Ref<VulkanFence> m_frameThrottles[FrameLag];
+    // Serials of the frame submissions, to throttle if we get too far ahead of image presents.
+    uint64_t m_frameSerials[FrameLag] = {};
     uint32_t m_frameIndex = 0;
 
 }; // class VulkanWindow
@@ -0,0 +1,176 @@
+#include "VulkanGeometryArena.h"
+
+VulkanGeometryAllocation::VulkanGeometryAllocation(Ref<VulkanGeometryArena> arena, uint32_t pageIndex,
+    VulkanBuffer* buffer, VkDeviceSize offset, VkDeviceSize size, VkDeviceSize alignment) :
+    m_arena(std::move(arena)),
+    m_pageIndex(pageIndex),
+    m_buffer(buffer),
+    m_offset(offset),
+    m_size(size),
+    m_alignment(alignment)
+{
+}
+
+VulkanGeometryAllocation::~VulkanGeometryAllocation()
+{
+    m_arena->Free(this);
+}
+
+VulkanGeometryArena::VulkanGeometryArena(Ref<VulkanDevice> device, VkDeviceSize pageSize) :
+    m_device(std::move(device)),
+    m_pageSize(pageSize)
+{
+}
+
+VulkanGeometryArena::~VulkanGeometryArena()
+{
+}
+
+Ref<VulkanGeometryAllocation> VulkanGeometryArena::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    if (size == 0)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard lock(m_mutex);
+    uint32_t pageIndex = 0;
+    uint64_t offset = FreeListAllocator::InvalidOffset;
+    for (; pageIndex < m_pages.size(); ++pageIndex)
+    {
+        if (m_pages[pageIndex].buffer)
+        {
+            offset = m_pages[pageIndex].allocator.Allocate(size, alignment);
+            if (offset != FreeListAllocator::InvalidOffset)
+            {
+                break;
+            }
+        }
+    }
+    if (offset == FreeListAllocator::InvalidOffset)
+    {
+        pageIndex = CreatePage(std::max(size, m_pageSize));
+        offset = m_pages[pageIndex].allocator.Allocate(size, alignment);
+    }
+
+    Page& page = m_pages[pageIndex];
+    Ref<VulkanGeometryAllocation> allocation = MakeRefCounted<VulkanGeometryAllocation>(
+        this, pageIndex, page.buffer.get(), offset, size, alignment);
+    page.allocations.insert(allocation.get());
+    return allocation;
+}
+
+uint32_t VulkanGeometryArena::CreatePage(VkDeviceSize size)
+{
+    uint32_t pageIndex = 0;
+    while ((pageIndex < m_pages.size()) && m_pages[pageIndex].buffer)
+    {
+        ++pageIndex;
+    }
+    if (pageIndex == m_pages.size())
+    {
+        m_pages.emplace_back();
+    }
+    Page& page = m_pages[pageIndex];
+    page.buffer = m_device->CreateVertexBuffer(size,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    page.allocator.Reset(size);
+    return pageIndex;
+}
+
+void VulkanGeometryArena::Free(VulkanGeometryAllocation* allocation)
+{
+    std::lock_guard lock(m_mutex);
+    Page& page = m_pages[allocation->m_pageIndex];
+    page.allocator.Free(allocation->m_offset);
+    page.allocations.erase(allocation);
+}
+
+void VulkanGeometryArena::Defragment()
+{
+    std::lock_guard lock(m_mutex);
+    bool compacted = false;
+    for (Page& page : m_pages)
+    {
+        if (!page.buffer)
+        {
+            continue;
+        }
+        // The frames in flight may still read the buffers replaced or released.
+        if (page.allocations.empty())
+        {
+            m_device->Retire(std::move(page.buffer));
+            page.allocator.Reset(0);
+            continue;
+        }
+        // Worth it if the free space out of the largest free range is significant.
+        const VkDeviceSize capacity = page.allocator.GetCapacity();
+        if (compacted || (page.allocator.GetFreeSize() - page.allocator.GetLargestFreeSize() < capacity / 8))
+        {
+            continue;
+        }
+
+        // Copy the allocations in offset order to the start of a new buffer, which keeps their alignments.
+        std::vector<VulkanGeometryAllocation*> allocations(page.allocations.begin(), page.allocations.end());
+        std::sort(allocations.begin(), allocations.end(),
+            [](const VulkanGeometryAllocation* a, const VulkanGeometryAllocation* b) { return a->m_offset < b->m_offset; });
+        FreeListAllocator allocator(capacity);
+        std::vector<VkBufferCopy> copyRegions(allocations.size());
+        for (size_t i = 0; i < allocations.size(); ++i)
+        {
+            copyRegions[i].srcOffset = allocations[i]->m_offset;
+            copyRegions[i].dstOffset = allocator.Allocate(allocations[i]->m_size, allocations[i]->m_alignment);
+            copyRegions[i].size = allocations[i]->m_size;
+        }
+        // The copies of the pages are submitted after the uploads to them, and before the frame drawing from
+        // the new buffer (same queue); they are not waited for.
+        m_device->GetUploadContext()->Flush();
+        Ref<VulkanBuffer> buffer = m_device->CreateVertexBuffer(capacity,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        Ref<VulkanCommandBuffer> commandBuffer = m_device->AllocateCommandBufferOneTimeUse();
+        commandBuffer->Begin();
+        commandBuffer->CopyBuffer(page.buffer.get(), buffer.get(), copyRegions);
+        // Make the copies visible to any later command of the queue.
+        commandBuffer->SetMemoryBarrier(
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+        commandBuffer->End();
+        m_device->GetQueue()->Submit({ commandBuffer.get() }, {}, {}, nullptr);
+        m_device->Retire(std::move(commandBuffer));
+
+        for (size_t i = 0; i < allocations.size(); ++i)
+        {
+            allocations[i]->m_buffer = buffer.get();
+            allocations[i]->m_offset = copyRegions[i].dstOffset;
+            m_stats.movedSize += copyRegions[i].size;
+        }
+        m_device->Retire(std::move(page.buffer));
+        page.buffer = std::move(buffer);
+        page.allocator = std::move(allocator);
+        m_stats.defragmentCount++;
+        compacted = true;
+    }
+}
+
+VulkanGeometryArena::Stats VulkanGeometryArena::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    Stats stats = m_stats;
+    stats.pageCount = 0;
+    stats.allocationCount = 0;
+    stats.capacity = 0;
+    stats.usedSize = 0;
+    stats.largestFreeSize = 0;
+    for (const Page& page : m_pages)
+    {
+        if (page.buffer)
+        {
+            stats.pageCount++;
+            stats.allocationCount += page.allocations.size();
+            stats.capacity += page.allocator.GetCapacity();
+            stats.usedSize += page.allocator.GetUsedSize();
+            stats.largestFreeSize = std::max(stats.largestFreeSize, page.allocator.GetLargestFreeSize());
+        }
+    }
+    return stats;
+}
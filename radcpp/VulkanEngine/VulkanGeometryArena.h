@@ -0,0 +1,94 @@
+#ifndef VULKAN_GEOMETRY_ARENA_H
+#define VULKAN_GEOMETRY_ARENA_H
+#pragma once
+
+#include "VulkanCore.h"
+#include "radcpp/Common/FreeListAllocator.h"
+#include <mutex>
+#include <unordered_set>
+
+class VulkanGeometryArena;
+
+// A range of a buffer of the geometry arena, freed when released.
+// VulkanGeometryArena::Defragment() may move it to another offset (and buffer).
+class VulkanGeometryAllocation : public RefCounted<VulkanGeometryAllocation>
+{
+public:
+    VulkanGeometryAllocation(Ref<VulkanGeometryArena> arena, uint32_t pageIndex,
+        VulkanBuffer* buffer, VkDeviceSize offset, VkDeviceSize size, VkDeviceSize alignment);
+    ~VulkanGeometryAllocation();
+
+    VulkanBuffer* GetBuffer() const { return m_buffer; }
+    VkDeviceSize GetOffset() const { return m_offset; }
+    VkDeviceSize GetSize() const { return m_size; }
+    VkDeviceSize GetAlignment() const { return m_alignment; }
+
+private:
+    friend class VulkanGeometryArena;
+
+    Ref<VulkanGeometryArena> m_arena;
+    uint32_t m_pageIndex;
+    VulkanBuffer* m_buffer; // owned by the page
+    VkDeviceSize m_offset;
+    VkDeviceSize m_size;
+    VkDeviceSize m_alignment;
+
+}; // class VulkanGeometryAllocation
+
+// Vertex, index and storage data of the meshes, sub-allocated from a few large device local buffers (pages)
+// instead of a buffer per mesh, so that the meshes of a page are drawn without rebinding the buffers:
+// with vertexOffset = offset / stride and firstIndex = offset / index size.
+// Allocations larger than a page get a page of their own. Allocate() and releasing allocations are thread safe.
+class VulkanGeometryArena : public RefCounted<VulkanGeometryArena>
+{
+public:
+    static constexpr VkDeviceSize DefaultPageSize = 256ull * 1024 * 1024;
+
+    struct Stats
+    {
+        uint32_t pageCount;
+        size_t allocationCount;
+        VkDeviceSize capacity; // of the pages
+        VkDeviceSize usedSize;
+        VkDeviceSize largestFreeSize;
+        uint32_t defragmentCount; // pages compacted since the creation
+        VkDeviceSize movedSize; // by the compactions
+    };
+
+    VulkanGeometryArena(Ref<VulkanDevice> device, VkDeviceSize pageSize = DefaultPageSize);
+    ~VulkanGeometryArena();
+
+    // Allocate size bytes at an offset multiple of alignment, which can be any value (a vertex stride),
+    // and must be a multiple of the offset alignment the data is bound with (minStorageBufferOffsetAlignment).
+    Ref<VulkanGeometryAllocation> Allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+    // Compact a page fragmented by the allocations released (after unloading meshes), at most one a call to bound
+    // the copies of a frame, and release the empty ones. Moved allocations get new offsets at once: the copies are
+    // submitted to the universal queue without waiting, before the commands recorded after the call (call it
+    // between frames, or while recording one), and the buffers replaced are retired to the device (the frames
+    // in flight and the copies may read them). Cheap if no page is fragmented.
+    void Defragment();
+
+    Stats GetStats() const;
+
+private:
+    friend class VulkanGeometryAllocation;
+    void Free(VulkanGeometryAllocation* allocation);
+    uint32_t CreatePage(VkDeviceSize size);
+
+    struct Page
+    {
+        Ref<VulkanBuffer> buffer; // null if released, the index is then reused
+        FreeListAllocator allocator;
+        std::unordered_set<VulkanGeometryAllocation*> allocations;
+    };
+
+    Ref<VulkanDevice> m_device;
+    VkDeviceSize m_pageSize;
+    mutable std::mutex m_mutex;
+    std::vector<Page> m_pages;
+    Stats m_stats = {};
+
+}; // class VulkanGeometryArena
+
+#endif // VULKAN_GEOMETRY_ARENA_H
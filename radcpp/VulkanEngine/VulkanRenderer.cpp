@@ -1,4 +1,6 @@
 #include "VulkanRenderer.h"
+#include "radcpp/Common/Parallel.h"
+#include "radcpp/Common/RadixSort.h"
 
 VulkanRenderer::VulkanRenderer(Ref<VulkanDevice> device, VulkanWindow* window) :
     m_device(std::move(device)),
@@ -18,20 +20,15 @@ VulkanRenderer::VulkanRenderer(Ref<VulkanDevice> device, VulkanWindow* window) :
         m_shaderSourceDir.push_back('/');
     }
 
-    VulkanSwapchain* swapchain = m_window->GetSwapchain();
-
-    m_uniformBuffers.resize(swapchain->GetImageCount());
-    m_uniformData.resize(swapchain->GetImageCount());
-    for (uint32_t i = 0; i < swapchain->GetImageCount(); i++)
-    {
-        m_uniformBuffers[i] = m_device->CreateUniformBuffer(128 * 1024 * 1024, true);
-        m_uniformData[i] = (uint8_t*)m_uniformBuffers[i]->GetPersistentMappedAddr();
-    }
+    m_uniformAllocator = MakeRefCounted<VulkanUniformAllocator>(m_device);
+    m_frameCommandPools.resize(VulkanWindow::FrameLag);
+    // The calling thread records a chunk too.
+    m_recordingThreadCount = static_cast<uint32_t>(GetGlobalThreadPool()->GetThreadCount() + 1);
 
     uint32_t maxSets = 4096;
     m_descriptorPool = m_device->CreateDescriptorPool(maxSets,
         std::array{ // type, descriptorCount
-            VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,    2 * swapchain->GetImageCount() },
+            VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,    2 * 64 }, // per uniform block
             VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,            1024 },
             VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,             4096 },
             VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,             4096 },
@@ -45,47 +42,13 @@ VulkanRenderer::VulkanRenderer(Ref<VulkanDevice> device, VulkanWindow* window) :
         }
     );
 
-    m_frameDescriptorSets.resize(swapchain->GetImageCount());
-    for (uint32_t i = 0; i < swapchain->GetImageCount(); i++)
-    {
-        m_frameDescriptorSets[i] = m_descriptorPool->Allocate(m_frameDescriptorSetLayout.get());
-        VkWriteDescriptorSet descWrites[2] = {};
-        descWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descWrites[0].pNext = nullptr;
-        descWrites[0].dstSet = m_frameDescriptorSets[i]->GetHandle();
-        descWrites[0].dstBinding = 0;
-        descWrites[0].dstArrayElement = 0;
-        descWrites[0].descriptorCount = 1;
-        descWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-        descWrites[0].pImageInfo = nullptr;
-        VkDescriptorBufferInfo frameUniformBufferInfo =
-        {
-            VkDescriptorBufferInfo{ m_uniformBuffers[i]->GetHandle(), 0, sizeof(FrameUniforms) }
-        };
-        descWrites[0].pBufferInfo = &frameUniformBufferInfo;
-        descWrites[0].pTexelBufferView = nullptr;
-        descWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descWrites[1].pNext = nullptr;
-        descWrites[1].dstSet = m_frameDescriptorSets[i]->GetHandle();
-        descWrites[1].dstBinding = 1;
-        descWrites[1].dstArrayElement = 0;
-        descWrites[1].descriptorCount = 1;
-        descWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-        descWrites[1].pImageInfo = nullptr;
-        VkDescriptorBufferInfo meshUniformBufferInfo =
-        {   // buffer, offset, range
-            VkDescriptorBufferInfo{ m_uniformBuffers[i]->GetHandle(), 0, sizeof(MeshUniforms) }
-        };
-        descWrites[1].pBufferInfo = &meshUniformBufferInfo;
-        descWrites[1].pTexelBufferView = nullptr;
-        m_frameDescriptorSets[i]->Update(descWrites);
-    }
-
     m_meshDescriptorSetLayout = m_device->CreateDescriptorSetLayout(
         std::array{ // layout bindings
         // binding, type, count, stageFlags, pImmutableSamplers
         VkDescriptorSetLayoutBinding{ 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},   // baseColor
         });
+    // Bound by the meshes without material (the scene cache can load them), which sample no texture.
+    m_emptyMaterialDescriptorSet = m_descriptorPool->Allocate(m_meshDescriptorSetLayout.get());
 
     CreateSamplers();
 
@@ -113,7 +76,11 @@ VulkanRenderer::VulkanRenderer(Ref<VulkanDevice> device, VulkanWindow* window) :
     m_scissors[0].extent.width = windowWidth;
     m_scissors[0].extent.height = windowHeight;
 
-    m_scene = MakeRefCounted<VulkanScene>(m_device);
+    m_textureCache = MakeRefCounted<VulkanTextureCache>();
+    m_textureStreamer = MakeRefCounted<VulkanTextureStreamer>(m_device);
+    m_geometryArena = MakeRefCounted<VulkanGeometryArena>(m_device);
+    m_scene = MakeRefCounted<VulkanScene>(m_device, m_textureCache, m_geometryArena);
+    m_scene->m_textureStreamer = m_textureStreamer;
 }
 
 VulkanRenderer::~VulkanRenderer()
@@ -129,22 +96,18 @@ bool VulkanRenderer::Import3DModel(const Path& filePath)
         {
             VulkanMesh* mesh = m_scene->m_meshes[i].get();
             CreateSolidWireframePipeline(mesh);
-
-            if (!mesh->m_descriptorSet)
+        }
+        // The meshes bind the descriptor set of their material.
+        for (const Ref<VulkanMaterial>& material : m_scene->m_materials)
+        {
+            if (!material->m_descriptorSet)
             {
-                mesh->m_descriptorSet =
+                material->m_descriptorSet =
                     m_descriptorPool->Allocate(m_meshDescriptorSetLayout.get());
             }
-
-            VulkanMaterial* material = mesh->m_material.get();
-            if (material->m_baseColorTexture)
-            {
-                mesh->m_descriptorSet->UpdateImages(
-                    0, 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                    std::array{ material->m_baseColorTexture->image->GetDefaultView() },
-                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-            }
+            UpdateMaterialDescriptorSet(material.get());
         }
+        UpdateSortKeys();
 
         VulkanCamera* camera = m_scene->m_camera.get();
 
@@ -169,6 +132,79 @@ bool VulkanRenderer::Import3DModel(const Path& filePath)
     }
 }
 
+void VulkanRenderer::UpdateSortKeys()
+{
+    std::unordered_map<const VulkanMaterial*, uint64_t> materialIds;
+    for (size_t i = 0; i < m_scene->m_materials.size(); ++i)
+    {
+        materialIds[m_scene->m_materials[i].get()] = i;
+    }
+    for (size_t i = 0; i < m_scene->m_meshes.size(); ++i)
+    {
+        VulkanMesh* mesh = m_scene->m_meshes[i].get();
+        // The ids are assigned in the order the pipelines are first drawn with.
+        auto pipelineIter = m_pipelineSortIds.try_emplace(mesh->m_pipeline.get(),
+            static_cast<uint32_t>(m_pipelineSortIds.size())).first;
+        const uint64_t pipelineId = pipelineIter->second;
+        const uint64_t materialId = materialIds[mesh->m_material.get()];
+        // The ids out of their bit ranges wrap, which only makes the sort group fewer draws.
+        mesh->m_sortKey =
+            ((pipelineId & SortKeyPipelineMask) << SortKeyPipelineShift) |
+            ((materialId & SortKeyMaterialMask) << SortKeyMaterialShift) |
+            ((i & SortKeyMeshMask) << SortKeyMeshShift);
+    }
+}
+
+void VulkanRenderer::UpdateMaterialDescriptorSet(VulkanMaterial* material)
+{
+    if (material->m_baseColorTexture)
+    {
+        material->m_descriptorSet->UpdateImages(
+            0, 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            std::array{ material->m_baseColorTexture->image->GetDefaultView() },
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+}
+
+void VulkanRenderer::UpdateStreamedTextures()
+{
+    // A set per material changed (shared by its meshes): the sets in use are bounded by the materials
+    // in the frames in flight, whatever the number of meshes.
+    for (const Ref<VulkanMaterial>& material : m_scene->m_materials)
+    {
+        VulkanTexture* texture = material->m_baseColorTexture.get();
+        if (texture && texture->streamedImage && (texture->image.get() != texture->streamedImage->GetImage()))
+        {
+            texture->image = texture->streamedImage->GetImage();
+            if (material->m_descriptorSet)
+            {
+                m_device->Retire(std::move(material->m_descriptorSet));
+                material->m_descriptorSet = m_descriptorPool->Allocate(m_meshDescriptorSetLayout.get());
+                UpdateMaterialDescriptorSet(material.get());
+            }
+        }
+    }
+}
+
+void VulkanRenderer::RequestTextureLevels(const VulkanMeshInstance& instance, const glm::vec3& cameraPosition, float pixelScale)
+{
+    const VulkanMaterial* material = instance.m_mesh->m_material.get();
+    VulkanTexture* texture = material ? material->m_baseColorTexture.get() : nullptr;
+    if (!texture || !texture->streamedImage)
+    {
+        return;
+    }
+    // The size on screen of the bounding sphere, at its nearest point.
+    const float diameter = instance.m_aabb.DiagonalLength();
+    float size = diameter * pixelScale;
+    if (m_scene->m_camera->m_type == VulkanCamera::Type::Perspective)
+    {
+        float distance = glm::distance(instance.m_aabb.GetCenter(), cameraPosition) - diameter * 0.5f;
+        size /= std::max(distance, m_scene->m_camera->m_zNear);
+    }
+    m_textureStreamer->Request(texture->streamedImage.get(), size);
+}
+
 void VulkanRenderer::CreateSolidWireframePipeline(VulkanMesh* mesh)
 {
     std::vector<ShaderMacro> shaderMacros = GetShaderMacros(mesh);
@@ -227,6 +263,10 @@ void VulkanRenderer::CreateSolidWireframePipeline(VulkanMesh* mesh)
 std::vector<ShaderMacro> VulkanRenderer::GetShaderMacros(VulkanMesh* mesh)
 {
     std::vector<ShaderMacro> shaderMacros;
+    if (mesh->m_vertexFormat == VulkanVertexFormat::Compact)
+    {
+        shaderMacros.push_back(ShaderMacro("COMPACT_VERTEX_FORMAT"));
+    }
     if (mesh->m_hasPosition)
     {
         shaderMacros.push_back(ShaderMacro("HAS_POSITION"));
@@ -247,7 +287,7 @@ std::vector<ShaderMacro> VulkanRenderer::GetShaderMacros(VulkanMesh* mesh)
     {
         shaderMacros.push_back(ShaderMacro("HAS_COLOR"));
     }
-    if (mesh->m_material->m_baseColorTexture)
+    if (mesh->m_material && mesh->m_material->m_baseColorTexture)
     {
         shaderMacros.push_back(ShaderMacro("HAS_BASE_COLOR_TEXTURE"));
     }
@@ -256,43 +296,155 @@ std::vector<ShaderMacro> VulkanRenderer::GetShaderMacros(VulkanMesh* mesh)
 
 void VulkanRenderer::SetVertexInputState(VulkanGraphicsPipelineCreateInfo& pipelineInfo, VulkanMesh* mesh)
 {
+    // Must match the layout written by the importer.
+    const bool compact = (mesh->m_vertexFormat == VulkanVertexFormat::Compact);
     pipelineInfo.AddVertexBinding(0, mesh->m_vertexStride);
     uint32_t attribOffset = 0;
     if (mesh->m_hasPosition)
     {
-        pipelineInfo.AddVertexAttribute(0, 0, VK_FORMAT_R32G32B32_SFLOAT, attribOffset);
-        attribOffset += sizeof(glm::vec3);
+        if (compact)
+        {
+            pipelineInfo.AddVertexAttribute(0, 0, VK_FORMAT_R16G16B16A16_UNORM, attribOffset);
+            attribOffset += 4 * sizeof(uint16_t);
+        }
+        else
+        {
+            pipelineInfo.AddVertexAttribute(0, 0, VK_FORMAT_R32G32B32_SFLOAT, attribOffset);
+            attribOffset += sizeof(glm::vec3);
+        }
     }
     if (mesh->m_hasNormal)
     {
-        pipelineInfo.AddVertexAttribute(1, 0, VK_FORMAT_R32G32B32_SFLOAT, attribOffset);
-        attribOffset += sizeof(glm::vec3);
+        if (compact)
+        {
+            pipelineInfo.AddVertexAttribute(1, 0, VK_FORMAT_R16G16_SNORM, attribOffset);
+            attribOffset += 2 * sizeof(uint16_t);
+        }
+        else
+        {
+            pipelineInfo.AddVertexAttribute(1, 0, VK_FORMAT_R32G32B32_SFLOAT, attribOffset);
+            attribOffset += sizeof(glm::vec3);
+        }
     }
     if (mesh->m_hasTangent)
     {
-        pipelineInfo.AddVertexAttribute(2, 0, VK_FORMAT_R32G32B32A32_SFLOAT, attribOffset);
-        attribOffset += sizeof(glm::vec4);
+        if (compact)
+        {
+            pipelineInfo.AddVertexAttribute(2, 0, VK_FORMAT_R16G16_UINT, attribOffset);
+            attribOffset += 2 * sizeof(uint16_t);
+        }
+        else
+        {
+            pipelineInfo.AddVertexAttribute(2, 0, VK_FORMAT_R32G32B32A32_SFLOAT, attribOffset);
+            attribOffset += sizeof(glm::vec4);
+        }
     }
     if (mesh->m_hasColor)
     { // vertex color
-        pipelineInfo.AddVertexAttribute(3, 0, VK_FORMAT_R32G32B32A32_SFLOAT, attribOffset);
-        attribOffset += sizeof(glm::vec4);
+        if (compact)
+        {
+            pipelineInfo.AddVertexAttribute(3, 0, VK_FORMAT_R8G8B8A8_UNORM, attribOffset);
+            attribOffset += 4 * sizeof(uint8_t);
+        }
+        else
+        {
+            pipelineInfo.AddVertexAttribute(3, 0, VK_FORMAT_R32G32B32A32_SFLOAT, attribOffset);
+            attribOffset += sizeof(glm::vec4);
+        }
     }
     uint32_t texCoordLocation = 4; // texCoord started at location=4
     for (uint32_t texCoordIndex = 0; texCoordIndex < mesh->m_numUVChannels; texCoordIndex++)
     {
-        pipelineInfo.AddVertexAttribute(texCoordLocation++, 0, VK_FORMAT_R32G32_SFLOAT, attribOffset);
-        attribOffset += sizeof(glm::vec2);
+        if (compact)
+        {
+            pipelineInfo.AddVertexAttribute(texCoordLocation++, 0, VK_FORMAT_R16G16_SFLOAT, attribOffset);
+            attribOffset += 2 * sizeof(uint16_t);
+        }
+        else
+        {
+            pipelineInfo.AddVertexAttribute(texCoordLocation++, 0, VK_FORMAT_R32G32_SFLOAT, attribOffset);
+            attribOffset += sizeof(glm::vec2);
+        }
     }
 }
 
 void VulkanRenderer::Reset()
 {
-    m_scene = MakeRefCounted<VulkanScene>(m_device);
-
-    m_uniformData.clear();
-    m_uniformBuffers.clear();
+    // The frames in flight may still draw the meshes released: the scene and the pipelines are retired to the device,
+    // and released after them. The uniform allocator is kept.
+    // The texture cache is kept, to reuse the images of the scene if imported again.
+    m_device->Retire(std::move(m_scene));
+    m_scene = MakeRefCounted<VulkanScene>(m_device, m_textureCache, m_geometryArena);
+    m_scene->m_textureStreamer = m_textureStreamer;
+    for (auto& [name, pipeline] : m_solidWireframePipelines)
+    {
+        m_device->Retire(std::move(pipeline));
+    }
     m_solidWireframePipelines.clear();
+    m_pipelineSortIds.clear();
+}
+
+VulkanCommandBuffer* VulkanRenderer::BeginSecondaryCommandBuffer()
+{
+    std::vector<FrameCommandPool>& commandPools =
+        m_frameCommandPools[m_window->GetFrameIndex()];
+    if (commandPools.empty())
+    {
+        commandPools.emplace_back();
+        commandPools.back().commandPool = m_device->CreateCommandPool(VulkanQueueFamilyUniversal,
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    }
+    return BeginSecondary(commandPools[0]);
+}
+
+VulkanCommandBuffer* VulkanRenderer::BeginSecondary(FrameCommandPool& commandPool)
+{
+    if (commandPool.usedCount == commandPool.commandBuffers.size())
+    {
+        commandPool.commandBuffers.push_back(commandPool.commandPool->Allocate(VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+    }
+    VulkanCommandBuffer* commandBuffer = commandPool.commandBuffers[commandPool.usedCount++].get();
+    commandBuffer->BeginSecondary(m_window->GetDefaultRenderPass(), 0);
+    return commandBuffer;
+}
+
+VulkanDescriptorSet* VulkanRenderer::GetUniformDescriptorSet(VulkanUniformBlock* block)
+{
+    if (!block->m_descriptorSet)
+    {
+        block->m_descriptorSet = m_descriptorPool->Allocate(m_frameDescriptorSetLayout.get());
+        VkWriteDescriptorSet descWrites[2] = {};
+        descWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descWrites[0].pNext = nullptr;
+        descWrites[0].dstSet = block->m_descriptorSet->GetHandle();
+        descWrites[0].dstBinding = 0;
+        descWrites[0].dstArrayElement = 0;
+        descWrites[0].descriptorCount = 1;
+        descWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        descWrites[0].pImageInfo = nullptr;
+        VkDescriptorBufferInfo frameUniformBufferInfo =
+        {
+            VkDescriptorBufferInfo{ block->m_buffer->GetHandle(), 0, sizeof(FrameUniforms) }
+        };
+        descWrites[0].pBufferInfo = &frameUniformBufferInfo;
+        descWrites[0].pTexelBufferView = nullptr;
+        descWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descWrites[1].pNext = nullptr;
+        descWrites[1].dstSet = block->m_descriptorSet->GetHandle();
+        descWrites[1].dstBinding = 1;
+        descWrites[1].dstArrayElement = 0;
+        descWrites[1].descriptorCount = 1;
+        descWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        descWrites[1].pImageInfo = nullptr;
+        VkDescriptorBufferInfo meshUniformBufferInfo =
+        {   // buffer, offset, range
+            VkDescriptorBufferInfo{ block->m_buffer->GetHandle(), 0, sizeof(MeshUniforms) }
+        };
+        descWrites[1].pBufferInfo = &meshUniformBufferInfo;
+        descWrites[1].pTexelBufferView = nullptr;
+        block->m_descriptorSet->Update(descWrites);
+    }
+    return block->m_descriptorSet.get();
 }
 
 void VulkanRenderer::Resize(uint32_t width, uint32_t height)
@@ -302,80 +454,364 @@ void VulkanRenderer::Resize(uint32_t width, uint32_t height)
 
 void VulkanRenderer::Render(float deltaTime)
 {
-    uint32_t swapchainImageIndex = m_window->GetSwapchain()->GetCurrentImageIndex();
-
     VulkanCamera* camera = m_scene->m_camera.get();
 
-    m_uniformOffset = 0;
-    FrameUniforms frameUniforms = {};
-    glm::mat4 correctionMatrix = {
-        +1.0, +0.0, +0.0, +0.0,
-        +0.0, -1.0, +0.0, +0.0,
-        +0.0, +0.0, +0.5, +0.5,
-        +0.0, +0.0, +0.0, +1.0,
-    };
-    frameUniforms.viewProjectionMatrix = correctionMatrix *
+    // The window waited for the last frame of its frame-lag slot: the command buffers recorded for it are complete
+    // (unlike the ones of the swapchain image, which may be acquired out of order).
+    for (FrameCommandPool& commandPool : m_frameCommandPools[m_window->GetFrameIndex()])
+    {
+        commandPool.commandPool->Reset();
+        commandPool.usedCount = 0;
+    }
+    // Reuse the uniform space of the frames completed.
+    m_uniformAllocator->BeginFrame();
+
+    // Flip Y and map depth from [-1, 1] (OpenGL) to [0, 1] (Vulkan).
+    glm::mat4 correctionMatrix = glm::mat4(
+        glm::vec4(+1.0f, +0.0f, +0.0f, +0.0f),  // column 0
+        glm::vec4(+0.0f, -1.0f, +0.0f, +0.0f),  // column 1
+        glm::vec4(+0.0f, +0.0f, +0.5f, +0.0f),  // column 2
+        glm::vec4(+0.0f, +0.0f, +0.5f, +1.0f)   // column 3
+    );
+    const glm::mat4 viewProjection = correctionMatrix *
         camera->GetProjectionMatrix() * camera->GetViewMatrix();
-    WriteUniforms(&frameUniforms, sizeof(frameUniforms));
+
+    // Switch to the texture levels streamed in (or out) since the last frame; the requests of the last frame
+    // schedule the next uploads.
+    if (m_textureStreamer->Update() > 0)
+    {
+        UpdateStreamedTextures();
+    }
+    // Compact the geometry once the meshes released (by Reset, when the frames in flight complete) fragment it.
+    m_geometryArena->Defragment();
 
     if (m_scene)
     {
-        RenderNodes(m_scene->m_rootNode.get(), glm::identity<glm::mat4>());
+        // Apply the node transforms changed since the last frame (free if none did).
+        m_scene->RefitInstanceBVH();
+        CullInstances(Frustum(viewProjection, true));
+        RenderInstances(viewProjection);
     }
 }
 
-void VulkanRenderer::RenderNodes(VulkanSceneNode* node, glm::mat4 transform)
+void VulkanRenderer::CullInstances(const Frustum& frustum)
 {
-    transform = transform * node->m_transform;
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    const AABBArray& boxes = m_scene->m_instanceBoxes;
+    const size_t instanceCount = boxes.Size();
+    m_visibleInstances.resize(instanceCount);
+
+    // Each chunk writes the visible indices to its own range, which are compacted afterwards.
+    constexpr size_t ChunkSize = 1024;
+    const size_t chunkCount = (instanceCount + ChunkSize - 1) / ChunkSize;
+    std::vector<size_t> chunkVisibleCounts(chunkCount);
+    ParallelFor(0, chunkCount, 1,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t chunkIndex = begin; chunkIndex < end; ++chunkIndex)
+            {
+                const size_t first = chunkIndex * ChunkSize;
+                const size_t count = std::min(ChunkSize, instanceCount - first);
+                chunkVisibleCounts[chunkIndex] = CullBoundingBoxes(boxes, first, count, frustum,
+                    m_visibleInstances.data() + first);
+            }
+        });
 
-    // @TODO: render with multi-thread
+    size_t visibleCount = 0;
+    for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+    {
+        const uint32_t* chunkIndices = m_visibleInstances.data() + chunkIndex * ChunkSize;
+        // The destination never passes the source, so an overlapping move is safe.
+        std::memmove(m_visibleInstances.data() + visibleCount, chunkIndices,
+            chunkVisibleCounts[chunkIndex] * sizeof(uint32_t));
+        visibleCount += chunkVisibleCounts[chunkIndex];
+    }
+    m_visibleInstances.resize(visibleCount);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    m_stats.instanceCount = static_cast<uint32_t>(instanceCount);
+    m_stats.visibleCount = static_cast<uint32_t>(visibleCount);
+    m_stats.culledCount = static_cast<uint32_t>(instanceCount - visibleCount);
+    m_stats.cullTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+}
+
+void VulkanRenderer::RenderInstances(const glm::mat4& viewProjection)
+{
     VulkanCommandBuffer* cmdBuffer = m_window->GetCommandBuffer();
-    VulkanSwapchain* swapchain = m_window->GetSwapchain();
+    const uint32_t frameIndex = m_window->GetFrameIndex();
+
+    const VulkanCamera* camera = m_scene->m_camera.get();
+    const float viewportHeight = m_viewports.empty() ? 0.0f : std::abs(m_viewports[0].height);
+    float lodErrorScale = 0.0f;
+    if (camera->m_type == VulkanCamera::Type::Perspective)
+    {
+        lodErrorScale = viewportHeight / (2.0f * std::tan(camera->m_yfov * 0.5f));
+    }
+    else if (camera->m_ymag > 0.0f)
+    {
+        lodErrorScale = viewportHeight / (2.0f * camera->m_ymag);
+    }
+
+    // The streamer is not thread safe: the texture levels are requested before recording.
+    for (uint32_t instanceIndex : m_visibleInstances)
+    {
+        const VulkanMeshInstance& instance = m_scene->m_instances[instanceIndex];
+        if (instance.m_mesh->m_vertexAllocation)
+        {
+            RequestTextureLevels(instance, camera->m_position, lodErrorScale);
+        }
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
 
-    for (uint32_t i = 0; i < node->m_meshes.size(); i++)
+    // Sort the draws by state, to group the ones sharing binds (skipped by the command buffers as redundant),
+    // then front to back, for the early depth test.
+    const size_t drawCount = m_visibleInstances.size();
+    m_drawSortKeys.resize(drawCount);
+    for (size_t i = 0; i < drawCount; ++i)
+    {
+        const VulkanMeshInstance& instance = m_scene->m_instances[m_visibleInstances[i]];
+        const float distance = glm::distance(instance.m_aabb.GetCenter(), camera->m_position);
+        const float depth = std::clamp(distance / camera->m_zFar, 0.0f, 1.0f);
+        m_drawSortKeys[i] = instance.m_mesh->m_sortKey | static_cast<uint64_t>(depth * float(SortKeyDepthMask));
+    }
+    RadixSort(m_drawSortKeys, m_visibleInstances, m_sortTempKeys, m_sortTempValues);
+
+    // The FrameUniforms, followed by the MeshUniforms of the draws, in a single allocation (bound by one descriptor set).
+    const VkDeviceSize uniformAlignment = m_uniformAllocator->GetAlignment();
+    const VkDeviceSize frameUniformsSize = RoundUpToMultiple<VkDeviceSize>(sizeof(FrameUniforms), uniformAlignment);
+    const VkDeviceSize uniformStride = RoundUpToMultiple<VkDeviceSize>(sizeof(MeshUniforms), uniformAlignment);
+    VulkanUniformAllocation uniforms = m_uniformAllocator->Allocate(frameUniformsSize + uniformStride * drawCount);
+    FrameUniforms frameUniforms = {};
+    frameUniforms.viewProjectionMatrix = viewProjection;
+    memcpy(uniforms.data, &frameUniforms, sizeof(frameUniforms));
+    // Created before recording: the descriptor pool is not thread safe.
+    GetUniformDescriptorSet(uniforms.block);
+    const VkDeviceSize meshUniformOffset = uniforms.offset + frameUniformsSize;
+
+    // Each chunk of the visible instances is recorded into a secondary command buffer of its own pool,
+    // and writes the uniforms of its draws to the slots reserved for them.
+    const size_t chunkCount = std::clamp<size_t>(
+        (drawCount + MinDrawsPerChunk - 1) / MinDrawsPerChunk, 1, m_recordingThreadCount);
+    const size_t chunkSize = (drawCount + chunkCount - 1) / chunkCount;
+
+    std::vector<FrameCommandPool>& commandPools = m_frameCommandPools[frameIndex];
+    while (commandPools.size() < chunkCount + 1)
+    {
+        commandPools.emplace_back();
+        commandPools.back().commandPool = m_device->CreateCommandPool(VulkanQueueFamilyUniversal,
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    }
+    if (m_chunkMeshlets.size() < chunkCount)
+    {
+        m_chunkMeshlets.resize(chunkCount);
+        m_chunkUniforms.resize(chunkCount);
+    }
+    std::vector<VulkanCommandBuffer*> chunkCommandBuffers(chunkCount);
+    std::vector<Stats> chunkStats(chunkCount, Stats{});
+    ParallelFor(0, chunkCount, 1,
+        [&](size_t chunkBegin, size_t chunkEnd)
+        {
+            for (size_t chunkIndex = chunkBegin; chunkIndex < chunkEnd; ++chunkIndex)
+            {
+                // The first pool is of BeginSecondaryCommandBuffer().
+                VulkanCommandBuffer* chunkCmdBuffer = BeginSecondary(commandPools[chunkIndex + 1]);
+                const size_t begin = std::min(chunkIndex * chunkSize, drawCount);
+                const size_t end = std::min(begin + chunkSize, drawCount);
+                RecordInstances(chunkCmdBuffer, begin, end, uniforms.block, uniforms.offset,
+                    meshUniformOffset + uniformStride * begin, uniformStride, viewProjection, lodErrorScale,
+                    m_chunkMeshlets[chunkIndex], m_chunkUniforms[chunkIndex], chunkStats[chunkIndex]);
+                chunkCmdBuffer->End();
+                chunkCommandBuffers[chunkIndex] = chunkCmdBuffer;
+            }
+        });
+    cmdBuffer->ExecuteCommands(chunkCommandBuffers);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    m_stats.recordTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+    m_stats.recordingChunkCount = static_cast<uint32_t>(chunkCount);
+    m_stats.triangleCount = 0;
+    m_stats.fullDetailTriangleCount = 0;
+    m_stats.meshletCount = 0;
+    m_stats.meshletFrustumCulledCount = 0;
+    m_stats.meshletBackfacingCount = 0;
+    m_stats.stateCommandCount = 0;
+    m_stats.skippedStateCommandCount = 0;
+    for (VulkanCommandBuffer* chunkCmdBuffer : chunkCommandBuffers)
     {
-        VulkanMesh* mesh = node->m_meshes[i].get();
+        m_stats.stateCommandCount += chunkCmdBuffer->GetStateCommandCount();
+        m_stats.skippedStateCommandCount += chunkCmdBuffer->GetSkippedStateCommandCount();
+    }
+    for (const Stats& stats : chunkStats)
+    {
+        m_stats.triangleCount += stats.triangleCount;
+        m_stats.fullDetailTriangleCount += stats.fullDetailTriangleCount;
+        m_stats.meshletCount += stats.meshletCount;
+        m_stats.meshletFrustumCulledCount += stats.meshletFrustumCulledCount;
+        m_stats.meshletBackfacingCount += stats.meshletBackfacingCount;
+    }
+}
+
+void VulkanRenderer::RecordInstances(VulkanCommandBuffer* cmdBuffer, size_t begin, size_t end,
+    VulkanUniformBlock* uniformBlock, VkDeviceSize frameUniformOffset, VkDeviceSize meshUniformOffset,
+    VkDeviceSize uniformStride, const glm::mat4& viewProjection, float lodErrorScale,
+    std::vector<uint32_t>& visibleMeshlets, std::vector<uint8_t>& uniformStaging, Stats& stats)
+{
+    const VulkanCamera* camera = m_scene->m_camera.get();
+    // The uniforms are gathered in cached memory and copied at once to the mapped block (likely write-combined),
+    // with the padding of the stride.
+    uniformStaging.resize(uniformStride * (end - begin));
+    // The dynamic states are not inherited by secondary command buffers.
+    cmdBuffer->SetViewports(m_viewports);
+    cmdBuffer->SetScissors(m_scissors);
+    // The command buffer skips the binds of the states already bound: the draws are sorted by state,
+    // and the meshes share the buffers of the geometry arena.
+    for (size_t drawIndex = begin; drawIndex < end; ++drawIndex)
+    {
+        const VulkanMeshInstance& instance = m_scene->m_instances[m_visibleInstances[drawIndex]];
+        VulkanMesh* mesh = instance.m_mesh;
+        if (!mesh->m_vertexAllocation)
+        {
+            continue;
+        }
+        uint32_t lodIndex = m_lodEnabled ? SelectLOD(instance, camera->m_position, lodErrorScale) : 0;
         MeshUniforms meshUniforms = {};
-        meshUniforms.modelToWorld = transform;
-        uint32_t meshUniformOffset = WriteUniforms(&meshUniforms, sizeof(meshUniforms));
+        meshUniforms.modelToWorld = instance.m_transform;
+        meshUniforms.normalToWorld = glm::mat3x4(instance.m_normalTransform);
+        meshUniforms.positionOffset = glm::vec4(mesh->m_positionOffset, 0.0f);
+        meshUniforms.positionScale = glm::vec4(mesh->m_positionScale, 0.0f);
+        memcpy(uniformStaging.data() + uniformStride * (drawIndex - begin), &meshUniforms, sizeof(meshUniforms));
 
         VulkanPipeline* pipeline = mesh->m_pipeline.get();
         cmdBuffer->BindPipeline(pipeline);
+        // The set of the uniforms has a dynamic offset per draw; the others are bound apart, to be skipped
+        // for the draws of the same material.
         cmdBuffer->BindDescriptorSets(pipeline, m_pipelineLayout.get(), 0,
             std::array{ // descriptor sets
-                m_frameDescriptorSets[swapchain->GetCurrentImageIndex()].get(),
-                mesh->m_descriptorSet.get(),
-                m_samplerSet.get(),
+                uniformBlock->m_descriptorSet.get(),
             },
             std::array{ // dynamic offsets
-                0u,  // set = 0, binding = 0: FrameUniforms
-                meshUniformOffset,  // set = 0, binding = 1: MeshUniforms
+                static_cast<uint32_t>(frameUniformOffset),  // set = 0, binding = 0: FrameUniforms
+                static_cast<uint32_t>(meshUniformOffset + uniformStride * (drawIndex - begin)),  // set = 0, binding = 1: MeshUniforms
+            }
+        );
+        cmdBuffer->BindDescriptorSets(pipeline, m_pipelineLayout.get(), 1,
+            std::array{ // descriptor sets
+                mesh->m_material ? mesh->m_material->m_descriptorSet.get() : m_emptyMaterialDescriptorSet.get(),
+                m_samplerSet.get(),
             }
         );
-        cmdBuffer->BindVertexBuffers(0, std::array{ mesh->m_vertexBuffer.get() }, std::array{ mesh->m_vertexBufferOffset });
-        if (mesh->m_indexBuffer)
+        cmdBuffer->BindVertexBuffers(0, std::array{ mesh->m_vertexAllocation->GetBuffer() }, std::array{ VkDeviceSize(0) });
+        VulkanGeometryAllocation* indexAllocation = mesh->m_indexAllocation.get();
+        if (indexAllocation)
         {
-            cmdBuffer->BindIndexBuffer(mesh->m_indexBuffer.get(), mesh->m_indexBufferOffset, VK_INDEX_TYPE_UINT32);
+            cmdBuffer->BindIndexBuffer(indexAllocation->GetBuffer(), 0, mesh->m_indexType);
         }
 
-        cmdBuffer->SetViewports(m_viewports);
-        cmdBuffer->SetScissors(m_scissors);
-
-        if (mesh->m_indexBuffer)
+        if (indexAllocation && m_meshletCullingEnabled && (lodIndex == 0) && !mesh->m_meshlets.empty())
         {
-            cmdBuffer->DrawIndexed(mesh->GetIndexCount(), 1, 0, 0, 0);
+            CullMeshlets(instance, viewProjection, visibleMeshlets, stats);
+            // Consecutive visible meshlets are contiguous in the index buffer, and drawn at once.
+            size_t i = 0;
+            while (i < visibleMeshlets.size())
+            {
+                const Meshlet& first = mesh->m_meshlets[visibleMeshlets[i]];
+                uint32_t triangleCount = first.triangleCount;
+                size_t j = i + 1;
+                while ((j < visibleMeshlets.size()) && (visibleMeshlets[j] == visibleMeshlets[j - 1] + 1))
+                {
+                    triangleCount += mesh->m_meshlets[visibleMeshlets[j]].triangleCount;
+                    ++j;
+                }
+                cmdBuffer->DrawIndexed(triangleCount * 3, 1,
+                    mesh->GetFirstIndex() + first.triangleOffset * 3, mesh->GetVertexOffset(), 0);
+                stats.triangleCount += triangleCount;
+                i = j;
+            }
+            stats.fullDetailTriangleCount += mesh->GetIndexCount() / 3;
+        }
+        else if (indexAllocation)
+        {
+            const VulkanMeshLOD& lod = mesh->m_lods[lodIndex];
+            cmdBuffer->DrawIndexed(lod.m_indexCount, 1,
+                mesh->GetFirstIndex() + lod.m_indexOffset, mesh->GetVertexOffset(), 0);
+            stats.triangleCount += lod.m_indexCount / 3;
+            stats.fullDetailTriangleCount += mesh->GetIndexCount() / 3;
         }
         else
         {
-            cmdBuffer->Draw(mesh->GetVertexCount(), 1, 0, 0);
+            cmdBuffer->Draw(mesh->GetVertexCount(), 1, static_cast<uint32_t>(mesh->GetVertexOffset()), 0);
+            stats.triangleCount += mesh->GetVertexCount() / 3;
+            stats.fullDetailTriangleCount += mesh->GetVertexCount() / 3;
         }
     }
+    // Read by the GPU after the submission of the frame only.
+    memcpy(uniformBlock->m_data + meshUniformOffset, uniformStaging.data(), uniformStaging.size());
+}
 
-    // traversal the scene nodes recursively
-    for (auto& childNode : node->m_children)
+void VulkanRenderer::CullMeshlets(const VulkanMeshInstance& instance, const glm::mat4& viewProjection,
+    std::vector<uint32_t>& visibleMeshlets, Stats& stats)
+{
+    const VulkanMesh* mesh = instance.m_mesh;
+    const size_t meshletCount = mesh->m_meshlets.size();
+    visibleMeshlets.resize(meshletCount);
+
+    // Cull in mesh space, with the frustum planes of the model-view-projection matrix.
+    Frustum frustum(viewProjection * instance.m_transform, true);
+    size_t frustumVisibleCount = CullBoundingSpheres(mesh->m_meshletSpheres, 0, meshletCount, frustum,
+        visibleMeshlets.data());
+    visibleMeshlets.resize(frustumVisibleCount);
+
+    // The normal cones are only counted: the pipelines are created without back-face culling,
+    // so the back faces of the meshlets may be visible.
+    glm::vec3 cameraPosition = glm::vec3(instance.m_inverseTransform * glm::vec4(m_scene->m_camera->m_position, 1.0f));
+    uint32_t backfacingCount = 0;
+    for (uint32_t meshletIndex : visibleMeshlets)
     {
-        RenderNodes(childNode.get(), transform);
+        const MeshletBounds& bounds = mesh->m_meshletBounds[meshletIndex];
+        if (glm::dot(glm::normalize(bounds.coneApex - cameraPosition), bounds.coneAxis) >= bounds.coneCutoff)
+        {
+            backfacingCount++;
+        }
     }
+
+    stats.meshletCount += static_cast<uint32_t>(meshletCount);
+    stats.meshletFrustumCulledCount += static_cast<uint32_t>(meshletCount - frustumVisibleCount);
+    stats.meshletBackfacingCount += backfacingCount;
+}
+
+uint32_t VulkanRenderer::SelectLOD(const VulkanMeshInstance& instance, const glm::vec3& cameraPosition, float errorScale) const
+{
+    const VulkanMesh* mesh = instance.m_mesh;
+    if (mesh->GetLODCount() <= 1)
+    {
+        return 0;
+    }
+
+    // The mesh errors are scaled by the largest scale of the instance transform.
+    const glm::mat4& transform = instance.m_transform;
+    float scale = std::sqrt(std::max({
+        glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+        glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+        glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])) }));
+    float pixelsPerUnit = errorScale * scale;
+    if (m_scene->m_camera->m_type == VulkanCamera::Type::Perspective)
+    {
+        // The nearest point of the bounding sphere gives the largest projected error.
+        glm::vec3 center = instance.m_aabb.GetCenter();
+        float radius = instance.m_aabb.DiagonalLength() * 0.5f;
+        float distance = std::max(glm::distance(center, cameraPosition) - radius, m_scene->m_camera->m_zNear);
+        pixelsPerUnit /= distance;
+    }
+
+    uint32_t lodIndex = 0;
+    while ((lodIndex + 1 < mesh->GetLODCount()) &&
+        (mesh->m_lods[lodIndex + 1].m_error * pixelsPerUnit <= m_lodErrorThreshold))
+    {
+        ++lodIndex;
+    }
+    return lodIndex;
 }
 
 void VulkanRenderer::CreateSamplers()
@@ -430,15 +866,3 @@ void VulkanRenderer::CreateSamplers()
     descWrites[0].pTexelBufferView = nullptr;
     m_samplerSet->Update(descWrites);
 }
-
-uint32_t VulkanRenderer::WriteUniforms(void* data, VkDeviceSize dataSize)
-{
-    uint32_t currentUniformOffset = static_cast<uint32_t>(m_uniformOffset);
-
-    uint32_t swapchainImageIndex = m_window->GetSwapchain()->GetCurrentImageIndex();
-    memcpy(m_uniformData[swapchainImageIndex] + m_uniformOffset, data, dataSize);
-    VkDeviceSize offsetAlignment = m_device->GetPhysicalDevice()->GetProperties().limits.minUniformBufferOffsetAlignment;
-    m_uniformOffset += RoundUpToMultiple(dataSize, offsetAlignment);
-
-    return currentUniformOffset;
-}
@@ -4,6 +4,7 @@
 
 #include "VulkanCore.h"
 #include "VulkanScene.h"
+#include "VulkanUniformAllocator.h"
 
 class VulkanRenderer : public RefCounted<VulkanRenderer>
 {
@@ -12,6 +13,14 @@ public:
     ~VulkanRenderer();
 
     VulkanScene* GetScene() const { return m_scene.get(); }
+    // Shared by the scenes of the renderer.
+    VulkanTextureCache* GetTextureCache() const { return m_textureCache.get(); }
+    // Streams the mip levels of the textures by their size on screen; set its budget to bound the GPU memory.
+    VulkanTextureStreamer* GetTextureStreamer() const { return m_textureStreamer.get(); }
+    // The vertex, index and meshlet buffers of the meshes.
+    VulkanGeometryArena* GetGeometryArena() const { return m_geometryArena.get(); }
+    // The uniforms of the frames, in a ring sized from the peak usage.
+    VulkanUniformAllocator* GetUniformAllocator() const { return m_uniformAllocator.get(); }
 
     bool Import3DModel(const Path& filePath);
     void Reset();
@@ -20,18 +29,80 @@ public:
     void SetViewports(ArrayRef<VkViewport> viewports) { m_viewports = viewports; }
     void SetScissors(ArrayRef<VkRect2D> scissors) { m_scissors = scissors; }
 
+    // Record the draws of the scene into secondary command buffers, in parallel, and execute them in the command
+    // buffer of the window: call it in the default render pass, begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
     void Render(float deltaTime);
+    // A secondary command buffer of the frame, begun in the default render pass, to record the other draws
+    // of the subpass (the UI) after Render(); end it and execute it in the command buffer of the window.
+    VulkanCommandBuffer* BeginSecondaryCommandBuffer();
+    // The draws are split into chunks of at least MinDrawsPerChunk, one per recording thread at most
+    // (the worker threads and the calling one by default).
+    void SetRecordingThreadCount(uint32_t count) { m_recordingThreadCount = std::max(count, 1u); }
+    uint32_t GetRecordingThreadCount() const { return m_recordingThreadCount; }
+
+    // Level of detail selection: each draw uses the coarsest LOD of the mesh whose error (VulkanMeshLOD::m_error,
+    // a quadric error estimate) projects to at most the threshold, in pixels.
+    void SetLODEnabled(bool enabled) { m_lodEnabled = enabled; }
+    bool IsLODEnabled() const { return m_lodEnabled; }
+    void SetLODErrorThreshold(float pixels) { m_lodErrorThreshold = pixels; }
+    float GetLODErrorThreshold() const { return m_lodErrorThreshold; }
+    // Frustum cull the meshlets of the instances drawn at full detail, and draw the visible ranges only.
+    void SetMeshletCullingEnabled(bool enabled) { m_meshletCullingEnabled = enabled; }
+    bool IsMeshletCullingEnabled() const { return m_meshletCullingEnabled; }
+
+    struct Stats
+    {
+        uint32_t instanceCount;
+        uint32_t visibleCount;
+        uint32_t culledCount;
+        float cullTime; // in milliseconds
+        uint32_t triangleCount; // drawn
+        uint32_t fullDetailTriangleCount; // that would be drawn with LODs off
+        uint32_t meshletCount; // of the instances culled by meshlets
+        uint32_t meshletFrustumCulledCount;
+        uint32_t meshletBackfacingCount; // in the frustum, but rejected by their normal cones (not culled)
+        float recordTime; // of the draws (with their sorting), in milliseconds
+        uint32_t recordingChunkCount; // secondary command buffers recorded in parallel
+        uint32_t stateCommandCount; // binds and dynamic states set by the draws
+        uint32_t skippedStateCommandCount; // redundant, not recorded
+    };
+    // The statistics of the last frame rendered.
+    const Stats& GetStats() const { return m_stats; }
 
 private:
     void CreateSamplers();
     void CreateSolidWireframePipeline(VulkanMesh* mesh);
     std::vector<ShaderMacro> GetShaderMacros(VulkanMesh* mesh);
     void SetVertexInputState(VulkanGraphicsPipelineCreateInfo& pipelineInfo, VulkanMesh* mesh);
+    void UpdateMaterialDescriptorSet(VulkanMaterial* material);
+    // Set the state part of the sort keys of the meshes of the scene.
+    void UpdateSortKeys();
+    // Switch the textures to the images replaced by the streamer, and rebind them in new descriptor sets
+    // (the ones of the frames in flight must not be updated).
+    void UpdateStreamedTextures();
+    // Request the texture levels needed to draw the instance; pixelScale as the errorScale of SelectLOD.
+    void RequestTextureLevels(const VulkanMeshInstance& instance, const glm::vec3& cameraPosition, float pixelScale);
 
-    void RenderNodes(VulkanSceneNode* node, glm::mat4 transform);
+    // Frustum cull the mesh instances of the scene in parallel, and write the indices of the visible ones to m_visibleInstances.
+    void CullInstances(const Frustum& frustum);
+    void RenderInstances(const glm::mat4& viewProjection);
+    // Record the draws [begin, end) of m_visibleInstances, with their uniforms written to the block from meshUniformOffset
+    // (with a single copy from uniformStaging); thread safe for different command buffers and ranges.
+    void RecordInstances(VulkanCommandBuffer* cmdBuffer, size_t begin, size_t end,
+        VulkanUniformBlock* uniformBlock, VkDeviceSize frameUniformOffset, VkDeviceSize meshUniformOffset,
+        VkDeviceSize uniformStride, const glm::mat4& viewProjection, float lodErrorScale,
+        std::vector<uint32_t>& visibleMeshlets, std::vector<uint8_t>& uniformStaging, Stats& stats);
+    // Write the indices of the meshlets of the instance in the frustum to visibleMeshlets.
+    void CullMeshlets(const VulkanMeshInstance& instance, const glm::mat4& viewProjection,
+        std::vector<uint32_t>& visibleMeshlets, Stats& stats);
+    // errorScale: pixels per unit of world space error at unit distance (perspective) or any distance (orthographic).
+    uint32_t SelectLOD(const VulkanMeshInstance& instance, const glm::vec3& cameraPosition, float errorScale) const;
 
     Ref<VulkanDevice> m_device;
     Ref<VulkanScene> m_scene;
+    Ref<VulkanTextureCache> m_textureCache;
+    Ref<VulkanTextureStreamer> m_textureStreamer;
+    Ref<VulkanGeometryArena> m_geometryArena;
     VulkanWindow* m_window;
 
     struct FrameUniforms
@@ -41,11 +112,13 @@ private:
     struct MeshUniforms
     {
         glm::mat4 modelToWorld;
+        glm::mat3x4 normalToWorld; // mat3 in std140: columns padded to vec4
+        glm::vec4 positionOffset; // dequantization of compact positions
+        glm::vec4 positionScale;
     };
-    std::vector<Ref<VulkanBuffer>> m_uniformBuffers;
-    std::vector<uint8_t*> m_uniformData;
-    VkDeviceSize m_uniformOffset = 0;
-    uint32_t WriteUniforms(void* data, VkDeviceSize dataSize);
+    Ref<VulkanUniformAllocator> m_uniformAllocator;
+    // The descriptor set binding the FrameUniforms and the MeshUniforms of the block, created on first use.
+    VulkanDescriptorSet* GetUniformDescriptorSet(VulkanUniformBlock* block);
 
     Ref<VulkanDescriptorPool> m_samplerDescriptorPool;
     Ref<VulkanDescriptorSetLayout> m_samplerSetLayout;
@@ -55,14 +128,49 @@ private:
     Ref<VulkanPipelineLayout> m_pipelineLayout;
     Ref<VulkanDescriptorPool> m_descriptorPool;
     Ref<VulkanDescriptorSetLayout> m_frameDescriptorSetLayout;
-    std::vector<Ref<VulkanDescriptorSet>> m_frameDescriptorSets;
     Ref<VulkanDescriptorSetLayout> m_meshDescriptorSetLayout;
+    Ref<VulkanDescriptorSet> m_emptyMaterialDescriptorSet;
     std::string m_shaderSourceDir;
     std::map<std::string, Ref<VulkanGraphicsPipeline>> m_solidWireframePipelines;
 
     std::vector<VkViewport> m_viewports;
     std::vector<VkRect2D> m_scissors;
 
+    std::vector<uint32_t> m_visibleInstances;
+    bool m_lodEnabled = true;
+    float m_lodErrorThreshold = 1.0f;
+    bool m_meshletCullingEnabled = true;
+
+    static constexpr size_t MinDrawsPerChunk = 256;
+    uint32_t m_recordingThreadCount = 1;
+    // The command pools of a frame (per frame-lag slot of the window, reset when it is reused): the first one
+    // for BeginSecondaryCommandBuffer(), then one per recording chunk, used by a single thread at a time.
+    struct FrameCommandPool
+    {
+        Ref<VulkanCommandPool> commandPool;
+        std::vector<Ref<VulkanCommandBuffer>> commandBuffers;
+        size_t usedCount = 0;
+    };
+    std::vector<std::vector<FrameCommandPool>> m_frameCommandPools;
+    VulkanCommandBuffer* BeginSecondary(FrameCommandPool& commandPool);
+    std::vector<std::vector<uint32_t>> m_chunkMeshlets; // the visible meshlets, per recording chunk
+    std::vector<std::vector<uint8_t>> m_chunkUniforms; // the MeshUniforms of the draws, per recording chunk
+
+    // Draw sort keys, from the most significant bits: pipeline, material (its descriptor set), mesh (its geometry),
+    // then the depth of the instance (front to back).
+    static constexpr uint64_t SortKeyDepthMask = (1ull << 20) - 1;
+    static constexpr uint64_t SortKeyMeshShift = 20;
+    static constexpr uint64_t SortKeyMeshMask = (1ull << 16) - 1;
+    static constexpr uint64_t SortKeyMaterialShift = 36;
+    static constexpr uint64_t SortKeyMaterialMask = (1ull << 16) - 1;
+    static constexpr uint64_t SortKeyPipelineShift = 52;
+    static constexpr uint64_t SortKeyPipelineMask = (1ull << 12) - 1;
+    std::unordered_map<const VulkanPipeline*, uint32_t> m_pipelineSortIds;
+    std::vector<uint64_t> m_drawSortKeys; // of m_visibleInstances
+    std::vector<uint64_t> m_sortTempKeys;
+    std::vector<uint32_t> m_sortTempValues;
+    Stats m_stats = {};
+
 }; // class VulkanRenderer
 
 #endif // VULKAN_RENDERER_H
\ No newline at end of file
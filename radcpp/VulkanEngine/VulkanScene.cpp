@@ -1,4 +1,9 @@
 #include "VulkanScene.h"
+#include "radcpp/Common/BatchMath.h"
+#include "radcpp/Common/BinaryStream.h"
+#include "radcpp/Common/Hash.h"
+#include "radcpp/Common/MeshProcessing.h"
+#include "radcpp/Common/Parallel.h"
 
 #include "assimp/scene.h"
 #include "assimp/cimport.h"
@@ -34,9 +39,20 @@ glm::mat4 ToMat4(const aiMatrix4x4& matrix)
     );
 }
 
-VulkanScene::VulkanScene(Ref<VulkanDevice> device) :
-    m_device(device)
+VulkanScene::VulkanScene(Ref<VulkanDevice> device, Ref<VulkanTextureCache> textureCache,
+    Ref<VulkanGeometryArena> geometryArena) :
+    m_device(device),
+    m_textureCache(textureCache),
+    m_geometryArena(geometryArena)
 {
+    if (!m_textureCache)
+    {
+        m_textureCache = MakeRefCounted<VulkanTextureCache>();
+    }
+    if (!m_geometryArena)
+    {
+        m_geometryArena = MakeRefCounted<VulkanGeometryArena>(m_device);
+    }
     m_rootNode = MakeRefCounted<VulkanSceneNode>(nullptr, "Root");
     m_camera = MakeRefCounted<VulkanCamera>();
 }
@@ -45,6 +61,29 @@ VulkanScene::~VulkanScene()
 {
 }
 
+// The cooked scene cache (<source file>.radscene) holds the result of an import, with the meshes in the layout
+// of their GPU buffers, so that loading the asset again skips assimp and the mesh processing:
+// the vertex, index and meshlet blobs are copied from the mapped file straight into the staging buffers.
+// Layout: the header, the materials, lights and nodes, the mesh records, and the table of the mesh record offsets;
+// arrays are 16-byte aligned (BinaryWriter). The cache is rewritten when the key does not match:
+// the content hash of the source file, the import flags, the vertex format and the version.
+// External files of the source (glTF buffers, OBJ materials) are not hashed.
+struct VulkanSceneCacheHeader
+{
+    char magic[8];
+    // Increase when the cooked data or the import that produces it changes.
+    uint32_t version;
+    uint32_t importFlags;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint32_t vertexFormat;
+    uint32_t meshCount;
+    uint64_t meshTableOffset;
+};
+
+static constexpr char VulkanSceneCacheMagic[8] = { 'R', 'A', 'D', 'S', 'C', 'E', 'N', 'E' };
+static constexpr uint32_t VulkanSceneCacheVersion = 1;
+
 class VulkanAsset : public RefCounted<VulkanAsset>
 {
 public:
@@ -57,6 +96,10 @@ public:
     std::vector<VulkanLight> m_lights;
     Ref<VulkanSceneNode> m_rootNode;
     std::map<Path, Ref<VulkanImage>> m_images;
+    std::map<Path, Ref<VulkanStreamedImage>> m_streamedImages; // instead of m_images if the scene streams textures
+    // The textures of the materials, and the distinct image files they refer to, loaded by InitResources.
+    std::vector<Ref<VulkanTexture>> m_textures;
+    std::vector<Path> m_imagePaths;
 
     VulkanAsset(VulkanScene* scene) :
         m_scene(scene)
@@ -80,6 +123,21 @@ public:
             aiProcessPreset_TargetRealtime_Fast |
             aiProcess_FlipUVs |
             aiProcess_GenBoundingBoxes;
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        Path cachePath = filePath;
+        cachePath += ".radscene";
+        VulkanSceneCacheHeader cacheKey = {};
+        const bool useCache = m_scene->m_useSceneCache &&
+            GetCacheKey(filePath, static_cast<uint32_t>(processFlags), cacheKey);
+        if (useCache && LoadCache(cachePath, cacheKey))
+        {
+            auto endTime = std::chrono::high_resolution_clock::now();
+            LogPrint("Vulkan", LogLevel::Info, "Loaded '%s' from the cooked cache in %.2f ms",
+                m_fileName.c_str(), std::chrono::duration<double, std::milli>(endTime - startTime).count());
+            return true;
+        }
+
         m_asset = aiImportFile((const char*)filePath.u8string().c_str(),
             processFlags);
         if (!m_asset)
@@ -103,9 +161,22 @@ public:
         {
             const aiMesh* meshData = m_asset->mMeshes[i];
             m_meshes[i] = MakeRefCounted<VulkanMesh>(m_scene, meshData->mName.C_Str());
-            InitMesh(m_meshes[i].get(), meshData);
         }
 
+        std::vector<MeshBuildData> buildData(m_meshes.size());
+        InitResources(
+            [&](size_t i)
+            {
+                BuildMesh(m_meshes[i].get(), m_asset->mMeshes[i], buildData[i]);
+                OptimizeMesh(m_meshes[i].get(), buildData[i]);
+                BuildMeshLODs(m_meshes[i].get(), buildData[i]);
+                PackIndices(m_meshes[i].get(), buildData[i]);
+                BuildMeshMeshlets(m_meshes[i].get(), buildData[i]);
+                return buildData[i].GetUploadData();
+            });
+        LogMeshStatistics(buildData);
+        BuildMeshBVHs();
+
         m_lights.resize(m_asset->mNumLights);
         for (uint32_t i = 0; i < m_asset->mNumLights; i++)
         {
@@ -143,88 +214,401 @@ public:
 
         m_rootNode->m_name = m_asset->mRootNode->mName.C_Str();
         InitNodes(m_rootNode.get(), m_asset->mRootNode);
+
+        auto importEndTime = std::chrono::high_resolution_clock::now();
+        LogPrint("Vulkan", LogLevel::Info, "Imported '%s' in %.2f ms",
+            m_fileName.c_str(), std::chrono::duration<double, std::milli>(importEndTime - startTime).count());
+        if (useCache)
+        {
+            if (SaveCache(cachePath, cacheKey, buildData))
+            {
+                auto endTime = std::chrono::high_resolution_clock::now();
+                LogPrint("Vulkan", LogLevel::Info, "Cooked '%s' into '%s' in %.2f ms",
+                    m_fileName.c_str(), (const char*)cachePath.u8string().c_str(),
+                    std::chrono::duration<double, std::milli>(endTime - importEndTime).count());
+            }
+            else
+            {
+                LogPrint("Vulkan", LogLevel::Warn, "Failed to write the cooked cache '%s'",
+                    (const char*)cachePath.u8string().c_str());
+            }
+        }
         return true;
     }
 
-    bool InitMesh(VulkanMesh* mesh, const aiMesh* meshData)
+    // The GPU data of a mesh: in its MeshBuildData after an import, or in place in the mapped cooked cache.
+    struct MeshUploadData
     {
-        mesh->m_vertexStride = 0;
-        if (meshData->HasPositions())
+        ArrayRef<uint8_t> vertices;
+        ArrayRef<uint8_t> indexData;
+        ArrayRef<uint32_t> meshletVertices;
+        ArrayRef<uint32_t> meshletTriangles;
+    };
+
+    // CPU side data of a mesh between the import stages.
+    struct MeshBuildData
+    {
+        std::vector<uint8_t> vertices; // interleaved, m_vertexStride bytes each
+        std::vector<uint32_t> lodIndices; // of m_lods[1...], concatenated
+        std::vector<uint8_t> indexData; // of all LODs, in m_indexType
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint32_t> meshletTriangles;
+        uint32_t importedVertexCount = 0;
+        VertexCacheStatistics cacheStatsBefore = {};
+        VertexCacheStatistics cacheStatsAfter = {};
+
+        MeshUploadData GetUploadData() const
+        {
+            return { vertices, indexData, meshletVertices, meshletTriangles };
+        }
+    };
+
+    // Run the CPU stages of the meshes and the images (decode, mipmaps) together on the thread pool,
+    // then create the GPU resources and upload them in batches. buildMesh(i) runs the stages of mesh i
+    // (vertex interleaving, optimization, LODs, meshlets, or reading the cooked cache),
+    // and returns its data to upload, which must stay valid until InitResources returns.
+    void InitResources(const std::function<MeshUploadData(size_t)>& buildMesh)
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        // Key the image files by content; only the images not in the texture cache are decoded,
+        // once per content in this import.
+        VulkanTextureCache* textureCache = m_scene->m_textureCache.get();
+        VulkanTextureStreamer* textureStreamer = m_scene->m_textureStreamer.get();
+        const uint32_t imageOptions = textureStreamer ?
+            (VulkanTextureCache::OptionMipmaps | VulkanTextureCache::OptionStreamed) : VulkanTextureCache::OptionMipmaps;
+        const size_t imageCount = m_imagePaths.size();
+        std::vector<VulkanTextureCache::Key> imageKeys(imageCount);
+        std::vector<uint8_t> imageKeyed(imageCount, 0);
+        ParallelFor(0, imageCount, 1,
+            [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    imageKeyed[i] = textureCache->GetKey(m_imagePaths[i], imageOptions, imageKeys[i]);
+                }
+            });
+        std::vector<size_t> decodeIndices;
+        std::unordered_map<VulkanTextureCache::Key, size_t, VulkanTextureCache::KeyHasher> decodeSlots;
+        std::vector<size_t> imageDecodeSlots(imageCount, SIZE_MAX);
+        size_t cachedImageCount = 0;
+        for (size_t i = 0; i < imageCount; ++i)
+        {
+            if (!imageKeyed[i])
+            {
+                continue;
+            }
+            auto slot = decodeSlots.find(imageKeys[i]);
+            if (slot != decodeSlots.end())
+            {
+                imageDecodeSlots[i] = slot->second;
+            }
+            else if (textureStreamer && FindStreamedImage(m_imagePaths[i], imageKeys[i]))
+            {
+                ++cachedImageCount;
+            }
+            else if (!textureStreamer && FindImage(m_imagePaths[i], imageKeys[i]))
+            {
+                ++cachedImageCount;
+            }
+            else
+            {
+                imageDecodeSlots[i] = decodeIndices.size();
+                decodeSlots[imageKeys[i]] = decodeIndices.size();
+                decodeIndices.push_back(i);
+            }
+        }
+
+        std::vector<MeshUploadData> uploadData(m_meshes.size());
+        std::vector<VulkanImageData> imageData(decodeIndices.size());
+        std::vector<uint8_t> imageLoaded(decodeIndices.size(), 0);
+        // The images first, as decoding is usually the longest task.
+        const size_t decodeCount = decodeIndices.size();
+        ParallelFor(0, decodeCount + m_meshes.size(), 1,
+            [&](size_t begin, size_t end)
+            {
+                for (size_t task = begin; task < end; ++task)
+                {
+                    if (task < decodeCount)
+                    {
+                        imageLoaded[task] = VulkanImage::LoadImage2DFromFile(
+                            m_imagePaths[decodeIndices[task]], true, imageData[task]);
+                        continue;
+                    }
+                    const size_t i = task - decodeCount;
+                    uploadData[i] = buildMesh(i);
+                }
+            });
+        auto buildEndTime = std::chrono::high_resolution_clock::now();
+
+        // The data is copied to the staging ring of the device as it is added, and uploaded in batches
+        // submitted while the next ones are copied.
+        VulkanUploadContext* uploadContext = m_scene->m_device->GetUploadContext();
+        const VulkanUploadContext::Stats uploadStatsBefore = uploadContext->GetStats();
+        for (size_t i = 0; i < m_meshes.size(); ++i)
         {
-            mesh->m_vertexStride += sizeof(glm::vec3);
-            mesh->m_hasPosition = true;
+            UploadMesh(m_meshes[i].get(), uploadData[i]);
         }
-        if (meshData->HasNormals())
+        std::vector<Ref<VulkanImage>> decodedImages(decodeCount);
+        std::vector<Ref<VulkanStreamedImage>> decodedStreamedImages(decodeCount);
+        for (size_t slot = 0; slot < decodeCount; ++slot)
         {
-            mesh->m_vertexStride += sizeof(glm::vec3);
-            mesh->m_hasNormal = true;
+            if (!imageLoaded[slot])
+            {
+                continue;
+            }
+            const VkDeviceSize dataSize = imageData[slot].data.size();
+            if (textureStreamer)
+            {
+                // Upload the mip tail only; the streamer owns the data from now on.
+                Ref<VulkanStreamedImage> image = textureStreamer->Create(std::move(imageData[slot]));
+                uploadContext->UploadImage2D(image->GetImage(), image->GetMipChainData(image->GetResidentMip()),
+                    image->GetMipChainSize(image->GetResidentMip()));
+                textureCache->Add(imageKeys[decodeIndices[slot]], image, dataSize);
+                decodedStreamedImages[slot] = std::move(image);
+            }
+            else
+            {
+                decodedImages[slot] = VulkanImage::CreateImage2D(m_scene->m_device.get(), imageData[slot]);
+                uploadContext->UploadImage2D(decodedImages[slot].get(), imageData[slot].data.data(), dataSize);
+                textureCache->Add(imageKeys[decodeIndices[slot]], decodedImages[slot], dataSize);
+            }
         }
-        if (meshData->HasTangentsAndBitangents())
+        for (size_t i = 0; i < imageCount; ++i)
         {
-            mesh->m_vertexStride += sizeof(glm::vec4);
-            mesh->m_hasTangent = true;
+            if (imageDecodeSlots[i] != SIZE_MAX)
+            {
+                m_images[m_imagePaths[i]] = decodedImages[imageDecodeSlots[i]];
+                m_streamedImages[m_imagePaths[i]] = decodedStreamedImages[imageDecodeSlots[i]];
+            }
+            if (!m_images[m_imagePaths[i]] && !m_streamedImages[m_imagePaths[i]])
+            {
+                LogPrint("Vulkan", LogLevel::Warn, "Failed to load image '%s'",
+                    (const char*)m_imagePaths[i].u8string().c_str());
+            }
         }
-        uint32_t numUVChannels = meshData->GetNumUVChannels();
-        if (numUVChannels > 0)
+        for (const Ref<VulkanTexture>& texture : m_textures)
         {
-            mesh->m_vertexStride += numUVChannels * sizeof(glm::vec2);
-            mesh->m_hasUV = true;
-            mesh->m_numUVChannels = numUVChannels;
+            texture->streamedImage = m_streamedImages[texture->filePath];
+            texture->image = texture->streamedImage ? texture->streamedImage->GetImage() : m_images[texture->filePath];
         }
-        if (uint32_t numColorChannels = meshData->GetNumColorChannels())
+        // Not waited for: the frames are submitted after the uploads.
+        uploadContext->Flush();
+        const VulkanUploadContext::Stats uploadStats = uploadContext->GetStats();
+        const VkDeviceSize uploadSize = uploadStats.uploadedSize - uploadStatsBefore.uploadedSize;
+        const uint32_t submitCount = static_cast<uint32_t>(uploadStats.submitCount - uploadStatsBefore.submitCount);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        LogPrint("Vulkan", LogLevel::Info, "Resources of '%s': %zu meshes and %zu images built in %.2f ms "
+            "on %zu threads, %.2f MB uploaded in %u submissions in %.2f ms",
+            m_fileName.c_str(), m_meshes.size(), decodeCount,
+            std::chrono::duration<double, std::milli>(buildEndTime - startTime).count(),
+            GetGlobalThreadPool()->GetThreadCount(), uploadSize / (1024.0 * 1024.0), submitCount,
+            std::chrono::duration<double, std::milli>(endTime - buildEndTime).count());
+        if (imageCount > 0)
         {
-            mesh->m_vertexStride += sizeof(glm::vec4);
-            mesh->m_hasColor = true;
+            const VulkanTextureCache::Stats cacheStats = textureCache->GetStats();
+            LogPrint("Vulkan", LogLevel::Info, "Images of '%s': %zu files, %zu in the texture cache, %zu decoded; "
+                "texture cache: %llu hits, %llu misses, %llu evictions, %zu images, %.2f MB, %.2f MB reused",
+                m_fileName.c_str(), imageCount, cachedImageCount, decodeCount,
+                cacheStats.hitCount, cacheStats.missCount, cacheStats.evictionCount, cacheStats.entryCount,
+                cacheStats.memoryUsage / (1024.0 * 1024.0), cacheStats.reusedMemorySize / (1024.0 * 1024.0));
+        }
+    }
+
+    bool FindImage(const Path& filePath, const VulkanTextureCache::Key& key)
+    {
+        m_images[filePath] = m_scene->m_textureCache->Find(key);
+        return bool(m_images[filePath]);
+    }
+
+    bool FindStreamedImage(const Path& filePath, const VulkanTextureCache::Key& key)
+    {
+        m_streamedImages[filePath] = m_scene->m_textureCache->FindStreamed(key);
+        return bool(m_streamedImages[filePath]);
+    }
+
+    void LogMeshStatistics(const std::vector<MeshBuildData>& buildData)
+    {
+        size_t importedVertexCount = 0;
+        size_t vertexCount = 0;
+        size_t triangleCount = 0;
+        size_t transformCountBefore = 0;
+        size_t transformCountAfter = 0;
+        size_t lodCount = 0;
+        size_t lodTriangleCount = 0;
+        size_t vertexDataSize = 0;
+        size_t floatVertexDataSize = 0;
+        size_t indexDataSize = 0;
+        size_t uint16MeshCount = 0;
+        size_t meshletCount = 0;
+        size_t meshletVertexCount = 0;
+        for (size_t i = 0; i < m_meshes.size(); ++i)
+        {
+            meshletCount += m_meshes[i]->m_meshlets.size();
+            meshletVertexCount += buildData[i].meshletVertices.size();
+            indexDataSize += buildData[i].indexData.size();
+            uint16MeshCount += (m_meshes[i]->m_indexType == VK_INDEX_TYPE_UINT16) ? 1 : 0;
+            vertexDataSize += size_t(m_meshes[i]->m_vertexCount) * m_meshes[i]->m_vertexStride;
+            floatVertexDataSize += size_t(m_meshes[i]->m_vertexCount) *
+                m_meshes[i]->GetVertexStride(VulkanVertexFormat::Float);
+            lodCount += m_meshes[i]->m_lods.size() - 1;
+            lodTriangleCount += buildData[i].lodIndices.size() / 3;
+            importedVertexCount += buildData[i].importedVertexCount;
+            vertexCount += m_meshes[i]->m_vertexCount;
+            triangleCount += m_meshes[i]->m_indices.size() / 3;
+            transformCountBefore += buildData[i].cacheStatsBefore.vertexTransformCount;
+            transformCountAfter += buildData[i].cacheStatsAfter.vertexTransformCount;
+        }
+        if (triangleCount > 0)
+        {
+            LogPrint("Vulkan", LogLevel::Info, "Mesh optimization of '%s': %zu -> %zu vertices, "
+                "ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+                m_fileName.c_str(), importedVertexCount, vertexCount,
+                double(transformCountBefore) / triangleCount, double(transformCountAfter) / triangleCount,
+                double(transformCountBefore) / importedVertexCount, double(transformCountAfter) / vertexCount);
+            LogPrint("Vulkan", LogLevel::Info, "Mesh LODs of '%s': %zu LODs, %zu triangles (%.1f%% of the full detail)",
+                m_fileName.c_str(), lodCount, lodTriangleCount, 100.0 * double(lodTriangleCount) / triangleCount);
+            // Vertex fetch bandwidth scales with the vertex data size.
+            LogPrint("Vulkan", LogLevel::Info, "Vertex data of '%s': %.2f MB (%.2f MB with float attributes, %.1f%% saved)",
+                m_fileName.c_str(), vertexDataSize / (1024.0 * 1024.0), floatVertexDataSize / (1024.0 * 1024.0),
+                (floatVertexDataSize > 0) ? (100.0 * (1.0 - double(vertexDataSize) / floatVertexDataSize)) : 0.0);
+            const size_t uint32IndexDataSize = (triangleCount * 3 + lodTriangleCount * 3) * sizeof(uint32_t);
+            LogPrint("Vulkan", LogLevel::Info, "Index data of '%s': %.2f MB (%.2f MB with 32-bit indices), "
+                "%zu of %zu meshes with 16-bit indices",
+                m_fileName.c_str(), indexDataSize / (1024.0 * 1024.0), uint32IndexDataSize / (1024.0 * 1024.0),
+                uint16MeshCount, m_meshes.size());
+            if (meshletCount > 0)
+            {
+                LogPrint("Vulkan", LogLevel::Info, "Meshlets of '%s': %zu, %.1f vertices and %.1f triangles on average",
+                    m_fileName.c_str(), meshletCount, double(meshletVertexCount) / meshletCount,
+                    double(triangleCount) / meshletCount);
+            }
         }
-        mesh->m_vertexBufferSize = VkDeviceSize(meshData->mNumVertices) * VkDeviceSize(mesh->m_vertexStride);
-        mesh->m_indexBufferSize = VkDeviceSize(meshData->mNumFaces) * 3 * sizeof(uint32_t);
+    }
 
-        mesh->m_vertexBuffer = m_scene->m_device->CreateVertexBuffer(mesh->m_vertexBufferSize);
-        mesh->m_indexBuffer = m_scene->m_device->CreateIndexBuffer(mesh->m_indexBufferSize);
+    template<typename T>
+    static void WriteVertexAttribute(uint8_t*& pVertex, const T& value)
+    {
+        memcpy(pVertex, &value, sizeof(T));
+        pVertex += sizeof(T);
+    }
 
-        std::vector<uint8_t> vertices(mesh->m_vertexBufferSize);
+    void BuildMesh(VulkanMesh* mesh, const aiMesh* meshData, MeshBuildData& buildData)
+    {
+        mesh->m_vertexFormat = m_scene->m_vertexFormat;
+        mesh->m_hasPosition = meshData->HasPositions();
+        mesh->m_hasNormal = meshData->HasNormals();
+        // The bitangent is rebuilt from the normal and the tangent.
+        mesh->m_hasTangent = meshData->HasNormals() && meshData->HasTangentsAndBitangents();
+        mesh->m_numUVChannels = meshData->GetNumUVChannels();
+        mesh->m_hasUV = (mesh->m_numUVChannels > 0);
+        mesh->m_hasColor = (meshData->GetNumColorChannels() > 0);
+        mesh->m_vertexStride = mesh->GetVertexStride(mesh->m_vertexFormat);
+        mesh->m_vertexCount = meshData->mNumVertices;
+        buildData.importedVertexCount = meshData->mNumVertices;
+
+        mesh->m_material = m_materials[meshData->mMaterialIndex];
+        mesh->m_aabb.m_minCorner = ToVec3(meshData->mAABB.mMin);
+        mesh->m_aabb.m_maxCorner = ToVec3(meshData->mAABB.mMax);
+        // Compact positions are quantized relative to the bounding box.
+        mesh->m_positionOffset = mesh->m_aabb.m_minCorner;
+        mesh->m_positionScale = mesh->m_aabb.Diagonal();
+        const glm::vec3 positionQuantizeScale = glm::vec3(
+            (mesh->m_positionScale.x > 0.0f) ? (1.0f / mesh->m_positionScale.x) : 0.0f,
+            (mesh->m_positionScale.y > 0.0f) ? (1.0f / mesh->m_positionScale.y) : 0.0f,
+            (mesh->m_positionScale.z > 0.0f) ? (1.0f / mesh->m_positionScale.z) : 0.0f);
+
+        if (meshData->HasPositions())
+        {
+            mesh->m_positions.resize(meshData->mNumVertices);
+            for (uint32_t vertexIndex = 0; vertexIndex < meshData->mNumVertices; vertexIndex++)
+            {
+                mesh->m_positions[vertexIndex] = ToVec3(meshData->mVertices[vertexIndex]);
+            }
+        }
+
+        // The attributes are in the order of their shader locations: position, normal, tangent, color, UVs.
+        const bool compact = (mesh->m_vertexFormat == VulkanVertexFormat::Compact);
+        std::vector<uint8_t>& vertices = buildData.vertices;
+        vertices.resize(size_t(meshData->mNumVertices) * mesh->m_vertexStride);
         uint8_t* pVertex = vertices.data();
         for (uint32_t vertexIndex = 0; vertexIndex < meshData->mNumVertices; vertexIndex++)
         {
-            if (meshData->HasPositions())
+            if (mesh->m_hasPosition)
             {
-                *reinterpret_cast<glm::vec3*>(pVertex) = ToVec3(meshData->mVertices[vertexIndex]);
-                pVertex += sizeof(glm::vec3);
+                const glm::vec3& position = mesh->m_positions[vertexIndex];
+                if (compact)
+                {
+                    glm::vec3 t = (position - mesh->m_positionOffset) * positionQuantizeScale;
+                    WriteVertexAttribute(pVertex, glm::packUnorm4x16(glm::vec4(t, 0.0f)));
+                }
+                else
+                {
+                    WriteVertexAttribute(pVertex, position);
+                }
             }
-            if (meshData->HasNormals())
+            glm::vec3 normal = {};
+            if (mesh->m_hasNormal)
             {
-                glm::vec3 normal = ToVec3(meshData->mNormals[vertexIndex]);
-                *reinterpret_cast<glm::vec3*>(pVertex) = normal;
-                pVertex += sizeof(glm::vec3);
-
-                if (meshData->HasTangentsAndBitangents())
+                normal = ToVec3(meshData->mNormals[vertexIndex]);
+                if (compact)
                 {
-                    glm::vec3 tangent = ToVec3(meshData->mTangents[vertexIndex]);
-                    glm::vec3 bitangent = ToVec3(meshData->mBitangents[vertexIndex]);
-                    float handness = 1.0f;
-                    if (glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f)
-                    {
-                        handness = -1.0f;
-                    }
-                    *reinterpret_cast<glm::vec4*>(pVertex) = glm::vec4(tangent, handness);
-                    pVertex += sizeof(glm::vec4);
+                    WriteVertexAttribute(pVertex, glm::packSnorm2x16(EncodeOctahedral(normal)));
+                }
+                else
+                {
+                    WriteVertexAttribute(pVertex, normal);
                 }
             }
-            if (uint32_t numUVChannels = meshData->GetNumUVChannels())
+            if (mesh->m_hasTangent)
             {
-                for (uint32_t channelIndex = 0; channelIndex < numUVChannels; channelIndex++)
+                glm::vec3 tangent = ToVec3(meshData->mTangents[vertexIndex]);
+                glm::vec3 bitangent = ToVec3(meshData->mBitangents[vertexIndex]);
+                float handness = 1.0f;
+                if (glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f)
                 {
-                    *reinterpret_cast<glm::vec2*>(pVertex) = glm::vec2(
-                        meshData->mTextureCoords[channelIndex][vertexIndex][0],
-                        meshData->mTextureCoords[channelIndex][vertexIndex][1]
-                    );
-                    pVertex += sizeof(glm::vec2);
+                    handness = -1.0f;
+                }
+                if (compact)
+                {
+                    // Octahedral x in 16 bits, y in 15 bits, and the handness in the top bit.
+                    glm::vec2 e = EncodeOctahedral(tangent) * 0.5f + 0.5f;
+                    uint32_t x = uint32_t(std::round(glm::clamp(e.x, 0.0f, 1.0f) * 65535.0f));
+                    uint32_t y = uint32_t(std::round(glm::clamp(e.y, 0.0f, 1.0f) * 32767.0f));
+                    uint32_t sign = (handness < 0.0f) ? 0x8000u : 0u;
+                    WriteVertexAttribute(pVertex, x | ((y | sign) << 16));
+                }
+                else
+                {
+                    WriteVertexAttribute(pVertex, glm::vec4(tangent, handness));
                 }
             }
-            if (uint32_t numColorChannel = meshData->GetNumColorChannels())
+            if (mesh->m_hasColor)
             {
-                *reinterpret_cast<glm::vec4*>(pVertex) = ToVec4(meshData->mColors[0][vertexIndex]);
-                pVertex += sizeof(glm::vec4);
+                glm::vec4 color = ToVec4(meshData->mColors[0][vertexIndex]);
+                if (compact)
+                {
+                    WriteVertexAttribute(pVertex, glm::packUnorm4x8(color));
+                }
+                else
+                {
+                    WriteVertexAttribute(pVertex, color);
+                }
+            }
+            for (uint32_t channelIndex = 0; channelIndex < mesh->m_numUVChannels; channelIndex++)
+            {
+                glm::vec2 uv = glm::vec2(
+                    meshData->mTextureCoords[channelIndex][vertexIndex][0],
+                    meshData->mTextureCoords[channelIndex][vertexIndex][1]
+                );
+                if (compact)
+                {
+                    // Half floats, since the UVs may be out of [0, 1] for tiling.
+                    WriteVertexAttribute(pVertex, glm::packHalf2x16(uv));
+                }
+                else
+                {
+                    WriteVertexAttribute(pVertex, uv);
+                }
             }
         }
 
@@ -236,16 +620,240 @@ public:
             mesh->m_indices.push_back(meshData->mFaces[faceIndex].mIndices[1]);
             mesh->m_indices.push_back(meshData->mFaces[faceIndex].mIndices[2]);
         }
+    }
 
-        mesh->m_vertexBuffer->Write(vertices.data(), mesh->m_vertexBufferOffset, mesh->m_vertexBufferSize);
-        mesh->m_indexBuffer->Write(mesh->m_indices.data(), mesh->m_indexBufferOffset, mesh->m_indexBufferSize);
+    // Merge duplicated vertices, reorder the triangles for the vertex cache and overdraw,
+    // then reorder the vertices for fetch locality.
+    static void OptimizeMesh(VulkanMesh* mesh, MeshBuildData& buildData)
+    {
+        std::vector<uint32_t>& indices = mesh->m_indices;
+        buildData.cacheStatsBefore = AnalyzeVertexCache(indices.data(), indices.size(), mesh->m_vertexCount);
+        if (indices.empty() || !mesh->m_hasPosition)
+        {
+            buildData.cacheStatsAfter = buildData.cacheStatsBefore;
+            return;
+        }
 
-        mesh->m_material = m_materials[meshData->mMaterialIndex];
-        mesh->m_aabb.m_minCorner = ToVec3(meshData->mAABB.mMin);
-        mesh->m_aabb.m_maxCorner = ToVec3(meshData->mAABB.mMax);
+        std::vector<uint32_t> remap(mesh->m_vertexCount);
+        size_t vertexCount = GenerateVertexRemap(remap.data(),
+            buildData.vertices.data(), mesh->m_vertexCount, mesh->m_vertexStride);
+        RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+        RemapVertices(mesh, buildData, remap, vertexCount);
+
+        std::vector<uint32_t> reordered(indices.size());
+        OptimizeVertexCache(reordered.data(), indices.data(), indices.size(), mesh->m_vertexCount);
+        OptimizeOverdraw(indices.data(), reordered.data(), indices.size(),
+            mesh->m_positions.data(), mesh->m_vertexCount);
+
+        vertexCount = GenerateVertexFetchRemap(remap.data(), indices.data(), indices.size(), mesh->m_vertexCount);
+        RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+        RemapVertices(mesh, buildData, remap, vertexCount);
+
+        buildData.cacheStatsAfter = AnalyzeVertexCache(indices.data(), indices.size(), mesh->m_vertexCount);
+    }
+
+    // Build the LOD chain by simplifying the full detail, halving the triangle count at each level.
+    static void BuildMeshLODs(VulkanMesh* mesh, MeshBuildData& buildData)
+    {
+        constexpr size_t MaxLODCount = 8;
+        constexpr size_t MinLODTriangleCount = 64;
+
+        const std::vector<uint32_t>& indices = mesh->m_indices;
+        mesh->m_lods.clear();
+        mesh->m_lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+        if (!mesh->m_hasPosition)
+        {
+            return;
+        }
+
+        std::vector<uint32_t> simplified(indices.size());
+        std::vector<uint32_t> optimized(indices.size());
+        size_t targetIndexCount = indices.size();
+        while (mesh->m_lods.size() < MaxLODCount)
+        {
+            targetIndexCount = targetIndexCount / 6 * 3;
+            if (targetIndexCount < MinLODTriangleCount * 3)
+            {
+                break;
+            }
+            // Simplify from the full detail each time, so that the error is measured against it.
+            float error = 0.0f;
+            size_t indexCount = SimplifyMesh(simplified.data(), indices.data(), indices.size(),
+                mesh->m_positions.data(), mesh->m_vertexCount, targetIndexCount, FLT_MAX, &error);
+            // Stop when locked borders and seams keep the simplification from making progress.
+            if (indexCount > mesh->m_lods.back().m_indexCount * 3 / 4)
+            {
+                break;
+            }
+            OptimizeVertexCache(optimized.data(), simplified.data(), indexCount, mesh->m_vertexCount);
+
+            VulkanMeshLOD lod = {};
+            lod.m_indexOffset = static_cast<uint32_t>(indices.size() + buildData.lodIndices.size());
+            lod.m_indexCount = static_cast<uint32_t>(indexCount);
+            lod.m_error = std::max(error, mesh->m_lods.back().m_error);
+            mesh->m_lods.push_back(lod);
+            buildData.lodIndices.insert(buildData.lodIndices.end(), optimized.begin(), optimized.begin() + indexCount);
+            targetIndexCount = indexCount;
+        }
+    }
+
+    // Apply the remap to the interleaved vertices and the CPU copy of the positions.
+    static void RemapVertices(VulkanMesh* mesh, MeshBuildData& buildData,
+        const std::vector<uint32_t>& remap, size_t vertexCount)
+    {
+        std::vector<uint8_t> vertices(vertexCount * mesh->m_vertexStride);
+        RemapVertexBuffer(vertices.data(), buildData.vertices.data(),
+            mesh->m_vertexCount, mesh->m_vertexStride, remap.data());
+        buildData.vertices = std::move(vertices);
+
+        std::vector<glm::vec3> positions(vertexCount);
+        RemapVertexBuffer(positions.data(), mesh->m_positions.data(),
+            mesh->m_vertexCount, sizeof(glm::vec3), remap.data());
+        mesh->m_positions = std::move(positions);
+
+        mesh->m_vertexCount = static_cast<uint32_t>(vertexCount);
+    }
+
+    // Concatenate the indices of all LODs, in 16 bits if the vertices allow.
+    static void PackIndices(VulkanMesh* mesh, MeshBuildData& buildData)
+    {
+        // 0xFFFF is left out, as it restarts primitives when primitive restart is enabled.
+        mesh->m_indexType = (mesh->m_vertexCount < 0xFFFF) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        const size_t indexCount = mesh->m_indices.size() + buildData.lodIndices.size();
+        const size_t indexSize = mesh->GetIndexSize();
+        std::vector<uint8_t>& indexData = buildData.indexData;
+        indexData.resize(indexCount * indexSize);
+        if (mesh->m_indexType == VK_INDEX_TYPE_UINT16)
+        {
+            uint16_t* pIndex = reinterpret_cast<uint16_t*>(indexData.data());
+            pIndex = std::copy(mesh->m_indices.begin(), mesh->m_indices.end(), pIndex);
+            std::copy(buildData.lodIndices.begin(), buildData.lodIndices.end(), pIndex);
+        }
+        else
+        {
+            uint32_t* pIndex = reinterpret_cast<uint32_t*>(indexData.data());
+            pIndex = std::copy(mesh->m_indices.begin(), mesh->m_indices.end(), pIndex);
+            std::copy(buildData.lodIndices.begin(), buildData.lodIndices.end(), pIndex);
+        }
+    }
+
+    // Split the full detail triangles into meshlets; as their order is kept, meshlet ranges can be drawn
+    // from the index buffer.
+    static void BuildMeshMeshlets(VulkanMesh* mesh, MeshBuildData& buildData)
+    {
+        if (!mesh->m_hasPosition || mesh->m_indices.empty())
+        {
+            return;
+        }
+        BuildMeshlets(mesh->m_meshlets, buildData.meshletVertices, buildData.meshletTriangles,
+            mesh->m_indices.data(), mesh->m_indices.size(), mesh->m_vertexCount);
+        mesh->m_meshletBounds.resize(mesh->m_meshlets.size());
+        mesh->m_meshletSpheres.Resize(mesh->m_meshlets.size());
+        for (size_t i = 0; i < mesh->m_meshlets.size(); ++i)
+        {
+            mesh->m_meshletBounds[i] = ComputeMeshletBounds(mesh->m_meshlets[i],
+                buildData.meshletVertices.data(), buildData.meshletTriangles.data(), mesh->m_positions.data());
+            mesh->m_meshletSpheres.Set(i, Sphere{ mesh->m_meshletBounds[i].center, mesh->m_meshletBounds[i].radius });
+        }
+    }
+
+    // Upload the data of an arena range, if allocated.
+    void AddUpload(const VulkanGeometryAllocation* allocation, const void* data)
+    {
+        if (allocation)
+        {
+            m_scene->m_device->GetUploadContext()->UploadBuffer(
+                allocation->GetBuffer(), allocation->GetOffset(), data, allocation->GetSize());
+        }
+    }
+
+    // Allocate the arena ranges of the mesh and upload their data.
+    bool UploadMesh(VulkanMesh* mesh, const MeshUploadData& uploadData)
+    {
+        mesh->m_vertexBufferSize = VkDeviceSize(mesh->m_vertexCount) * VkDeviceSize(mesh->m_vertexStride);
+        mesh->m_indexBufferSize = VkDeviceSize(uploadData.indexData.size());
+
+        VulkanGeometryArena* arena = m_scene->m_geometryArena.get();
+        mesh->m_vertexAllocation = arena->Allocate(mesh->m_vertexBufferSize, mesh->m_vertexStride);
+        mesh->m_indexAllocation = arena->Allocate(mesh->m_indexBufferSize, mesh->GetIndexSize());
+        AddUpload(mesh->m_vertexAllocation.get(), uploadData.vertices.data());
+        AddUpload(mesh->m_indexAllocation.get(), uploadData.indexData.data());
+
+        if (!mesh->m_meshlets.empty())
+        {
+            const VkDeviceSize storageAlignment =
+                m_scene->m_device->GetPhysicalDevice()->GetProperties().limits.minStorageBufferOffsetAlignment;
+            mesh->m_meshletAllocation = arena->Allocate(
+                mesh->m_meshlets.size() * sizeof(Meshlet), storageAlignment);
+            mesh->m_meshletBoundsAllocation = arena->Allocate(
+                mesh->m_meshletBounds.size() * sizeof(MeshletBounds), storageAlignment);
+            mesh->m_meshletVertexAllocation = arena->Allocate(
+                uploadData.meshletVertices.size() * sizeof(uint32_t), storageAlignment);
+            mesh->m_meshletTriangleAllocation = arena->Allocate(
+                uploadData.meshletTriangles.size() * sizeof(uint32_t), storageAlignment);
+            AddUpload(mesh->m_meshletAllocation.get(), mesh->m_meshlets.data());
+            AddUpload(mesh->m_meshletBoundsAllocation.get(), mesh->m_meshletBounds.data());
+            AddUpload(mesh->m_meshletVertexAllocation.get(), uploadData.meshletVertices.data());
+            AddUpload(mesh->m_meshletTriangleAllocation.get(), uploadData.meshletTriangles.data());
+        }
         return true;
     }
 
+    void BuildMeshBVHs()
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        ParallelFor(0, m_meshes.size(), 1,
+            [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    m_meshes[i]->BuildBVH();
+                }
+            });
+        auto endTime = std::chrono::high_resolution_clock::now();
+
+        size_t triangleCount = 0;
+        size_t nodeCount = 0;
+        double weightedSAHCost = 0.0;
+        for (const Ref<VulkanMesh>& mesh : m_meshes)
+        {
+            triangleCount += mesh->m_bvh.m_primIndices.size();
+            nodeCount += mesh->m_bvh.m_nodes.size();
+            weightedSAHCost += double(mesh->m_bvh.GetSAHCost()) * mesh->m_bvh.m_primIndices.size();
+        }
+        LogPrint("Vulkan", LogLevel::Info, "Mesh BVHs of '%s': %zu meshes, %zu triangles, %zu nodes, "
+            "average SAH cost %.2f, built in %.2f ms",
+            m_fileName.c_str(), m_meshes.size(), triangleCount, nodeCount,
+            (triangleCount > 0) ? (weightedSAHCost / triangleCount) : 0.0,
+            std::chrono::duration<double, std::milli>(endTime - startTime).count());
+    }
+
+    // Cooked scene cache, see VulkanSceneCacheHeader.
+    bool GetCacheKey(const Path& filePath, uint32_t importFlags, VulkanSceneCacheHeader& key);
+    bool LoadCache(const Path& cachePath, const VulkanSceneCacheHeader& key);
+    bool ReadCache(const MappedFile& cacheFile, BinaryReader& reader, const VulkanSceneCacheHeader& header);
+    bool ReadCachedMesh(BinaryReader& reader, VulkanMesh* mesh, MeshUploadData& uploadData);
+    Ref<VulkanTexture> ReadCachedTexture(BinaryReader& reader);
+    bool SaveCache(const Path& cachePath, const VulkanSceneCacheHeader& key,
+        const std::vector<MeshBuildData>& buildData);
+    void WriteCachedMesh(BinaryWriter& writer, const VulkanMesh* mesh, uint32_t materialIndex,
+        const MeshBuildData& buildData);
+    void WriteCachedTexture(BinaryWriter& writer, const VulkanTexture* texture);
+
+    // Create a texture of the image file; the image is loaded by InitResources, once per file.
+    Ref<VulkanTexture> CreateTexture(const Path& filePath)
+    {
+        Ref<VulkanTexture> texture = MakeRefCounted<VulkanTexture>();
+        texture->filePath = filePath;
+        if (m_images.find(texture->filePath) == m_images.end())
+        {
+            m_images[texture->filePath] = nullptr;
+            m_imagePaths.push_back(texture->filePath);
+        }
+        m_textures.push_back(texture);
+        return texture;
+    }
+
     Ref<VulkanTexture> CreateTexture2DFromFile(const aiMaterial* materialData, aiTextureType textureType, unsigned int index);
     bool InitMaterial(VulkanMaterial* material, const aiMaterial* materialData)
     {
@@ -292,6 +900,7 @@ bool VulkanScene::Import(const Path& filePath)
             asset->m_materials.begin(), asset->m_materials.end()
         );
         m_rootNode->AddChild(asset->m_rootNode);
+        BuildInstanceBVH();
         return true;
     }
     else
@@ -305,6 +914,187 @@ BoundingBox VulkanScene::GetBoundingBox() const
     return m_rootNode->GetBoundingBox();
 }
 
+static void FlattenNodesRecursive(VulkanSceneNode* node, uint32_t parentIndex,
+    std::vector<VulkanSceneNode*>& nodes, std::vector<uint32_t>& parents)
+{
+    node->m_hierarchyIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(node);
+    parents.push_back(parentIndex);
+    for (const Ref<VulkanSceneNode>& child : node->m_children)
+    {
+        FlattenNodesRecursive(child.get(), node->m_hierarchyIndex, nodes, parents);
+    }
+}
+
+void VulkanScene::UpdateInstances(size_t begin, size_t end)
+{
+    const size_t count = end - begin;
+    m_scratchTransforms.resize(count);
+    m_scratchNormalTransforms.resize(count);
+    m_scratchBoxes.Resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_scratchTransforms[i] = m_instances[begin + i].m_transform;
+        m_scratchBoxes.Set(i, m_instances[begin + i].m_mesh->m_aabb);
+    }
+    ComputeNormalMatrices(m_scratchTransforms.data(), m_scratchNormalTransforms.data(), count);
+    TransformBoundingBoxes(m_scratchBoxes, m_scratchTransforms.data(), m_scratchBoxes);
+    for (size_t i = 0; i < count; ++i)
+    {
+        VulkanMeshInstance& instance = m_instances[begin + i];
+        instance.m_inverseTransform = glm::inverse(instance.m_transform);
+        instance.m_normalTransform = m_scratchNormalTransforms[i];
+        instance.m_aabb = m_scratchBoxes.Get(i);
+        m_instanceBoxes.Set(begin + i, instance.m_aabb);
+    }
+}
+
+void VulkanScene::BuildInstanceBVH()
+{
+    m_nodes.clear();
+    std::vector<uint32_t> parents;
+    FlattenNodesRecursive(m_rootNode.get(), TransformHierarchy::InvalidIndex, m_nodes, parents);
+    std::vector<glm::mat4> localTransforms(m_nodes.size());
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        m_nodes[i]->m_scene = this;
+        localTransforms[i] = m_nodes[i]->m_transform;
+    }
+    m_transformHierarchy.Build(parents.data(), localTransforms.data(), m_nodes.size());
+
+    m_instances.clear();
+    m_nodeInstanceOffsets.resize(m_nodes.size() + 1);
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        VulkanSceneNode* node = m_nodes[i];
+        m_nodeInstanceOffsets[i] = static_cast<uint32_t>(m_instances.size());
+        for (const Ref<VulkanMesh>& mesh : node->m_meshes)
+        {
+            VulkanMeshInstance& instance = m_instances.emplace_back();
+            instance.m_node = node;
+            instance.m_mesh = mesh.get();
+            instance.m_transform = m_transformHierarchy.GetWorldTransform(node->m_hierarchyIndex);
+        }
+    }
+    m_nodeInstanceOffsets[m_nodes.size()] = static_cast<uint32_t>(m_instances.size());
+    m_instanceBoxes.Resize(m_instances.size());
+    UpdateInstances(0, m_instances.size());
+
+    std::vector<BoundingBox> instanceBoxes(m_instances.size());
+    for (size_t i = 0; i < m_instances.size(); ++i)
+    {
+        instanceBoxes[i] = m_instances[i].m_aabb;
+    }
+    m_instanceBVH.Build(instanceBoxes.data(), instanceBoxes.size());
+    LogPrint("Vulkan", LogLevel::Info, "Instance BVH: %zu instances, %zu nodes, depth %u, SAH cost %.2f, built in %.2f ms",
+        m_instances.size(), m_instanceBVH.m_nodes.size(), m_instanceBVH.GetDepth(),
+        m_instanceBVH.GetSAHCost(), m_instanceBVH.m_buildTime);
+}
+
+void VulkanScene::RefitInstanceBVH()
+{
+    if (m_transformHierarchy.Update() == 0)
+    {
+        return;
+    }
+    // The updated nodes are whole subtrees, whose instances are contiguous: only these are updated and refit.
+    m_movedInstances.clear();
+    for (auto [nodeBegin, nodeEnd] : m_transformHierarchy.GetUpdatedRanges())
+    {
+        for (uint32_t nodeIndex = nodeBegin; nodeIndex < nodeEnd; ++nodeIndex)
+        {
+            const glm::mat4& transform = m_transformHierarchy.GetWorldTransform(nodeIndex);
+            for (uint32_t i = m_nodeInstanceOffsets[nodeIndex]; i < m_nodeInstanceOffsets[nodeIndex + 1]; ++i)
+            {
+                m_instances[i].m_transform = transform;
+                m_movedInstances.push_back(i);
+            }
+        }
+        UpdateInstances(m_nodeInstanceOffsets[nodeBegin], m_nodeInstanceOffsets[nodeEnd]);
+    }
+    m_instanceBVH.Refit(m_instanceBoxes, m_movedInstances.data(), m_movedInstances.size());
+}
+
+// The direction is not normalized, so that t is the same in both spaces.
+static Ray TransformRay(const Ray& ray, const glm::mat4& transform)
+{
+    return Ray(
+        glm::vec3(transform * glm::vec4(ray.m_origin, 1.0f)),
+        glm::vec3(transform * glm::vec4(ray.m_direction, 0.0f)),
+        ray.m_tMin, ray.m_tMax);
+}
+
+bool VulkanScene::Intersect(const Ray& ray, VulkanSceneHit& hit) const
+{
+    Ray closestRay = ray;
+    bool hasHit = m_instanceBVH.IntersectClosest(closestRay,
+        [&](uint32_t instanceIndex, Ray& worldRay)
+        {
+            const VulkanMeshInstance& instance = m_instances[instanceIndex];
+            Ray meshRay = TransformRay(worldRay, instance.m_inverseTransform);
+            RayHit meshHit;
+            if (instance.m_mesh->IntersectClosest(meshRay, meshHit))
+            {
+                worldRay.m_tMax = meshHit.m_t;
+                hit.m_instanceIndex = instanceIndex;
+                hit.m_hit = meshHit;
+                return true;
+            }
+            return false;
+        });
+    if (hasHit)
+    {
+        hit.m_position = ray.At(hit.m_hit.m_t);
+    }
+    return hasHit;
+}
+
+bool VulkanScene::Occluded(const Ray& ray) const
+{
+    return m_instanceBVH.IntersectAny(ray,
+        [&](uint32_t instanceIndex, Ray& worldRay)
+        {
+            const VulkanMeshInstance& instance = m_instances[instanceIndex];
+            return instance.m_mesh->IntersectAny(TransformRay(worldRay, instance.m_inverseTransform));
+        });
+}
+
+void VulkanScene::Occluded(const Ray* rays, size_t rayCount, bool* occluded) const
+{
+    const size_t packetCount = (rayCount + RayPacket8::Size - 1) / RayPacket8::Size;
+    ParallelFor(0, packetCount, 16,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t packetIndex = begin; packetIndex < end; ++packetIndex)
+            {
+                const size_t first = packetIndex * RayPacket8::Size;
+                const uint32_t laneCount = static_cast<uint32_t>(std::min<size_t>(RayPacket8::Size, rayCount - first));
+                RayPacket8 packet;
+                for (uint32_t lane = 0; lane < RayPacket8::Size; ++lane)
+                {
+                    // Pad the last packet with copies of its first ray, which are masked off.
+                    packet.Set(lane, rays[first + ((lane < laneCount) ? lane : 0)]);
+                }
+                const uint32_t activeMask = (1u << laneCount) - 1;
+                uint32_t hitMask = m_instanceBVH.IntersectAny(packet, activeMask,
+                    [&](uint32_t instanceIndex, RayPacket8& worldPacket, uint32_t mask)
+                    {
+                        const VulkanMeshInstance& instance = m_instances[instanceIndex];
+                        RayPacket8 meshPacket;
+                        for (uint32_t lane = 0; lane < RayPacket8::Size; ++lane)
+                        {
+                            meshPacket.Set(lane, TransformRay(worldPacket.Get(lane), instance.m_inverseTransform));
+                        }
+                        return instance.m_mesh->IntersectAny(meshPacket, mask);
+                    });
+                for (uint32_t lane = 0; lane < laneCount; ++lane)
+                {
+                    occluded[first + lane] = (hitMask & (1u << lane)) != 0;
+                }
+            }
+        });
+}
+
 VulkanSceneNode::VulkanSceneNode(VulkanSceneNode* parent, std::string_view name) :
     m_parent(parent),
     m_name(name)
@@ -321,21 +1111,37 @@ void VulkanSceneNode::AddChild(Ref<VulkanSceneNode> childNode)
     m_children.push_back(childNode);
 }
 
-BoundingBox GetBoundingBoxRecursive(const VulkanSceneNode* node, glm::mat4 transform)
+void VulkanSceneNode::SetTransform(const glm::mat4& transform)
+{
+    m_transform = transform;
+    if (m_scene != nullptr)
+    {
+        m_scene->m_transformHierarchy.SetLocalTransform(m_hierarchyIndex, transform);
+    }
+}
+
+glm::mat4 VulkanSceneNode::GetWorldTransform() const
+{
+    if ((m_scene != nullptr) && !m_scene->m_transformHierarchy.HasDirtyNodes())
+    {
+        return m_scene->m_transformHierarchy.GetWorldTransform(m_hierarchyIndex);
+    }
+    glm::mat4 transform = m_transform;
+    for (VulkanSceneNode* parent = m_parent; parent != nullptr; parent = parent->m_parent)
+    {
+        transform = parent->m_transform * transform;
+    }
+    return transform;
+}
+
+BoundingBox GetBoundingBoxRecursive(const VulkanSceneNode* node, const glm::mat4& parentTransform)
 {
     BoundingBox nodeBox = {};
-    transform = transform * node->m_transform;
+    glm::mat4 transform = parentTransform * node->m_transform;
     for (uint32_t i = 0; i < node->m_meshes.size(); ++i)
     {
         VulkanMesh* mesh = node->m_meshes[i].get();
-        BoundingBox meshBox = {};
-        for (int i = 0; i < 8; i++)
-        {
-            glm::vec3 worldCorner = transform * glm::vec4(mesh->m_aabb.Corner(i), 1.0f);
-            meshBox.m_minCorner = glm::min(meshBox.m_minCorner, worldCorner);
-            meshBox.m_maxCorner = glm::max(meshBox.m_maxCorner, worldCorner);
-        }
-        nodeBox = Union(nodeBox, meshBox);
+        nodeBox = Union(nodeBox, Transform(mesh->m_aabb, transform));
     }
 
     for (auto& child : node->m_children)
@@ -349,15 +1155,24 @@ BoundingBox GetBoundingBoxRecursive(const VulkanSceneNode* node, glm::mat4 trans
 
 BoundingBox VulkanSceneNode::GetBoundingBox() const
 {
-    glm::mat4 transform = glm::identity<glm::mat4>();
-    VulkanSceneNode* parentNode = m_parent;
-    while (parentNode != nullptr)
+    if ((m_scene == nullptr) || m_scene->m_transformHierarchy.HasDirtyNodes())
     {
-        transform = parentNode->m_transform * transform;
-        parentNode = parentNode->m_parent;
+        glm::mat4 parentTransform = (m_parent != nullptr) ? m_parent->GetWorldTransform() : glm::identity<glm::mat4>();
+        return GetBoundingBoxRecursive(this, parentTransform);
     }
 
-    return GetBoundingBoxRecursive(this, transform);
+    // The subtree is the contiguous range of the node in the flattened hierarchy.
+    const TransformHierarchy& hierarchy = m_scene->m_transformHierarchy;
+    BoundingBox nodeBox = {};
+    for (uint32_t i = m_hierarchyIndex; i < hierarchy.GetSubtreeEnd(m_hierarchyIndex); ++i)
+    {
+        const glm::mat4& transform = hierarchy.GetWorldTransform(i);
+        for (const Ref<VulkanMesh>& mesh : m_scene->m_nodes[i]->m_meshes)
+        {
+            nodeBox = Union(nodeBox, Transform(mesh->m_aabb, transform));
+        }
+    }
+    return nodeBox;
 }
 
 VulkanMesh::VulkanMesh(VulkanScene* scene, std::string_view name) :
@@ -370,6 +1185,99 @@ VulkanMesh::~VulkanMesh()
 {
 }
 
+uint32_t VulkanMesh::GetVertexStride(VulkanVertexFormat format) const
+{
+    const bool compact = (format == VulkanVertexFormat::Compact);
+    uint32_t stride = 0;
+    if (m_hasPosition)
+    {
+        stride += compact ? 4 * sizeof(uint16_t) : sizeof(glm::vec3);
+    }
+    if (m_hasNormal)
+    {
+        stride += compact ? 2 * sizeof(uint16_t) : sizeof(glm::vec3);
+    }
+    if (m_hasTangent)
+    {
+        stride += compact ? 2 * sizeof(uint16_t) : sizeof(glm::vec4);
+    }
+    if (m_hasColor)
+    {
+        stride += compact ? 4 * sizeof(uint8_t) : sizeof(glm::vec4);
+    }
+    stride += m_numUVChannels * (compact ? 2 * sizeof(uint16_t) : sizeof(glm::vec2));
+    return stride;
+}
+
+void VulkanMesh::BuildBVH(const BVHBuildSettings& settings)
+{
+    const size_t triangleCount = m_positions.empty() ? 0 : (m_indices.size() / 3);
+    std::vector<BoundingBox> triangleBoxes(triangleCount);
+    for (size_t i = 0; i < triangleCount; ++i)
+    {
+        BoundingBox box(m_positions[m_indices[3 * i + 0]]);
+        box = Union(box, m_positions[m_indices[3 * i + 1]]);
+        box = Union(box, m_positions[m_indices[3 * i + 2]]);
+        triangleBoxes[i] = box;
+    }
+    m_bvh.Build(triangleBoxes.data(), triangleBoxes.size(), settings);
+}
+
+bool VulkanMesh::IntersectClosest(Ray& ray, RayHit& hit) const
+{
+    const WatertightRay watertightRay(ray);
+    return m_bvh.IntersectClosest(ray,
+        [&](uint32_t triangleIndex, Ray& triangleRay)
+        {
+            float t, u, v;
+            if (IntersectRayTriangleWatertight(triangleRay, watertightRay,
+                m_positions[m_indices[3 * triangleIndex + 0]],
+                m_positions[m_indices[3 * triangleIndex + 1]],
+                m_positions[m_indices[3 * triangleIndex + 2]],
+                t, u, v))
+            {
+                triangleRay.m_tMax = t;
+                hit.m_t = t;
+                hit.m_u = u;
+                hit.m_v = v;
+                hit.m_primIndex = triangleIndex;
+                return true;
+            }
+            return false;
+        });
+}
+
+bool VulkanMesh::IntersectAny(const Ray& ray) const
+{
+    const WatertightRay watertightRay(ray);
+    return m_bvh.IntersectAny(ray,
+        [&](uint32_t triangleIndex, Ray& triangleRay)
+        {
+            float t, u, v;
+            return IntersectRayTriangleWatertight(triangleRay, watertightRay,
+                m_positions[m_indices[3 * triangleIndex + 0]],
+                m_positions[m_indices[3 * triangleIndex + 1]],
+                m_positions[m_indices[3 * triangleIndex + 2]],
+                t, u, v);
+        });
+}
+
+uint32_t VulkanMesh::IntersectAny(RayPacket8& packet, uint32_t activeMask) const
+{
+    return m_bvh.IntersectAny(packet, activeMask,
+        [&](uint32_t triangleIndex, RayPacket8& trianglePacket, uint32_t mask)
+        {
+            alignas(32) float t[RayPacket8::Size];
+            alignas(32) float u[RayPacket8::Size];
+            alignas(32) float v[RayPacket8::Size];
+            return IntersectRayPacketTriangle(trianglePacket, mask,
+                m_positions[m_indices[3 * triangleIndex + 0]],
+                m_positions[m_indices[3 * triangleIndex + 1]],
+                m_positions[m_indices[3 * triangleIndex + 2]],
+                t, u, v);
+        });
+}
+
 VulkanMaterial::VulkanMaterial(VulkanScene* scene, std::string_view name) :
     m_scene(scene),
     m_name(name)
@@ -394,7 +1302,6 @@ VkSamplerAddressMode GetSamplerAddressMode(aiTextureMapMode mapMode)
 
 Ref<VulkanTexture> VulkanAsset::CreateTexture2DFromFile(const aiMaterial* materialData, aiTextureType textureType, unsigned int index)
 {
-    VulkanDevice* device = m_scene->m_device.get();
     aiString path;
     aiTextureMapping mapping;
     uint32_t uvIndex = 0;
@@ -402,29 +1309,20 @@ Ref<VulkanTexture> VulkanAsset::CreateTexture2DFromFile(const aiMaterial* materi
     aiTextureOp op;
     aiTextureMapMode mapMode[3]; // UVW
 
-    bool bGenerateMipmaps = true;
-
-    materialData->GetTexture(textureType,
+    if (materialData->GetTexture(textureType,
         index,
         &path,
         &mapping,
         &uvIndex,
         &blend,
         &op,
-        mapMode);
-
-    Ref<VulkanTexture> texture = MakeRefCounted<VulkanTexture>();
-    texture->filePath = m_baseDir / (const char8_t*)path.C_Str();
-    if (auto iter = m_images.find(texture->filePath); iter != m_images.end())
+        mapMode) != aiReturn_SUCCESS)
     {
-        texture->image = iter->second;
-    }
-    else
-    {
-        texture->image = VulkanImage::CreateImage2DFromFile(device, texture->filePath, bGenerateMipmaps);
-        m_images[texture->filePath] = texture->image;
+        return nullptr;
     }
 
+    Ref<VulkanTexture> texture = CreateTexture(m_baseDir / (const char8_t*)path.C_Str());
+
     static_assert(TextureMappingUV == aiTextureMapping_UV);
     static_assert(TextureMappingSphere == aiTextureMapping_SPHERE);
     static_assert(TextureMappingCylinder == aiTextureMapping_CYLINDER);
@@ -447,3 +1345,358 @@ Ref<VulkanTexture> VulkanAsset::CreateTexture2DFromFile(const aiMaterial* materi
 
     return texture;
 }
+
+bool VulkanAsset::GetCacheKey(const Path& filePath, uint32_t importFlags, VulkanSceneCacheHeader& key)
+{
+    MappedFile sourceFile;
+    if (!sourceFile.Open(filePath))
+    {
+        return false;
+    }
+    key = {};
+    memcpy(key.magic, VulkanSceneCacheMagic, sizeof(key.magic));
+    key.version = VulkanSceneCacheVersion;
+    key.importFlags = importFlags;
+    key.sourceHash = XXHash64(sourceFile.GetData(), sourceFile.GetSize());
+    key.sourceSize = sourceFile.GetSize();
+    key.vertexFormat = static_cast<uint32_t>(m_scene->m_vertexFormat);
+    return true;
+}
+
+bool VulkanAsset::LoadCache(const Path& cachePath, const VulkanSceneCacheHeader& key)
+{
+    // The vertex and index data is uploaded from the mapping, which stays open until ReadCache returns.
+    MappedFile cacheFile;
+    if (!cacheFile.Open(cachePath))
+    {
+        return false;
+    }
+    BinaryReader reader(cacheFile.GetData(), cacheFile.GetSize());
+    VulkanSceneCacheHeader header = {};
+    if (!reader.Read(header) ||
+        (memcmp(header.magic, key.magic, sizeof(header.magic)) != 0) ||
+        (header.version != key.version) ||
+        (header.importFlags != key.importFlags) ||
+        (header.sourceHash != key.sourceHash) ||
+        (header.sourceSize != key.sourceSize) ||
+        (header.vertexFormat != key.vertexFormat))
+    {
+        LogPrint("Vulkan", LogLevel::Info, "The cooked cache '%s' is out of date",
+            (const char*)cachePath.u8string().c_str());
+        return false;
+    }
+
+    if (!ReadCache(cacheFile, reader, header))
+    {
+        LogPrint("Vulkan", LogLevel::Warn, "The cooked cache '%s' is invalid",
+            (const char*)cachePath.u8string().c_str());
+        m_meshes.clear();
+        m_materials.clear();
+        m_lights.clear();
+        m_images.clear();
+        m_streamedImages.clear();
+        m_textures.clear();
+        m_imagePaths.clear();
+        m_rootNode->m_children.clear();
+        m_rootNode->m_meshes.clear();
+        return false;
+    }
+    return true;
+}
+
+bool VulkanAsset::ReadCache(const MappedFile& cacheFile, BinaryReader& reader, const VulkanSceneCacheHeader& header)
+{
+    const uint32_t materialCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; (i < materialCount) && reader.IsValid(); i++)
+    {
+        std::string name;
+        reader.ReadString(name);
+        Ref<VulkanMaterial> material = MakeRefCounted<VulkanMaterial>(m_scene, name);
+        reader.Read(material->m_baseColor);
+        reader.Read(material->m_opacity);
+        reader.Read(material->m_metallic);
+        reader.Read(material->m_roughness);
+        reader.Read(material->m_emissiveColor);
+        reader.Read(material->m_emissiveIntensity);
+        reader.Read(material->m_ambientColor);
+        reader.Read(material->m_ambientWeight);
+        material->m_displacementTexture = ReadCachedTexture(reader);
+        material->m_normalTexture = ReadCachedTexture(reader);
+        material->m_baseColorTexture = ReadCachedTexture(reader);
+        material->m_metallicRoughnessTexture = ReadCachedTexture(reader);
+        material->m_emissiveTexture = ReadCachedTexture(reader);
+        material->m_ambientTexture = ReadCachedTexture(reader);
+        m_materials.push_back(material);
+    }
+    reader.ReadArray(m_lights);
+
+    // The mesh records are read in parallel, each from its offset in the table.
+    const size_t nodeOffset = reader.GetOffset();
+    reader.Seek(header.meshTableOffset);
+    ArrayRef<uint64_t> meshOffsets = reader.ReadArray<uint64_t>();
+    reader.Seek(nodeOffset);
+    if (!reader.IsValid() || (meshOffsets.size() != header.meshCount))
+    {
+        return false;
+    }
+    m_meshes.resize(header.meshCount);
+    std::vector<MeshUploadData> uploadData(header.meshCount);
+    std::vector<uint8_t> meshValid(header.meshCount, 0);
+    ParallelFor(0, m_meshes.size(), 1,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                BinaryReader meshReader(cacheFile.GetData(), cacheFile.GetSize());
+                m_meshes[i] = MakeRefCounted<VulkanMesh>(m_scene, "");
+                meshValid[i] = meshReader.Seek(meshOffsets[i]) &&
+                    ReadCachedMesh(meshReader, m_meshes[i].get(), uploadData[i]);
+            }
+        });
+    if (std::find(meshValid.begin(), meshValid.end(), 0) != meshValid.end())
+    {
+        return false;
+    }
+
+    // The nodes in depth-first preorder, from m_rootNode.
+    const uint32_t nodeCount = reader.Read<uint32_t>();
+    std::vector<VulkanSceneNode*> nodes;
+    for (uint32_t i = 0; (i < nodeCount) && reader.IsValid(); i++)
+    {
+        std::string name;
+        reader.ReadString(name);
+        glm::mat4 transform = reader.Read<glm::mat4>();
+        const uint32_t parentIndex = reader.Read<uint32_t>();
+        ArrayRef<uint32_t> meshIndices = reader.ReadArray<uint32_t>();
+        VulkanSceneNode* node = m_rootNode.get();
+        if (i > 0)
+        {
+            if (parentIndex >= i)
+            {
+                return false;
+            }
+            Ref<VulkanSceneNode> child = MakeRefCounted<VulkanSceneNode>(nodes[parentIndex], name);
+            nodes[parentIndex]->AddChild(child);
+            node = child.get();
+        }
+        node->m_name = name;
+        node->m_transform = transform;
+        for (uint32_t meshIndex : meshIndices)
+        {
+            if (meshIndex >= m_meshes.size())
+            {
+                return false;
+            }
+            node->m_meshes.push_back(m_meshes[meshIndex]);
+        }
+        nodes.push_back(node);
+    }
+    if (!reader.IsValid())
+    {
+        return false;
+    }
+
+    InitResources(
+        [&](size_t i)
+        {
+            return uploadData[i];
+        });
+    BuildMeshBVHs();
+    return true;
+}
+
+bool VulkanAsset::ReadCachedMesh(BinaryReader& reader, VulkanMesh* mesh, MeshUploadData& uploadData)
+{
+    reader.ReadString(mesh->m_name);
+    const uint32_t materialIndex = reader.Read<uint32_t>();
+    mesh->m_vertexFormat = m_scene->m_vertexFormat;
+    mesh->m_hasPosition = (reader.Read<uint8_t>() != 0);
+    mesh->m_hasNormal = (reader.Read<uint8_t>() != 0);
+    mesh->m_hasTangent = (reader.Read<uint8_t>() != 0);
+    mesh->m_hasColor = (reader.Read<uint8_t>() != 0);
+    mesh->m_numUVChannels = reader.Read<uint32_t>();
+    mesh->m_hasUV = (mesh->m_numUVChannels > 0);
+    mesh->m_vertexStride = mesh->GetVertexStride(mesh->m_vertexFormat);
+    mesh->m_vertexCount = reader.Read<uint32_t>();
+    reader.Read(mesh->m_positionOffset);
+    reader.Read(mesh->m_positionScale);
+    reader.Read(mesh->m_aabb.m_minCorner);
+    reader.Read(mesh->m_aabb.m_maxCorner);
+    mesh->m_indexType = static_cast<VkIndexType>(reader.Read<uint32_t>());
+    reader.ReadArray(mesh->m_indices);
+    reader.ReadArray(mesh->m_lods);
+    reader.ReadArray(mesh->m_meshlets);
+    reader.ReadArray(mesh->m_meshletBounds);
+    reader.ReadArray(mesh->m_positions);
+    uploadData.vertices = reader.ReadArray<uint8_t>();
+    uploadData.indexData = reader.ReadArray<uint8_t>();
+    uploadData.meshletVertices = reader.ReadArray<uint32_t>();
+    uploadData.meshletTriangles = reader.ReadArray<uint32_t>();
+    if (!reader.IsValid() ||
+        ((materialIndex >= m_materials.size()) && (materialIndex != UINT32_MAX)) ||
+        ((mesh->m_indexType != VK_INDEX_TYPE_UINT16) && (mesh->m_indexType != VK_INDEX_TYPE_UINT32)) ||
+        (uploadData.vertices.size() != size_t(mesh->m_vertexCount) * mesh->m_vertexStride) ||
+        (uploadData.indexData.size() < mesh->m_indices.size() * mesh->GetIndexSize()) ||
+        (mesh->m_hasPosition && (mesh->m_positions.size() != mesh->m_vertexCount)) ||
+        (mesh->m_meshletBounds.size() != mesh->m_meshlets.size()))
+    {
+        return false;
+    }
+    mesh->m_material = (materialIndex != UINT32_MAX) ? m_materials[materialIndex] : nullptr;
+    mesh->m_meshletSpheres.Resize(mesh->m_meshlets.size());
+    for (size_t i = 0; i < mesh->m_meshlets.size(); ++i)
+    {
+        mesh->m_meshletSpheres.Set(i, Sphere{ mesh->m_meshletBounds[i].center, mesh->m_meshletBounds[i].radius });
+    }
+    return true;
+}
+
+Ref<VulkanTexture> VulkanAsset::ReadCachedTexture(BinaryReader& reader)
+{
+    std::string path;
+    if ((reader.Read<uint8_t>() == 0) || !reader.ReadString(path))
+    {
+        return nullptr;
+    }
+    Ref<VulkanTexture> texture = CreateTexture(m_baseDir / (const char8_t*)path.c_str());
+    texture->mapping = static_cast<TextureMapping>(reader.Read<uint32_t>());
+    texture->texCoordIndex = reader.Read<uint32_t>();
+    texture->blend = reader.Read<float>();
+    texture->op = static_cast<TextureOp>(reader.Read<uint32_t>());
+    texture->addressModeU = static_cast<VkSamplerAddressMode>(reader.Read<uint32_t>());
+    texture->addressModeV = static_cast<VkSamplerAddressMode>(reader.Read<uint32_t>());
+    texture->addressModeW = static_cast<VkSamplerAddressMode>(reader.Read<uint32_t>());
+    return texture;
+}
+
+static void GatherNodesPreorder(const VulkanSceneNode* node, uint32_t parentIndex,
+    std::vector<const VulkanSceneNode*>& nodes, std::vector<uint32_t>& parents)
+{
+    const uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(node);
+    parents.push_back(parentIndex);
+    for (const Ref<VulkanSceneNode>& child : node->m_children)
+    {
+        GatherNodesPreorder(child.get(), nodeIndex, nodes, parents);
+    }
+}
+
+bool VulkanAsset::SaveCache(const Path& cachePath, const VulkanSceneCacheHeader& key,
+    const std::vector<MeshBuildData>& buildData)
+{
+    BinaryWriter writer;
+    VulkanSceneCacheHeader header = key;
+    header.meshCount = static_cast<uint32_t>(m_meshes.size());
+    writer.Write(header);
+
+    std::unordered_map<const VulkanMaterial*, uint32_t> materialIndices;
+    writer.Write<uint32_t>(static_cast<uint32_t>(m_materials.size()));
+    for (const Ref<VulkanMaterial>& material : m_materials)
+    {
+        materialIndices[material.get()] = static_cast<uint32_t>(materialIndices.size());
+        writer.WriteString(material->m_name);
+        writer.Write(material->m_baseColor);
+        writer.Write(material->m_opacity);
+        writer.Write(material->m_metallic);
+        writer.Write(material->m_roughness);
+        writer.Write(material->m_emissiveColor);
+        writer.Write(material->m_emissiveIntensity);
+        writer.Write(material->m_ambientColor);
+        writer.Write(material->m_ambientWeight);
+        WriteCachedTexture(writer, material->m_displacementTexture.get());
+        WriteCachedTexture(writer, material->m_normalTexture.get());
+        WriteCachedTexture(writer, material->m_baseColorTexture.get());
+        WriteCachedTexture(writer, material->m_metallicRoughnessTexture.get());
+        WriteCachedTexture(writer, material->m_emissiveTexture.get());
+        WriteCachedTexture(writer, material->m_ambientTexture.get());
+    }
+    writer.WriteArray(m_lights);
+
+    // The mesh records and their table are after the nodes.
+    std::vector<const VulkanSceneNode*> nodes;
+    std::vector<uint32_t> parents;
+    GatherNodesPreorder(m_rootNode.get(), UINT32_MAX, nodes, parents);
+    std::unordered_map<const VulkanMesh*, uint32_t> meshIndices;
+    for (size_t i = 0; i < m_meshes.size(); ++i)
+    {
+        meshIndices[m_meshes[i].get()] = static_cast<uint32_t>(i);
+    }
+    writer.Write<uint32_t>(static_cast<uint32_t>(nodes.size()));
+    std::vector<uint32_t> nodeMeshIndices;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        writer.WriteString(nodes[i]->m_name);
+        writer.Write(nodes[i]->m_transform);
+        writer.Write<uint32_t>(parents[i]);
+        nodeMeshIndices.clear();
+        for (const Ref<VulkanMesh>& mesh : nodes[i]->m_meshes)
+        {
+            nodeMeshIndices.push_back(meshIndices.at(mesh.get()));
+        }
+        writer.WriteArray(nodeMeshIndices);
+    }
+
+    std::vector<uint64_t> meshOffsets(m_meshes.size());
+    for (size_t i = 0; i < m_meshes.size(); ++i)
+    {
+        writer.Align(BinaryWriter::ArrayAlignment);
+        meshOffsets[i] = writer.GetSize();
+        auto material = materialIndices.find(m_meshes[i]->m_material.get());
+        WriteCachedMesh(writer, m_meshes[i].get(),
+            (material != materialIndices.end()) ? material->second : UINT32_MAX, buildData[i]);
+    }
+    header.meshTableOffset = writer.GetSize();
+    writer.WriteArray(meshOffsets);
+    writer.WriteAt(0, header);
+    return writer.SaveToFile(cachePath);
+}
+
+void VulkanAsset::WriteCachedMesh(BinaryWriter& writer, const VulkanMesh* mesh, uint32_t materialIndex,
+    const MeshBuildData& buildData)
+{
+    writer.WriteString(mesh->m_name);
+    writer.Write<uint32_t>(materialIndex);
+    writer.Write<uint8_t>(mesh->m_hasPosition);
+    writer.Write<uint8_t>(mesh->m_hasNormal);
+    writer.Write<uint8_t>(mesh->m_hasTangent);
+    writer.Write<uint8_t>(mesh->m_hasColor);
+    writer.Write<uint32_t>(mesh->m_numUVChannels);
+    writer.Write<uint32_t>(mesh->m_vertexCount);
+    writer.Write(mesh->m_positionOffset);
+    writer.Write(mesh->m_positionScale);
+    writer.Write(mesh->m_aabb.m_minCorner);
+    writer.Write(mesh->m_aabb.m_maxCorner);
+    writer.Write<uint32_t>(static_cast<uint32_t>(mesh->m_indexType));
+    writer.WriteArray(mesh->m_indices);
+    writer.WriteArray(mesh->m_lods);
+    writer.WriteArray(mesh->m_meshlets);
+    writer.WriteArray(mesh->m_meshletBounds);
+    writer.WriteArray(mesh->m_positions);
+    writer.WriteArray(buildData.vertices);
+    writer.WriteArray(buildData.indexData);
+    writer.WriteArray(buildData.meshletVertices);
+    writer.WriteArray(buildData.meshletTriangles);
+}
+
+void VulkanAsset::WriteCachedTexture(BinaryWriter& writer, const VulkanTexture* texture)
+{
+    writer.Write<uint8_t>(texture ? 1 : 0);
+    if (!texture)
+    {
+        return;
+    }
+    // Relative to the asset, so that the asset can be moved with its cache.
+    Path path = texture->filePath.lexically_relative(m_baseDir);
+    if (path.empty())
+    {
+        path = texture->filePath;
+    }
+    writer.WriteString((const char*)path.u8string().c_str());
+    writer.Write<uint32_t>(texture->mapping);
+    writer.Write<uint32_t>(texture->texCoordIndex);
+    writer.Write<float>(texture->blend);
+    writer.Write<uint32_t>(texture->op);
+    writer.Write<uint32_t>(texture->addressModeU);
+    writer.Write<uint32_t>(texture->addressModeV);
+    writer.Write<uint32_t>(texture->addressModeW);
+}
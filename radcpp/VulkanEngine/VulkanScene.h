@@ -3,7 +3,12 @@
 
 #include "VulkanCore.h"
 #include "VulkanCamera.h"
+#include "VulkanTextureCache.h"
+#include "VulkanGeometryArena.h"
 #include "radcpp/Common/Geometry.h"
+#include "radcpp/Common/BVH.h"
+#include "radcpp/Common/MeshProcessing.h"
+#include "radcpp/Common/TransformHierarchy.h"
 
 struct VulkanLight
 {
@@ -33,22 +38,94 @@ class VulkanMaterial;
 
 struct VulkanTexture;
 
+// A mesh placed in the world by a scene node.
+struct VulkanMeshInstance
+{
+    VulkanSceneNode* m_node;
+    VulkanMesh* m_mesh;
+    glm::mat4 m_transform; // mesh to world
+    glm::mat4 m_inverseTransform; // world to mesh
+    glm::mat3 m_normalTransform; // inverse transpose of m_transform, for normals
+    BoundingBox m_aabb; // in world space
+};
+
+struct VulkanSceneHit
+{
+    uint32_t m_instanceIndex = UINT32_MAX;
+    RayHit m_hit; // m_primIndex is the triangle index in the mesh
+    glm::vec3 m_position; // in world space
+
+    bool IsValid() const { return (m_instanceIndex != UINT32_MAX); }
+};
+
+enum class VulkanVertexFormat
+{
+    // 32-bit floats: vec3 position, vec3 normal, vec4 tangent, vec4 color, vec2 per UV channel.
+    Float,
+    // unorm16x4 position relative to the bounding box, octahedral snorm16x2 normal, octahedral tangent
+    // with the handness in 32 bits, unorm8x4 color, and half float UVs.
+    Compact,
+};
+
 class VulkanScene : public RefCounted<VulkanScene>
 {
 public:
-    VulkanScene(Ref<VulkanDevice> device);
+    // Scenes can share a texture cache (to share the images of their imports) and a geometry arena
+    // (to draw their meshes with the same buffers); new ones are created if null.
+    VulkanScene(Ref<VulkanDevice> device, Ref<VulkanTextureCache> textureCache = nullptr,
+        Ref<VulkanGeometryArena> geometryArena = nullptr);
     ~VulkanScene();
 
     bool Import(const Path& filePath);
     BoundingBox GetBoundingBox() const;
 
+    // Flatten the node hierarchy, gather its mesh instances and build the BVH over their world bounding boxes.
+    void BuildInstanceBVH();
+    // Update the world transforms of the nodes changed by VulkanSceneNode::SetTransform, then the instances
+    // of these nodes and the BVH nodes above them (the hierarchy must not change). Does nothing if no node changed.
+    void RefitInstanceBVH();
+
+    // Ray queries against the triangles of the mesh instances, in world space.
+    bool Intersect(const Ray& ray, VulkanSceneHit& hit) const;
+    bool Occluded(const Ray& ray) const;
+    // Batch occlusion query: the rays are traced in packets of 8 on the global thread pool.
+    void Occluded(const Ray* rays, size_t rayCount, bool* occluded) const;
+
     Ref<VulkanDevice> m_device;
+    Ref<VulkanTextureCache> m_textureCache;
+    Ref<VulkanGeometryArena> m_geometryArena;
+    // If set, the images imported afterwards are streamed by mip levels: only their mip tails are uploaded
+    // by the import, and the renderer requests the higher levels by their size on screen.
+    Ref<VulkanTextureStreamer> m_textureStreamer;
+    // The vertex format of the meshes imported afterwards; Compact (quantized, about half the size) is opt-in.
+    VulkanVertexFormat m_vertexFormat = VulkanVertexFormat::Float;
+    // Cook imported assets into a binary cache next to the source file (<file>.radscene),
+    // and load it instead of importing again while the source and the import settings are unchanged.
+    bool m_useSceneCache = true;
     std::vector<Ref<VulkanMesh>> m_meshes;
     std::vector<Ref<VulkanMaterial>> m_materials;
     Ref<VulkanCamera> m_camera;
     std::vector<VulkanLight> m_lights;
 
     Ref<VulkanSceneNode> m_rootNode;
+    // The nodes in depth-first preorder, flattened into m_transformHierarchy by BuildInstanceBVH.
+    std::vector<VulkanSceneNode*> m_nodes;
+    TransformHierarchy m_transformHierarchy;
+
+    // Update the world space data of the instances [begin, end) from m_transform.
+    void UpdateInstances(size_t begin, size_t end);
+
+    std::vector<VulkanMeshInstance> m_instances;
+    // The instances of m_nodes[i] are m_instances[m_nodeInstanceOffsets[i], m_nodeInstanceOffsets[i + 1]):
+    // as the nodes are in preorder, the instances of a subtree are contiguous too.
+    std::vector<uint32_t> m_nodeInstanceOffsets;
+    AABBArray m_instanceBoxes; // m_instances[i].m_aabb in SoA form, for batch culling
+    BVH m_instanceBVH;
+    // Scratch of UpdateInstances() and RefitInstanceBVH(), kept to not allocate every frame.
+    std::vector<glm::mat4> m_scratchTransforms;
+    std::vector<glm::mat3> m_scratchNormalTransforms;
+    AABBArray m_scratchBoxes;
+    std::vector<uint32_t> m_movedInstances;
 
 }; // class VulkanScene
 
@@ -60,6 +137,11 @@ public:
 
     void AddChild(Ref<VulkanSceneNode> childNode);
 
+    // Set m_transform, and mark the node dirty in the flattened hierarchy.
+    void SetTransform(const glm::mat4& transform);
+    // The transformation to world space: from the flattened hierarchy once the scene is built,
+    // otherwise by walking the parents.
+    glm::mat4 GetWorldTransform() const;
     BoundingBox GetBoundingBox() const;
 
     std::string m_name;
@@ -68,10 +150,24 @@ public:
     std::vector<Ref<VulkanSceneNode>> m_children;
 
     glm::mat4 m_transform; // the transformation relative to the node's parent
+    // The scene that flattened the node, and the index of the node in its m_nodes and m_transformHierarchy.
+    VulkanScene* m_scene = nullptr;
+    uint32_t m_hierarchyIndex = TransformHierarchy::InvalidIndex;
 
     std::vector<Ref<VulkanMesh>> m_meshes;
 }; // class VulkanSceneNode
 
+// A level of detail of a mesh: a range of its index buffer, indexing the vertices of the full detail.
+struct VulkanMeshLOD
+{
+    uint32_t m_indexOffset;
+    uint32_t m_indexCount;
+    // The square root of the largest quadric error of the collapses (Quadric::Evaluate in MeshProcessing.cpp):
+    // the RMS distance of a collapsed vertex to the planes of its original triangles, weighted by their areas,
+    // in mesh space. An estimate of the simplification error, not a bound of the deviation from the full detail.
+    float m_error;
+};
+
 class VulkanMesh : public RefCounted<VulkanMesh>
 {
 public:
@@ -80,32 +176,69 @@ public:
 
     uint32_t GetVertexCount() const { return m_vertexCount; }
     uint32_t GetIndexCount() const { return static_cast<uint32_t>(m_indices.size()); }
+    uint32_t GetLODCount() const { return static_cast<uint32_t>(m_lods.size()); }
+    uint32_t GetIndexSize() const { return (m_indexType == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t); }
+    // The stride of the attributes present in the format.
+    uint32_t GetVertexStride(VulkanVertexFormat format) const;
+
+    // Build the BVH over the triangles (in mesh space).
+    void BuildBVH(const BVHBuildSettings& settings = {});
+    // Ray queries in mesh space, using the watertight test for single rays.
+    bool IntersectClosest(Ray& ray, RayHit& hit) const;
+    bool IntersectAny(const Ray& ray) const;
+    uint32_t IntersectAny(RayPacket8& packet, uint32_t activeMask) const;
 
     VulkanScene* m_scene;
     std::string m_name;
     std::vector<uint32_t> m_indices;
-
-    Ref<VulkanBuffer> m_vertexBuffer;
-    Ref<VulkanBuffer> m_indexBuffer;
-
+    // m_lods[0] is the full detail (m_indices), followed by coarser ones stored after it in the index buffer.
+    std::vector<VulkanMeshLOD> m_lods;
+    // Clusters of the full detail triangles; meshlet i covers the triangles
+    // [m_meshlets[i].triangleOffset, + triangleCount) of m_indices.
+    std::vector<Meshlet> m_meshlets;
+    std::vector<MeshletBounds> m_meshletBounds;
+    SphereArray m_meshletSpheres; // the bounding spheres in SoA form, for batch culling
+    // CPU copy of the vertex positions, for the triangle BVH and queries.
+    std::vector<glm::vec3> m_positions;
+    BVH m_bvh;
+
+    // Ranges of the geometry arena: the vertices at a multiple of the stride, and the indices (null if none)
+    // at a multiple of the index size, so that the meshes of a buffer are drawn without rebinding it.
+    Ref<VulkanGeometryAllocation> m_vertexAllocation;
+    Ref<VulkanGeometryAllocation> m_indexAllocation;
+    // The offsets to draw with, in vertices and in indices.
+    int32_t GetVertexOffset() const { return static_cast<int32_t>(m_vertexAllocation->GetOffset() / m_vertexStride); }
+    uint32_t GetFirstIndex() const { return static_cast<uint32_t>(m_indexAllocation->GetOffset() / GetIndexSize()); }
+    // Storage buffer ranges of the meshlets for GPU culling: Meshlet[], MeshletBounds[],
+    // uint32_t[] vertex indices, and uint32_t[] packed local triangles.
+    Ref<VulkanGeometryAllocation> m_meshletAllocation;
+    Ref<VulkanGeometryAllocation> m_meshletBoundsAllocation;
+    Ref<VulkanGeometryAllocation> m_meshletVertexAllocation;
+    Ref<VulkanGeometryAllocation> m_meshletTriangleAllocation;
+
+    VulkanVertexFormat m_vertexFormat = VulkanVertexFormat::Float;
     uint32_t        m_vertexCount = 0;
     uint32_t        m_vertexStride;
-    VkDeviceSize    m_vertexBufferOffset = 0;
+    // Compact positions are decoded as m_positionOffset + m_positionScale * unorm16.
+    glm::vec3       m_positionOffset = { 0, 0, 0 };
+    glm::vec3       m_positionScale = { 1, 1, 1 };
     VkDeviceSize    m_vertexBufferSize = 0;
-    VkDeviceSize    m_indexBufferOffset = 0;
+    // 16-bit if the mesh has fewer than 65535 vertices.
+    VkIndexType     m_indexType = VK_INDEX_TYPE_UINT32;
     VkDeviceSize    m_indexBufferSize = 0;
 
     Ref<VulkanMaterial> m_material;
 
-    bool m_hasPosition;
-    bool m_hasNormal;
-    bool m_hasTangent;
-    bool m_hasUV;
-    uint32_t m_numUVChannels;
-    bool m_hasColor;
+    bool m_hasPosition = false;
+    bool m_hasNormal = false;
+    bool m_hasTangent = false;
+    bool m_hasUV = false;
+    uint32_t m_numUVChannels = 0;
+    bool m_hasColor = false;
 
-    Ref<VulkanDescriptorSet> m_descriptorSet;
     Ref<VulkanGraphicsPipeline> m_pipeline;
+    // The state part of the draw sort key, set by the renderer.
+    uint64_t m_sortKey = 0;
 
     BoundingBox m_aabb = {};
 
@@ -135,7 +268,9 @@ enum TextureOp
 struct VulkanTexture : public RefCounted<VulkanTexture>
 {
     Path filePath;
+    // The resident image of streamedImage if streamed, updated by the renderer as levels are streamed.
     Ref<VulkanImage> image;
+    Ref<VulkanStreamedImage> streamedImage;
     TextureMapping mapping = TextureMappingUV;
     uint32_t texCoordIndex = 0;
     float blend = 0.0f;
@@ -174,6 +309,9 @@ public:
     float m_ambientWeight = 1.0f;
     Ref<VulkanTexture> m_ambientTexture;
 
+    // Set by the renderer: the textures bound, shared by the meshes of the material.
+    Ref<VulkanDescriptorSet> m_descriptorSet;
+
 }; // class VulkanMaterial
 
 #endif // VULKAN_SCENE_H
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include "VulkanTextureCache.h"
+#include "radcpp/Common/Hash.h"
+
+size_t VulkanTextureCache::KeyHasher::operator()(const Key& key) const
+{
+    return static_cast<size_t>(HashCombine64(HashCombine64(key.contentHash, key.contentSize), key.options));
+}
+
+VulkanTextureCache::VulkanTextureCache(VkDeviceSize budget) :
+    m_budget(budget)
+{
+}
+
+VulkanTextureCache::~VulkanTextureCache()
+{
+}
+
+bool VulkanTextureCache::GetKey(const Path& filePath, uint32_t options, Key& key)
+{
+    std::error_code ec;
+    const FileTime lastWriteTime = std::filesystem::last_write_time(filePath, ec);
+    if (ec)
+    {
+        return false;
+    }
+    const uint64_t fileSize = std::filesystem::file_size(filePath, ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    key.contentSize = fileSize;
+    key.options = options;
+    {
+        std::lock_guard lock(m_mutex);
+        auto iter = m_fileVersions.find(filePath);
+        if ((iter != m_fileVersions.end()) &&
+            (iter->second.lastWriteTime == lastWriteTime) && (iter->second.size == fileSize))
+        {
+            key.contentHash = iter->second.contentHash;
+            return true;
+        }
+    }
+
+    // Hash without the lock, so that files are hashed in parallel.
+    MappedFile file;
+    if (!file.Open(filePath))
+    {
+        return false;
+    }
+    key.contentHash = XXHash64(file.GetData(), file.GetSize());
+    key.contentSize = file.GetSize();
+
+    std::lock_guard lock(m_mutex);
+    m_fileVersions[filePath] = { lastWriteTime, key.contentSize, key.contentHash };
+    m_stats.hashedFileCount++;
+    return true;
+}
+
+Ref<VulkanImage> VulkanTextureCache::Find(const Key& key)
+{
+    std::lock_guard lock(m_mutex);
+    Entry* entry = FindLocked(key);
+    return entry ? entry->image : nullptr;
+}
+
+Ref<VulkanStreamedImage> VulkanTextureCache::FindStreamed(const Key& key)
+{
+    std::lock_guard lock(m_mutex);
+    Entry* entry = FindLocked(key);
+    return entry ? entry->streamedImage : nullptr;
+}
+
+VulkanTextureCache::Entry* VulkanTextureCache::FindLocked(const Key& key)
+{
+    auto iter = m_entries.find(key);
+    if (iter == m_entries.end())
+    {
+        m_stats.missCount++;
+        return nullptr;
+    }
+    Entry& entry = iter->second;
+    m_lru.splice(m_lru.begin(), m_lru, entry.lruIter);
+    m_stats.hitCount++;
+    m_stats.reusedMemorySize += entry.size;
+    return &entry;
+}
+
+void VulkanTextureCache::Add(const Key& key, Ref<VulkanImage> image, VkDeviceSize size)
+{
+    std::lock_guard lock(m_mutex);
+    AddLocked(key, size).image = std::move(image);
+    TrimLocked(m_budget);
+}
+
+void VulkanTextureCache::Add(const Key& key, Ref<VulkanStreamedImage> image, VkDeviceSize size)
+{
+    std::lock_guard lock(m_mutex);
+    AddLocked(key, size).streamedImage = std::move(image);
+    TrimLocked(m_budget);
+}
+
+VulkanTextureCache::Entry& VulkanTextureCache::AddLocked(const Key& key, VkDeviceSize size)
+{
+    auto iter = m_entries.find(key);
+    if (iter != m_entries.end())
+    {
+        // Replace the image added concurrently.
+        Entry& entry = iter->second;
+        m_stats.memoryUsage -= entry.size;
+        entry.size = size;
+        m_lru.splice(m_lru.begin(), m_lru, entry.lruIter);
+        m_stats.memoryUsage += size;
+        return entry;
+    }
+    m_lru.push_front(key);
+    m_stats.memoryUsage += size;
+    return m_entries[key] = { nullptr, nullptr, size, m_lru.begin() };
+}
+
+void VulkanTextureCache::SetBudget(VkDeviceSize budget)
+{
+    std::lock_guard lock(m_mutex);
+    m_budget = budget;
+    TrimLocked(m_budget);
+}
+
+VkDeviceSize VulkanTextureCache::GetBudget() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_budget;
+}
+
+void VulkanTextureCache::Trim(VkDeviceSize budget)
+{
+    std::lock_guard lock(m_mutex);
+    TrimLocked(budget);
+}
+
+void VulkanTextureCache::TrimLocked(VkDeviceSize budget)
+{
+    // Images in use are skipped: evicting them would not free any memory.
+    auto iter = m_lru.end();
+    while ((m_stats.memoryUsage > budget) && (iter != m_lru.begin()))
+    {
+        --iter;
+        auto entryIter = m_entries.find(*iter);
+        const Entry& entry = entryIter->second;
+        if ((entry.image ? entry.image->GetRefCount() : entry.streamedImage->GetRefCount()) > 1)
+        {
+            continue;
+        }
+        m_stats.memoryUsage -= entry.size;
+        m_stats.evictionCount++;
+        m_entries.erase(entryIter);
+        iter = m_lru.erase(iter);
+    }
+}
+
+void VulkanTextureCache::Clear()
+{
+    std::lock_guard lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_fileVersions.clear();
+    m_stats.memoryUsage = 0;
+}
+
+VulkanTextureCache::Stats VulkanTextureCache::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    Stats stats = m_stats;
+    stats.entryCount = m_entries.size();
+    return stats;
+}
@@ -0,0 +1,106 @@
+#ifndef VULKAN_TEXTURE_CACHE_H
+#define VULKAN_TEXTURE_CACHE_H
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanTextureStreamer.h"
+#include "radcpp/Common/File.h"
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+// Images decoded from files, shared by the imports of all scenes on a device. They are keyed by the content
+// of the files and the decode options, so identical files under different paths share an image,
+// and importing a model again reuses its images.
+// Images no longer referenced outside the cache are kept while the memory usage is within the budget,
+// and evicted in least recently used order beyond it. All functions are thread safe.
+class VulkanTextureCache : public RefCounted<VulkanTextureCache>
+{
+public:
+    enum OptionBits : uint32_t
+    {
+        OptionMipmaps = 0x00000001,
+        OptionStreamed = 0x00000002, // the entry is a VulkanStreamedImage
+    };
+
+    struct Key
+    {
+        uint64_t contentHash;
+        uint64_t contentSize;
+        uint32_t options;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct KeyHasher
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Stats
+    {
+        uint64_t hitCount;
+        uint64_t missCount;
+        uint64_t evictionCount;
+        uint64_t hashedFileCount; // files read to compute their key
+        size_t entryCount;
+        VkDeviceSize memoryUsage; // of the cached images
+        VkDeviceSize reusedMemorySize; // of the images found, not decoded and uploaded again
+    };
+
+    VulkanTextureCache(VkDeviceSize budget = DefaultBudget);
+    ~VulkanTextureCache();
+
+    static constexpr VkDeviceSize DefaultBudget = 1024ull * 1024 * 1024;
+
+    // The key of the file content: each file is hashed once per version (its size and last write time).
+    bool GetKey(const Path& filePath, uint32_t options, Key& key);
+    // Return the image of the key and count a hit, or nullptr and count a miss.
+    Ref<VulkanImage> Find(const Key& key);
+    Ref<VulkanStreamedImage> FindStreamed(const Key& key);
+    // Add an image created from the key, of size bytes, then evict unused images if over the budget.
+    void Add(const Key& key, Ref<VulkanImage> image, VkDeviceSize size);
+    // The size of a streamed image is its CPU mip chain; its GPU memory is budgeted by its streamer.
+    void Add(const Key& key, Ref<VulkanStreamedImage> image, VkDeviceSize size);
+
+    void SetBudget(VkDeviceSize budget);
+    VkDeviceSize GetBudget() const;
+    // Evict the least recently used images referenced by the cache only, until the memory usage is within the budget.
+    void Trim(VkDeviceSize budget);
+    // Remove all the images; the ones still referenced elsewhere stay alive.
+    void Clear();
+
+    Stats GetStats() const;
+
+private:
+    struct Entry
+    {
+        Ref<VulkanImage> image;
+        Ref<VulkanStreamedImage> streamedImage; // instead of image if OptionStreamed
+        VkDeviceSize size;
+        std::list<Key>::iterator lruIter;
+    };
+
+    Entry* FindLocked(const Key& key);
+    // Insert or replace the entry of the key, as the most recently used.
+    Entry& AddLocked(const Key& key, VkDeviceSize size);
+    void TrimLocked(VkDeviceSize budget);
+
+    struct FileVersion
+    {
+        FileTime lastWriteTime;
+        uint64_t size;
+        uint64_t contentHash;
+    };
+
+    mutable std::mutex m_mutex;
+    VkDeviceSize m_budget;
+    std::unordered_map<Key, Entry, KeyHasher> m_entries;
+    std::list<Key> m_lru; // the most recently used first
+    std::map<Path, FileVersion> m_fileVersions;
+    Stats m_stats = {};
+
+}; // class VulkanTextureCache
+
+#endif // VULKAN_TEXTURE_CACHE_H
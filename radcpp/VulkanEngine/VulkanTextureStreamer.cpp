@@ -0,0 +1,285 @@
+#include "VulkanTextureStreamer.h"
+
+VulkanStreamedImage::VulkanStreamedImage(Ref<VulkanTextureStreamer> streamer, VulkanImageData&& data) :
+    m_streamer(std::move(streamer)),
+    m_data(std::move(data))
+{
+    m_mipOffsets.resize(m_data.mipLevels + 1);
+    for (uint32_t level = 0; level <= m_data.mipLevels; ++level)
+    {
+        m_mipOffsets[level] = m_data.GetMipOffset(level);
+    }
+
+    m_tailMip = 0;
+    while ((m_tailMip + 1 < m_data.mipLevels) &&
+        (std::max(m_data.width, m_data.height) >> m_tailMip > VulkanTextureStreamer::MipTailSize))
+    {
+        ++m_tailMip;
+    }
+    m_residentMip = m_tailMip;
+    m_targetMip = m_tailMip;
+    m_wantedMip = m_tailMip;
+}
+
+VulkanStreamedImage::~VulkanStreamedImage()
+{
+    m_streamer->Unregister(this);
+}
+
+// Create a GPU image of the levels [baseMip, mipLevels).
+static Ref<VulkanImage> CreateMipChainImage(VulkanDevice* device, const VulkanImageData& data, uint32_t baseMip)
+{
+    VulkanImageData chainData = {};
+    chainData.format = data.format;
+    chainData.width = std::max<uint32_t>(data.width >> baseMip, 1);
+    chainData.height = std::max<uint32_t>(data.height >> baseMip, 1);
+    chainData.mipLevels = data.mipLevels - baseMip;
+    return VulkanImage::CreateImage2D(device, chainData);
+}
+
+VulkanTextureStreamer::VulkanTextureStreamer(Ref<VulkanDevice> device, VkDeviceSize budget) :
+    m_device(std::move(device)),
+    m_budget(budget)
+{
+}
+
+VulkanTextureStreamer::~VulkanTextureStreamer()
+{
+    for (PendingUpload& upload : m_pendingUploads)
+    {
+        m_device->GetUploadContext()->Wait(upload.token);
+    }
+}
+
+Ref<VulkanStreamedImage> VulkanTextureStreamer::Create(VulkanImageData&& data)
+{
+    Ref<VulkanStreamedImage> image = MakeRefCounted<VulkanStreamedImage>(this, std::move(data));
+    image->m_image = CreateMipChainImage(m_device.get(), image->m_data, image->m_residentMip);
+
+    std::lock_guard lock(m_mutex);
+    m_images.push_back(image.get());
+    m_stats.residentMemory += image->GetMipChainSize(image->m_residentMip);
+    m_stats.tailMemory += image->GetMipChainSize(image->m_tailMip);
+    return image;
+}
+
+void VulkanTextureStreamer::Unregister(VulkanStreamedImage* image)
+{
+    std::lock_guard lock(m_mutex);
+    m_images.erase(std::find(m_images.begin(), m_images.end(), image));
+    for (PendingUpload& upload : m_pendingUploads)
+    {
+        for (PendingImage& pendingImage : upload.images)
+        {
+            if (pendingImage.image == image)
+            {
+                pendingImage.image = nullptr;
+            }
+        }
+    }
+    m_stats.residentMemory -= image->GetMipChainSize(image->m_targetMip);
+    m_stats.tailMemory -= image->GetMipChainSize(image->m_tailMip);
+}
+
+void VulkanTextureStreamer::Request(VulkanStreamedImage* image, float size)
+{
+    image->m_requestedSize = std::max(image->m_requestedSize, size);
+}
+
+uint32_t VulkanTextureStreamer::GetWantedMip(const VulkanStreamedImage* image, float size) const
+{
+    // One texel per pixel at the level wanted; the texture is assumed to cover the mesh once.
+    const float maxSide = float(std::max(image->m_data.width, image->m_data.height));
+    if (size >= maxSide)
+    {
+        return 0;
+    }
+    if (size <= 1.0f)
+    {
+        return image->m_tailMip;
+    }
+    const uint32_t mip = static_cast<uint32_t>(std::floor(std::log2(maxSide / size)));
+    return std::min(mip, image->m_tailMip);
+}
+
+uint32_t VulkanTextureStreamer::Update()
+{
+    std::lock_guard lock(m_mutex);
+    ++m_frame;
+    const uint32_t replacedCount = CompleteUploads();
+
+    std::vector<VulkanStreamedImage*> candidates;
+    for (VulkanStreamedImage* image : m_images)
+    {
+        if (image->m_requestedSize > 0.0f)
+        {
+            image->m_priority = image->m_requestedSize;
+            image->m_wantedMip = GetWantedMip(image, image->m_requestedSize);
+            image->m_lastRequestFrame = m_frame;
+        }
+        else
+        {
+            // Not visible: the levels are kept while they fit, but evicted first.
+            image->m_priority = 0.0f;
+            if (m_frame - image->m_lastRequestFrame > IdleFrameCount)
+            {
+                image->m_wantedMip = image->m_tailMip;
+            }
+        }
+        image->m_requestedSize = 0.0f;
+        if (!image->m_pending && (image->m_wantedMip < image->m_residentMip))
+        {
+            candidates.push_back(image);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](const VulkanStreamedImage* a, const VulkanStreamedImage* b) { return a->m_priority > b->m_priority; });
+
+    // Each change uploads the levels [mip, mipLevels) to a new image.
+    std::vector<std::pair<VulkanStreamedImage*, uint32_t>> changes;
+    VkDeviceSize uploadSize = 0;
+    for (VulkanStreamedImage* image : candidates)
+    {
+        if (image->m_pending)
+        {
+            continue; // shrunk to make room for a higher priority image
+        }
+        // The highest level within the upload limit, at least one level up.
+        uint32_t mip = image->m_wantedMip;
+        while ((mip + 1 < image->m_residentMip) && (uploadSize + image->GetMipChainSize(mip) > m_uploadLimit))
+        {
+            ++mip;
+        }
+        const VkDeviceSize chainSize = image->GetMipChainSize(mip);
+        if ((uploadSize > 0) && (uploadSize + chainSize > m_uploadLimit))
+        {
+            break;
+        }
+        const VkDeviceSize growth = chainSize - image->GetMipChainSize(image->m_residentMip);
+        const size_t changeCount = changes.size();
+        if (!MakeRoom(growth, image->m_priority, changes))
+        {
+            continue;
+        }
+        for (size_t i = changeCount; i < changes.size(); ++i)
+        {
+            uploadSize += changes[i].first->GetMipChainSize(changes[i].second);
+        }
+        m_stats.streamedInCount += image->m_residentMip - mip;
+        m_stats.residentMemory += growth;
+        image->m_targetMip = mip;
+        image->m_pending = true;
+        changes.emplace_back(image, mip);
+        uploadSize += chainSize;
+    }
+
+    Upload(changes);
+    m_stats.uploadSize = uploadSize;
+    return replacedCount;
+}
+
+bool VulkanTextureStreamer::MakeRoom(VkDeviceSize size, float priority,
+    std::vector<std::pair<VulkanStreamedImage*, uint32_t>>& changes)
+{
+    while (m_stats.residentMemory + size > m_budget)
+    {
+        // Evict the levels not wanted anymore first, then the lowest priority ones.
+        auto evictionOrder = [](const VulkanStreamedImage* image)
+            {
+                return std::make_pair(image->m_residentMip >= image->m_wantedMip, image->m_priority);
+            };
+        VulkanStreamedImage* victim = nullptr;
+        for (VulkanStreamedImage* image : m_images)
+        {
+            if (image->m_pending || (image->m_residentMip >= image->m_tailMip))
+            {
+                continue;
+            }
+            const bool unwanted = (image->m_residentMip < image->m_wantedMip);
+            if (!unwanted && (image->m_priority >= priority))
+            {
+                continue;
+            }
+            if ((victim == nullptr) || (evictionOrder(image) < evictionOrder(victim)))
+            {
+                victim = image;
+            }
+        }
+        if (victim == nullptr)
+        {
+            return false;
+        }
+        const uint32_t mip = (victim->m_residentMip < victim->m_wantedMip) ?
+            victim->m_wantedMip : (victim->m_residentMip + 1);
+        m_stats.evictedCount += mip - victim->m_residentMip;
+        m_stats.residentMemory -= victim->GetMipChainSize(victim->m_residentMip) - victim->GetMipChainSize(mip);
+        victim->m_targetMip = mip;
+        victim->m_pending = true;
+        changes.emplace_back(victim, mip);
+    }
+    return true;
+}
+
+void VulkanTextureStreamer::Upload(const std::vector<std::pair<VulkanStreamedImage*, uint32_t>>& changes)
+{
+    if (changes.empty())
+    {
+        return;
+    }
+
+    VulkanUploadContext* uploadContext = m_device->GetUploadContext();
+    PendingUpload upload;
+    for (auto [image, mip] : changes)
+    {
+        Ref<VulkanImage> gpuImage = CreateMipChainImage(m_device.get(), image->m_data, mip);
+        uploadContext->UploadImage2D(gpuImage.get(), image->GetMipChainData(mip), image->GetMipChainSize(mip));
+        upload.images.push_back({ image, std::move(gpuImage), mip });
+    }
+    upload.token = uploadContext->Flush();
+    m_pendingUploads.push_back(std::move(upload));
+}
+
+uint32_t VulkanTextureStreamer::CompleteUploads()
+{
+    uint32_t replacedCount = 0;
+    size_t i = 0;
+    while (i < m_pendingUploads.size())
+    {
+        PendingUpload& upload = m_pendingUploads[i];
+        if (!m_device->GetUploadContext()->IsComplete(upload.token))
+        {
+            ++i;
+            continue;
+        }
+        for (PendingImage& pendingImage : upload.images)
+        {
+            VulkanStreamedImage* image = pendingImage.image;
+            if (image == nullptr)
+            {
+                continue;
+            }
+            // The frames recorded before may still sample the replaced image.
+            m_device->Retire(std::move(image->m_image));
+            image->m_image = std::move(pendingImage.gpuImage);
+            image->m_residentMip = pendingImage.residentMip;
+            image->m_pending = false;
+            image->m_version++;
+            ++replacedCount;
+        }
+        m_pendingUploads.erase(m_pendingUploads.begin() + i);
+    }
+    return replacedCount;
+}
+
+VulkanTextureStreamer::Stats VulkanTextureStreamer::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    Stats stats = m_stats;
+    stats.imageCount = m_images.size();
+    stats.pendingCount = 0;
+    for (const PendingUpload& upload : m_pendingUploads)
+    {
+        stats.pendingCount += static_cast<uint32_t>(upload.images.size());
+    }
+    return stats;
+}
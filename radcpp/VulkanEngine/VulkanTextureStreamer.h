@@ -0,0 +1,141 @@
+#ifndef VULKAN_TEXTURE_STREAMER_H
+#define VULKAN_TEXTURE_STREAMER_H
+#pragma once
+
+#include "VulkanCore.h"
+#include <mutex>
+
+class VulkanTextureStreamer;
+
+// A 2D image streamed by mip levels: the decoded mip chain stays on the CPU, and the GPU image holds the levels
+// [residentMip, mipLevels) only. The streamer replaces the GPU image by a larger one as higher levels are
+// streamed in, or by a smaller one as they are evicted; GetVersion() changes each time it does.
+class VulkanStreamedImage : public RefCounted<VulkanStreamedImage>
+{
+public:
+    VulkanStreamedImage(Ref<VulkanTextureStreamer> streamer, VulkanImageData&& data);
+    ~VulkanStreamedImage();
+
+    VulkanImage* GetImage() const { return m_image.get(); }
+    uint32_t GetVersion() const { return m_version; }
+    uint32_t GetWidth() const { return m_data.width; }
+    uint32_t GetHeight() const { return m_data.height; }
+    uint32_t GetMipLevels() const { return m_data.mipLevels; }
+    // The first level of the GPU image, and the first level of the mip tail, resident from the creation.
+    uint32_t GetResidentMip() const { return m_residentMip; }
+    uint32_t GetTailMip() const { return m_tailMip; }
+    // The CPU data of the levels [baseMip, mipLevels), in the layout of CopyFromBuffer2D.
+    const uint8_t* GetMipChainData(uint32_t baseMip) const { return m_data.data.data() + m_mipOffsets[baseMip]; }
+    VkDeviceSize GetMipChainSize(uint32_t baseMip) const { return m_mipOffsets[m_data.mipLevels] - m_mipOffsets[baseMip]; }
+
+    // The number of Refs to the image, to find cached images no longer used elsewhere.
+    size_t GetRefCount() const { return GetUseCount(); }
+
+private:
+    friend class VulkanTextureStreamer;
+
+    Ref<VulkanTextureStreamer> m_streamer;
+    VulkanImageData m_data;
+    std::vector<size_t> m_mipOffsets; // mipLevels + 1 offsets
+    Ref<VulkanImage> m_image;
+    uint32_t m_residentMip;
+    uint32_t m_tailMip;
+    // The resident level once the upload in flight completes, counted in the resident memory of the streamer.
+    uint32_t m_targetMip;
+    uint32_t m_version = 0;
+    bool m_pending = false; // an upload of the image is in flight
+
+    // The largest size on screen (in pixels) requested since the last update, and the state derived from it.
+    float m_requestedSize = 0.0f;
+    float m_priority = 0.0f;
+    uint32_t m_wantedMip;
+    uint64_t m_lastRequestFrame = 0;
+
+}; // class VulkanStreamedImage
+
+// Streams the mip levels of images within a GPU memory budget. Images are created with their mip tail
+// (the levels of at most MipTailSize texels) resident, so that they can be drawn immediately; Request() asks
+// for the levels needed at a size on screen, and Update() uploads them by priority (the size on screen),
+// with at most the upload limit per frame, and evicts the levels of the lowest priority images when over
+// the budget. Uploads are asynchronous: the images are replaced by a later Update() once the copies completed,
+// and the replaced images are kept alive for the frames in flight.
+// Create() is thread safe; Request() and Update() must be called from the render thread.
+class VulkanTextureStreamer : public RefCounted<VulkanTextureStreamer>
+{
+public:
+    static constexpr uint32_t MipTailSize = 64;
+    static constexpr VkDeviceSize DefaultBudget = 512ull * 1024 * 1024;
+    static constexpr VkDeviceSize DefaultUploadLimit = 32ull * 1024 * 1024;
+    // The images not requested for that many frames are streamed out first.
+    static constexpr uint32_t IdleFrameCount = 120;
+
+    struct Stats
+    {
+        size_t imageCount;
+        VkDeviceSize residentMemory; // of the GPU images, including the uploads in flight
+        VkDeviceSize tailMemory; // of the mip tails, always resident
+        VkDeviceSize uploadSize; // in the last update
+        uint32_t pendingCount; // images with an upload in flight
+        uint64_t streamedInCount; // levels streamed in since the creation
+        uint64_t evictedCount; // levels evicted since the creation
+    };
+
+    // The images replaced are retired to the device, released after the frames in flight.
+    VulkanTextureStreamer(Ref<VulkanDevice> device, VkDeviceSize budget = DefaultBudget);
+    ~VulkanTextureStreamer();
+
+    // Take the decoded mip chain, and create the GPU image of the mip tail, without uploading it:
+    // upload GetMipChainData(GetResidentMip()) to GetImage() before drawing it.
+    Ref<VulkanStreamedImage> Create(VulkanImageData&& data);
+
+    // Request the levels of the image needed to draw it at size pixels on screen (the largest side);
+    // the largest request of each image counts for the next update.
+    void Request(VulkanStreamedImage* image, float size);
+    // Complete the uploads finished, then schedule the next ones by priority. Call once per frame,
+    // before recording the draws; returns the number of images replaced, whose views must be rebound.
+    uint32_t Update();
+
+    void SetBudget(VkDeviceSize budget) { m_budget = budget; }
+    VkDeviceSize GetBudget() const { return m_budget; }
+    // The bytes uploaded per update at most (a larger level is still uploaded alone).
+    void SetUploadLimit(VkDeviceSize limit) { m_uploadLimit = limit; }
+    VkDeviceSize GetUploadLimit() const { return m_uploadLimit; }
+
+    Stats GetStats() const;
+
+private:
+    friend class VulkanStreamedImage;
+    void Unregister(VulkanStreamedImage* image);
+
+    uint32_t CompleteUploads();
+    // The highest level to draw the image at size pixels on screen.
+    uint32_t GetWantedMip(const VulkanStreamedImage* image, float size) const;
+    // Evict levels of images with a priority below the given one, until size bytes more fit in the budget.
+    bool MakeRoom(VkDeviceSize size, float priority, std::vector<std::pair<VulkanStreamedImage*, uint32_t>>& changes);
+    void Upload(const std::vector<std::pair<VulkanStreamedImage*, uint32_t>>& changes);
+
+    struct PendingImage
+    {
+        VulkanStreamedImage* image; // null if released before the upload completed
+        Ref<VulkanImage> gpuImage;
+        uint32_t residentMip;
+    };
+    struct PendingUpload
+    {
+        VulkanUploadToken token; // of the upload context of the device
+        std::vector<PendingImage> images;
+    };
+
+    Ref<VulkanDevice> m_device;
+    VkDeviceSize m_budget;
+    VkDeviceSize m_uploadLimit = DefaultUploadLimit;
+
+    mutable std::mutex m_mutex;
+    std::vector<VulkanStreamedImage*> m_images;
+    std::vector<PendingUpload> m_pendingUploads;
+    uint64_t m_frame = 0;
+    Stats m_stats = {};
+
+}; // class VulkanTextureStreamer
+
+#endif // VULKAN_TEXTURE_STREAMER_H
@@ -0,0 +1,139 @@
+#include "VulkanUniformAllocator.h"
+
+VulkanUniformAllocator::VulkanUniformAllocator(Ref<VulkanDevice> device, VkDeviceSize ringSize) :
+    m_device(std::move(device))
+{
+    m_alignment = m_device->GetPhysicalDevice()->GetProperties().limits.minUniformBufferOffsetAlignment;
+    // The ring positions stay aligned across the wraps.
+    m_minRingSize = RoundUpToMultiple(std::max(ringSize, m_alignment), m_alignment);
+}
+
+VulkanUniformAllocator::~VulkanUniformAllocator()
+{
+    // The frames in flight may still read the blocks.
+    m_device->Retire(std::move(m_ring));
+    for (Ref<VulkanUniformBlock>& block : m_overflowBlocks)
+    {
+        m_device->Retire(std::move(block));
+    }
+}
+
+void VulkanUniformAllocator::BeginFrame()
+{
+    bool overflowed = false;
+    if (m_frameBegun)
+    {
+        // The last frame is submitted, after the submissions before it: its ring space and its overflow blocks
+        // are released once the last serial submitted completes.
+        m_pendingFrames.push_back({ m_device->GetSubmittedSerial(), m_ringHead });
+        overflowed = !m_overflowBlocks.empty();
+        m_stats.frameSize = m_frameSize;
+        m_stats.peakFrameSize = std::max(m_stats.peakFrameSize, m_frameSize);
+        m_stats.overflowBlockCount = static_cast<uint32_t>(m_overflowBlocks.size());
+        if (overflowed)
+        {
+            m_stats.overflowFrameCount++;
+        }
+        for (Ref<VulkanUniformBlock>& block : m_overflowBlocks)
+        {
+            m_device->Retire(std::move(block));
+        }
+        m_overflowBlocks.clear();
+    }
+    m_frameBegun = true;
+    m_frameSize = 0;
+    m_overflowOffset = 0;
+    m_frameOverflowSize = 0;
+
+    while (!m_pendingFrames.empty() && m_device->IsSerialComplete(m_pendingFrames.front().serial))
+    {
+        m_ringTail = m_pendingFrames.front().ringEnd;
+        m_pendingFrames.pop_front();
+    }
+
+    if (!m_ring)
+    {
+        ResizeRing(m_minRingSize);
+    }
+    else if (overflowed)
+    {
+        // At least double: the high-water mark does not count the space skipped by the wraps.
+        ResizeRing(std::max(RoundUpToPow2(m_intervalPeakInUseSize), 2 * m_ring->m_size));
+    }
+    else if (++m_intervalFrameCount >= ShrinkInterval)
+    {
+        const VkDeviceSize size = std::max(RoundUpToPow2(m_intervalPeakInUseSize), m_minRingSize);
+        if (4 * size <= m_ring->m_size)
+        {
+            ResizeRing(size);
+        }
+        m_intervalPeakInUseSize = 0;
+        m_intervalFrameCount = 0;
+    }
+    m_stats.inUseSize = m_ringHead - m_ringTail;
+}
+
+VulkanUniformAllocation VulkanUniformAllocator::Allocate(VkDeviceSize size)
+{
+    assert(m_ring && "BeginFrame() must be called before allocating!");
+    size = RoundUpToMultiple(size, m_alignment);
+
+    VulkanUniformAllocation allocation = {};
+    const VkDeviceSize ringSize = m_ring->m_size;
+    const VkDeviceSize ringOffset = m_ringHead % ringSize;
+    // The range is contiguous: skip the end of the ring if it does not fit before.
+    const VkDeviceSize padding = (ringOffset + size > ringSize) ? (ringSize - ringOffset) : 0;
+    if (m_ringHead + padding + size - m_ringTail <= ringSize)
+    {
+        m_ringHead += padding;
+        allocation.block = m_ring.get();
+        allocation.offset = m_ringHead % ringSize;
+        m_ringHead += size;
+    }
+    else
+    {
+        // The frames in flight fill the ring: fall back to a block of the frame.
+        if (m_overflowBlocks.empty() || (m_overflowOffset + size > m_overflowBlocks.back()->m_size))
+        {
+            m_overflowBlocks.push_back(CreateBlock(std::max(size, ringSize)));
+            m_overflowOffset = 0;
+        }
+        allocation.block = m_overflowBlocks.back().get();
+        allocation.offset = m_overflowOffset;
+        m_overflowOffset += size;
+        m_frameOverflowSize += size;
+    }
+    allocation.data = allocation.block->m_data + allocation.offset;
+
+    m_frameSize += size;
+    m_stats.inUseSize = (m_ringHead - m_ringTail) + m_frameOverflowSize;
+    m_stats.peakInUseSize = std::max(m_stats.peakInUseSize, m_stats.inUseSize);
+    m_intervalPeakInUseSize = std::max(m_intervalPeakInUseSize, m_stats.inUseSize);
+    return allocation;
+}
+
+Ref<VulkanUniformBlock> VulkanUniformAllocator::CreateBlock(VkDeviceSize size)
+{
+    Ref<VulkanUniformBlock> block = MakeRefCounted<VulkanUniformBlock>();
+    block->m_buffer = m_device->CreateUniformBuffer(size, true);
+    block->m_data = (uint8_t*)block->m_buffer->GetPersistentMappedAddr();
+    block->m_size = size;
+    return block;
+}
+
+void VulkanUniformAllocator::ResizeRing(VkDeviceSize size)
+{
+    // The frames in flight may still read the ring replaced; the new one starts empty.
+    if (m_ring)
+    {
+        m_device->Retire(std::move(m_ring));
+        m_stats.resizeCount++;
+    }
+    m_ring = CreateBlock(size);
+    m_ringHead = 0;
+    m_ringTail = 0;
+    m_pendingFrames.clear();
+    m_intervalPeakInUseSize = 0;
+    m_intervalFrameCount = 0;
+    m_stats.ringSize = size;
+}
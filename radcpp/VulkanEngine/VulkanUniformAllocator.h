@@ -0,0 +1,96 @@
+#ifndef VULKAN_UNIFORM_ALLOCATOR_H
+#define VULKAN_UNIFORM_ALLOCATOR_H
+#pragma once
+
+#include "VulkanCore.h"
+#include <deque>
+
+// A persistently mapped uniform buffer of the allocator, bound with dynamic offsets.
+class VulkanUniformBlock : public RefCounted<VulkanUniformBlock>
+{
+public:
+    Ref<VulkanBuffer> m_buffer;
+    uint8_t* m_data = nullptr;
+    VkDeviceSize m_size = 0;
+    // Set by the user to bind the buffer; released with the block, once the frames using it complete.
+    Ref<VulkanDescriptorSet> m_descriptorSet;
+
+}; // class VulkanUniformBlock
+
+struct VulkanUniformAllocation
+{
+    VulkanUniformBlock* block = nullptr;
+    VkDeviceSize offset = 0; // in the buffer of the block: the dynamic offset to bind
+    uint8_t* data = nullptr; // the mapped address of the offset
+};
+
+// Per-frame uniform data, sub-allocated from a ring buffer shared by the frames in flight: the space of a frame
+// is reused once the submissions up to the one of the frame complete (their device serial).
+// If the frames in flight fill the ring, the allocations fall back to additional blocks, released after the frame,
+// and the ring is recreated at the next frame with the size of the high-water mark (rounded up to a power of two).
+// The ring also shrinks when the peak of a while uses a small part of it.
+// Not thread safe: allocate on the rendering thread; the ranges allocated can be written from any thread.
+class VulkanUniformAllocator : public RefCounted<VulkanUniformAllocator>
+{
+public:
+    static constexpr VkDeviceSize DefaultRingSize = 4ull * 1024 * 1024;
+    static constexpr uint32_t ShrinkInterval = 1024; // frames
+
+    struct Stats
+    {
+        VkDeviceSize ringSize;
+        VkDeviceSize frameSize; // allocated by the last frame
+        VkDeviceSize peakFrameSize;
+        VkDeviceSize inUseSize; // by the frames in flight and the last one, with the overflow blocks
+        VkDeviceSize peakInUseSize; // the high-water mark
+        uint32_t overflowBlockCount; // created by the last frame
+        uint64_t overflowFrameCount; // frames that filled the ring
+        uint32_t resizeCount; // of the ring
+    };
+
+    VulkanUniformAllocator(Ref<VulkanDevice> device, VkDeviceSize ringSize = DefaultRingSize);
+    ~VulkanUniformAllocator();
+
+    // The alignment of the offsets and the sizes allocated (minUniformBufferOffsetAlignment).
+    VkDeviceSize GetAlignment() const { return m_alignment; }
+
+    // Call once a frame, before allocating: the last frame must be submitted.
+    // Release the space of the frames completed, and resize the ring if needed.
+    void BeginFrame();
+    // size bytes valid until the frame completes; contiguous, to write arrays with a single memcpy.
+    VulkanUniformAllocation Allocate(VkDeviceSize size);
+
+    Stats GetStats() const { return m_stats; }
+
+private:
+    Ref<VulkanUniformBlock> CreateBlock(VkDeviceSize size);
+    void ResizeRing(VkDeviceSize size);
+
+    Ref<VulkanDevice> m_device;
+    VkDeviceSize m_alignment;
+    VkDeviceSize m_minRingSize;
+
+    Ref<VulkanUniformBlock> m_ring; // created by the first BeginFrame()
+    // Monotonic positions; the ring offset is position % ring size.
+    uint64_t m_ringHead = 0;
+    uint64_t m_ringTail = 0;
+    struct PendingFrame
+    {
+        uint64_t serial;
+        uint64_t ringEnd; // the ring position after the data of the frame
+    };
+    std::deque<PendingFrame> m_pendingFrames;
+
+    bool m_frameBegun = false;
+    VkDeviceSize m_frameSize = 0;
+    // The blocks the frame fell back to, when the ring is full: the last one is allocated from.
+    std::vector<Ref<VulkanUniformBlock>> m_overflowBlocks;
+    VkDeviceSize m_overflowOffset = 0;
+    VkDeviceSize m_frameOverflowSize = 0;
+    VkDeviceSize m_intervalPeakInUseSize = 0; // since the last resize, or shrink check
+    uint32_t m_intervalFrameCount = 0;
+    Stats m_stats = {};
+
+}; // class VulkanUniformAllocator
+
+#endif // VULKAN_UNIFORM_ALLOCATOR_H
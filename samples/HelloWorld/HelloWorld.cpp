@@ -88,6 +88,10 @@ void HelloWorld::OnRender()
     {
         ShowEnvironmentVariableTable();
     }
+    if (m_showStatistics)
+    {
+        ShowStatistics();
+    }
 
     if (m_cameraController)
     {
@@ -102,9 +106,14 @@ void HelloWorld::OnRender()
     std::array<VkClearValue, 2> clearValues;
     clearValues[0].color = { 0.0f, 0.0f, 0.0f, 0.0f };
     clearValues[1].depthStencil = { 1.0, 0 };
-    cmdBuffer->BeginRenderPass(m_defaultRenderPass.get(), m_defaultFramebuffers[m_swapchainImageIndex].get(), clearValues);
+    // The renderer records the scene in secondary command buffers, and the UI follows it in one too.
+    cmdBuffer->BeginRenderPass(m_defaultRenderPass.get(), m_defaultFramebuffers[m_swapchainImageIndex].get(), clearValues,
+        VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
     m_renderer->Render(deltaTime);
-    m_ui->Render(cmdBuffer);
+    VulkanCommandBuffer* uiCmdBuffer = m_renderer->BeginSecondaryCommandBuffer();
+    m_ui->Render(uiCmdBuffer);
+    uiCmdBuffer->End();
+    cmdBuffer->ExecuteCommands({ uiCmdBuffer });
     cmdBuffer->EndRenderPass();
     cmdBuffer->End();
 
@@ -206,6 +215,46 @@ void HelloWorld::OnMouseMove(const SDL_MouseMotionEvent& mouseMotion)
     }
 }
 
+void HelloWorld::OnMouseButtonDown(const SDL_MouseButtonEvent& mouseButton)
+{
+    if ((mouseButton.button == SDL_BUTTON_LEFT) && !m_cameraController && !ImGui::GetIO().WantCaptureMouse)
+    {
+        Pick(mouseButton.x, mouseButton.y);
+    }
+}
+
+void HelloWorld::Pick(int x, int y)
+{
+    if (!m_renderer || !m_renderer->GetScene())
+    {
+        return;
+    }
+    int windowWidth = 0;
+    int windowHeight = 0;
+    GetSize(&windowWidth, &windowHeight);
+    if ((windowWidth <= 0) || (windowHeight <= 0))
+    {
+        return;
+    }
+
+    VulkanScene* scene = m_renderer->GetScene();
+    Ray ray = scene->m_camera->GenerateRay(
+        (float(x) + 0.5f) / float(windowWidth),
+        (float(y) + 0.5f) / float(windowHeight));
+    VulkanSceneHit hit;
+    if (scene->Intersect(ray, hit))
+    {
+        const VulkanMeshInstance& instance = scene->m_instances[hit.m_instanceIndex];
+        LogPrint("HelloWorld", LogLevel::Info, "Picked mesh '%s' of node '%s': triangle %u at (%.3f, %.3f, %.3f), distance %.3f",
+            instance.m_mesh->m_name.c_str(), instance.m_node->m_name.c_str(), hit.m_hit.m_primIndex,
+            hit.m_position.x, hit.m_position.y, hit.m_position.z, hit.m_hit.m_t);
+    }
+    else
+    {
+        LogPrint("HelloWorld", LogLevel::Info, "Picked nothing.");
+    }
+}
+
 bool HelloWorld::Import3DFile()
 {
     Path filePath;
@@ -241,6 +290,11 @@ void HelloWorld::ShowMainMenuBar()
             if (ImGui::MenuItem("Paste", "Ctrl+V")) {}
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("View"))
+        {
+            ImGui::MenuItem("Statistics", nullptr, &m_showStatistics);
+            ImGui::EndMenu();
+        }
         if (ImGui::BeginMenu("System"))
         {
             if (ImGui::MenuItem("Environment Variables..."))
@@ -291,6 +345,56 @@ void HelloWorld::ShowMenuFile()
     }
 }
 
+void HelloWorld::ShowStatistics()
+{
+    ImGui::SetNextWindowSize(ImVec2(360, 260), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Statistics", &m_showStatistics);
+    // The stats are of the previous frame, since this frame is not rendered yet.
+    const VulkanRenderer::Stats& stats = m_renderer->GetStats();
+    ImGui::Text("Instances: %u", stats.instanceCount);
+    ImGui::Text("Visible: %u", stats.visibleCount);
+    ImGui::Text("Culled: %u", stats.culledCount);
+    ImGui::Text("Culling: %.3f ms", stats.cullTime);
+    ImGui::Text("Triangles: %u (%u with LODs off)", stats.triangleCount, stats.fullDetailTriangleCount);
+    ImGui::Text("Recording: %.3f ms, %u command buffers", stats.recordTime, stats.recordingChunkCount);
+    ImGui::Text("State commands: %u, %u redundant skipped", stats.stateCommandCount, stats.skippedStateCommandCount);
+    const VulkanUniformAllocator::Stats uniformStats = m_renderer->GetUniformAllocator()->GetStats();
+    ImGui::Text("Uniforms: %.1f KB/frame, peak %.1f KB in flight, ring %.1f MB",
+        uniformStats.frameSize / 1024.0, uniformStats.peakInUseSize / 1024.0, uniformStats.ringSize / (1024.0 * 1024.0));
+    if (uniformStats.overflowFrameCount > 0)
+    {
+        ImGui::Text("Uniform ring overflowed %llu times, resized %u times",
+            (unsigned long long)uniformStats.overflowFrameCount, uniformStats.resizeCount);
+    }
+    int recordingThreadCount = static_cast<int>(m_renderer->GetRecordingThreadCount());
+    if (ImGui::SliderInt("Recording threads", &recordingThreadCount, 1, 32))
+    {
+        m_renderer->SetRecordingThreadCount(static_cast<uint32_t>(recordingThreadCount));
+    }
+    bool lodEnabled = m_renderer->IsLODEnabled();
+    if (ImGui::Checkbox("LODs", &lodEnabled))
+    {
+        m_renderer->SetLODEnabled(lodEnabled);
+    }
+    if (stats.meshletCount > 0)
+    {
+        ImGui::Text("Meshlets: %u, frustum culled %.1f%%, back-facing %.1f%%", stats.meshletCount,
+            100.0f * stats.meshletFrustumCulledCount / stats.meshletCount,
+            100.0f * stats.meshletBackfacingCount / stats.meshletCount);
+    }
+    bool meshletCullingEnabled = m_renderer->IsMeshletCullingEnabled();
+    if (ImGui::Checkbox("Meshlet culling", &meshletCullingEnabled))
+    {
+        m_renderer->SetMeshletCullingEnabled(meshletCullingEnabled);
+    }
+    float lodErrorThreshold = m_renderer->GetLODErrorThreshold();
+    if (ImGui::SliderFloat("LOD error (pixels)", &lodErrorThreshold, 0.1f, 16.0f))
+    {
+        m_renderer->SetLODErrorThreshold(lodErrorThreshold);
+    }
+    ImGui::End();
+}
+
 void HelloWorld::ShowEnvironmentVariableTable()
 {
     ImGui::SetNextWindowSize(ImVec2(800, 600), ImGuiCond_FirstUseEver);
@@ -41,7 +41,7 @@ protected:
 
     // Mouse
     virtual void OnMouseMove(const SDL_MouseMotionEvent& mouseMotion);
-    virtual void OnMouseButtonDown(const SDL_MouseButtonEvent& mouseButton) {}
+    virtual void OnMouseButtonDown(const SDL_MouseButtonEvent& mouseButton);
     virtual void OnMouseButtonUp(const SDL_MouseButtonEvent& mouseButton) {}
     virtual void OnMouseWheel(const SDL_MouseWheelEvent& mouseWheel) {}
 
@@ -58,11 +58,16 @@ private:
     std::vector<VkRect2D> m_scissors;
 
     bool Import3DFile();
+    // Cast a ray from the camera through the window point and log the mesh hit.
+    void Pick(int x, int y);
 
     bool m_showMainMenu = true;
     void ShowMainMenuBar();
     void ShowMenuFile();
 
+    bool m_showStatistics = false;
+    void ShowStatistics();
+
     bool m_showEnvironmentVariableTable = false;
     void ShowEnvironmentVariableTable();
     std::atomic<bool> m_environmentVariableQueryReady;